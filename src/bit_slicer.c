@@ -26,9 +26,14 @@
 #endif
 
 #include "misc.h"
+#include "cpu.h"
 #include "bit_slicer.h"
 #include "version.h"
 
+#if defined (HAVE_X86_SIMD)
+#  include <immintrin.h>
+#endif
+
 #if 2 == VBI_VERSION_MINOR
 #  define VBI_PIXFMT_Y8 VBI_PIXFMT_YUV420
 #  define VBI_PIXFMT_RGB24_LE VBI_PIXFMT_RGB24
@@ -116,25 +121,36 @@ do {									\
 
 #define PAYLOAD()							\
 do {									\
-	i = bs->phase_shift; /* current bit position << 8 */		\
+	unsigned int eye = 0; /* distance of levels from tr */		\
+									\
+	++bs->n_cri_matches;						\
+									\
+	pos = bs->bit_pos; /* bit positions << 8 */			\
 	tr *= 256;							\
 	c = 0;								\
 									\
 	for (j = bs->frc_bits; j > 0; --j) {				\
+		i = *pos++;						\
 		SAMPLE (VBI3_FRC_BIT);					\
 		c = c * 2 + (raw0 >= tr);				\
-		i += bs->step; /* next bit */				\
+		eye += ABS ((int)(raw0 - tr));				\
 	}								\
 									\
-	if (c != bs->frc)						\
+	if (c != bs->frc) {						\
+		++bs->n_frc_errors;					\
 		return FALSE;						\
+	}								\
+									\
+	bs->last_thresh = tr >> 8;					\
+	bs->last_eye_opening = (0 == bs->frc_bits) ? 0 :		\
+		(eye >> 8) / bs->frc_bits;				\
 									\
 	switch (bs->endian) {						\
 	case 3: /* bitwise, lsb first */				\
 		for (j = 0; j < bs->payload; ++j) {			\
+			i = *pos++;					\
 			SAMPLE (VBI3_PAYLOAD_BIT);			\
 			c = (c >> 1) + ((raw0 >= tr) << 7);		\
-			i += bs->step;					\
 			if ((j & 7) == 7)				\
 				*buffer++ = c;				\
 		}							\
@@ -143,9 +159,9 @@ do {									\
 									\
 	case 2: /* bitwise, msb first */				\
 		for (j = 0; j < bs->payload; ++j) {			\
+			i = *pos++;					\
 			SAMPLE (VBI3_PAYLOAD_BIT);			\
 			c = c * 2 + (raw0 >= tr);			\
-			i += bs->step;					\
 			if ((j & 7) == 7)				\
 				*buffer++ = c;				\
 		}							\
@@ -155,9 +171,9 @@ do {									\
 	case 1: /* octets, lsb first */					\
 		for (j = bs->payload; j > 0; --j) {			\
 			for (k = 0, c = 0; k < 8; ++k) {		\
+				i = *pos++;				\
 				SAMPLE (VBI3_PAYLOAD_BIT);		\
 				c += (raw0 >= tr) << k;			\
-				i += bs->step;				\
 			}						\
 			*buffer++ = c;					\
 		}							\
@@ -166,9 +182,9 @@ do {									\
 	default: /* octets, msb first */				\
 		for (j = bs->payload; j > 0; --j) {			\
 			for (k = 0; k < 8; ++k) {			\
+				i = *pos++;				\
 				SAMPLE (VBI3_PAYLOAD_BIT);		\
 				c = c * 2 + (raw0 >= tr);		\
-				i += bs->step;				\
 			}						\
 			*buffer++ = c;					\
 		}							\
@@ -229,6 +245,7 @@ do {									\
 	unsigned int raw0;	/* oversampling temporary */		\
 	unsigned int raw1;						\
 	unsigned char b1;	/* previous bit */			\
+	const unsigned int *pos; /* next bit position */		\
 									\
 	thresh0 = bs->thresh;						\
 	raw_start = raw;						\
@@ -291,6 +308,345 @@ BIT_SLICER (RGB16_BE, 4, bs->thresh_frac)
 BIT_SLICER (RGB8, 8, bs->thresh_frac)
 #endif
 
+#if defined (HAVE_X86_SIMD)
+
+/* SIMD bit slicers.
+
+   The CRI search is inherently sequential because the 0/1 threshold
+   adapts after each sample. What we can do in parallel is fetching
+   the Y samples (deinterleaving YUYV) and calculating the amplitude
+   differences and oversampling points the search needs. The prepare
+   functions below do this for a block of samples at once, the search
+   itself remains in C.
+
+   The four oversampling points of a sample are linear interpolated,
+   so when the first and last point are on the same side of the
+   threshold as the previous bit there cannot be a transition within
+   the sample and we advance the clock by four steps at once.
+   Otherwise we fall back to the CRI() loop. Either way the results
+   are identical to those of bit_slicer_Y8() and bit_slicer_YUYV(). */
+
+/* Number of samples prepared at once. */
+#define SIMD_BLOCK 64
+
+/* lvl[n] = Y[n] for 0 <= n <= n_samples,
+   lvl3[n] = last oversampling point (Y[n] + 3 * Y[n + 1] + 2) / 4,
+   adiff[n] = |Y[n + 1] - Y[n]|. */
+typedef void
+simd_prepare_fn			(uint8_t *		lvl,
+				 uint8_t *		lvl3,
+				 uint8_t *		adiff,
+				 const uint8_t *	raw,
+				 unsigned int		n_samples);
+
+_vbi_inline void
+prepare_tail			(uint8_t *		lvl,
+				 uint8_t *		lvl3,
+				 uint8_t *		adiff,
+				 const uint8_t *	raw,
+				 unsigned int		bpp,
+				 unsigned int		i,
+				 unsigned int		n_samples)
+{
+	for (; i < n_samples; ++i) {
+		unsigned int y0 = raw[i * bpp];
+		unsigned int y1 = raw[(i + 1) * bpp];
+
+		lvl[i] = y0;
+		lvl3[i] = (y0 + 3 * y1 + 2) >> 2;
+		adiff[i] = ABS ((int)(y1 - y0));
+	}
+
+	lvl[n_samples] = raw[n_samples * bpp];
+}
+
+/* (y0 + 3 * y1 + 2) >> 2 of 16 bit lanes. */
+#define LVL3_EPI16(y0, y1)						\
+	_mm_srli_epi16 (_mm_add_epi16 (_mm_add_epi16 (y0, y1),		\
+				       _mm_add_epi16 (_mm_slli_epi16	\
+						      (y1, 1), two)), 2)
+#define LVL3_EPI16_256(y0, y1)						\
+	_mm256_srli_epi16 (_mm256_add_epi16				\
+			   (_mm256_add_epi16 (y0, y1),			\
+			    _mm256_add_epi16 (_mm256_slli_epi16		\
+					      (y1, 1), two)), 2)
+
+static void __attribute__ ((target ("sse2")))
+prepare_Y8_sse2			(uint8_t *		lvl,
+				 uint8_t *		lvl3,
+				 uint8_t *		adiff,
+				 const uint8_t *	raw,
+				 unsigned int		n_samples)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i two = _mm_set1_epi16 (2);
+	unsigned int i;
+
+	/* Note we read up to raw[n_samples], no further. */
+	for (i = 0; i + 16 <= n_samples; i += 16) {
+		__m128i y0, y1, lo, hi;
+
+		y0 = _mm_loadu_si128 ((const __m128i *)(raw + i));
+		y1 = _mm_loadu_si128 ((const __m128i *)(raw + i + 1));
+
+		_mm_storeu_si128 ((__m128i *)(lvl + i), y0);
+		_mm_storeu_si128 ((__m128i *)(adiff + i),
+				  _mm_or_si128 (_mm_subs_epu8 (y0, y1),
+						_mm_subs_epu8 (y1, y0)));
+
+		lo = LVL3_EPI16 (_mm_unpacklo_epi8 (y0, zero),
+				 _mm_unpacklo_epi8 (y1, zero));
+		hi = LVL3_EPI16 (_mm_unpackhi_epi8 (y0, zero),
+				 _mm_unpackhi_epi8 (y1, zero));
+		_mm_storeu_si128 ((__m128i *)(lvl3 + i),
+				  _mm_packus_epi16 (lo, hi));
+	}
+
+	prepare_tail (lvl, lvl3, adiff, raw, 1, i, n_samples);
+}
+
+static void __attribute__ ((target ("sse2")))
+prepare_YUYV_sse2		(uint8_t *		lvl,
+				 uint8_t *		lvl3,
+				 uint8_t *		adiff,
+				 const uint8_t *	raw,
+				 unsigned int		n_samples)
+{
+	const __m128i mask = _mm_set1_epi16 (0x00FF);
+	const __m128i two = _mm_set1_epi16 (2);
+	unsigned int i;
+
+	/* Note we read up to raw[n_samples * 2 - 1], no further. */
+	for (i = 0; i + 9 <= n_samples; i += 8) {
+		__m128i y0, y1, t;
+
+		y0 = _mm_and_si128 (_mm_loadu_si128
+				    ((const __m128i *)(raw + i * 2)), mask);
+		y1 = _mm_and_si128 (_mm_loadu_si128
+				    ((const __m128i *)(raw + i * 2 + 2)), mask);
+
+		_mm_storel_epi64 ((__m128i *)(lvl + i),
+				  _mm_packus_epi16 (y0, y0));
+		t = _mm_or_si128 (_mm_subs_epu16 (y0, y1),
+				  _mm_subs_epu16 (y1, y0));
+		_mm_storel_epi64 ((__m128i *)(adiff + i),
+				  _mm_packus_epi16 (t, t));
+		t = LVL3_EPI16 (y0, y1);
+		_mm_storel_epi64 ((__m128i *)(lvl3 + i),
+				  _mm_packus_epi16 (t, t));
+	}
+
+	prepare_tail (lvl, lvl3, adiff, raw, 2, i, n_samples);
+}
+
+static void __attribute__ ((target ("avx2")))
+prepare_Y8_avx2			(uint8_t *		lvl,
+				 uint8_t *		lvl3,
+				 uint8_t *		adiff,
+				 const uint8_t *	raw,
+				 unsigned int		n_samples)
+{
+	const __m256i zero = _mm256_setzero_si256 ();
+	const __m256i two = _mm256_set1_epi16 (2);
+	unsigned int i;
+
+	for (i = 0; i + 32 <= n_samples; i += 32) {
+		__m256i y0, y1, lo, hi;
+
+		y0 = _mm256_loadu_si256 ((const __m256i *)(raw + i));
+		y1 = _mm256_loadu_si256 ((const __m256i *)(raw + i + 1));
+
+		_mm256_storeu_si256 ((__m256i *)(lvl + i), y0);
+		_mm256_storeu_si256 ((__m256i *)(adiff + i),
+				     _mm256_or_si256
+				     (_mm256_subs_epu8 (y0, y1),
+				      _mm256_subs_epu8 (y1, y0)));
+
+		/* Unpack and pack operate on 128 bit lanes,
+		   so the order of samples is preserved. */
+		lo = LVL3_EPI16_256 (_mm256_unpacklo_epi8 (y0, zero),
+				     _mm256_unpacklo_epi8 (y1, zero));
+		hi = LVL3_EPI16_256 (_mm256_unpackhi_epi8 (y0, zero),
+				     _mm256_unpackhi_epi8 (y1, zero));
+		_mm256_storeu_si256 ((__m256i *)(lvl3 + i),
+				     _mm256_packus_epi16 (lo, hi));
+	}
+
+	prepare_tail (lvl, lvl3, adiff, raw, 1, i, n_samples);
+}
+
+static void __attribute__ ((target ("avx2")))
+prepare_YUYV_avx2		(uint8_t *		lvl,
+				 uint8_t *		lvl3,
+				 uint8_t *		adiff,
+				 const uint8_t *	raw,
+				 unsigned int		n_samples)
+{
+	const __m256i mask = _mm256_set1_epi16 (0x00FF);
+	const __m256i two = _mm256_set1_epi16 (2);
+	unsigned int i;
+
+#define STORE_EPI16(p, x)						\
+	_mm_storeu_si128 ((__m128i *)(p), _mm256_castsi256_si128	\
+			  (_mm256_permute4x64_epi64			\
+			   (_mm256_packus_epi16 (x, x), 0xD8)))
+
+	for (i = 0; i + 17 <= n_samples; i += 16) {
+		__m256i y0, y1, t;
+
+		y0 = _mm256_and_si256 (_mm256_loadu_si256
+				       ((const __m256i *)(raw + i * 2)),
+				       mask);
+		y1 = _mm256_and_si256 (_mm256_loadu_si256
+				       ((const __m256i *)(raw + i * 2 + 2)),
+				       mask);
+
+		STORE_EPI16 (lvl + i, y0);
+		t = _mm256_or_si256 (_mm256_subs_epu16 (y0, y1),
+				     _mm256_subs_epu16 (y1, y0));
+		STORE_EPI16 (adiff + i, t);
+		t = LVL3_EPI16_256 (y0, y1);
+		STORE_EPI16 (lvl3 + i, t);
+	}
+
+#undef STORE_EPI16
+
+	prepare_tail (lvl, lvl3, adiff, raw, 2, i, n_samples);
+}
+
+#define SIMD_CORE(prepare)						\
+do {									\
+	uint8_t lvl[SIMD_BLOCK + 1];					\
+	uint8_t lvl3[SIMD_BLOCK];					\
+	uint8_t adiff[SIMD_BLOCK];					\
+	const uint8_t *raw_start;					\
+	unsigned int i, j, k;						\
+	unsigned int n, n_left;						\
+	unsigned int cl;	/* clock */				\
+	unsigned int cl4;	/* clock increment per sample */	\
+	unsigned int thresh0;	/* old 0/1 threshold */			\
+	unsigned int tr;	/* current threshold */			\
+	unsigned int c;		/* current byte */			\
+	unsigned int t;		/* t = raw[0] * j + raw[1] * (1 - j) */	\
+	unsigned int raw0;	/* oversampling temporary */		\
+	unsigned int raw1;						\
+	unsigned char b1;	/* previous bit */			\
+	const unsigned int *pos; /* next bit position */		\
+									\
+	thresh0 = bs->thresh;						\
+	raw_start = raw;						\
+	raw += bs->skip;						\
+									\
+	cl = 0;								\
+	cl4 = bs->cri_rate * oversampling;				\
+	c = 0;								\
+	b1 = 0;								\
+									\
+	for (n_left = bs->cri_samples; n_left > 0; n_left -= n) {	\
+		n = MIN (n_left, (unsigned int) SIMD_BLOCK);		\
+		prepare (lvl, lvl3, adiff, raw, n);			\
+									\
+		for (i = 0; i < n; ++i) {				\
+			unsigned char b0;				\
+									\
+			tr = bs->thresh >> thresh_frac;			\
+			raw0 = lvl[i];					\
+			bs->thresh += (int)(raw0 - tr) * (int) adiff[i]; \
+			b0 = (raw0 >= tr);				\
+									\
+			if (likely (b0 == b1				\
+				    && (lvl3[i] >= tr) == b0)) {	\
+				/* No transition. */			\
+				cl += cl4;				\
+				if (cl >= bs->oversampling_rate) {	\
+					cl -= bs->oversampling_rate;	\
+					c = c * 2 + b0;			\
+					if ((c & bs->cri_mask)		\
+					    == bs->cri) {		\
+						PAYLOAD ();		\
+						return TRUE;		\
+					}				\
+				}					\
+			} else {					\
+				raw1 = lvl[i + 1] - raw0;		\
+				t = raw0 * oversampling;		\
+									\
+				for (j = oversampling; j > 0; --j)	\
+					CRI ();				\
+			}						\
+									\
+			raw += bpp;					\
+		}							\
+	}								\
+									\
+	bs->thresh = thresh0;						\
+									\
+	return FALSE;							\
+} while (0)
+
+#define SIMD_BIT_SLICER(fmt, ext)					\
+static vbi_bool								\
+bit_slicer_ ## fmt ## _ ## ext	(vbi3_bit_slicer *	bs,		\
+				 uint8_t *		buffer,		\
+				 vbi3_bit_slicer_point *points,		\
+				 unsigned int *		n_points,	\
+				 const uint8_t *	raw)		\
+{									\
+	static const vbi_pixfmt pixfmt = VBI_PIXFMT_ ## fmt;		\
+	unsigned int bpp =						\
+		vbi_pixfmt_bytes_per_pixel (VBI_PIXFMT_ ## fmt);	\
+	static const unsigned int oversampling = 4;			\
+	static const vbi3_bit_slicer_point *points_start = NULL;	\
+	static const vbi_bool collect_points = FALSE;			\
+	unsigned int thresh_frac = DEF_THR_FRAC;			\
+									\
+	SIMD_CORE (prepare_ ## fmt ## _ ## ext);			\
+}
+
+SIMD_BIT_SLICER (Y8, sse2)
+SIMD_BIT_SLICER (YUYV, sse2)
+SIMD_BIT_SLICER (Y8, avx2)
+SIMD_BIT_SLICER (YUYV, avx2)
+
+#endif /* HAVE_X86_SIMD */
+
+/* Replaces a C bit slicer by a SIMD version if
+   the CPU supports one. */
+static _vbi3_bit_slicer_fn *
+simd_bit_slicer			(_vbi3_bit_slicer_fn *	func)
+{
+#if defined (HAVE_X86_SIMD)
+	unsigned int features = _vbi_cpu_features ();
+
+	if (features & _VBI_CPU_AVX2) {
+		if (bit_slicer_Y8 == func)
+			return bit_slicer_Y8_avx2;
+		else if (bit_slicer_YUYV == func)
+			return bit_slicer_YUYV_avx2;
+	} else if (features & _VBI_CPU_SSE2) {
+		if (bit_slicer_Y8 == func)
+			return bit_slicer_Y8_sse2;
+		else if (bit_slicer_YUYV == func)
+			return bit_slicer_YUYV_sse2;
+	}
+#endif
+
+	return func;
+}
+
+/* TRUE if func is bit_slicer_Y8() or a SIMD version thereof. */
+static vbi_bool
+is_bit_slicer_Y8		(_vbi3_bit_slicer_fn *	func)
+{
+#if defined (HAVE_X86_SIMD)
+	if (bit_slicer_Y8_sse2 == func
+	    || bit_slicer_Y8_avx2 == func)
+		return TRUE;
+#endif
+
+	return (bit_slicer_Y8 == func);
+}
+
 static const unsigned int	LP_AVG = 4;
 
 static vbi_bool
@@ -311,6 +667,7 @@ low_pass_bit_slicer_Y8		(vbi3_bit_slicer *	bs,
 	unsigned char b1;	/* previous bit */
 	unsigned int bps;
 	unsigned int raw0sum;
+	const unsigned int *pos; /* next bit position */
 
 	points_start = points;
 
@@ -382,6 +739,12 @@ low_pass_bit_slicer_Y8		(vbi3_bit_slicer *	bs,
 		}
 	}
 
+/* raw0 = sum of the 1 << LP_AVG samples at bit position i. We
+   add them afresh for each bit rather than updating a running sum
+   like raw0sum above. This slicer runs only with more than
+   3 << (LP_AVG - 1) samples per bit, so the windows of successive
+   bits overlap by less than a quarter, and moving the window would
+   load more samples than it saves. */
 #define LP_SAMPLE(_kind)						\
 do {									\
 	unsigned int ii = (i >> 8) * bps;				\
@@ -401,26 +764,36 @@ do {									\
 	}								\
 } while (0)
 
-	i = bs->phase_shift; /* current bit position << 8 */
+	++bs->n_cri_matches;
+
+	pos = bs->bit_pos; /* bit positions << 8 */
 	c = 0;
+	k = 0; /* distance of levels from tr, LP_SAMPLE uses m */
 
 	for (j = bs->frc_bits; j > 0; --j) {
+		i = *pos++;
 		LP_SAMPLE (VBI3_FRC_BIT);
 		c = c * 2 + (raw0 >= tr);
-		i += bs->step; /* next bit */
+		k += ABS ((int)(raw0 - tr));
 	}
 
-	if (c != bs->frc)
+	if (c != bs->frc) {
+		++bs->n_frc_errors;
 		return FALSE;
+	}
+
+	bs->last_thresh = tr >> LP_AVG;
+	bs->last_eye_opening = (0 == bs->frc_bits) ? 0 :
+		(k >> LP_AVG) / bs->frc_bits;
 
 	c = 0;
 
 	switch (bs->endian) {
 	case 3: /* bitwise, lsb first */
 		for (j = 0; j < bs->payload; ++j) {
+			i = *pos++;
 			LP_SAMPLE (VBI3_PAYLOAD_BIT);
 			c = (c >> 1) + ((raw0 >= tr) << 7);
-			i += bs->step;
 			if ((j & 7) == 7)
 				*buffer++ = c;
 		}
@@ -429,9 +802,9 @@ do {									\
 
 	case 2: /* bitwise, msb first */
 		for (j = 0; j < bs->payload; ++j) {
+			i = *pos++;
 			LP_SAMPLE (VBI3_PAYLOAD_BIT);
 			c = c * 2 + (raw0 >= tr);
-			i += bs->step;
 			if ((j & 7) == 7)
 				*buffer++ = c;
 		}
@@ -442,9 +815,9 @@ do {									\
 		j = bs->payload;
 		do {
 			for (k = 0; k < 8; ++k) {
+				i = *pos++;
 				LP_SAMPLE (VBI3_PAYLOAD_BIT);
 				c = (c >> 1) + ((raw0 >= tr) << 7);
-				i += bs->step;
 			}
 			*buffer++ = c;
 		} while (--j > 0);
@@ -454,9 +827,9 @@ do {									\
 		j = bs->payload;
 		do {
 			for (k = 0; k < 8; ++k) {
+				i = *pos++;
 				LP_SAMPLE (VBI3_PAYLOAD_BIT);
 				c = c * 2 + (raw0 >= tr);
-				i += bs->step;
 			}
 			*buffer++ = c;
 		} while (--j > 0);
@@ -488,6 +861,43 @@ null_function			(vbi3_bit_slicer *	bs,
 	return FALSE;
 }
 
+/* Cheap test if a line can contain data at all. Noise on a blank
+   line may accidentally match a short CRI, and searching for it
+   costs more than this pass. RGB formats with green_mask are not
+   checked. */
+static vbi_bool
+weak_signal			(const vbi3_bit_slicer *bs,
+				 const uint8_t *	raw)
+{
+	const uint8_t *end;
+	unsigned int bps;
+	unsigned int min;
+	unsigned int max;
+
+	if (0 == bs->min_amplitude || 0 != bs->green_mask)
+		return FALSE;
+
+	bps = bs->bytes_per_sample;
+
+	raw += bs->skip;
+	end = raw + bs->cri_samples * bps;
+
+	min = 255;
+	max = 0;
+
+	for (; raw < end; raw += bps) {
+		unsigned int y = *raw;
+
+		min = MIN (min, y);
+		max = MAX (max, y);
+
+		if (max - min >= bs->min_amplitude)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 /**
  * @param bs Pointer to vbi3_bit_slicer object allocated with
  *   vbi3_bit_slicer_new().
@@ -560,9 +970,12 @@ vbi3_bit_slicer_slice_with_points
 		return FALSE;
 	}
 
+	if (weak_signal (bs, raw))
+		return FALSE;
+
 	if (low_pass_bit_slicer_Y8 == bs->func) {
 		return bs->func (bs, buffer, points, n_points, raw);
-	} else if (bit_slicer_Y8 != bs->func) {
+	} else if (!is_bit_slicer_Y8 (bs->func)) {
 #if 3 == VBI_VERSION_MINOR
 		warning (&bs->log,
 			 "Function not implemented for pixfmt %s.",
@@ -621,6 +1034,9 @@ vbi3_bit_slicer_slice		(vbi3_bit_slicer *	bs,
 		return FALSE;
 	}
 
+	if (weak_signal (bs, raw))
+		return FALSE;
+
 	return bs->func (bs, buffer,
 			 /* points */ NULL,
 			 /* n_points */ NULL,
@@ -704,6 +1120,7 @@ vbi3_bit_slicer_set_params	(vbi3_bit_slicer *	bs,
 	unsigned int data_samples;
 	unsigned int cri_samples;
 	unsigned int skip;
+	unsigned int i;
 
 	assert (NULL != bs);
 	assert (cri_bits <= 32);
@@ -1080,6 +1497,30 @@ vbi3_bit_slicer_set_params	(vbi3_bit_slicer *	bs,
 		break;
 	}
 
+	/* Precompute the position of each bit. Adding bs->step
+	   would accumulate its rounding error, up to half a sample
+	   after a Teletext packet sampled at 27 MHz. */
+	if (data_bits > bs->bit_pos_capacity) {
+		unsigned int *bit_pos;
+
+		bit_pos = vbi_malloc (data_bits * sizeof (*bit_pos));
+		if (NULL == bit_pos) {
+			error (&bs->log, "Out of memory.");
+			goto failure;
+		}
+
+		vbi_free (bs->bit_pos);
+		bs->bit_pos = bit_pos;
+		bs->bit_pos_capacity = data_bits;
+	}
+
+	for (i = 0; i < data_bits; ++i) {
+		bs->bit_pos[i] = bs->phase_shift
+			+ (sampling_rate * (int64_t) 256 * i) / payload_rate;
+	}
+
+	bs->func = simd_bit_slicer (bs->func);
+
 	return TRUE;
 
  failure:
@@ -1088,6 +1529,28 @@ vbi3_bit_slicer_set_params	(vbi3_bit_slicer *	bs,
 	return FALSE;
 }
 
+/**
+ * @param bs Pointer to vbi3_bit_slicer object allocated with
+ *   vbi3_bit_slicer_new().
+ * @param amplitude Minimum peak-to-peak amplitude in 8 bit sample
+ *   units, or 0.
+ *
+ * The bit slicer will not search for the CRI if the samples where
+ * it can start differ by less than @a amplitude. This rejects noise
+ * on blank lines which may be mistaken for a data signal and saves
+ * time. The check is disabled by default and not available for
+ * 16 bit RGB formats.
+ */
+void
+vbi3_bit_slicer_set_min_amplitude
+				(vbi3_bit_slicer *	bs,
+				 unsigned int		amplitude)
+{
+	assert (NULL != bs);
+
+	bs->min_amplitude = amplitude;
+}
+
 void
 vbi3_bit_slicer_set_log_fn	(vbi3_bit_slicer *	bs,
 				 vbi_log_mask		mask,
@@ -1112,6 +1575,8 @@ _vbi3_bit_slicer_destroy	(vbi3_bit_slicer *	bs)
 {
 	assert (NULL != bs);
 
+	vbi_free (bs->bit_pos);
+
 	/* Make unusable. */
 	CLEAR (*bs);
 }
@@ -130,6 +130,11 @@ vbi3_bit_slicer_set_params	(vbi3_bit_slicer *	bs,
 				 vbi3_modulation	modulation)
   _vbi_nonnull ((1));
 extern void
+vbi3_bit_slicer_set_min_amplitude
+				(vbi3_bit_slicer *	bs,
+				 unsigned int		amplitude)
+  _vbi_nonnull ((1));
+extern void
 vbi3_bit_slicer_set_log_fn	(vbi3_bit_slicer *	bs,
 				 vbi_log_mask		mask,
 				 vbi_log_fn *		log_fn,
@@ -172,6 +177,19 @@ struct _vbi3_bit_slicer {
 	unsigned int		bytes_per_sample;
 	unsigned int		skip;
 	unsigned int		green_mask;
+	unsigned int		min_amplitude;
+
+	/* Position of each FRC and payload bit in 1/256 raw samples,
+	   relative to the sample where the CRI was found. */
+	unsigned int *		bit_pos;
+	unsigned int		bit_pos_capacity;
+
+	/* Statistics for the raw decoder. Levels of the last
+	   decoded line in sample units. */
+	unsigned int		n_cri_matches;
+	unsigned int		n_frc_errors;
+	unsigned int		last_thresh;
+	unsigned int		last_eye_opening;
 
 	_vbi_log_hook		log;
 };
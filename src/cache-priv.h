@@ -24,6 +24,8 @@
 #ifndef CACHE_PRIV_H
 #define CACHE_PRIV_H
 
+#include <pthread.h>
+
 #include "cache.h"
 #include "dlist.h"		/* list, node & funcs */
 #if 2 == VBI_VERSION_MINOR
@@ -39,8 +41,6 @@
 #include "sampling_par.h"	/* vbi_videostd_set */
 #include "vt.h"			/* Teletext definitions */
 
-#define HASH_SIZE 113
-
 /** @internal */
 typedef enum {
 	/** Pages to be deleted when no longer referenced. */
@@ -59,6 +59,32 @@ typedef enum {
 	CACHE_PRI_SPECIAL,
 } cache_priority;
 
+/**
+ * @internal
+ * Lists of unreferenced pages in the order we delete them when we
+ * run out of memory. Pages of networks nobody references go first.
+ */
+enum {
+	CACHE_LRU_INACTIVE_NORMAL,
+	CACHE_LRU_INACTIVE_SPECIAL,
+	CACHE_LRU_NORMAL,
+	CACHE_LRU_SPECIAL,
+	/**
+	 * libzvbi 0.2 only: DRCS pages. A vbi_page points to DRCS
+	 * data without reference, so we never delete these pages to
+	 * make room for others. They don't count toward the
+	 * memory_limit.
+	 */
+	CACHE_LRU_PINNED,
+	CACHE_LRU_LISTS
+};
+
+/** @internal */
+typedef struct cache_page_index_entry cache_page_index_entry;
+
+/** @internal */
+typedef struct cache_snapshot cache_snapshot;
+
 /**
  * @internal
  * Network related data.
@@ -114,6 +140,25 @@ typedef struct {
 	/** Number of referenced Teletext pages of this network. */
 	unsigned int			n_referenced_pages;
 
+	/**
+	 * Open addressing hash table of the Teletext pages of this
+	 * network, see page_by_pgno(). NULL if no pages have been
+	 * cached yet.
+	 */
+	cache_page_index_entry *	index;
+
+	/** Number of entries in the index, a power of two. */
+	unsigned int			index_size;
+
+	/** Number of used entries. */
+	unsigned int			index_used;
+
+	/**
+	 * Pages loaded with _vbi_cache_load_network() but not
+	 * requested yet, NULL if none.
+	 */
+	cache_snapshot *		snapshot;
+
 	/** Usually 100. */
 	struct ttx_page_link		initial_page;
 
@@ -151,8 +196,13 @@ typedef struct {
 typedef struct {
 	/* Cache internal stuff. */
 
+	/**
+	 * Ring of all cached subpages with the same pgno, see
+	 * page_by_pgno(). Zombies are not on the ring.
+	 */
+	struct node			subpage_node;
+
 	/** See struct vbi_cache. */
-	struct node			hash_node;
 	struct node			pri_node;
 
 	/** Network sending this page. */
@@ -163,6 +213,33 @@ typedef struct {
 	/** Current priority of this page. */
 	cache_priority			priority;
 
+	/**
+	 * Serial number of this version of the page, unique in the
+	 * cache, and of the version it replaced, zero if none. A page
+	 * replacing an identical page keeps its numbers. See
+	 * vbi_update_vt_page() and vbi_fetch_vt_page().
+	 */
+	unsigned int			version;
+	unsigned int			prev_version;
+
+	/**
+	 * Packets which differ from the previous version, 1 << packet
+	 * 0 ... 25, and CACHE_PAGE_OTHER_CHANGED if any other data
+	 * differs. Valid if prev_version is non-zero.
+	 */
+	unsigned int			changed_packets;
+
+	/**
+	 * Size of the data in compact form, zero if not compressed.
+	 * Referenced pages are never compressed. See compress_page().
+	 */
+	unsigned int			compact_size;
+
+	/**
+	 * Time the page header was received, as the vbi_decode()
+	 * timestamp, zero if unknown (e.g. loaded from a snapshot).
+	 */
+	double				time;
 
 	/* Teletext stuff. */
 
@@ -283,24 +360,79 @@ typedef struct {
 	   cache_page is statically allocated. */
 } cache_page;
 
+/**
+ * @internal
+ * Page index key of the subpage ring of a page, see
+ * struct cache_page_index_entry.
+ */
+#define CACHE_PAGE_OTHER_CHANGED (1 << 26)
+
+#define CACHE_INDEX_ANY_SUBNO 0xFFFF
+
+/**
+ * @internal
+ * Entry of the cache_network page index.
+ */
+struct cache_page_index_entry {
+	/**
+	 * pgno << 16 | subno, zero if the entry is unused. With
+	 * subno CACHE_INDEX_ANY_SUBNO, @a cp points to any page
+	 * on the cache_page.subpage_node ring of pgno.
+	 */
+	uint32_t			key;
+
+	cache_page *			cp;
+};
+
+/** @internal Maximum number of cache_page pools, one per size. */
+#define CACHE_PAGE_POOLS 8
+
+/**
+ * @internal
+ * Pages of one cache_page_size(), allocated from slabs
+ * holding several pages.
+ */
+typedef struct {
+	/** cache_page_size() of the pages in this pool. */
+	unsigned int		page_size;
+
+	/** Bytes per page in a slab, including a header. */
+	unsigned int		slot_size;
+	unsigned int		slots_per_slab;
+
+	/**
+	 * Slabs with free slots at head of list, full slabs
+	 * at tail. Points to a cache_page_slab.node.
+	 */
+	struct node		slabs;
+
+	/** Number of slabs without pages in use. */
+	unsigned int		n_empty_slabs;
+} cache_page_pool;
+
 /** @internal */
 struct _vbi_cache {
 	/**
-	 * Lists of Teletext pages by pgno, most recently used at head
-	 * of each list. Points to a cache_page.hash_node.
+	 * Protects all fields of the cache, its networks and pages
+	 * except the contents of the pages, which never change while
+	 * a page is referenced. Held only for the duration of one
+	 * cache operation, never while the client processes a page.
 	 */
-	struct node		hash[HASH_SIZE];
+	pthread_mutex_t		mutex;
 
 	/** Total number of pages cached, for statistics. */
 	unsigned int		n_cached_pages;
 
+	/** Last cache_page.version assigned. */
+	unsigned int		page_version;
+
 	unsigned int		ref_count;
 
 	/**
-	 * List of Teletext pages to be replaced when out of memory,
-	 * oldest at head of list. Points to a cache_page.pri_node.
+	 * Lists of Teletext pages to be replaced when out of memory,
+	 * oldest at head of each list. Points to a cache_page.pri_node.
 	 */
-	struct node		priority;
+	struct node		priority[CACHE_LRU_LISTS];
 
 	/**
 	 * List of Teletext pages which are referenced by the client.
@@ -325,6 +457,13 @@ struct _vbi_cache {
 	unsigned int		n_cached_networks;
 	unsigned int		n_networks_limit;
 
+	/** Store unreferenced pages in compact form. */
+	vbi_bool		compress_pages;
+
+	/** Page allocator, see alloc_page(). */
+	cache_page_pool		page_pools[CACHE_PAGE_POOLS];
+	unsigned int		n_page_pools;
+
 #if 3 == VBI_VERSION_MINOR
 	_vbi_event_handler_list handlers;
 #endif
@@ -440,7 +579,34 @@ _vbi_cache_get_page		(vbi_cache *		ca,
 extern cache_page *
 _vbi_cache_put_page		(vbi_cache *		ca,
 				 cache_network *	cn,
-				 const cache_page *	cp);
+				 const cache_page *	cp,
+				 unsigned int *		diff);
+extern vbi_bool
+_vbi_cache_save_network		(vbi_cache *		ca,
+				 cache_network *	cn,
+				 const char *		file_name);
+extern vbi_bool
+_vbi_cache_load_network		(vbi_cache *		ca,
+				 cache_network *	cn,
+				 const char *		file_name);
+extern unsigned int
+_vbi_cache_get_page_version	(vbi_cache *		ca,
+				 cache_network *	cn,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 vbi_subno		subno_mask);
+extern vbi_bool
+_vbi_cache_predict_subpage	(vbi_cache *		ca,
+				 cache_network *	cn,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 double *		time);
+extern void
+_vbi_cache_set_memory_limit	(vbi_cache *		ca,
+				 unsigned long		limit);
+extern void
+_vbi_cache_set_compression	(vbi_cache *		ca,
+				 vbi_bool		enable);
 extern void
 _vbi_cache_dump			(const vbi_cache *	ca,
 				 FILE *			fp);
@@ -26,6 +26,10 @@
 #endif
 
 #include <errno.h>
+#include <fcntl.h>		/* open() */
+#include <unistd.h>		/* close(), unlink() */
+#include <sys/mman.h>		/* mmap(), munmap() */
+#include <sys/stat.h>		/* fstat() */
 
 #include "version.h"
 #if 2 == VBI_VERSION_MINOR
@@ -92,6 +96,16 @@ no_mem_error			(vbi_cache *		ca)
 static void
 delete_all_pages		(vbi_cache *		ca,
 				 cache_network *	cn);
+static void
+snapshot_delete			(cache_network *	cn);
+static cache_page *
+put_page			(vbi_cache *		ca,
+				 cache_network *	cn,
+				 const cache_page *	cp,
+				 unsigned int *		diff);
+static void
+network_activity_changed	(vbi_cache *		ca,
+				 cache_network *	cn);
 
 static const char *
 cache_priority_name		(cache_priority		pri)
@@ -233,6 +247,8 @@ delete_network			(vbi_cache *		ca,
 		delete_all_pages (ca, cn);
 	}
 
+	snapshot_delete (cn);
+
 	/* Zombies don't count. */
 	if (!cn->zombie)
 		--ca->n_cached_networks;
@@ -276,6 +292,8 @@ delete_network			(vbi_cache *		ca,
 	cache_network_destroy_teletext (cn);
 #endif /* 3 == VBI_VERSION_MINOR */
 
+	vbi_cache_free (cn->index);
+
 	CLEAR (*cn);
 
 	vbi_cache_free (cn);
@@ -346,7 +364,11 @@ vbi_cache_set_network_limit	(vbi_cache *		ca,
 	else
 		ca->n_networks_limit = SATURATE (limit, 1, 3000);
 
+	pthread_mutex_lock (&ca->mutex);
+
 	delete_surplus_networks (ca);
+
+	pthread_mutex_unlock (&ca->mutex);
 }
 
 #endif /* 3 == VBI_VERSION_MINOR */
@@ -452,6 +474,8 @@ recycle_network			(vbi_cache *		ca)
 	if (cn->n_cached_pages > 0)
 		delete_all_pages (ca, cn);
 
+	snapshot_delete (cn);
+
 	unlink_node (&cn->node);
 
 	cn->ref_count = 0;
@@ -676,13 +700,18 @@ vbi_cache_get_networks		(vbi_cache *		ca,
 
 	*n_elements = 0;
 
-	if (0 == ca->n_cached_networks)
+	pthread_mutex_lock (&ca->mutex);
+
+	if (0 == ca->n_cached_networks) {
+		pthread_mutex_unlock (&ca->mutex);
 		return NULL;
+	}
 
 	/* Not ca->n_cached_networks because we list zombies too. */
 	size = (list_length (&ca->networks) + 1) * sizeof (*nk);
 
 	if (!(nk = vbi_malloc (size))) {
+		pthread_mutex_unlock (&ca->mutex);
 		return NULL;
 	}
 
@@ -693,6 +722,7 @@ vbi_cache_get_networks		(vbi_cache *		ca,
 			continue;
 
 		if (!(vbi_network_copy (nk + i, &cn->network))) {
+			pthread_mutex_unlock (&ca->mutex);
 			vbi_network_array_delete (nk, i);
 			return NULL;
 		}
@@ -700,6 +730,8 @@ vbi_cache_get_networks		(vbi_cache *		ca,
 		++i;
 	}
 
+	pthread_mutex_unlock (&ca->mutex);
+
 	CLEAR (nk[i]);
 
 	*n_elements = i;
@@ -728,6 +760,8 @@ cache_network_unref		(cache_network *	cn)
 
 	ca = cn->cache;
 
+	pthread_mutex_lock (&ca->mutex);
+
 	if (CACHE_CONSISTENCY)
 		assert (is_member (&ca->networks, &cn->node));
 
@@ -738,10 +772,14 @@ cache_network_unref		(cache_network *	cn)
 	} else if (1 == cn->ref_count) {
 		cn->ref_count = 0;
 
+		network_activity_changed (ca, cn);
+
 		delete_surplus_networks (ca);
 	} else {
 		--cn->ref_count;
 	}
+
+	pthread_mutex_unlock (&ca->mutex);
 }
 
 /**
@@ -758,7 +796,12 @@ cache_network_ref		(cache_network *	cn)
 {
 	assert (NULL != cn);
 
-	++cn->ref_count;
+	pthread_mutex_lock (&cn->cache->mutex);
+
+	if (1 == ++cn->ref_count)
+		network_activity_changed (cn->cache, cn);
+
+	pthread_mutex_unlock (&cn->cache->mutex);
 
 	return cn;
 }
@@ -785,15 +828,20 @@ _vbi_cache_get_network		(vbi_cache *		ca,
 	assert (NULL != ca);
 	assert (NULL != nk);
 
+	pthread_mutex_lock (&ca->mutex);
+
 	if ((cn = network_by_id (ca, nk))) {
 		if (cn->zombie) {
 			++ca->n_cached_networks;
 			cn->zombie = FALSE;
 		}
 
-		++cn->ref_count;
+		if (1 == ++cn->ref_count)
+			network_activity_changed (ca, cn);
 	}
 
+	pthread_mutex_unlock (&ca->mutex);
+
 	return cn;
 }
 
@@ -821,10 +869,15 @@ _vbi_cache_add_network		(vbi_cache *		ca,
 
 	assert (NULL != ca);
 
+	pthread_mutex_lock (&ca->mutex);
+
 	if ((cn = add_network (ca, nk, videostd_set))) {
-		++cn->ref_count;
+		if (1 == ++cn->ref_count)
+			network_activity_changed (ca, cn);
 	}
 
+	pthread_mutex_unlock (&ca->mutex);
+
 	return cn;
 }
 
@@ -856,16 +909,9 @@ cache_page_dump			(const cache_page *	cp,
 		 cp->ref_count, cache_priority_name (cp->priority));
 }
 
-/**
- * @internal
- * @param cp Teletext page.
- * 
- * @returns
- * Storage size required for the raw Teletext page,
- * depending on its function and the data union member used.
- */
-unsigned int
-cache_page_size			(const cache_page *	cp)
+/* Storage size of cp with uncompressed data. */
+static unsigned int
+expanded_page_size		(const cache_page *	cp)
 {
 	const unsigned int header_size = sizeof (*cp) - sizeof (cp->data);
 
@@ -895,6 +941,108 @@ cache_page_size			(const cache_page *	cp)
 	}
 }
 
+/**
+ * @internal
+ * @param cp Teletext page.
+ * 
+ * @returns
+ * Storage size required for the raw Teletext page,
+ * depending on its function and the data union member used,
+ * or the size of the compact form if the page is compressed.
+ */
+unsigned int
+cache_page_size			(const cache_page *	cp)
+{
+	if (cp->compact_size > 0) {
+		return sizeof (*cp) - sizeof (cp->data)
+			+ cp->compact_size;
+	}
+
+	return expanded_page_size (cp);
+}
+
+/* Compact page storage. Most rows of a Teletext page are blank
+   or padded with spaces and most links unused, so we compress the
+   data of unreferenced pages with a simple run-length code
+   (PackBits): a byte n < 128 is followed by n + 1 literal bytes,
+   a byte n > 128 by one byte repeated 257 - n times. */
+
+/* Worst case size of n bytes in compact form. */
+#define COMPACT_SIZE(n) ((n) + ((n) + 127) / 128)
+
+static unsigned int
+compact_encode			(uint8_t *		dst,
+				 const uint8_t *	src,
+				 unsigned int		size)
+{
+	const uint8_t *end = src + size;
+	uint8_t *d = dst;
+
+	while (src < end) {
+		const uint8_t *s;
+		unsigned int n;
+
+		for (s = src + 1; s < end && *s == *src
+			     && s - src < 128; ++s)
+			;
+
+		n = s - src;
+		if (n >= 3) {
+			*d++ = 257 - n;
+			*d++ = *src;
+			src = s;
+			continue;
+		}
+
+		/* Literal bytes up to the next run of three. */
+		for (s = src + 1; s < end && s - src < 128; ++s) {
+			if (s + 2 < end && s[0] == s[1] && s[0] == s[2])
+				break;
+		}
+
+		n = s - src;
+		*d++ = n - 1;
+		memcpy (d, src, n);
+		d += n;
+		src = s;
+	}
+
+	return d - dst;
+}
+
+static void
+compact_decode			(uint8_t *		dst,
+				 unsigned int		size,
+				 const uint8_t *	src)
+{
+	uint8_t *end = dst + size;
+
+	while (dst < end) {
+		unsigned int n = *src++;
+
+		if (n < 128) {
+			memcpy (dst, src, n + 1);
+			dst += n + 1;
+			src += n + 1;
+		} else {
+			memset (dst, *src++, 257 - n);
+			dst += 257 - n;
+		}
+	}
+}
+
+/* Copies the data of a compressed page cp to dst, which must have
+   room for expanded_page_size() - header bytes. */
+static void
+expand_data			(void *			dst,
+				 const cache_page *	cp)
+{
+	compact_decode ((uint8_t *) dst,
+			expanded_page_size (cp)
+			- (sizeof (*cp) - sizeof (cp->data)),
+			(const uint8_t *) &cp->data);
+}
+
 /** internal */
 vbi_bool
 cache_page_copy			(cache_page *		dst,
@@ -906,7 +1054,13 @@ cache_page_copy			(cache_page *		dst,
 	assert (NULL != dst);
 
 	if (src) {
-		memcpy (dst, src, cache_page_size (src));
+		if (src->compact_size > 0) {
+			memcpy (dst, src, sizeof (*dst) - sizeof (dst->data));
+			expand_data (&dst->data, src);
+			dst->compact_size = 0;
+		} else {
+			memcpy (dst, src, cache_page_size (src));
+		}
 
 		dst->network = NULL; /* not cached */
 	} else {
@@ -916,365 +1070,2035 @@ cache_page_copy			(cache_page *		dst,
 	return TRUE;
 }
 
-_vbi_inline unsigned int
-hash				(vbi_pgno		pgno)
+/* Page allocator. The pages in the cache have only a few different
+   sizes, see cache_page_size(). Each size has a pool of slabs holding
+   several pages, deleted pages return to their slab. A pool keeps at
+   most MAX_EMPTY_SLABS slabs without pages in use, so a busy service
+   rotating subpages rarely needs to malloc() or free() a page. */
+
+#define SLAB_SIZE 65536
+#define MAX_EMPTY_SLABS 1
+
+typedef struct cache_page_slab cache_page_slab;
+
+/* Precedes each page in a slab. */
+typedef union {
+	struct {
+		/* NULL if the page was not allocated from a slab. */
+		cache_page_slab *	slab;
+
+		/* Next free slot of the slab. */
+		void *			next_free;
+	}			s;
+
+	/* Alignment of the cache_page following the header. */
+	uint64_t		align_u64;
+	double			align_double;
+} page_slot;
+
+struct cache_page_slab {
+	struct node		node;
+	cache_page_pool *	pool;
+	page_slot *		free_slots;
+	unsigned int		n_used;
+};
+
+/* sizeof (cache_page_slab) rounded up to a multiple of the slot
+   alignment, slot 0 begins here. */
+#define SLAB_HEADER_SIZE						\
+	((sizeof (cache_page_slab) + sizeof (page_slot) - 1)		\
+	 / sizeof (page_slot) * sizeof (page_slot))
+
+static void
+init_page_pools			(vbi_cache *		ca)
 {
-	return pgno % HASH_SIZE;
+	const unsigned int header_size =
+		sizeof (cache_page) - sizeof (((cache_page *) 0)->data);
+	unsigned int sizes[CACHE_PAGE_POOLS];
+	unsigned int i;
+
+	/* See cache_page_size(). */
+	sizes[0] = header_size + sizeof (((cache_page *) 0)->data.lop);
+	sizes[1] = header_size + sizeof (((cache_page *) 0)->data.enh_lop);
+	sizes[2] = header_size + sizeof (((cache_page *) 0)->data.ext_lop);
+	sizes[3] = header_size + sizeof (((cache_page *) 0)->data.pop);
+	sizes[4] = header_size + sizeof (((cache_page *) 0)->data.drcs);
+	sizes[5] = header_size + sizeof (((cache_page *) 0)->data.ait);
+	sizes[6] = sizeof (cache_page);
+
+	ca->n_page_pools = 0;
+
+	for (i = 0; i < 7; ++i) {
+		cache_page_pool *pool;
+		unsigned int j;
+
+		for (j = 0; j < ca->n_page_pools; ++j)
+			if (sizes[i] == ca->page_pools[j].page_size)
+				break;
+
+		if (j < ca->n_page_pools)
+			continue; /* same size as another union member */
+
+		pool = &ca->page_pools[ca->n_page_pools++];
+
+		pool->page_size = sizes[i];
+		pool->slot_size = (sizeof (page_slot) + sizes[i]
+				   + sizeof (page_slot) - 1)
+			/ sizeof (page_slot) * sizeof (page_slot);
+		pool->slots_per_slab = MAX ((SLAB_SIZE - SLAB_HEADER_SIZE)
+					    / pool->slot_size, 4UL);
+
+		list_init (&pool->slabs);
+
+		pool->n_empty_slabs = 0;
+	}
 }
 
-static vbi_bool
-page_in_cache			(const vbi_cache *	ca,
-				 const cache_page *	cp)
+static void
+destroy_page_pools		(vbi_cache *		ca)
 {
-	const struct node *hash_list;
-	const struct node *pri_list;
+	unsigned int i;
 
-	if (CACHE_PRI_ZOMBIE == cp->priority) {
-		/* Note cp->ref_count may be zero if the page is
-		   about to be deleted. */
-		return is_member (&ca->referenced, &cp->pri_node);
-	}
+	for (i = 0; i < ca->n_page_pools; ++i) {
+		cache_page_pool *pool = &ca->page_pools[i];
+		cache_page_slab *slab, *slab1;
 
-	hash_list = &ca->hash[hash (cp->pgno)];
+		FOR_ALL_NODES (slab, slab1, &pool->slabs, node) {
+			/* Slabs with pages still referenced by the
+			   client leak, see vbi_cache_delete(). */
+			if (0 == slab->n_used) {
+				unlink_node (&slab->node);
+				vbi_cache_free (slab);
+			}
+		}
 
-	if (cp->ref_count > 0)
-		pri_list = &ca->referenced;
-	else
-		pri_list = &ca->priority;
+		list_destroy (&pool->slabs);
+	}
 
-	return (is_member (hash_list, &cp->hash_node)
-		&& is_member (pri_list, &cp->pri_node));
+	ca->n_page_pools = 0;
 }
 
-static void
-delete_page			(vbi_cache *		ca,
-				 cache_page *		cp)
+static cache_page_slab *
+new_slab			(cache_page_pool *	pool)
 {
-	if (CACHE_CONSISTENCY) {
-		assert (NULL != cp->network);
-		assert (ca == cp->network->cache);
-		assert (page_in_cache (ca, cp));
+	cache_page_slab *slab;
+	uint8_t *p;
+	unsigned int i;
+
+	slab = vbi_cache_malloc (SLAB_HEADER_SIZE
+				 + pool->slots_per_slab * pool->slot_size);
+	if (NULL == slab)
+		return NULL;
+
+	slab->pool = pool;
+	slab->free_slots = NULL;
+	slab->n_used = 0;
+
+	/* Free list in address order. */
+	p = (uint8_t *) slab + SLAB_HEADER_SIZE
+		+ pool->slots_per_slab * pool->slot_size;
+
+	for (i = 0; i < pool->slots_per_slab; ++i) {
+		page_slot *slot;
+
+		p -= pool->slot_size;
+		slot = (page_slot *) p;
+
+		slot->s.slab = slab;
+		slot->s.next_free = slab->free_slots;
+		slab->free_slots = slot;
 	}
 
-	if (cp->ref_count > 0) {
-		if (CACHE_PRI_ZOMBIE != cp->priority) {
-			/* Remove from cache, mark for deletion.
-			   cp->pri_node remains on ca->referenced. */
+	return slab;
+}
+
+/* Allocates a page of page_size bytes,
+   see cache_page_size(). */
+static cache_page *
+alloc_page			(vbi_cache *		ca,
+				 unsigned int		page_size)
+{
+	cache_page_pool *pool;
+	cache_page_slab *slab;
+	page_slot *slot;
+	unsigned int i;
 
-			unlink_node (&cp->hash_node);
+	pool = NULL;
 
-			cp->priority = CACHE_PRI_ZOMBIE;
+	for (i = 0; i < ca->n_page_pools; ++i) {
+		if (page_size == ca->page_pools[i].page_size) {
+			pool = &ca->page_pools[i];
+			break;
 		}
+	}
 
-		return;
+	if (unlikely (NULL == pool)) {
+		slot = vbi_cache_malloc (sizeof (*slot) + page_size);
+		if (NULL == slot)
+			return NULL;
+
+		slot->s.slab = NULL;
+
+		return (cache_page *)(slot + 1);
 	}
 
-	if (CACHE_DEBUG) {
-		fputs ("Delete ", stderr);
-		cache_page_dump (cp, stderr);
-		fputc (' ', stderr);
-		cache_network_dump (cp->network, stderr);
-		fputc ('\n', stderr);
+	slab = NULL;
+
+	if (!is_empty (&pool->slabs)) {
+		slab = PARENT (pool->slabs._succ, cache_page_slab, node);
+		if (NULL == slab->free_slots)
+			slab = NULL; /* all slabs full */
 	}
 
-	if (CACHE_PRI_ZOMBIE != cp->priority) {
-		/* Referenced and zombie pages don't count. */ 
-		ca->memory_used -= cache_page_size (cp);
+	if (NULL == slab) {
+		slab = new_slab (pool);
+		if (NULL == slab)
+			return NULL;
 
-		unlink_node (&cp->hash_node);
+		add_head (&pool->slabs, &slab->node);
+		++pool->n_empty_slabs;
 	}
 
-	unlink_node (&cp->pri_node);
+	slot = slab->free_slots;
+	slab->free_slots = slot->s.next_free;
 
-	cache_network_remove_page (cp->network, cp);
+	if (0 == slab->n_used++)
+		--pool->n_empty_slabs;
 
-	vbi_cache_free (cp);
+	if (NULL == slab->free_slots) {
+		unlink_node (&slab->node);
+		add_tail (&pool->slabs, &slab->node);
+	}
 
-	--ca->n_cached_pages;
+	return (cache_page *)(slot + 1);
 }
 
 static void
-delete_all_pages		(vbi_cache *		ca,
-				 cache_network *	cn)
+free_page			(cache_page *		cp)
 {
-	cache_page *cp, *cp1;
+	cache_page_pool *pool;
+	cache_page_slab *slab;
+	page_slot *slot;
 
-	if (CACHE_CONSISTENCY && NULL != cn) {
-		assert (ca == cn->cache);
-		assert (is_member (&ca->networks, &cn->node));
-	}
+	slot = ((page_slot *) cp) - 1;
+	slab = slot->s.slab;
 
-	FOR_ALL_NODES (cp, cp1, &ca->priority, pri_node)
-		if (!cn || cp->network == cn)
-			delete_page (ca, cp);
-}
+	if (unlikely (NULL == slab)) {
+		vbi_cache_free (slot);
+		return;
+	}
 
-static void
-delete_surplus_pages		(vbi_cache *		ca)
-{
-	cache_priority pri;
-	cache_page *cp, *cp1;
+	pool = slab->pool;
 
-	for (pri = CACHE_PRI_NORMAL; pri <= CACHE_PRI_SPECIAL; ++pri) {
-		FOR_ALL_NODES (cp, cp1, &ca->priority, pri_node) {
-			if (ca->memory_used <= ca->memory_limit)
-				return;
-			else if (cp->priority == pri
-				 && 0 == cp->network->ref_count)
-				delete_page (ca, cp);
-		}
+	if (NULL == slab->free_slots) {
+		/* Was full. */
+		unlink_node (&slab->node);
+		add_head (&pool->slabs, &slab->node);
 	}
 
-	for (pri = CACHE_PRI_NORMAL; pri <= CACHE_PRI_SPECIAL; ++pri) {
-		FOR_ALL_NODES (cp, cp1, &ca->priority, pri_node) {
-			if (ca->memory_used <= ca->memory_limit)
-				return;
-			else if (cp->priority == pri)
-				delete_page (ca, cp);
+	slot->s.next_free = slab->free_slots;
+	slab->free_slots = slot;
+
+	if (0 == --slab->n_used) {
+		if (pool->n_empty_slabs >= MAX_EMPTY_SLABS) {
+			unlink_node (&slab->node);
+			vbi_cache_free (slab);
+		} else {
+			++pool->n_empty_slabs;
 		}
 	}
 }
 
-#if 3 == VBI_VERSION_MINOR
+/* Page index. Each network has an open addressing hash table with
+   linear probing which maps pgno and subno to a cached page. Another
+   entry per pgno with subno CACHE_INDEX_ANY_SUBNO points to the ring
+   of all subpages of the page, for lookups with a subno_mask. The
+   table is at most half full, so lookups usually touch one or two
+   cache lines and never the pages themselves. */
 
-/**
- * @param ca Cache allocated with vbi_cache_new().
- * @param limit Amount of memory in bytes.
- *
- * Limits the amount of memory used by the Teletext page cache. Reasonable
- * values range from 16 KB to 1 GB, default is 1 GB as in libzvbi 0.2.
- * The number of pages transmitted by networks varies. Expect on the order
- * of one or two megabytes for a complete set.
- * 
- * When the cache is too small to contain all pages of a network,
- * newly received pages will replace older pages. Pages of the
- * current network, or which have been recently requested, or will
- * likely be requested in the future, or take longer to reload
- * are last deleted.
- *
- * When @a limit is smaller than the amount of memory currently
- * used, this function attempts to delete an appropriate number of
- * pages.
- */
-void
-vbi_cache_set_memory_limit	(vbi_cache *		ca,
-				 unsigned long		limit)
+_vbi_inline uint32_t
+index_key			(vbi_pgno		pgno,
+				 vbi_subno		subno)
 {
-	assert (NULL != ca);
+	return ((uint32_t) pgno << 16) | (uint32_t) subno;
+}
 
-#if 2 == VBI_VERSION_MINOR
-	/* We must never delete pages because reference counting
-	   doesn't work right and we can't fix that without
-	   breaking compatibility. (E.g. DRCS data referenced in
-	   a vbi_page isn't reference counted. Also some apps may
-	   not call vbi_unref_page() because that did not cause
-	   problems in earlier versions.) */
-	limit = 1 << 30;
-#endif
+_vbi_inline unsigned int
+index_hash			(const cache_network *	cn,
+				 uint32_t		key)
+{
+	key *= 0x9E3779B1;
+	return (key ^ (key >> 16)) & (cn->index_size - 1);
+}
 
-	ca->memory_limit = SATURATE (limit, 1 << 10, 1 << 30);
+static cache_page_index_entry *
+index_lookup			(const cache_network *	cn,
+				 uint32_t		key)
+{
+	unsigned int mask;
+	unsigned int i;
 
-	delete_surplus_pages (ca);
-}
+	if (0 == cn->index_used)
+		return NULL;
 
-#endif /* 3 == VBI_VERSION_MINOR */
+	mask = cn->index_size - 1;
 
-static cache_page *
-page_by_pgno			(vbi_cache *		ca,
-				 const cache_network *	cn,
-				 vbi_pgno		pgno,
-				 vbi_subno		subno,
-				 vbi_subno		subno_mask)
-{
-	struct node *hash_list;
-	cache_page *cp, *cp1;
+	for (i = index_hash (cn, key);; i = (i + 1) & mask) {
+		cache_page_index_entry *e = &cn->index[i];
 
-	if (CACHE_CONSISTENCY) {
-		assert (ca == cn->cache);
-		assert (is_member (&ca->networks, &cn->node));
+		if (key == e->key)
+			return e;
+		else if (0 == e->key)
+			return NULL;
 	}
+}
 
-	subno &= subno_mask;
+/* Call index_reserve() first. */
+static void
+index_insert			(cache_network *	cn,
+				 uint32_t		key,
+				 cache_page *		cp)
+{
+	unsigned int mask;
+	unsigned int i;
 
-	hash_list = ca->hash + hash (pgno);
+	assert (2 * (cn->index_used + 1) <= cn->index_size);
 
-	FOR_ALL_NODES (cp, cp1, hash_list, hash_node) {
-		if (CACHE_DEBUG > 1) {
-			fputs ("Try ", stderr);
-			cache_page_dump (cp, stderr);
-			fputc ('\n', stderr);
-		}
+	mask = cn->index_size - 1;
 
-		if (cp->pgno == pgno
-		    && (cp->subno & subno_mask) == subno
-		    && (!cn || cp->network == cn)) {
-			/* Find faster next time. */
-			add_head (hash_list, unlink_node (&cp->hash_node));
-			return cp;
-		}
+	for (i = index_hash (cn, key); 0 != cn->index[i].key;
+	     i = (i + 1) & mask) {
+		if (CACHE_CONSISTENCY)
+			assert (key != cn->index[i].key);
 	}
 
-	return NULL;
+	cn->index[i].key = key;
+	cn->index[i].cp = cp;
+
+	++cn->index_used;
 }
 
-/**
- * @internal
- * @param cp
- *
- * Unreferences a page returned by vbi_cache_put_cache_page(),
- * vbi_cache_get_cache_page(), or vbi_page_new_cache_page_ref().
- * @a cp can be @c NULL.
- */
-void
-cache_page_unref		(cache_page *		cp)
+/* Removes entry e. Note this moves other entries. */
+static void
+index_erase			(cache_network *	cn,
+				 cache_page_index_entry *e)
 {
-	vbi_cache *ca;
+	unsigned int mask;
+	unsigned int i;
+	unsigned int j;
 
-	if (NULL == cp)
-		return;
+	mask = cn->index_size - 1;
 
-	assert (NULL != cp->network);
-	assert (NULL != cp->network->cache);
+	i = e - cn->index;
+	j = i;
 
-	ca = cp->network->cache;
+	/* Move the following entries of the probe sequence into
+	   the hole, unless that puts them before their home. */
+	for (;;) {
+		unsigned int k;
 
-	if (CACHE_CONSISTENCY)
+		j = (j + 1) & mask;
+		if (0 == cn->index[j].key)
+			break;
+
+		k = index_hash (cn, cn->index[j].key);
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+
+		cn->index[i] = cn->index[j];
+		i = j;
+	}
+
+	cn->index[i].key = 0;
+	cn->index[i].cp = NULL;
+
+	--cn->index_used;
+}
+
+/* Makes room for n more index entries. */
+static vbi_bool
+index_reserve			(vbi_cache *		ca,
+				 cache_network *	cn,
+				 unsigned int		n)
+{
+	cache_page_index_entry *old_index;
+	unsigned int old_size;
+	unsigned int size;
+	unsigned int i;
+
+	if (likely (2 * (cn->index_used + n) <= cn->index_size))
+		return TRUE;
+
+	size = MAX (cn->index_size, 32U);
+	while (2 * (cn->index_used + n) > size)
+		size *= 2;
+
+	old_index = cn->index;
+	old_size = cn->index_size;
+
+	cn->index = vbi_cache_malloc (size * sizeof (*cn->index));
+	if (NULL == cn->index) {
+		cn->index = old_index;
+		no_mem_error (ca);
+		return FALSE;
+	}
+
+	memset (cn->index, 0, size * sizeof (*cn->index));
+
+	cn->index_size = size;
+	cn->index_used = 0;
+
+	for (i = 0; i < old_size; ++i) {
+		if (0 != old_index[i].key)
+			index_insert (cn, old_index[i].key, old_index[i].cp);
+	}
+
+	vbi_cache_free (old_index);
+
+	return TRUE;
+}
+
+/* Adds cp to the index of its network, with room for
+   two entries reserved. */
+static void
+index_add_page			(cache_network *	cn,
+				 cache_page *		cp)
+{
+	cache_page_index_entry *head;
+
+	index_insert (cn, index_key (cp->pgno, cp->subno), cp);
+
+	head = index_lookup (cn, index_key (cp->pgno,
+					    CACHE_INDEX_ANY_SUBNO));
+	if (NULL == head) {
+		cp->subpage_node._succ = &cp->subpage_node;
+		cp->subpage_node._pred = &cp->subpage_node;
+
+		index_insert (cn, index_key (cp->pgno,
+					     CACHE_INDEX_ANY_SUBNO), cp);
+	} else {
+		insert_before (&head->cp->subpage_node, &cp->subpage_node);
+		head->cp = cp;
+	}
+}
+
+static void
+index_remove_page		(cache_network *	cn,
+				 cache_page *		cp)
+{
+	cache_page_index_entry *e;
+
+	e = index_lookup (cn, index_key (cp->pgno, cp->subno));
+	assert (NULL != e && cp == e->cp);
+
+	index_erase (cn, e);
+
+	e = index_lookup (cn, index_key (cp->pgno, CACHE_INDEX_ANY_SUBNO));
+	assert (NULL != e);
+
+	if (&cp->subpage_node == cp->subpage_node._succ) {
+		/* Last subpage. */
+		index_erase (cn, e);
+		cp->subpage_node._succ = NULL;
+		cp->subpage_node._pred = NULL;
+	} else {
+		if (cp == e->cp) {
+			e->cp = PARENT (cp->subpage_node._succ,
+					cache_page, subpage_node);
+		}
+
+		unlink_node (&cp->subpage_node);
+	}
+}
+
+/* Replaces the cached, unreferenced page cp by new_cp in the page
+   index, the subpage ring and the priority list, and frees cp. */
+static void
+relocate_page			(cache_page *		cp,
+				 cache_page *		new_cp)
+{
+	cache_network *cn = cp->network;
+	cache_page_index_entry *e;
+
+	e = index_lookup (cn, index_key (cp->pgno, cp->subno));
+	assert (NULL != e && cp == e->cp);
+	e->cp = new_cp;
+
+	e = index_lookup (cn, index_key (cp->pgno, CACHE_INDEX_ANY_SUBNO));
+	assert (NULL != e);
+	if (cp == e->cp)
+		e->cp = new_cp;
+
+	if (&cp->subpage_node == cp->subpage_node._succ) {
+		new_cp->subpage_node._succ = &new_cp->subpage_node;
+		new_cp->subpage_node._pred = &new_cp->subpage_node;
+	} else {
+		insert_after (&cp->subpage_node, &new_cp->subpage_node);
+		unlink_node (&cp->subpage_node);
+	}
+
+	insert_after (&cp->pri_node, &new_cp->pri_node);
+	unlink_node (&cp->pri_node);
+
+	free_page (cp);
+}
+
+/* TRUE if cp is never deleted to make room for other pages. In
+   libzvbi 0.2 a vbi_page points to DRCS data without reference. */
+static vbi_bool
+pinned_page			(const cache_page *	cp)
+{
+#if 2 == VBI_VERSION_MINOR
+	switch (cp->function) {
+	case PAGE_FUNCTION_DRCS:
+	case PAGE_FUNCTION_GDRCS:
+		return TRUE;
+
+	default:
+		break;
+	}
+#else
+	cp = cp; /* unused */
+#endif
+
+	return FALSE;
+}
+
+/* Memory an unreferenced page counts toward the memory_limit.
+   Pinned pages don't count, they would fill the cache for good. */
+static unsigned int
+lru_page_size			(const cache_page *	cp)
+{
+	if (pinned_page (cp))
+		return 0;
+
+	return cache_page_size (cp);
+}
+
+/* Encodes the data of the uncompressed page cp into buffer.
+   Returns the size of the compact data, zero if cp shall not be
+   compressed because that saves no memory. */
+static unsigned int
+encode_page			(uint8_t *		buffer,
+				 const cache_page *	cp)
+{
+	const unsigned int header_size = sizeof (*cp) - sizeof (cp->data);
+	unsigned int size;
+
+	/* A vbi_page may point to DRCS data. */
+	if (pinned_page (cp))
+		return 0;
+
+	size = compact_encode (buffer, (const uint8_t *) &cp->data,
+			       expanded_page_size (cp) - header_size);
+	if (header_size + size >= expanded_page_size (cp))
+		return 0;
+
+	return size;
+}
+
+/* Stores the cached, unreferenced page cp in compact form if that
+   saves memory. Returns the new page or cp. */
+static cache_page *
+compress_page			(vbi_cache *		ca,
+				 cache_page *		cp)
+{
+	const unsigned int header_size = sizeof (*cp) - sizeof (cp->data);
+	uint8_t buffer[COMPACT_SIZE (sizeof (((cache_page *) 0)->data))];
+	cache_page *new_cp;
+	unsigned int size;
+
+	if (cp->compact_size > 0)
+		return cp;
+
+	size = encode_page (buffer, cp);
+	if (0 == size)
+		return cp;
+
+	new_cp = alloc_page (ca, header_size + size);
+	if (NULL == new_cp)
+		return cp; /* keep it uncompressed */
+
+	memcpy (new_cp, cp, header_size);
+	memcpy (&new_cp->data, buffer, size);
+	new_cp->compact_size = size;
+
+	relocate_page (cp, new_cp);
+
+	return new_cp;
+}
+
+/* Restores a page stored by compress_page(). Returns the new page,
+   NULL if we ran out of memory. */
+static cache_page *
+expand_page			(vbi_cache *		ca,
+				 cache_page *		cp)
+{
+	const unsigned int header_size = sizeof (*cp) - sizeof (cp->data);
+	cache_page *new_cp;
+
+	new_cp = alloc_page (ca, expanded_page_size (cp));
+	if (NULL == new_cp) {
+		no_mem_error (ca);
+		return NULL;
+	}
+
+	memcpy (new_cp, cp, header_size);
+	expand_data (&new_cp->data, cp);
+	new_cp->compact_size = 0;
+
+	relocate_page (cp, new_cp);
+
+	return new_cp;
+}
+
+/* Returns the list of unreferenced pages cp belongs on. */
+static struct node *
+lru_list			(const vbi_cache *	ca,
+				 const cache_page *	cp)
+{
+	unsigned int i;
+
+	if (pinned_page (cp))
+		return (struct node *) &ca->priority[CACHE_LRU_PINNED];
+
+	if (cp->network->ref_count > 0)
+		i = CACHE_LRU_NORMAL;
+	else
+		i = CACHE_LRU_INACTIVE_NORMAL;
+
+	if (CACHE_PRI_SPECIAL == cp->priority)
+		++i;
+
+	return (struct node *) &ca->priority[i];
+}
+
+/* Moves the unreferenced pages of cn after its ref_count changed
+   from or to zero. */
+static void
+network_activity_changed	(vbi_cache *		ca,
+				 cache_network *	cn)
+{
+	unsigned int from;
+	unsigned int i;
+
+	if (cn->ref_count > 0)
+		from = CACHE_LRU_INACTIVE_NORMAL;
+	else
+		from = CACHE_LRU_NORMAL;
+
+	for (i = from; i <= from + 1; ++i) {
+		cache_page *cp, *cp1;
+
+		FOR_ALL_NODES (cp, cp1, &ca->priority[i], pri_node) {
+			if (cp->network == cn)
+				add_tail (lru_list (ca, cp),
+					  unlink_node (&cp->pri_node));
+		}
+	}
+}
+
+static vbi_bool
+page_in_cache			(const vbi_cache *	ca,
+				 const cache_page *	cp)
+{
+	const cache_page_index_entry *e;
+	const struct node *pri_list;
+
+	if (CACHE_PRI_ZOMBIE == cp->priority) {
+		/* Note cp->ref_count may be zero if the page is
+		   about to be deleted. */
+		return is_member (&ca->referenced, &cp->pri_node);
+	}
+
+	e = index_lookup (cp->network, index_key (cp->pgno, cp->subno));
+
+	if (cp->ref_count > 0)
+		pri_list = &ca->referenced;
+	else
+		pri_list = lru_list (ca, cp);
+
+	return (NULL != e && cp == e->cp
+		&& is_member (pri_list, &cp->pri_node));
+}
+
+static void
+delete_page			(vbi_cache *		ca,
+				 cache_page *		cp)
+{
+	if (CACHE_CONSISTENCY) {
+		assert (NULL != cp->network);
+		assert (ca == cp->network->cache);
+		assert (page_in_cache (ca, cp));
+	}
+
+	if (cp->ref_count > 0) {
+		if (CACHE_PRI_ZOMBIE != cp->priority) {
+			/* Remove from cache, mark for deletion.
+			   cp->pri_node remains on ca->referenced. */
+
+			index_remove_page (cp->network, cp);
+
+			cp->priority = CACHE_PRI_ZOMBIE;
+		}
+
+		return;
+	}
+
+	if (CACHE_DEBUG) {
+		fputs ("Delete ", stderr);
+		cache_page_dump (cp, stderr);
+		fputc (' ', stderr);
+		cache_network_dump (cp->network, stderr);
+		fputc ('\n', stderr);
+	}
+
+	if (CACHE_PRI_ZOMBIE != cp->priority) {
+		/* Referenced and zombie pages don't count. */ 
+		ca->memory_used -= lru_page_size (cp);
+
+		index_remove_page (cp->network, cp);
+	}
+
+	unlink_node (&cp->pri_node);
+
+	cache_network_remove_page (cp->network, cp);
+
+	free_page (cp);
+
+	--ca->n_cached_pages;
+}
+
+static void
+delete_all_pages		(vbi_cache *		ca,
+				 cache_network *	cn)
+{
+	unsigned int i;
+
+	if (CACHE_CONSISTENCY && NULL != cn) {
+		assert (ca == cn->cache);
+		assert (is_member (&ca->networks, &cn->node));
+	}
+
+	for (i = 0; i < CACHE_LRU_LISTS; ++i) {
+		cache_page *cp, *cp1;
+
+		FOR_ALL_NODES (cp, cp1, &ca->priority[i], pri_node)
+			if (!cn || cp->network == cn)
+				delete_page (ca, cp);
+	}
+}
+
+static void
+delete_surplus_pages		(vbi_cache *		ca)
+{
+	unsigned int i;
+
+	for (i = 0; i < CACHE_LRU_PINNED; ++i) {
+		struct node *list = &ca->priority[i];
+
+		while (!is_empty (list)) {
+			if (ca->memory_used <= ca->memory_limit)
+				return;
+
+			delete_page (ca, PARENT (list->_succ,
+						 cache_page, pri_node));
+		}
+	}
+}
+
+/**
+ * @internal
+ * @param ca Cache allocated with vbi_cache_new().
+ * @param limit Amount of memory in bytes.
+ *
+ * Limits the amount of memory used by unreferenced pages in the
+ * cache, see vbi_cache_set_memory_limit(). In libzvbi 0.2 DRCS
+ * pages are never deleted to make room for other pages and don't
+ * count.
+ */
+void
+_vbi_cache_set_memory_limit	(vbi_cache *		ca,
+				 unsigned long		limit)
+{
+	assert (NULL != ca);
+
+	pthread_mutex_lock (&ca->mutex);
+
+	ca->memory_limit = SATURATE (limit, 1 << 10, 1 << 30);
+
+	delete_surplus_pages (ca);
+
+	pthread_mutex_unlock (&ca->mutex);
+}
+
+#if 3 == VBI_VERSION_MINOR
+
+/**
+ * @param ca Cache allocated with vbi_cache_new().
+ * @param limit Amount of memory in bytes.
+ *
+ * Limits the amount of memory used by the Teletext page cache. Reasonable
+ * values range from 16 KB to 1 GB, default is 1 GB as in libzvbi 0.2.
+ * The number of pages transmitted by networks varies. Expect on the order
+ * of one or two megabytes for a complete set.
+ * 
+ * When the cache is too small to contain all pages of a network,
+ * newly received pages will replace older pages. Pages of the
+ * current network, or which have been recently requested, or will
+ * likely be requested in the future, or take longer to reload
+ * are last deleted.
+ *
+ * When @a limit is smaller than the amount of memory currently
+ * used, this function attempts to delete an appropriate number of
+ * pages.
+ */
+void
+vbi_cache_set_memory_limit	(vbi_cache *		ca,
+				 unsigned long		limit)
+{
+	_vbi_cache_set_memory_limit (ca, limit);
+}
+
+#endif /* 3 == VBI_VERSION_MINOR */
+
+/**
+ * @internal
+ * @param ca Cache.
+ * @param enable @c TRUE to store unreferenced pages in compact form.
+ *
+ * When enabled the pages currently in the cache and all pages
+ * unreferenced later are compressed. When disabled, compressed
+ * pages are expanded as they are referenced again.
+ */
+void
+_vbi_cache_set_compression	(vbi_cache *		ca,
+				 vbi_bool		enable)
+{
+	unsigned int i;
+
+	assert (NULL != ca);
+
+	pthread_mutex_lock (&ca->mutex);
+
+	ca->compress_pages = !!enable;
+
+	if (enable) {
+		for (i = 0; i < CACHE_LRU_PINNED; ++i) {
+			cache_page *cp, *cp1;
+
+			FOR_ALL_NODES (cp, cp1, &ca->priority[i], pri_node) {
+				ca->memory_used -= cache_page_size (cp);
+				cp = compress_page (ca, cp);
+				ca->memory_used += cache_page_size (cp);
+			}
+		}
+	}
+
+	pthread_mutex_unlock (&ca->mutex);
+}
+
+#if 3 == VBI_VERSION_MINOR
+
+/**
+ * @param ca Cache allocated with vbi_cache_new().
+ * @param enable @c TRUE to enable compression.
+ *
+ * Stores pages in the cache which are not in use in a compact form,
+ * so the cache holds more pages within its memory limit. Pages are
+ * expanded again when requested, which costs some CPU time.
+ * Compression is disabled by default.
+ */
+void
+vbi_cache_set_compression	(vbi_cache *		ca,
+				 vbi_bool		enable)
+{
+	_vbi_cache_set_compression (ca, enable);
+}
+
+#endif /* 3 == VBI_VERSION_MINOR */
+
+static cache_page *
+page_by_pgno			(vbi_cache *		ca,
+				 const cache_network *	cn,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 vbi_subno		subno_mask)
+{
+	cache_page_index_entry *head;
+	cache_page *cp;
+
+	if (CACHE_CONSISTENCY) {
+		assert (ca == cn->cache);
+		assert (is_member (&ca->networks, &cn->node));
+	}
+
+	subno &= subno_mask;
+
+	/* We store only subno 0x0000 ... 0x3F7F. */
+	if (0 == (0x3F7F & ~subno_mask)) {
+		const cache_page_index_entry *e;
+
+		if (0 != (subno & ~0x3F7F))
+			return NULL;
+
+		e = index_lookup (cn, index_key (pgno, subno));
+		if (NULL == e)
+			return NULL;
+
+		cp = e->cp;
+
+		if (&cp->subpage_node != cp->subpage_node._succ) {
+			/* VBI_ANY_SUBNO finds the most recently
+			   used subpage. */
+			head = index_lookup (cn, index_key
+					     (pgno, CACHE_INDEX_ANY_SUBNO));
+			head->cp = cp;
+		}
+
+		return cp;
+	}
+
+	head = index_lookup (cn, index_key (pgno, CACHE_INDEX_ANY_SUBNO));
+	if (NULL == head)
+		return NULL;
+
+	cp = head->cp;
+
+	do {
+		if (CACHE_DEBUG > 1) {
+			fputs ("Try ", stderr);
+			cache_page_dump (cp, stderr);
+			fputc ('\n', stderr);
+		}
+
+		if ((cp->subno & subno_mask) == subno) {
+			/* Find faster next time. */
+			head->cp = cp;
+			return cp;
+		}
+
+		cp = PARENT (cp->subpage_node._succ,
+			     cache_page, subpage_node);
+	} while (cp != head->cp);
+
+	return NULL;
+}
+
+/* cache_page_unref() with ca->mutex locked. */
+static void
+page_unref			(vbi_cache *		ca,
+				 cache_page *		cp)
+{
+	if (CACHE_CONSISTENCY)
 		assert (page_in_cache (ca, cp));
 
 	if (0 == cp->ref_count) {
-		warning (&ca->log,
-			 "Page %p already unreferenced.",
-			 (void *) cp);
+		warning (&ca->log,
+			 "Page %p already unreferenced.",
+			 (void *) cp);
+		return;
+	}
+
+	if (CACHE_DEBUG) {
+		fputs ("Unref ", stderr);
+		_vbi_cache_dump (ca, stderr);
+		fputc (' ', stderr);
+		cache_page_dump (cp, stderr);
+	}
+
+	if (1 == cp->ref_count) {
+		cache_network *cn;
+
+		cp->ref_count = 0;
+
+		cn = cp->network;
+
+		switch (cp->priority) {
+		case CACHE_PRI_ZOMBIE:
+			delete_page (ca, cp);
+			break;
+
+		default:
+			if (CACHE_DEBUG) {
+				fputc (' ', stderr);
+				cache_network_dump (cn, stderr);
+			}
+
+			add_tail (lru_list (ca, cp),
+				  unlink_node (&cp->pri_node));
+
+			if (ca->compress_pages)
+				cp = compress_page (ca, cp);
+
+			ca->memory_used += lru_page_size (cp);
+
+			break;
+		}
+
+		--cn->n_referenced_pages;
+
+		if (cn->zombie
+		    && 0 == cn->n_referenced_pages
+		    && 0 == cn->ref_count)
+			delete_network (ca, cn);
+
+		if (ca->memory_used > ca->memory_limit)
+			delete_surplus_pages (ca);
+	} else {
+		--cp->ref_count;
+	}
+
+	if (CACHE_DEBUG)
+		fputc ('\n', stderr);
+}
+
+/**
+ * @internal
+ * @param cp
+ *
+ * Unreferences a page returned by vbi_cache_put_cache_page(),
+ * vbi_cache_get_cache_page(), or vbi_page_new_cache_page_ref().
+ * @a cp can be @c NULL.
+ */
+void
+cache_page_unref		(cache_page *		cp)
+{
+	vbi_cache *ca;
+
+	if (NULL == cp)
+		return;
+
+	assert (NULL != cp->network);
+	assert (NULL != cp->network->cache);
+
+	/* The network lives as long as we have a page reference. */
+	ca = cp->network->cache;
+
+	pthread_mutex_lock (&ca->mutex);
+
+	page_unref (ca, cp);
+
+	pthread_mutex_unlock (&ca->mutex);
+}
+
+/* cache_page_ref() with ca->mutex locked. Returns cp, or a copy
+   replacing cp if it was compressed, NULL if we ran out of memory. */
+static cache_page *
+page_ref			(cache_page *		cp)
+{
+	if (CACHE_DEBUG) {
+		fputs ("Ref ", stderr);
+		cache_page_dump (cp, stderr);
+	}
+
+	if (0 == cp->ref_count) {
+		vbi_cache *ca;
+		cache_network *cn;
+
+		cn = cp->network;
+		ca = cn->cache;
+
+		if (CACHE_DEBUG) {
+			fputc (' ', stderr);
+			cache_network_dump (cn, stderr);
+		}
+
+		/* Referenced pages don't count. */
+		ca->memory_used -= lru_page_size (cp);
+
+		if (cp->compact_size > 0) {
+			cache_page *new_cp;
+
+			new_cp = expand_page (ca, cp);
+			if (NULL == new_cp) {
+				ca->memory_used += lru_page_size (cp);
+				return NULL;
+			}
+
+			cp = new_cp;
+		}
+
+		if (cn->zombie) {
+			++ca->n_cached_networks;
+			cn->zombie = FALSE;
+		}
+
+		++cn->n_referenced_pages;
+
+		add_tail (&ca->referenced, unlink_node (&cp->pri_node));
+	}
+
+	if (CACHE_DEBUG)
+		fputc ('\n', stderr);
+
+	++cp->ref_count;
+
+	return cp;
+}
+
+/**
+ * @internal
+ * @param cp
+ *
+ * Duplicates a page reference.
+ *
+ * @returns
+ * @a cp, never fails.
+ */
+cache_page *
+cache_page_ref			(cache_page *		cp)
+{
+	vbi_cache *ca;
+
+	assert (NULL != cp);
+
+	ca = cp->network->cache;
+
+	pthread_mutex_lock (&ca->mutex);
+
+	page_ref (cp);
+
+	pthread_mutex_unlock (&ca->mutex);
+
+	return cp;
+}
+
+#if 2 == VBI_VERSION_MINOR
+
+/**
+ * @param pg Previously fetched vbi_page.
+ *
+ * A vbi_page fetched from cache with vbi_fetch_vt_page() or
+ * vbi_fetch_cc_page() may reference other resource in cache which
+ * are locked after fetching. When done processing the page, you
+ * must call this function to unlock all the resources associated
+ * with this vbi_page.
+ */
+void
+vbi_unref_page			(vbi_page *		pg)
+{
+	/* Reference counting never really worked and we can't
+	   easily fix that in libzvbi 0.2 without breaking binary
+	   compatibility. For example DRCS data referenced in a
+	   vbi_page isn't reference counted. Also some apps may
+	   not call vbi_unref_page() as there are no consequences. */
+
+	/* Nothing to do. */
+
+	pg = pg;
+}
+
+#endif
+
+/* Returns the subno under which _vbi_cache_put_page() stores
+   page pgno.subno, and in *subno_mask which bits distinguish the
+   versions of the page we store. */
+static vbi_subno
+stored_subno			(const cache_network *	cn,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 vbi_subno *		subno_mask)
+{
+	*subno_mask = 0;
+
+	if (likely (vbi_is_bcd (pgno))) {
+		if (likely (0 == subno)) {
+			/* The page has no subpages or is a clock page
+			   at 00:00. We store only one version. */
+		} else {
+			const struct ttx_page_stat *ps;
+			vbi_page_type page_type;
+
+			ps = cache_network_const_page_stat (cn, pgno);
+			page_type = ps->page_type;
+
+			if (VBI_CLOCK_PAGE == page_type
+			    || subno >= 0x0100) {
+				/* A clock page or a rolling page without
+				   subpages (Section A.1 Note 1).
+				   One version. */
+				if (vbi_bcd_digits_greater (subno, 0x2959)
+				    || subno > 0x2300)
+					subno = 0; /* invalid */
+			} else if (vbi_bcd_digits_greater (subno, 0x79)) {
+				/* A rolling page without subpages.
+				   One version. */
+				subno = 0; /* invalid */
+			} else {
+				/* A page with subpages or an unmarked
+				   clock page between 00:00 and 00:59.
+				   We store all versions. */
+				*subno_mask = 0xFF;
+			}
+		}
+	} else {
+		/* S1 element is the subpage number. */
+		*subno_mask = 0x000F;
+	}
+
+	return subno;
+}
+
+/* Snapshots. _vbi_cache_save_network() writes the Teletext state and
+   pages of a network to a file, _vbi_cache_load_network() maps the
+   file into memory and copies pages into the cache when requested
+   first, see snapshot_get_page(). The file stores structures in host
+   format, so it can be read only on the same kind of machine. */
+
+#define SNAPSHOT_MAGIC "ZVBITTXC"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+typedef struct {
+	char			magic[8];
+	uint32_t		version;
+	uint32_t		byte_order;
+
+	/* Detect changes of the structures below. */
+	uint32_t		header_size;
+	uint32_t		network_size;
+	uint32_t		page_size;
+
+	uint32_t		n_pages;
+	uint64_t		file_size;
+} snapshot_header;
+
+/* The MOT, MIP and BTT derived part of struct ttx_page_stat. The
+   cache statistics are recomputed when pages are loaded. */
+typedef struct {
+	uint8_t			page_type;
+	uint8_t			charset_code;
+	uint16_t		subcode;
+	uint32_t		flags;
+} snapshot_page_stat;
+
+/* Follows the snapshot_header. */
+typedef struct {
+	uint32_t		cni_vps;
+	uint32_t		cni_8301;
+	uint32_t		cni_8302;
+	uint32_t		have_top;
+	uint8_t			channel_name[32];
+	uint8_t			status[20];
+	struct ttx_page_link	initial_page;
+	struct ttx_page_link	btt_link[2 * 5];
+	struct ttx_magazine	magazines[8];
+	snapshot_page_stat	pages[0x800];
+} snapshot_network;
+
+/* Follows the snapshot_network, sorted by pgno and subno. */
+typedef struct {
+	uint16_t		pgno;
+	uint16_t		subno;
+	int32_t			function;
+	int32_t			national;
+	uint32_t		flags;
+	uint32_t		lop_packets;
+	uint32_t		x26_designations;
+	uint32_t		x27_designations;
+	uint32_t		x28_designations;
+
+	/* cache_page.data, at an offset from the start of the
+	   file aligned to a multiple of eight. */
+	uint32_t		data_size;
+	uint32_t		reserved;
+	uint64_t		data_offset;
+} snapshot_page;
+
+struct cache_snapshot {
+	/* The mapped file. */
+	const uint8_t *		base;
+	size_t			size;
+
+	const snapshot_page *	pages;
+	unsigned int		n_pages;
+
+	/* For each page TRUE if not loaded into the cache yet. */
+	uint8_t *		pending;
+	unsigned int		n_pending;
+
+	/* One for cache_network.snapshot, one for each
+	   _vbi_cache_save_network() call writing pages of the
+	   snapshot. With ca->mutex locked. */
+	unsigned int		ref_count;
+};
+
+static void
+snapshot_unref			(cache_snapshot *	sn)
+{
+	if (--sn->ref_count > 0)
+		return;
+
+	munmap ((void *) sn->base, sn->size);
+
+	vbi_cache_free (sn->pending);
+
+	CLEAR (*sn);
+
+	vbi_cache_free (sn);
+}
+
+static void
+snapshot_delete			(cache_network *	cn)
+{
+	cache_snapshot *sn = cn->snapshot;
+
+	if (NULL == sn)
 		return;
+
+	cn->snapshot = NULL;
+
+	snapshot_unref (sn);
+}
+
+/* Returns the index of the first pending page matching pgno,
+   subno and subno_mask, or -1. */
+static int
+snapshot_find_page		(const cache_snapshot *	sn,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 vbi_subno		subno_mask)
+{
+	unsigned int l, r;
+
+	subno &= subno_mask;
+
+	/* First page with this pgno. */
+	l = 0;
+	r = sn->n_pages;
+
+	while (l < r) {
+		unsigned int m = (l + r) >> 1;
+
+		if (sn->pages[m].pgno < pgno)
+			l = m + 1;
+		else
+			r = m;
+	}
+
+	for (; l < sn->n_pages && pgno == sn->pages[l].pgno; ++l) {
+		if (sn->pending[l]
+		    && (sn->pages[l].subno & subno_mask) == subno)
+			return (int) l;
+	}
+
+	return -1;
+}
+
+/* Marks pending pages which would be replaced by this page as
+   loaded, called by _vbi_cache_put_page(). */
+static void
+snapshot_consume		(cache_network *	cn,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 vbi_subno		subno_mask)
+{
+	cache_snapshot *sn = cn->snapshot;
+	int i;
+
+	while ((i = snapshot_find_page (sn, pgno, subno, subno_mask)) >= 0) {
+		sn->pending[i] = FALSE;
+
+		if (0 == --sn->n_pending) {
+			/* Nothing left to load. */
+			snapshot_delete (cn);
+			return;
+		}
+	}
+}
+
+/* Copies page i of the snapshot into the cache. Returns
+   a referenced page or NULL if out of memory. */
+static cache_page *
+snapshot_load_page		(vbi_cache *		ca,
+				 cache_network *	cn,
+				 unsigned int		i)
+{
+	const snapshot_page *sp;
+	cache_page cp;
+
+	sp = &cn->snapshot->pages[i];
+
+	cp.function		= (enum ttx_page_function) sp->function;
+
+	cp.pgno			= sp->pgno;
+	cp.subno		= sp->subno;
+
+	cp.national		= sp->national;
+
+	cp.flags		= sp->flags;
+
+	cp.lop_packets		= sp->lop_packets;
+	cp.x26_designations	= sp->x26_designations;
+	cp.x27_designations	= sp->x27_designations;
+	cp.x28_designations	= sp->x28_designations;
+
+	cp.compact_size		= 0;
+	cp.time			= 0.0;
+
+	memcpy (&cp.data, cn->snapshot->base + sp->data_offset,
+		sp->data_size);
+
+	/* Consumes page i. */
+	return put_page (ca, cn, &cp, /* diff */ NULL);
+}
+
+/* Called by _vbi_cache_get_page() if the page is not cached. */
+static cache_page *
+snapshot_get_page		(vbi_cache *		ca,
+				 cache_network *	cn,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 vbi_subno		subno_mask)
+{
+	int i;
+
+	i = snapshot_find_page (cn->snapshot, pgno, subno, subno_mask);
+	if (i < 0)
+		return NULL;
+
+	if (CACHE_DEBUG)
+		fputs ("Loading from snapshot ", stderr);
+
+	return snapshot_load_page (ca, cn, (unsigned int) i);
+}
+
+/* Loads all pending pages of the snapshot into the cache. */
+static void
+snapshot_load_all		(vbi_cache *		ca,
+				 cache_network *	cn)
+{
+	unsigned int i;
+
+	for (i = 0; NULL != cn->snapshot && i < cn->snapshot->n_pages; ++i) {
+		cache_page *cp;
+
+		if (!cn->snapshot->pending[i])
+			continue;
+
+		cp = snapshot_load_page (ca, cn, i);
+		if (NULL == cp)
+			break; /* out of memory */
+
+		page_unref (ca, cp);
 	}
+}
+
+/* Marks pending pages as loaded which have been received before
+   the snapshot was loaded, these are newer. */
+static void
+snapshot_consume_cached_pages	(vbi_cache *		ca,
+				 cache_network *	cn)
+{
+	struct node *lists[CACHE_LRU_LISTS + 1];
+	unsigned int i;
+
+	for (i = 0; i < CACHE_LRU_LISTS; ++i)
+		lists[i] = &ca->priority[i];
+	lists[i] = &ca->referenced;
+
+	for (i = 0; i < N_ELEMENTS (lists); ++i) {
+		cache_page *cp, *cp1;
 
-	if (CACHE_DEBUG) {
-		fputs ("Unref ", stderr);
-		_vbi_cache_dump (ca, stderr);
-		fputc (' ', stderr);
-		cache_page_dump (cp, stderr);
+		FOR_ALL_NODES (cp, cp1, lists[i], pri_node) {
+			vbi_subno subno_mask;
+			vbi_subno subno;
+
+			if (cn != cp->network
+			    || CACHE_PRI_ZOMBIE == cp->priority)
+				continue;
+
+			subno = stored_subno (cn, cp->pgno, cp->subno,
+					      &subno_mask);
+			snapshot_consume (cn, cp->pgno, subno, subno_mask);
+			if (NULL == cn->snapshot)
+				return;
+		}
 	}
+}
 
-	if (1 == cp->ref_count) {
-		cache_network *cn;
+/* A page to save. */
+typedef struct {
+	snapshot_page		page;
+	const void *		data;
 
-		cp->ref_count = 0;
+	/* Referenced page data points into, NULL if a page
+	   of the snapshot. */
+	cache_page *		cp;
+} snapshot_entry;
 
-		cn = cp->network;
+static int
+snapshot_entry_cmp		(const void *		p1,
+				 const void *		p2)
+{
+	const snapshot_entry *se1 = p1;
+	const snapshot_entry *se2 = p2;
 
-		switch (cp->priority) {
-		case CACHE_PRI_ZOMBIE:
-			delete_page (ca, cp);
-			break;
+	if (se1->page.pgno != se2->page.pgno)
+		return (int) se1->page.pgno - (int) se2->page.pgno;
+	else
+		return (int) se1->page.subno - (int) se2->page.subno;
+}
 
-		default:
-			if (CACHE_DEBUG) {
-				fputc (' ', stderr);
-				cache_network_dump (cn, stderr);
-			}
+static void
+snapshot_page_from_cache_page	(snapshot_page *	sp,
+				 const cache_page *	cp)
+{
+	CLEAR (*sp);
+
+	sp->pgno		= cp->pgno;
+	sp->subno		= cp->subno;
+	sp->function		= cp->function;
+	sp->national		= cp->national;
+	sp->flags		= cp->flags;
+	sp->lop_packets		= cp->lop_packets;
+	sp->x26_designations	= cp->x26_designations;
+	sp->x27_designations	= cp->x27_designations;
+	sp->x28_designations	= cp->x28_designations;
+	sp->data_size		= expanded_page_size (cp)
+		- (sizeof (*cp) - sizeof (cp->data));
+}
 
-			add_tail (&ca->priority, unlink_node (&cp->pri_node));
+static void
+snapshot_network_from_cache_network
+				(snapshot_network *	snn,
+				 const cache_network *	cn)
+{
+	unsigned int i;
 
-			ca->memory_used += cache_page_size (cp);
+	CLEAR (*snn);
 
-			break;
-		}
+	snn->cni_vps = cn->network.cni_vps;
+	snn->cni_8301 = cn->network.cni_8301;
+	snn->cni_8302 = cn->network.cni_8302;
+	snn->have_top = cn->have_top;
 
-		--cn->n_referenced_pages;
+	memcpy (snn->channel_name, cn->channel_name,
+		sizeof (snn->channel_name));
+	memcpy (snn->status, cn->status, sizeof (snn->status));
 
-		if (cn->zombie
-		    && 0 == cn->n_referenced_pages
-		    && 0 == cn->ref_count)
-			delete_network (ca, cn);
+	snn->initial_page = cn->initial_page;
+	memcpy (snn->btt_link, cn->btt_link, sizeof (snn->btt_link));
+	memcpy (snn->magazines, cn->_magazines, sizeof (snn->magazines));
 
-		if (ca->memory_used > ca->memory_limit)
-			delete_surplus_pages (ca);
-	} else {
-		--cp->ref_count;
+	for (i = 0; i < N_ELEMENTS (snn->pages); ++i) {
+		const struct ttx_page_stat *ps = &cn->_pages[i];
+
+		snn->pages[i].page_type = ps->page_type;
+		snn->pages[i].charset_code = ps->charset_code;
+		snn->pages[i].subcode = ps->subcode;
+		snn->pages[i].flags = ps->flags;
+	}
+}
+
+static vbi_bool
+write_snapshot			(FILE *			fp,
+				 const snapshot_header *sh,
+				 const snapshot_network *snn,
+				 const snapshot_entry *	entries)
+{
+	static const uint8_t zero[8];
+	uint64_t offset;
+	unsigned int i;
+
+	if (1 != fwrite (sh, sizeof (*sh), 1, fp)
+	    || 1 != fwrite (snn, sizeof (*snn), 1, fp))
+		return FALSE;
+
+	for (i = 0; i < sh->n_pages; ++i) {
+		if (1 != fwrite (&entries[i].page,
+				 sizeof (entries[i].page), 1, fp))
+			return FALSE;
 	}
 
-	if (CACHE_DEBUG)
-		fputc ('\n', stderr);
+	offset = sizeof (*sh) + sizeof (*snn)
+		+ sh->n_pages * (uint64_t) sizeof (snapshot_page);
+
+	for (i = 0; i < sh->n_pages; ++i) {
+		const snapshot_page *sp = &entries[i].page;
+		size_t padding = sp->data_offset - offset;
+
+		if (padding > 0 && 1 != fwrite (zero, padding, 1, fp))
+			return FALSE;
+
+		if (1 != fwrite (entries[i].data, sp->data_size, 1, fp))
+			return FALSE;
+
+		offset = sp->data_offset + sp->data_size;
+	}
+
+	return TRUE;
 }
 
 /**
  * @internal
- * @param cp
+ * @param ca Cache.
+ * @param cn Network to save.
+ * @param file_name Name of the file to create or replace.
  *
- * Duplicates a page reference.
+ * Saves the cached Teletext pages of @a cn and the information
+ * gathered from MOT, MIP, BTT and packet 8/30 in a file which can be
+ * loaded with _vbi_cache_load_network(). Pages which have not been
+ * loaded from a snapshot yet are saved too. The file is replaced
+ * atomically, so other processes can safely map the old version.
+ * The cache is locked only to reference the pages, which do not
+ * change while referenced, not while the file is written.
  *
  * @returns
- * @a cp, never fails.
+ * @c FALSE on failure (out of memory or I/O error).
  */
-cache_page *
-cache_page_ref			(cache_page *		cp)
+vbi_bool
+_vbi_cache_save_network		(vbi_cache *		ca,
+				 cache_network *	cn,
+				 const char *		file_name)
 {
-	assert (NULL != cp);
+	struct node *lists[CACHE_LRU_LISTS + 1];
+	snapshot_header sh;
+	snapshot_network *snn;
+	snapshot_entry *entries;
+	cache_snapshot *sn;
+	unsigned int n_entries;
+	unsigned int max_entries;
+	char *tmp_name;
+	uint64_t offset;
+	vbi_bool success;
+	FILE *fp;
+	unsigned int i;
+	int fd;
 
-	if (CACHE_DEBUG) {
-		fputs ("Ref ", stderr);
-		cache_page_dump (cp, stderr);
+	assert (NULL != ca);
+	assert (NULL != cn);
+	assert (NULL != file_name);
+
+	assert (ca == cn->cache);
+
+	tmp_name = NULL;
+	sn = NULL;
+	n_entries = 0;
+	success = FALSE;
+
+	pthread_mutex_lock (&ca->mutex);
+
+	max_entries = cn->n_cached_pages;
+	if (NULL != cn->snapshot)
+		max_entries += cn->snapshot->n_pending;
+
+	snn = vbi_cache_malloc (sizeof (*snn));
+	entries = vbi_cache_malloc (MAX (max_entries, 1U)
+				    * sizeof (*entries));
+	if (NULL == snn || NULL == entries) {
+		no_mem_error (ca);
+		goto unref;
 	}
 
-	if (0 == cp->ref_count) {
-		vbi_cache *ca;
-		cache_network *cn;
+	for (i = 0; i < CACHE_LRU_LISTS; ++i)
+		lists[i] = &ca->priority[i];
+	lists[i] = &ca->referenced;
 
-		cn = cp->network;
-		ca = cn->cache;
+	for (i = 0; i < N_ELEMENTS (lists); ++i) {
+		cache_page *cp, *cp1;
 
-		if (CACHE_DEBUG) {
-			fputc (' ', stderr);
-			cache_network_dump (cn, stderr);
+		FOR_ALL_NODES (cp, cp1, lists[i], pri_node) {
+			if (cn != cp->network
+			    || CACHE_PRI_ZOMBIE == cp->priority)
+				continue;
+
+			assert (n_entries < max_entries);
+
+			snapshot_page_from_cache_page
+				(&entries[n_entries].page, cp);
+			entries[n_entries++].cp = cp;
 		}
+	}
 
-		if (cn->zombie) {
-			++ca->n_cached_networks;
-			cn->zombie = FALSE;
+	/* After the loop above because page_ref() moves pages to
+	   ca->referenced. Referenced pages are not compressed. */
+	for (i = 0; i < n_entries; ++i) {
+		cache_page *cp;
+
+		cp = page_ref (entries[i].cp);
+		if (NULL == cp) {
+			n_entries = i;
+			no_mem_error (ca);
+			goto unref;
 		}
 
-		++cn->n_referenced_pages;
+		entries[i].cp = cp;
+		entries[i].data = &cp->data;
+	}
 
-		ca->memory_used -= cache_page_size (cp);
+	if (NULL != cn->snapshot) {
+		sn = cn->snapshot;
+		++sn->ref_count;
 
-		add_tail (&ca->referenced, unlink_node (&cp->pri_node));
+		for (i = 0; i < sn->n_pages; ++i) {
+			if (!sn->pending[i])
+				continue;
+
+			assert (n_entries < max_entries);
+
+			entries[n_entries].page = sn->pages[i];
+			entries[n_entries].data =
+				sn->base + sn->pages[i].data_offset;
+			entries[n_entries++].cp = NULL;
+		}
 	}
 
-	if (CACHE_DEBUG)
-		fputc ('\n', stderr);
+	qsort (entries, n_entries, sizeof (*entries), snapshot_entry_cmp);
 
-	++cp->ref_count;
+	offset = sizeof (sh) + sizeof (*snn)
+		+ n_entries * (uint64_t) sizeof (snapshot_page);
 
-	return cp;
+	for (i = 0; i < n_entries; ++i) {
+		offset = (offset + 7) & ~(uint64_t) 7;
+		entries[i].page.data_offset = offset;
+		offset += entries[i].page.data_size;
+	}
+
+	CLEAR (sh);
+
+	memcpy (sh.magic, SNAPSHOT_MAGIC, sizeof (sh.magic));
+	sh.version = SNAPSHOT_VERSION;
+	sh.byte_order = SNAPSHOT_BYTE_ORDER;
+	sh.header_size = sizeof (sh);
+	sh.network_size = sizeof (*snn);
+	sh.page_size = sizeof (snapshot_page);
+	sh.n_pages = n_entries;
+	sh.file_size = offset;
+
+	snapshot_network_from_cache_network (snn, cn);
+
+	/* The decoder can store pages while we write the file. */
+	pthread_mutex_unlock (&ca->mutex);
+
+	if (asprintf (&tmp_name, "%s.XXXXXX", file_name) < 0) {
+		tmp_name = NULL;
+		no_mem_error (ca);
+		goto relock;
+	}
+
+	fd = mkstemp (tmp_name);
+	if (-1 == fd) {
+		set_errstr (ca, _("Cannot create file %s: %s."),
+			    tmp_name, strerror (errno));
+		goto relock;
+	}
+
+	fp = fdopen (fd, "wb");
+	if (NULL == fp) {
+		set_errstr (ca, _("Cannot create file %s: %s."),
+			    tmp_name, strerror (errno));
+		close (fd);
+		goto failure_unlink;
+	}
+
+	if (!write_snapshot (fp, &sh, snn, entries)) {
+		set_errstr (ca, _("Error while writing file %s: %s."),
+			    tmp_name, strerror (errno));
+		fclose (fp);
+		goto failure_unlink;
+	}
+
+	if (0 != fclose (fp)) {
+		set_errstr (ca, _("Error while writing file %s: %s."),
+			    tmp_name, strerror (errno));
+		goto failure_unlink;
+	}
+
+	if (0 != rename (tmp_name, file_name)) {
+		set_errstr (ca, _("Cannot rename %s to %s: %s."),
+			    tmp_name, file_name, strerror (errno));
+		goto failure_unlink;
+	}
+
+	success = TRUE;
+
+ relock:
+	pthread_mutex_lock (&ca->mutex);
+
+ unref:
+	for (i = 0; i < n_entries; ++i) {
+		if (NULL != entries[i].cp)
+			page_unref (ca, entries[i].cp);
+	}
+
+	if (NULL != sn)
+		snapshot_unref (sn);
+
+	pthread_mutex_unlock (&ca->mutex);
+
+	free (tmp_name);
+	vbi_cache_free (entries);
+	vbi_cache_free (snn);
+
+	return success;
+
+ failure_unlink:
+	unlink (tmp_name);
+	goto relock;
 }
 
-#if 2 == VBI_VERSION_MINOR
+static vbi_bool
+valid_snapshot_page		(const snapshot_page *	sp,
+				 const snapshot_page *	prev,
+				 uint64_t		data_start,
+				 uint64_t		file_size)
+{
+	cache_page cp;
+
+	if (sp->pgno < 0x100 || sp->pgno > 0x8FF
+	    || 0xFF == (sp->pgno & 0xFF)
+	    || sp->subno > 0x3F7F)
+		return FALSE;
+
+	/* Sorted and unique, see snapshot_find_page(). */
+	if (NULL != prev
+	    && (prev->pgno > sp->pgno
+		|| (prev->pgno == sp->pgno && prev->subno >= sp->subno)))
+		return FALSE;
+
+	if (sp->function < PAGE_FUNCTION_ACI
+	    || sp->function > PAGE_FUNCTION_IEC_TRIGGER)
+		return FALSE;
+
+	cp.function = (enum ttx_page_function) sp->function;
+	cp.x26_designations = sp->x26_designations;
+	cp.x28_designations = sp->x28_designations;
+
+	if (sp->data_size != expanded_page_size (&cp)
+	    - (sizeof (cp) - sizeof (cp.data)))
+		return FALSE;
+
+	return (0 == (sp->data_offset & 7)
+		&& sp->data_offset >= data_start
+		&& sp->data_offset <= file_size
+		&& sp->data_size <= file_size - sp->data_offset);
+}
 
 /**
- * @param pg Previously fetched vbi_page.
+ * @internal
+ * @param ca Cache.
+ * @param cn Network to load the snapshot into.
+ * @param file_name Name of a file created by _vbi_cache_save_network().
  *
- * A vbi_page fetched from cache with vbi_fetch_vt_page() or
- * vbi_fetch_cc_page() may reference other resource in cache which
- * are locked after fetching. When done processing the page, you
- * must call this function to unlock all the resources associated
- * with this vbi_page.
+ * Restores the information gathered from MOT, MIP, BTT and packet 8/30
+ * and makes the pages in the file available to _vbi_cache_get_page().
+ * The file is mapped into memory and pages are copied into the cache
+ * when requested first, unless a newer version of the page has been
+ * received in the meantime.
+ *
+ * @returns
+ * @c FALSE on failure, for instance if the file does not exist,
+ * is damaged, was written by an incompatible version of libzvbi or
+ * on a different kind of machine, or belongs to a network with
+ * a different CNI than @a cn.
  */
-void
-vbi_unref_page			(vbi_page *		pg)
+vbi_bool
+_vbi_cache_load_network		(vbi_cache *		ca,
+				 cache_network *	cn,
+				 const char *		file_name)
 {
-	/* Reference counting never really worked and we can't
-	   easily fix that in libzvbi 0.2 without breaking binary
-	   compatibility. For example DRCS data referenced in a
-	   vbi_page isn't reference counted. Also some apps may
-	   not call vbi_unref_page() as there are no consequences. */
+	const snapshot_header *sh;
+	const snapshot_network *snn;
+	cache_snapshot *sn;
+	struct stat st;
+	uint64_t data_start;
+	void *base;
+	unsigned int i;
+	int fd;
 
-	/* Nothing to do. */
+	assert (NULL != ca);
+	assert (NULL != cn);
+	assert (NULL != file_name);
+
+	assert (ca == cn->cache);
+
+	fd = open (file_name, O_RDONLY);
+	if (-1 == fd) {
+		set_errstr (ca, _("Cannot open file %s: %s."),
+			    file_name, strerror (errno));
+		return FALSE;
+	}
+
+	if (0 != fstat (fd, &st)) {
+		set_errstr (ca, _("Cannot open file %s: %s."),
+			    file_name, strerror (errno));
+		close (fd);
+		return FALSE;
+	}
+
+	if ((uint64_t) st.st_size < sizeof (*sh) + sizeof (*snn)
+	    || (uint64_t) st.st_size > (size_t) -1) {
+		close (fd);
+		goto invalid;
+	}
+
+	base = mmap (NULL, (size_t) st.st_size, PROT_READ,
+		     MAP_PRIVATE, fd, 0);
+
+	/* The mapping remains valid. */
+	close (fd);
+
+	if (MAP_FAILED == base) {
+		set_errstr (ca, _("Cannot open file %s: %s."),
+			    file_name, strerror (errno));
+		return FALSE;
+	}
+
+	sh = base;
+	snn = (const snapshot_network *)((const uint8_t *) base
+					 + sizeof (*sh));
+
+	if (0 != memcmp (sh->magic, SNAPSHOT_MAGIC, sizeof (sh->magic))
+	    || SNAPSHOT_VERSION != sh->version
+	    || SNAPSHOT_BYTE_ORDER != sh->byte_order
+	    || sizeof (*sh) != sh->header_size
+	    || sizeof (*snn) != sh->network_size
+	    || sizeof (snapshot_page) != sh->page_size
+	    || (uint64_t) st.st_size != sh->file_size)
+		goto invalid_unmap;
+
+	data_start = sizeof (*sh) + sizeof (*snn)
+		+ sh->n_pages * (uint64_t) sizeof (snapshot_page);
+	if (data_start > sh->file_size)
+		goto invalid_unmap;
+
+	/* Don't confuse networks. A CNI may be unknown yet. */
+	if ((0 != snn->cni_vps && 0 != cn->network.cni_vps
+	     && snn->cni_vps != (uint32_t) cn->network.cni_vps)
+	    || (0 != snn->cni_8301 && 0 != cn->network.cni_8301
+		&& snn->cni_8301 != (uint32_t) cn->network.cni_8301)
+	    || (0 != snn->cni_8302 && 0 != cn->network.cni_8302
+		&& snn->cni_8302 != (uint32_t) cn->network.cni_8302)) {
+		set_errstr (ca, _("%s belongs to a different network."),
+			    file_name);
+		munmap (base, (size_t) st.st_size);
+		return FALSE;
+	}
+
+	sn = vbi_cache_malloc (sizeof (*sn));
+	if (NULL == sn) {
+		no_mem_error (ca);
+		munmap (base, (size_t) st.st_size);
+		return FALSE;
+	}
+
+	CLEAR (*sn);
+
+	sn->base = base;
+	sn->size = (size_t) st.st_size;
+	sn->pages = (const snapshot_page *)(snn + 1);
+	sn->n_pages = sh->n_pages;
+
+	for (i = 0; i < sn->n_pages; ++i) {
+		if (!valid_snapshot_page (&sn->pages[i],
+					  (i > 0) ? &sn->pages[i - 1] : NULL,
+					  data_start, sh->file_size)) {
+			vbi_cache_free (sn);
+			goto invalid_unmap;
+		}
+	}
+
+	sn->pending = vbi_cache_malloc (MAX (sn->n_pages, 1U));
+	if (NULL == sn->pending) {
+		no_mem_error (ca);
+		vbi_cache_free (sn);
+		munmap (base, (size_t) st.st_size);
+		return FALSE;
+	}
+
+	memset (sn->pending, TRUE, sn->n_pages);
+	sn->n_pending = sn->n_pages;
+	sn->ref_count = 1;
+
+	pthread_mutex_lock (&ca->mutex);
+
+	/* Restore the network state. */
+
+	memcpy (cn->channel_name, snn->channel_name,
+		sizeof (cn->channel_name));
+	memcpy (cn->status, snn->status, sizeof (cn->status));
+
+	cn->have_top = !!snn->have_top;
+	cn->initial_page = snn->initial_page;
+	memcpy (cn->btt_link, snn->btt_link, sizeof (cn->btt_link));
+	memcpy (cn->_magazines, snn->magazines, sizeof (cn->_magazines));
+
+	for (i = 0; i < N_ELEMENTS (snn->pages); ++i) {
+		struct ttx_page_stat *ps = &cn->_pages[i];
+
+		ps->page_type = snn->pages[i].page_type;
+		ps->charset_code = snn->pages[i].charset_code;
+		ps->subcode = snn->pages[i].subcode;
+		ps->flags = snn->pages[i].flags;
+	}
+
+	snapshot_delete (cn);
+
+	cn->snapshot = sn;
+
+	if (0 == sn->n_pages)
+		snapshot_delete (cn);
+	else
+		snapshot_consume_cached_pages (ca, cn);
+
+	pthread_mutex_unlock (&ca->mutex);
+
+	return TRUE;
+
+ invalid_unmap:
+	munmap (base, (size_t) st.st_size);
+
+ invalid:
+	set_errstr (ca, _("%s is not a valid Teletext cache file."),
+		    file_name);
+	errno = EINVAL;
+
+	return FALSE;
+}
+
+/* _vbi_cache_get_page() with ca->mutex locked. */
+static cache_page *
+get_page			(vbi_cache *		ca,
+				 cache_network *	cn,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 vbi_subno		subno_mask)
+{
+	cache_page *cp;
+
+	if (CACHE_DEBUG) {
+		fprintf (stderr, "Get %x.%x/%x ", pgno, subno, subno_mask);
+		_vbi_cache_dump (ca, stderr);
+		fputc (' ', stderr);
+		cache_network_dump (cn, stderr);
+		fputc ('\n', stderr);
+	}
+
+	cp = page_by_pgno (ca, cn, pgno, subno, subno_mask);
+	if (NULL == cp) {
+		if (NULL != cn->snapshot) {
+			/* Already referenced. */
+			cp = snapshot_get_page (ca, cn, pgno,
+						subno, subno_mask);
+		}
+
+		if (CACHE_DEBUG && NULL == cp)
+			fputs ("Page not cached\n", stderr);
+	} else {
+		if (CACHE_DEBUG) {
+			fputs ("Found ", stderr);
+			cache_page_dump (cp, stderr);
+			fputc ('\n', stderr);
+		}
+
+		cp = page_ref (cp);
+	}
 
-	pg = pg;
+	return cp;
 }
 
-#endif
-
 /**
  * @internal
  *
@@ -1313,33 +3137,70 @@ _vbi_cache_get_page		(vbi_cache *		ca,
 	if (VBI_ANY_SUBNO == subno)
 		subno_mask = 0;
 
-	if (CACHE_DEBUG) {
-		fprintf (stderr, "Get %x.%x/%x ", pgno, subno, subno_mask);
-		_vbi_cache_dump (ca, stderr);
-		fputc (' ', stderr);
-		cache_network_dump (cn, stderr);
-		fputc ('\n', stderr);
-	}
+	pthread_mutex_lock (&ca->mutex);
+
+	cp = get_page (ca, cn, pgno, subno, subno_mask);
+
+	pthread_mutex_unlock (&ca->mutex);
+
+	return cp;
+}
+
+/**
+ * @internal
+ *
+ * Like _vbi_cache_get_page() but returns only the version number of
+ * the page, without expanding a page stored in compact form.
+ *
+ * @return
+ * cache_page.version, zero when the requested page is not cached.
+ */
+unsigned int
+_vbi_cache_get_page_version	(vbi_cache *		ca,
+				 cache_network *	cn,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 vbi_subno		subno_mask)
+{
+	cache_page *cp;
+	unsigned int version;
+
+	assert (NULL != ca);
+	assert (NULL != cn);
+
+	assert (ca == cn->cache);
+
+	if (pgno < 0x100 || pgno > 0x8FF || 0xFF == (pgno & 0xFF))
+		return 0;
+
+	if (VBI_ANY_SUBNO == subno)
+		subno_mask = 0;
+
+	pthread_mutex_lock (&ca->mutex);
+
+	version = 0;
 
 	cp = page_by_pgno (ca, cn, pgno, subno, subno_mask);
-	if (NULL == cp) {
-		if (CACHE_DEBUG)
-			fputs ("Page not cached\n", stderr);
-		return NULL;
-	} else {
-		if (CACHE_DEBUG) {
-			fputs ("Found ", stderr);
-			cache_page_dump (cp, stderr);
-			fputc ('\n', stderr);
+	if (NULL != cp) {
+		version = cp->version;
+	} else if (NULL != cn->snapshot) {
+		cp = snapshot_get_page (ca, cn, pgno, subno, subno_mask);
+		if (NULL != cp) {
+			version = cp->version;
+			page_unref (ca, cp);
 		}
 	}
 
-	return cache_page_ref (cp);
+	pthread_mutex_unlock (&ca->mutex);
+
+	return version;
 }
 
 /**
  * @internal
- * For vbi_search.
+ * For vbi_search. The cache is locked while we look for the next
+ * page, because the decoding thread may add and delete pages, but
+ * not while @a callback runs.
  */
 int
 _vbi_cache_foreach_page		(vbi_cache *		ca,
@@ -1358,10 +3219,24 @@ _vbi_cache_foreach_page		(vbi_cache *		ca,
 	assert (NULL != cn);
 	assert (NULL != callback);
 
-	if (0 == cn->n_cached_pages)
+	if (pgno < 0x100 || pgno > 0x8FF) {
+		warning (&ca->log,
+			 "Invalid pgno 0x%x.", pgno);
+		return 0;
+	}
+
+	pthread_mutex_lock (&ca->mutex);
+
+	/* We visit all pages anyway. */
+	if (NULL != cn->snapshot)
+		snapshot_load_all (ca, cn);
+
+	if (0 == cn->n_cached_pages) {
+		pthread_mutex_unlock (&ca->mutex);
 		return 0;
+	}
 
-	if ((cp = _vbi_cache_get_page (ca, cn, pgno, subno, -1))) {
+	if ((cp = get_page (ca, cn, pgno, subno, -1))) {
 		subno = cp->subno;
 	} else if (VBI_ANY_SUBNO == subno) {
 		cp = NULL;
@@ -1376,6 +3251,8 @@ _vbi_cache_foreach_page		(vbi_cache *		ca,
 		if (cp) {
 			int r;
 
+			pthread_mutex_unlock (&ca->mutex);
+
 			r = callback (cp, wrapped, user_data);
 
 			cache_page_unref (cp);
@@ -1383,6 +3260,15 @@ _vbi_cache_foreach_page		(vbi_cache *		ca,
 
 			if (0 != r)
 				return r;
+
+			pthread_mutex_lock (&ca->mutex);
+
+			/* The decoding thread may have deleted
+			   all pages meanwhile. */
+			if (0 == cn->n_cached_pages) {
+				pthread_mutex_unlock (&ca->mutex);
+				return 0;
+			}
 		}
 
 		subno += dir;
@@ -1415,36 +3301,258 @@ _vbi_cache_foreach_page		(vbi_cache *		ca,
 			}
 		}
 
-		cp = _vbi_cache_get_page (ca, cn, pgno, subno, -1);
+		cp = get_page (ca, cn, pgno, subno, -1);
+	}
+}
+
+/* Returns the cache_page.changed_packets of page cp replacing
+   old_cp. Sets *clock_only when packet 0 differs only in the
+   real time clock, the last eight bytes of the page header. */
+static unsigned int
+changed_packets			(const cache_page *	old_cp,
+				 const cache_page *	cp,
+				 vbi_bool *		clock_only)
+{
+	cache_page tmp;
+	unsigned int size;
+	unsigned int changed;
+	unsigned int i;
+
+	*clock_only = FALSE;
+
+	size = expanded_page_size (cp);
+
+	/* Bits 0 ... 15 of the flags are the subno. */
+	if (cp->function != old_cp->function
+	    || cp->national != old_cp->national
+	    || 0 != ((cp->flags ^ old_cp->flags) & ~0xFFFF)
+	    || cp->x26_designations != old_cp->x26_designations
+	    || cp->x27_designations != old_cp->x27_designations
+	    || cp->x28_designations != old_cp->x28_designations
+	    || size != expanded_page_size (old_cp))
+		return ~0U;
+
+	if (old_cp->compact_size > 0) {
+		memcpy (&tmp, old_cp, sizeof (tmp) - sizeof (tmp.data));
+		expand_data (&tmp.data, old_cp);
+		old_cp = &tmp;
+	}
+
+	switch (cp->function) {
+	case PAGE_FUNCTION_UNKNOWN:
+	case PAGE_FUNCTION_LOP:
+		break;
+
+	default:
+		if (cp->lop_packets != old_cp->lop_packets)
+			return ~0U;
+
+		size -= offsetof (cache_page, data);
+		if (0 != memcmp (&cp->data, &old_cp->data, size))
+			return ~0U;
+
+		return 0;
+	}
+
+	/* Packets received now or before. */
+	changed = (cp->lop_packets ^ old_cp->lop_packets)
+		& ((1 << N_ELEMENTS (cp->data.lop.raw)) - 1);
+
+	for (i = 0; i < N_ELEMENTS (cp->data.lop.raw); ++i) {
+		if (0 != memcmp (cp->data.lop.raw[i],
+				 old_cp->data.lop.raw[i], 40))
+			changed |= 1 << i;
+	}
+
+	if ((changed & 1)
+	    && 0 == memcmp (cp->data.lop.raw[0],
+			    old_cp->data.lop.raw[0], 32))
+		*clock_only = TRUE;
+
+	/* Links and enhancements. */
+	size -= offsetof (cache_page, data.lop.link);
+	if (0 != memcmp (&cp->data.lop.link, &old_cp->data.lop.link, size))
+		changed |= CACHE_PAGE_OTHER_CHANGED;
+
+	return changed;
+}
+
+/* Subpage rotation. Most networks transmit subpages 0x01 ... N
+   in ascending order, each for the same time. We remember the
+   subpage received last and the average time from one subpage to
+   the next, so we can predict when a subpage will arrive. */
+
+/* Number of subpages in the rotation, at least 2 if the page has
+   subpages, see ttx_page_stat.subcode. */
+static unsigned int
+rotation_length			(const struct ttx_page_stat *ps)
+{
+	unsigned int n;
+
+	n = vbi_bcd2dec (ps->subno_max);
+
+	if (ps->subcode >= 0x02 && ps->subcode <= 0x79
+	    && vbi_is_bcd (ps->subcode))
+		n = MAX (n, (unsigned int) vbi_bcd2dec (ps->subcode));
+
+	return n;
+}
+
+/* Number of subpages from subpage a to b in rotation order. */
+static unsigned int
+rotation_steps			(unsigned int		n,
+				 vbi_subno		a,
+				 vbi_subno		b)
+{
+	return (vbi_bcd2dec (b) + n - vbi_bcd2dec (a)) % n;
+}
+
+static vbi_bool
+rotating_subno			(vbi_pgno		pgno,
+				 vbi_subno		subno)
+{
+	return (vbi_is_bcd (pgno)
+		&& subno >= 0x01 && subno <= 0x79
+		&& vbi_is_bcd (subno));
+}
+
+/* Called by put_page() when page cp has been stored. */
+static void
+update_rotation			(vbi_cache *		ca,
+				 cache_network *	cn,
+				 cache_page *		cp)
+{
+	struct ttx_page_stat *ps;
+	const cache_page_index_entry *e;
+	cache_page *next_cp;
+	unsigned int n;
+
+	if (cp->time <= 0.0 || !rotating_subno (cp->pgno, cp->subno))
+		return;
+
+	ps = cache_network_page_stat (cn, cp->pgno);
+
+	/* Subpages are usually repeated until the next one is due. */
+	if (cp->subno == ps->last_subno)
+		return;
+
+	n = rotation_length (ps);
+
+	if (0 != ps->last_subno && cp->time > ps->last_time) {
+		float interval;
+
+		interval = (cp->time - ps->last_time)
+			/ rotation_steps (n, ps->last_subno, cp->subno);
+
+		if (0 == ps->interval)
+			ps->interval = interval;
+		else
+			ps->interval = (ps->interval * 3 + interval) / 4;
 	}
+
+	ps->last_subno = cp->subno;
+	ps->last_time = cp->time;
+
+	/* The next subpage will be replaced soon anyway, so
+	   we delete it first when we need memory. Not with
+	   page_by_pgno(), that would make it the most recently
+	   used subpage. */
+	e = index_lookup (cn, index_key (cp->pgno, vbi_dec2bcd
+					 (vbi_bcd2dec (cp->subno) % n + 1)));
+	if (NULL == e)
+		return;
+
+	next_cp = e->cp;
+	if (0 == next_cp->ref_count
+	    && CACHE_PRI_ZOMBIE != next_cp->priority)
+		add_head (lru_list (ca, next_cp),
+			  unlink_node (&next_cp->pri_node));
 }
 
 /**
  * @internal
  * @param ca Cache.
- * @param cn Network this page belongs to.
- * @param cp Teletext page to store in the cache.
+ * @param cn Network.
+ * @param pgno Page number.
+ * @param subno Subpage number 0x01 ... 0x79.
+ * @param time The predicted time is stored here.
+ *
+ * Predicts when subpage @a subno of a page with rotating subpages
+ * will be received next, after the subpage received last. The
+ * time is in the same time base as the vbi_decode() timestamps.
  *
- * Puts a copy of @a cp in the cache.
- * 
  * @returns
- * cache_page pointer (in the cache, not @a cp), @c NULL on failure
- * (out of memory). You must unref the returned page if no longer needed.
+ * @c FALSE if the page has no subpages or we did not see the
+ * rotation yet.
  */
-cache_page *
-_vbi_cache_put_page		(vbi_cache *		ca,
+vbi_bool
+_vbi_cache_predict_subpage	(vbi_cache *		ca,
 				 cache_network *	cn,
-				 const cache_page *	cp)
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 double *		time)
+{
+	const struct ttx_page_stat *ps;
+	vbi_bool success;
+	unsigned int n;
+
+	assert (NULL != ca);
+	assert (NULL != cn);
+	assert (NULL != time);
+
+	if (pgno < 0x100 || pgno > 0x8FF
+	    || !rotating_subno (pgno, subno))
+		return FALSE;
+
+	success = FALSE;
+
+	pthread_mutex_lock (&ca->mutex);
+
+	ps = cache_network_const_page_stat (cn, pgno);
+
+	n = rotation_length (ps);
+
+	if (ps->interval > 0 && (unsigned int) vbi_bcd2dec (subno) <= n) {
+		unsigned int steps;
+
+		steps = rotation_steps (n, ps->last_subno, subno);
+		if (0 == steps)
+			steps = n;
+
+		*time = ps->last_time + ps->interval * steps;
+		success = TRUE;
+	}
+
+	pthread_mutex_unlock (&ca->mutex);
+
+	return success;
+}
+
+/* _vbi_cache_put_page() with ca->mutex locked. Referenced pages are
+   never modified, a new version replaces them in the index and they
+   become zombies. So clients can read a page without holding the
+   lock. */
+static cache_page *
+put_page			(vbi_cache *		ca,
+				 cache_network *	cn,
+				 const cache_page *	cp,
+				 unsigned int *		diff)
 {
 	cache_page *death_row[20];
 	unsigned int death_count;
 	cache_page *old_cp;
 	long memory_available;	/* NB can be < 0 */
 	long memory_needed;
-	cache_priority pri;
+	unsigned int page_size;
 	cache_page *new_cp;
 	vbi_subno subno;
 	vbi_subno subno_mask;
+	unsigned int version;
+	unsigned int prev_version;
+	unsigned int changed;
+	unsigned int diff_packets;
+	vbi_bool clock_only;
+	unsigned int i;
 
 	assert (NULL != ca);
 	assert (NULL != cn);
@@ -1452,7 +3560,16 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 
 	assert (ca == cn->cache);
 
-	memory_needed = cache_page_size (cp);
+	page_size = expanded_page_size (cp);
+
+	/* Referenced pages don't count, we need room for the page
+	   when the caller unreferences it. If compression is enabled
+	   that's an upper bound, we compress the page only once,
+	   then. */
+	memory_needed = page_size;
+	if (pinned_page (cp))
+		memory_needed = 0;
+
 	memory_available = ca->memory_limit - ca->memory_used;
 
 	death_count = 0;
@@ -1476,49 +3593,36 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 		return NULL;
 	}
 
-	subno = cp->subno;
-	subno_mask = 0;
+	subno = stored_subno (cn, cp->pgno, cp->subno, &subno_mask);
 
-	if (likely (vbi_is_bcd (cp->pgno))) {
-		if (likely (0 == subno)) {
-			/* The page has no subpages or is a clock page
-			   at 00:00. We store only one version. */
-		} else {
-			const struct ttx_page_stat *ps;
-			vbi_page_type page_type;
-
-			ps = cache_network_const_page_stat (cn, cp->pgno);
-			page_type = ps->page_type;
-
-			if (VBI_CLOCK_PAGE == page_type
-			    || subno >= 0x0100) {
-				/* A clock page or a rolling page without
-				   subpages (Section A.1 Note 1).
-				   One version. */
-				if (vbi_bcd_digits_greater (subno, 0x2959)
-				    || subno > 0x2300)
-					subno = 0; /* invalid */
-			} else if (vbi_bcd_digits_greater (subno, 0x79)) {
-				/* A rolling page without subpages.
-				   One version. */
-				subno = 0; /* invalid */
-			} else {
-				/* A page with subpages or an unmarked
-				   clock page between 00:00 and 00:59.
-				   We store all versions. */
-				subno_mask = 0xFF;
-			}
-		}
-	} else {
-		/* S1 element is the subpage number. */
-		subno_mask = 0x000F;
-	}
+	/* The page and maybe its subpage ring. */
+	if (!index_reserve (ca, cn, 2))
+		return NULL;
 
 	old_cp = page_by_pgno (ca, cn,
 			       cp->pgno,
 			       subno & subno_mask,
 			       subno_mask);
-	if (NULL != old_cp) {
+	if (NULL == old_cp) {
+		version = 0;
+		prev_version = 0;
+		changed = ~0U;
+		diff_packets = ~0U;
+	} else {
+		/* We may reuse old_cp below. */
+		changed = changed_packets (old_cp, cp, &clock_only);
+		diff_packets = clock_only ? changed & ~1U : changed;
+		if (0 == changed) {
+			/* Retransmission, clients need not
+			   reformat the page. */
+			version = old_cp->version;
+			prev_version = old_cp->prev_version;
+			changed = old_cp->changed_packets;
+		} else {
+			version = 0;
+			prev_version = old_cp->version;
+		}
+
 		if (CACHE_DEBUG) {
 			fputs ("is cached ", stderr);
 			cache_page_dump (old_cp, stderr);
@@ -1529,32 +3633,31 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 			/* This page is still in use. We remove it from
 			   the cache and mark it for deletion when unref'd.
 			   old_cp->pri_node remains on ca->referenced. */
-			unlink_node (&old_cp->hash_node);
+			index_remove_page (cn, old_cp);
 
 			old_cp->priority = CACHE_PRI_ZOMBIE;
 			old_cp = NULL;
 		} else {
 			/* Got our first replacement candidate. */
 			death_row[death_count++] = old_cp;
-			memory_available += cache_page_size (old_cp);
+			memory_available += lru_page_size (old_cp);
 		}
 	}
 
 	if (memory_available >= memory_needed)
 		goto replace;
 
-	/* Find more pages to replace until we have enough memory. */
+	/* Find more pages to replace until we have enough memory,
+	   oldest first. */
 
-	for (pri = CACHE_PRI_NORMAL; pri <= CACHE_PRI_SPECIAL; ++pri) {
+	for (i = 0; i < CACHE_LRU_PINNED; ++i) {
 		cache_page *cp, *cp1;
 
-		FOR_ALL_NODES (cp, cp1, &ca->priority, pri_node) {
+		FOR_ALL_NODES (cp, cp1, &ca->priority[i], pri_node) {
 			if (memory_available >= memory_needed)
 				goto replace;
 
-			if (pri != cp->priority
-			    || cp->network->ref_count > 0
-			    || cp == old_cp)
+			if (cp == old_cp)
 				continue;
 
 			assert (death_count < N_ELEMENTS (death_row));
@@ -1564,23 +3667,8 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 		}
 	}
 
-	for (pri = CACHE_PRI_NORMAL; pri <= CACHE_PRI_SPECIAL; ++pri) {
-		cache_page *cp, *cp1;
-
-		FOR_ALL_NODES (cp, cp1, &ca->priority, pri_node) {
-			if (memory_available >= memory_needed)
-				goto replace;
-
-			if (pri != cp->priority
-			    || cp == old_cp)
-				continue;
-
-			assert (death_count < N_ELEMENTS (death_row));
-
-			death_row[death_count++] = cp;
-			memory_available += cache_page_size (cp);
-		}
-	}
+	if (memory_available >= memory_needed)
+		goto replace;
 
 	if (CACHE_DEBUG) {
 		fprintf (stderr, "need %lu bytes but only %lu available ",
@@ -1590,8 +3678,9 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 	goto failure;
 
  replace:
-	if (likely (memory_available == memory_needed
-		    && 1 == death_count)) {
+	if (likely (1 == death_count
+		    && 0 == death_row[0]->compact_size
+		    && cache_page_size (death_row[0]) == page_size)) {
 		/* Usually we can replace a single page of same size. */
 
 		new_cp = death_row[0];
@@ -1603,15 +3692,13 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 		}
 
 		unlink_node (&new_cp->pri_node);
-		unlink_node (&new_cp->hash_node);
+		index_remove_page (new_cp->network, new_cp);
 
 		cache_network_remove_page (new_cp->network, new_cp);
 
-		ca->memory_used -= memory_needed;
+		ca->memory_used -= lru_page_size (new_cp);
 	} else {
-		unsigned int i;
-
-		if (!(new_cp = vbi_cache_malloc ((size_t) memory_needed))) {
+		if (!(new_cp = alloc_page (ca, page_size))) {
 			no_mem_error (ca);
 			goto failure;
 		}
@@ -1622,8 +3709,6 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 		++ca->n_cached_pages;
 	}
 
-	add_head (ca->hash + hash (cp->pgno), &new_cp->hash_node);
-
 	/* 100, 200, 300, ... magazine start page. */
 	if (0x00 == (cp->pgno & 0xFF))
 		new_cp->priority = CACHE_PRI_SPECIAL;
@@ -1658,8 +3743,23 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 	new_cp->x27_designations	= cp->x27_designations;
 	new_cp->x28_designations	= cp->x28_designations;
 
+	new_cp->time			= cp->time;
+
 	memcpy (&new_cp->data, &cp->data,
-		memory_needed - (sizeof (*new_cp) - sizeof (new_cp->data)));
+		page_size - (sizeof (*new_cp) - sizeof (new_cp->data)));
+	new_cp->compact_size = 0;
+
+	if (0 == version) {
+		/* Zero means no version. */
+		if (0 == ++ca->page_version)
+			++ca->page_version;
+
+		version = ca->page_version;
+	}
+
+	new_cp->version = version;
+	new_cp->prev_version = prev_version;
+	new_cp->changed_packets = changed;
 
 	new_cp->ref_count = 1;
 	ca->memory_used += 0; /* see _vbi_cache_get_page() */
@@ -1670,6 +3770,14 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 
 	cache_network_add_page (cn, new_cp);
 
+	index_add_page (cn, new_cp);
+
+	update_rotation (ca, cn, new_cp);
+
+	/* This page is newer than any version in a snapshot. */
+	if (NULL != cn->snapshot)
+		snapshot_consume (cn, new_cp->pgno, subno, subno_mask);
+
 	if (CACHE_DEBUG) {
 		fputc ('\n', stderr);
 	}
@@ -1684,6 +3792,9 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 		fputc ('\n', stderr);
 	}
 
+	if (NULL != diff)
+		*diff = diff_packets;
+
 	return new_cp;
 
  failure:
@@ -1694,6 +3805,44 @@ _vbi_cache_put_page		(vbi_cache *		ca,
 	return NULL;
 }
 
+/**
+ * @internal
+ * @param ca Cache.
+ * @param cn Network this page belongs to.
+ * @param cp Teletext page to store in the cache.
+ * @param diff If not @c NULL, the packets of @a cp which differ
+ *   from the cached page it replaces are stored here, as in
+ *   cache_page.changed_packets, but excluding packet 0 if only the
+ *   real time clock in the page header changed. Zero if the page
+ *   is a retransmission, all ones if it was not cached.
+ *
+ * Puts a copy of @a cp in the cache.
+ * 
+ * @returns
+ * cache_page pointer (in the cache, not @a cp), @c NULL on failure
+ * (out of memory). You must unref the returned page if no longer needed.
+ */
+cache_page *
+_vbi_cache_put_page		(vbi_cache *		ca,
+				 cache_network *	cn,
+				 const cache_page *	cp,
+				 unsigned int *		diff)
+{
+	cache_page *new_cp;
+
+	assert (NULL != ca);
+	assert (NULL != cn);
+	assert (NULL != cp);
+
+	pthread_mutex_lock (&ca->mutex);
+
+	new_cp = put_page (ca, cn, cp, diff);
+
+	pthread_mutex_unlock (&ca->mutex);
+
+	return new_cp;
+}
+
 /** @internal */
 void
 _vbi_cache_dump			(const vbi_cache *	ca,
@@ -1804,11 +3953,15 @@ vbi_cache_delete		(vbi_cache *		ca)
 #endif
 
 	list_destroy (&ca->networks);
-	list_destroy (&ca->priority);
+	for (i = 0; i < CACHE_LRU_LISTS; ++i)
+		list_destroy (&ca->priority[i]);
 	list_destroy (&ca->referenced);
 
-	for (i = 0; i < N_ELEMENTS (ca->hash); ++i)
-		list_destroy (ca->hash + i);
+	destroy_page_pools (ca);
+
+	vbi_free (ca->errstr);
+
+	pthread_mutex_destroy (&ca->mutex);
 
 	CLEAR (*ca);
 
@@ -1877,19 +4030,20 @@ vbi_cache_new			(void)
 
 	CLEAR (*ca);
 
+	pthread_mutex_init (&ca->mutex, NULL);
+
 	if (CACHE_DEBUG) {
 		ca->log.fn = vbi_log_on_stderr;
 		ca->log.mask = -1; /* all */
 	}
 
-	for (i = 0; i < N_ELEMENTS (ca->hash); ++i) {
-		list_init (ca->hash + i);
-	}
-
 	list_init (&ca->referenced);
-	list_init (&ca->priority);
+	for (i = 0; i < CACHE_LRU_LISTS; ++i)
+		list_init (&ca->priority[i]);
 	list_init (&ca->networks);
 
+	init_page_pools (ca);
+
 	ca->memory_limit = 1 << 30;
 	ca->n_networks_limit = 1;
 
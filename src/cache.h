@@ -569,6 +569,10 @@ vbi_cache_set_memory_limit	(vbi_cache *		ca,
 				 unsigned long		limit)
   _vbi_nonnull ((1));
 extern void
+vbi_cache_set_compression	(vbi_cache *		ca,
+				 vbi_bool		enable)
+  _vbi_nonnull ((1));
+extern void
 vbi_cache_set_network_limit	(vbi_cache *		ca,
 				 unsigned int		limit)
   _vbi_nonnull ((1));
@@ -586,6 +590,12 @@ vbi_cache_set_network_limit	(vbi_cache *		ca,
 extern void             vbi_unref_page(vbi_page *pg);
 extern int              vbi_is_cached(vbi_decoder *, int pgno, int subno);
 extern int              vbi_cache_hi_subno(vbi_decoder *vbi, int pgno);
+extern vbi_bool         vbi_cache_predict_subpage(vbi_decoder *vbi, vbi_pgno pgno,
+						  vbi_subno subno, double *time);
+extern vbi_bool         vbi_save_cache(vbi_decoder *vbi, const char *file_name);
+extern vbi_bool         vbi_load_cache(vbi_decoder *vbi, const char *file_name);
+extern void             vbi_set_cache_memory_limit(vbi_decoder *vbi, unsigned long limit);
+extern void             vbi_set_cache_compression(vbi_decoder *vbi, vbi_bool enable);
 /** @} */
 
 /* Private */
@@ -47,11 +47,11 @@ static inline void
 caption_send_event(vbi_decoder *vbi, vbi_event *ev)
 {
 	/* Permits calling vbi_fetch_cc_page from handler */
-	pthread_mutex_unlock(&vbi->cc.mutex);
+	pthread_mutex_unlock(&vbi->cc->mutex);
 
 	vbi_send_event(vbi, ev);
 
-	pthread_mutex_lock(&vbi->cc.mutex);
+	pthread_mutex_lock(&vbi->cc->mutex);
 }
 
 /*
@@ -140,7 +140,7 @@ flush_prog_info(vbi_decoder *vbi, vbi_program_info *pi, vbi_event *e)
 		caption_send_event(vbi, e);
 	}
 
-	vbi->cc.info_cycle[pi->future] = 0;
+	vbi->cc->info_cycle[pi->future] = 0;
 }
 
 static inline void
@@ -162,7 +162,7 @@ xds_decoder(vbi_decoder *vbi, int _class, int type,
 	switch (_class) {
 	case XDS_CURRENT: /* 0 */
 	case XDS_FUTURE: /* 1 */
-		if (!(vbi->event_mask & (VBI_EVENT_ASPECT | VBI_EVENT_PROG_INFO)))
+		if (!(_vbi_event_mask(vbi) & (VBI_EVENT_ASPECT | VBI_EVENT_PROG_INFO)))
 			return;
 
 		pi = &vbi->prog_info[_class];
@@ -245,16 +245,16 @@ xds_decoder(vbi_decoder *vbi, int _class, int type,
 			neq = xds_strfu(pi->title, buffer, length);
 
 			if (!neq) { /* no title change */
-				if (!(vbi->cc.info_cycle[_class] & (1 << 3)))
+				if (!(vbi->cc->info_cycle[_class] & (1 << 3)))
 					break; /* already reported */
 
-				if (!(vbi->cc.info_cycle[_class] & (1 << 1))) {
+				if (!(vbi->cc->info_cycle[_class] & (1 << 1))) {
 					/* Second occurence without PIN */
 
 					flush_prog_info(vbi, pi, &e);
 
 					xds_strfu(pi->title, buffer, length);
-					vbi->cc.info_cycle[_class] |= 1 << 3;
+					vbi->cc->info_cycle[_class] |= 1 << 3;
 				}
 			}
 
@@ -404,7 +404,7 @@ xds_decoder(vbi_decoder *vbi, int _class, int type,
 				}
 
 				if (_class == XDS_CURRENT)
-					vbi->cc.channel[ch].language =
+					vbi->cc->channel[ch].language =
 						pi->caption_language[ch];
 			}
 
@@ -468,11 +468,11 @@ xds_decoder(vbi_decoder *vbi, int _class, int type,
 
 		if (0)
 			printf("[type %d cycle %08x class %d neq %d]\n",
-			       type, vbi->cc.info_cycle[_class], _class, neq);
+			       type, vbi->cc->info_cycle[_class], _class, neq);
 
 		if (neq) /* first occurence of this type with this data */
-			vbi->cc.info_cycle[_class] |= 1 << type;
-		else if (vbi->cc.info_cycle[_class] & (1 << type)) {
+			vbi->cc->info_cycle[_class] |= 1 << type;
+		else if (vbi->cc->info_cycle[_class] & (1 << type)) {
 			/* Second occurance of this type with same data */
 
 			e.type = VBI_EVENT_PROG_INFO;
@@ -480,7 +480,7 @@ xds_decoder(vbi_decoder *vbi, int _class, int type,
 
 			caption_send_event(vbi, &e);
 
-			vbi->cc.info_cycle[_class] = 0; /* all changes reported */
+			vbi->cc->info_cycle[_class] = 0; /* all changes reported */
 		}
 
 		break;
@@ -583,7 +583,7 @@ xds_decoder(vbi_decoder *vbi, int _class, int type,
 static void
 xds_separator(vbi_decoder *vbi, uint8_t *buf)
 {
-	struct caption *cc = &vbi->cc;
+	struct caption *cc = vbi->cc;
 	xds_sub_packet *sp = cc->curr_sp;
 	int c1 = vbi_unpar8 (buf[0]);
 	int c2 = vbi_unpar8 (buf[1]);
@@ -687,7 +687,7 @@ xds_separator(vbi_decoder *vbi, uint8_t *buf)
 static void
 itv_separator(vbi_decoder *vbi, struct caption *cc, char c)
 {
-	if (ITV_DEBUG(0 &&) !(vbi->event_mask & VBI_EVENT_TRIGGER))
+	if (ITV_DEBUG(0 &&) !(_vbi_event_mask(vbi) & VBI_EVENT_TRIGGER))
 		return;
 
 	if (c >= 0x20) {
@@ -1254,10 +1254,13 @@ caption_command(vbi_decoder *vbi, struct caption *cc,
 void
 vbi_decode_caption(vbi_decoder *vbi, int line, uint8_t *buf)
 {
-	struct caption *cc = &vbi->cc;
+	struct caption *cc = vbi->cc;
 	char c1 = buf[0] & 0x7F;
 	int field2 = 1, i;
 
+	if (NULL == cc)
+		return;
+
 	pthread_mutex_lock(&cc->mutex);
 
 	switch (line) {
@@ -1403,7 +1406,10 @@ vbi_decode_caption(vbi_decoder *vbi, int line, uint8_t *buf)
 void
 vbi_caption_desync(vbi_decoder *vbi)
 {
-	struct caption *cc = &vbi->cc;
+	struct caption *cc = vbi->cc;
+
+	if (NULL == cc)
+		return;
 
 	/* cc->curr_chan = 8; *//* garbage */
 
@@ -1427,10 +1433,13 @@ vbi_caption_desync(vbi_decoder *vbi)
 void
 vbi_caption_channel_switched(vbi_decoder *vbi)
 {
-	struct caption *cc = &vbi->cc;
+	struct caption *cc = vbi->cc;
 	cc_channel *ch;
 	int i;
 
+	if (NULL == cc)
+		return;
+
 	for (i = 0; i < 9; i++) {
 		ch = &cc->channel[i];
 
@@ -1494,12 +1503,15 @@ vbi_caption_color_level(vbi_decoder *vbi)
 {
 	int i;
 
-	vbi_transp_colormap(vbi, vbi->cc.channel[0].pg[0].color_map,
+	if (NULL == vbi->cc)
+		return;
+
+	vbi_transp_colormap(vbi, vbi->cc->channel[0].pg[0].color_map,
 			    default_color_map, 8);
 
 	for (i = 1; i < 16; i++)
-		memcpy(vbi->cc.channel[i >> 1].pg[i & 1].color_map,
-		       vbi->cc.channel[0].pg[0].color_map,
+		memcpy(vbi->cc->channel[i >> 1].pg[i & 1].color_map,
+		       vbi->cc->channel[0].pg[0].color_map,
 		       sizeof(default_color_map));
 }
 
@@ -1513,7 +1525,13 @@ vbi_caption_color_level(vbi_decoder *vbi)
 void
 vbi_caption_destroy(vbi_decoder *vbi)
 {
-	pthread_mutex_destroy(&vbi->cc.mutex);
+	if (NULL == vbi->cc)
+		return;
+
+	pthread_mutex_destroy(&vbi->cc->mutex);
+
+	free(vbi->cc);
+	vbi->cc = NULL;
 }
 
 /**
@@ -1521,16 +1539,24 @@ vbi_caption_destroy(vbi_decoder *vbi)
  * @param vbi VBI decoding context.
  * 
  * This function is called during @a vbi initialization
- * to initialize the Closed Caption subset of @a vbi.
+ * to initialize the Closed Caption subset of @a vbi. Decoders
+ * without this subset ignore Closed Caption data.
+ *
+ * @return
+ * @c FALSE if out of memory.
  */
-void
+vbi_bool
 vbi_caption_init(vbi_decoder *vbi)
 {
-	struct caption *cc = &vbi->cc;
+	struct caption *cc;
 	cc_channel *ch;
 	int i;
 
-	memset(cc, 0, sizeof(struct caption));
+	cc = (struct caption *) calloc(1, sizeof(struct caption));
+	if (NULL == cc)
+		return FALSE;
+
+	vbi->cc = cc;
 
 	pthread_mutex_init(&cc->mutex, NULL);
 
@@ -1566,6 +1592,8 @@ vbi_caption_init(vbi_decoder *vbi)
 	vbi_caption_channel_switched(vbi);
 
 	vbi_caption_color_level(vbi);
+
+	return TRUE;
 }
 
 /**
@@ -1596,15 +1624,17 @@ vbi_caption_init(vbi_decoder *vbi)
 vbi_bool
 vbi_fetch_cc_page(vbi_decoder *vbi, vbi_page *pg, vbi_pgno pgno, vbi_bool reset)
 {
-	cc_channel *ch = vbi->cc.channel + ((pgno - 1) & 7);
+	cc_channel *ch;
 	vbi_page *spg;
 
 	reset = reset;
 
-	if (pgno < 1 || pgno > 8)
+	if (NULL == vbi->cc || pgno < 1 || pgno > 8)
 		return FALSE;
 
-	pthread_mutex_lock(&vbi->cc.mutex);
+	ch = vbi->cc->channel + ((pgno - 1) & 7);
+
+	pthread_mutex_lock(&vbi->cc->mutex);
 
 	spg = ch->pg + (ch->hidden ^ 1);
 
@@ -1614,7 +1644,7 @@ vbi_fetch_cc_page(vbi_decoder *vbi, vbi_page *pg, vbi_pgno pgno, vbi_bool reset)
 	spg->dirty.y1 = -1;
 	spg->dirty.roll = 0;
 
-	pthread_mutex_unlock(&vbi->cc.mutex);
+	pthread_mutex_unlock(&vbi->cc->mutex);
 
 	return 1;
 }
@@ -97,7 +97,7 @@ extern vbi_bool		vbi_fetch_cc_page(vbi_decoder *vbi, vbi_page *pg,
 
 /* Private */
 
-extern void		vbi_caption_init(vbi_decoder *vbi);
+extern vbi_bool		vbi_caption_init(vbi_decoder *vbi);
 extern void		vbi_caption_destroy(vbi_decoder *vbi);
 extern void		vbi_decode_caption(vbi_decoder *vbi, int line, uint8_t *buf);
 extern void		vbi_caption_desync(vbi_decoder *vbi);
@@ -0,0 +1,131 @@
+/*
+ *  libzvbi -- CPU feature detection
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the 
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+ *  Boston, MA  02110-1301  USA.
+ */
+
+/* $Id$ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdlib.h>		/* getenv() */
+#include <string.h>
+#include <pthread.h>
+
+#include "misc.h"
+#include "cpu.h"
+
+/* Functions with a SIMD version call _vbi_cpu_features() to choose
+   one, once at initialization if they are called often. For testing,
+   the environment variable ZVBI_CPU can restrict the features the
+   library uses to a comma separated list such as "sse2". Any value
+   not naming a feature, for example "generic", selects the plain C
+   versions. */
+
+static const _vbi_key_value_pair
+cpu_feature_names [] = {
+	{ "sse2",	_VBI_CPU_SSE2 },
+	{ "ssse3",	_VBI_CPU_SSSE3 },
+	{ "avx2",	_VBI_CPU_AVX2 },
+	{ NULL,		0 }
+};
+
+static unsigned int		cpu_features;
+static pthread_once_t		cpu_features_once = PTHREAD_ONCE_INIT;
+
+static unsigned int
+detect_cpu_features		(void)
+{
+	unsigned int features = 0;
+
+#if defined (HAVE_X86_SIMD)
+	__builtin_cpu_init ();
+
+	if (__builtin_cpu_supports ("sse2"))
+		features |= _VBI_CPU_SSE2;
+	if (__builtin_cpu_supports ("ssse3"))
+		features |= _VBI_CPU_SSSE3;
+	if (__builtin_cpu_supports ("avx2"))
+		features |= _VBI_CPU_AVX2;
+#endif
+
+	return features;
+}
+
+static unsigned int
+parse_cpu_features		(const char *		s)
+{
+	unsigned int features = 0;
+
+	while (0 != *s) {
+		size_t len;
+		unsigned int i;
+
+		len = strcspn (s, ", ");
+
+		for (i = 0; NULL != cpu_feature_names[i].key; ++i) {
+			const char *key = cpu_feature_names[i].key;
+
+			if (strlen (key) == len
+			    && 0 == strncmp (s, key, len))
+				features |= cpu_feature_names[i].value;
+		}
+
+		s += len;
+		s += strspn (s, ", ");
+	}
+
+	return features;
+}
+
+static void
+init_cpu_features		(void)
+{
+	const char *s;
+
+	cpu_features = detect_cpu_features ();
+
+	s = getenv ("ZVBI_CPU");
+	if (NULL != s)
+		cpu_features &= parse_cpu_features (s);
+}
+
+/**
+ * @internal
+ *
+ * Detects the SIMD extensions of the CPU when called for the first
+ * time, minus any disabled with the ZVBI_CPU environment variable.
+ * This function is thread safe.
+ *
+ * @return
+ * Set of _vbi_cpu_feature flags.
+ */
+unsigned int
+_vbi_cpu_features		(void)
+{
+	pthread_once (&cpu_features_once, init_cpu_features);
+
+	return cpu_features;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
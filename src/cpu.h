@@ -0,0 +1,48 @@
+/*
+ *  libzvbi -- CPU feature detection
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the 
+ *  Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+ *  Boston, MA  02110-1301  USA.
+ */
+
+/* $Id$ */
+
+#ifndef __ZVBI_CPU_H__
+#define __ZVBI_CPU_H__
+
+#include "macros.h"
+
+VBI_BEGIN_DECLS
+
+/** @internal */
+typedef enum {
+	_VBI_CPU_SSE2		= (1 << 0),
+	_VBI_CPU_AVX2		= (1 << 1),
+	_VBI_CPU_SSSE3		= (1 << 2),
+} _vbi_cpu_feature;
+
+extern unsigned int
+_vbi_cpu_features		(void);
+
+VBI_END_DECLS
+
+#endif /* __ZVBI_CPU_H__ */
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
@@ -581,6 +581,13 @@ extern void		vbi_reset_prog_info(vbi_program_info *pi);
  * vbi_fetch_vt_page() for proper translation of national characters
  * and character attributes, the raw header is only provided here
  * as a means to quickly detect changes.
+ *
+ * ev.ttx_page.dirty_rows is the set of rows which changed since the
+ * page was last received, 1 << row 0 ... 24 as in vbi_update_vt_page().
+ * Changes of the real time clock alone do not count. All rows are
+ * dirty if the page was not cached or other data than the rows
+ * changed, none if the page is a retransmission. Retransmissions
+ * need not be reported at all, see vbi_teletext_set_changes_only().
  */
 #define	VBI_EVENT_TTX_PAGE	0x0002
 /**
@@ -744,6 +751,7 @@ typedef struct vbi_event {
 			unsigned int		roll_header : 1;
 		        unsigned int		header_update : 1;
 			unsigned int		clock_update : 1;
+			unsigned int		dirty_rows;
 	        }			ttx_page;
 		struct {
 			int			pgno;
@@ -778,6 +786,27 @@ extern vbi_bool		vbi_event_handler_register(vbi_decoder *vbi, int event_mask,
 extern void		vbi_event_handler_unregister(vbi_decoder *vbi,
 						     vbi_event_handler handler,
 						     void *user_data);
+extern vbi_bool
+vbi_event_queue_start		(vbi_decoder *		vbi,
+				 unsigned int		max_events);
+extern void
+vbi_event_queue_stop		(vbi_decoder *		vbi);
+extern void
+vbi_event_queue_get_stats	(vbi_decoder *		vbi,
+				 unsigned int *		depth,
+				 unsigned int *		dropped,
+				 unsigned int *		coalesced);
+extern vbi_bool
+vbi_event_handler_register_queued
+				(vbi_decoder *		vbi,
+				 int			event_mask,
+				 vbi_event_handler	handler,
+				 void *			user_data);
+extern void
+vbi_event_handler_unregister_queued
+				(vbi_decoder *		vbi,
+				 vbi_event_handler	handler,
+				 void *			user_data);
 /** @} */
 
 /* Private */
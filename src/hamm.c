@@ -25,10 +25,119 @@
 #  include "config.h"
 #endif
 
+#include <assert.h>
 #include <limits.h>		/* CHAR_BIT */
 
+#if defined (HAVE_X86_SIMD)
+#  include <immintrin.h>
+#endif
+
 #include "hamm.h"
 #include "hamm-tables.h"
+#include "cpu.h"
+
+/* SIMD versions of vbi_par() and vbi_unpar() for n a multiple of 16.
+   The parity of each byte is calculated by folding its bits. */
+
+#if defined (HAVE_X86_SIMD)
+
+static void __attribute__ ((target ("sse2")))
+par_sse2			(uint8_t *		p,
+				 unsigned int		n)
+{
+	const __m128i m0f = _mm_set1_epi8 (0x0F);
+	const __m128i m01 = _mm_set1_epi8 (0x01);
+
+	for (; n > 0; p += 16, n -= 16) {
+		__m128i c, t;
+
+		c = _mm_loadu_si128 ((const __m128i *) p);
+
+		/* Bit 0 of each byte 1 if odd parity, 16 bit shifts
+		   carry only garbage into the bits we discard. */
+		t = _mm_and_si128 (_mm_xor_si128 (c, _mm_srli_epi16 (c, 4)),
+				   m0f);
+		t = _mm_xor_si128 (t, _mm_srli_epi16 (t, 2));
+		t = _mm_xor_si128 (t, _mm_srli_epi16 (t, 1));
+
+		/* If even change msb. */
+		t = _mm_slli_epi16 (_mm_andnot_si128 (t, m01), 7);
+
+		_mm_storeu_si128 ((__m128i *) p, _mm_xor_si128 (c, t));
+	}
+}
+
+static int __attribute__ ((target ("sse2")))
+unpar_sse2			(uint8_t *		p,
+				 unsigned int		n)
+{
+	const __m128i m0f = _mm_set1_epi8 (0x0F);
+	const __m128i m01 = _mm_set1_epi8 (0x01);
+	const __m128i m7f = _mm_set1_epi8 (0x7F);
+	__m128i even = _mm_setzero_si128 ();
+
+	for (; n > 0; p += 16, n -= 16) {
+		__m128i c, t;
+
+		c = _mm_loadu_si128 ((const __m128i *) p);
+
+		t = _mm_and_si128 (_mm_xor_si128 (c, _mm_srli_epi16 (c, 4)),
+				   m0f);
+		t = _mm_xor_si128 (t, _mm_srli_epi16 (t, 2));
+		t = _mm_xor_si128 (t, _mm_srli_epi16 (t, 1));
+
+		even = _mm_or_si128 (even, _mm_andnot_si128 (t, m01));
+
+		_mm_storeu_si128 ((__m128i *) p, _mm_and_si128 (c, m7f));
+	}
+
+	if (0xFFFF != _mm_movemask_epi8 (_mm_cmpeq_epi8
+					 (even, _mm_setzero_si128 ())))
+		return INT_MIN;
+
+	return 0;
+}
+
+#endif /* HAVE_X86_SIMD */
+
+static void
+par_c				(uint8_t *		p,
+				 unsigned int		n)
+{
+	while (n-- > 0) {
+		uint8_t c = *p;
+
+		/* if 0 == (inv_par[] & 32) change msb of *p. */
+		*p++ = c ^ (128 & ~(_vbi_hamm24_inv_par[0][c] << 2));
+	}
+}
+
+static int
+unpar_c				(uint8_t *		p,
+				 unsigned int		n)
+{
+	int r = 0;
+
+	while (n-- > 0) {
+		uint8_t c = *p;
+
+		/* if 0 == (inv_par[] & 32) set msb of r. */
+		r |= ~ _vbi_hamm24_inv_par[0][c]
+			<< (sizeof (int) * CHAR_BIT - 1 - 5);
+
+		*p++ = c & 127;
+	}
+
+	return r;
+}
+
+/* The versions of par_c() and unpar_c() for n a multiple of 16
+   which init_hamm() selects for this CPU, so we need not check
+   the CPU features on each call. */
+static void (* par_block) (uint8_t *p, unsigned int n) = par_c;
+static int (* unpar_block) (uint8_t *p, unsigned int n) = unpar_c;
+
+static void init_hamm (void) __attribute__ ((constructor));
 
 /**
  * @ingroup Error
@@ -45,12 +154,10 @@ void
 vbi_par				(uint8_t *		p,
 				 unsigned int		n)
 {
-	while (n-- > 0) {
-		uint8_t c = *p;
+	unsigned int n16 = n & ~15;
 
-		/* if 0 == (inv_par[] & 32) change msb of *p. */
-		*p++ = c ^ (128 & ~(_vbi_hamm24_inv_par[0][c] << 2));
-	}
+	par_block (p, n16);
+	par_c (p + n16, n - n16);
 }
 
 /**
@@ -71,19 +178,270 @@ int
 vbi_unpar			(uint8_t *		p,
 				 unsigned int		n)
 {
-	int r = 0;
+	unsigned int n16 = n & ~15;
 
-	while (n-- > 0) {
-		uint8_t c = *p;
+	return unpar_block (p, n16) | unpar_c (p + n16, n - n16);
+}
 
-		/* if 0 == (inv_par[] & 32) set msb of r. */
-		r |= ~ _vbi_hamm24_inv_par[0][c]
-			<< (sizeof (int) * CHAR_BIT - 1 - 5);
+/* Whole packet versions of vbi_unpar8(), vbi_unham8() and
+   vbi_unham24p() for the Teletext decoder. Instead of ORing the
+   results to find an error they return a bitmap of the bytes or
+   triplets with errors.
 
-		*p++ = c & 127;
+   Hamming 8/4 decoding is linear, so we can look up the syndrome and
+   data bits of the low and high nibble in two 16 entry tables and
+   XOR the results. The syndrome (low nibble) then selects the
+   correction and error flag. This maps onto byte shuffles. */
+
+static const uint8_t
+hamm8_inv_lo [16] = {
+	0x00, 0x09, 0x1f, 0x16, 0x0a, 0x03, 0x15, 0x1c,
+	0x2e, 0x27, 0x31, 0x38, 0x24, 0x2d, 0x3b, 0x32
+};
+
+static const uint8_t
+hamm8_inv_hi [16] = {
+	0x00, 0x0c, 0x4d, 0x41, 0x08, 0x04, 0x45, 0x49,
+	0x8b, 0x87, 0xc6, 0xca, 0x83, 0x8f, 0xce, 0xc2
+};
+
+static const uint8_t
+hamm8_inv_fix [16] = {
+	0x01, 0x02, 0x04, 0x00, 0x08, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static const uint8_t
+hamm8_inv_err [16] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00
+};
+
+#if defined (HAVE_X86_SIMD)
+
+static uint64_t __attribute__ ((target ("sse2")))
+unpar_packet_sse2		(uint8_t *		dst,
+				 const uint8_t *	src,
+				 unsigned int		n)
+{
+	const __m128i m0f = _mm_set1_epi8 (0x0F);
+	const __m128i m01 = _mm_set1_epi8 (0x01);
+	const __m128i m7f = _mm_set1_epi8 (0x7F);
+	uint64_t err = 0;
+	unsigned int i;
+
+	for (i = 0; i < n; i += 16) {
+		__m128i c, t;
+
+		c = _mm_loadu_si128 ((const __m128i *)(src + i));
+
+		t = _mm_and_si128 (_mm_xor_si128 (c, _mm_srli_epi16 (c, 4)),
+				   m0f);
+		t = _mm_xor_si128 (t, _mm_srli_epi16 (t, 2));
+		t = _mm_xor_si128 (t, _mm_srli_epi16 (t, 1));
+
+		/* Bit 0 clear if even parity. */
+		t = _mm_cmpeq_epi8 (_mm_and_si128 (t, m01),
+				    _mm_setzero_si128 ());
+		err |= (uint64_t)(unsigned int) _mm_movemask_epi8 (t) << i;
+
+		_mm_storeu_si128 ((__m128i *)(dst + i),
+				  _mm_and_si128 (c, m7f));
 	}
 
-	return r;
+	return err;
+}
+
+static uint64_t __attribute__ ((target ("ssse3")))
+unham8_packet_ssse3		(int8_t *		dst,
+				 const uint8_t *	src,
+				 unsigned int		n)
+{
+	const __m128i lo = _mm_loadu_si128 ((const __m128i *) hamm8_inv_lo);
+	const __m128i hi = _mm_loadu_si128 ((const __m128i *) hamm8_inv_hi);
+	const __m128i fix = _mm_loadu_si128 ((const __m128i *) hamm8_inv_fix);
+	const __m128i bad = _mm_loadu_si128 ((const __m128i *) hamm8_inv_err);
+	const __m128i m0f = _mm_set1_epi8 (0x0F);
+	uint64_t err = 0;
+	unsigned int i;
+
+	for (i = 0; i < n; i += 16) {
+		__m128i c, t, s, d, e;
+
+		c = _mm_loadu_si128 ((const __m128i *)(src + i));
+
+		t = _mm_xor_si128 (_mm_shuffle_epi8
+				   (lo, _mm_and_si128 (c, m0f)),
+				   _mm_shuffle_epi8
+				   (hi, _mm_and_si128 (_mm_srli_epi16 (c, 4),
+						       m0f)));
+
+		s = _mm_and_si128 (t, m0f);
+		d = _mm_and_si128 (_mm_srli_epi16 (t, 4), m0f);
+
+		e = _mm_shuffle_epi8 (bad, s);
+		d = _mm_xor_si128 (d, _mm_shuffle_epi8 (fix, s));
+
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_or_si128 (d, e));
+
+		err |= (uint64_t)(unsigned int) _mm_movemask_epi8 (e) << i;
+	}
+
+	return err;
+}
+
+#endif /* HAVE_X86_SIMD */
+
+static uint64_t
+unpar_packet_c			(uint8_t *		dst,
+				 const uint8_t *	src,
+				 unsigned int		n)
+{
+	uint64_t err = 0;
+	unsigned int i;
+
+	for (i = 0; i < n; ++i) {
+		uint8_t c = src[i];
+
+		/* if 0 == (inv_par[] & 32) set bit i. */
+		err |= (uint64_t)((~_vbi_hamm24_inv_par[0][c] >> 5) & 1) << i;
+
+		dst[i] = c & 127;
+	}
+
+	return err;
+}
+
+static uint64_t
+unham8_packet_c			(int8_t *		dst,
+				 const uint8_t *	src,
+				 unsigned int		n)
+{
+	uint64_t err = 0;
+	unsigned int i;
+
+	for (i = 0; i < n; ++i) {
+		int8_t d = _vbi_hamm8_inv[src[i]];
+
+		err |= (uint64_t)(d < 0) << i;
+		dst[i] = d;
+	}
+
+	return err;
+}
+
+/* Selected by init_hamm() like par_block. */
+static uint64_t (* unpar_packet_block) (uint8_t *dst, const uint8_t *src,
+					unsigned int n) = unpar_packet_c;
+static uint64_t (* unham8_packet_block) (int8_t *dst, const uint8_t *src,
+					 unsigned int n) = unham8_packet_c;
+
+/**
+ * @internal
+ * @param dst The bytes of @a src without parity bit are stored here.
+ *   Can be the same as @a src.
+ * @param src Array of bytes with odd parity.
+ * @param n Size of the arrays, at most 64 bytes.
+ *
+ * Like vbi_unpar(), but returns which bytes had even parity.
+ *
+ * @returns
+ * Bitmap of the bytes with parity error, bit 0 for src[0].
+ */
+uint64_t
+_vbi_unpar_packet		(uint8_t *		dst,
+				 const uint8_t *	src,
+				 unsigned int		n)
+{
+	uint64_t err;
+	unsigned int i;
+
+	assert (n <= 64);
+
+	i = n & ~15;
+	err = unpar_packet_block (dst, src, i);
+	if (i < n)
+		err |= unpar_packet_c (dst + i, src + i, n - i) << i;
+
+	return err;
+}
+
+/**
+ * @internal
+ * @param dst The results of vbi_unham8() for each byte of @a src
+ *   are stored here. Can be the same as @a src.
+ * @param src Array of Hamming 8/4 protected bytes.
+ * @param n Size of the arrays, at most 64 bytes.
+ *
+ * Decodes a sequence of Hamming 8/4 protected bytes, e.g. the
+ * page address and links in a Teletext packet.
+ *
+ * @returns
+ * Bitmap of the bytes with uncorrectable errors, bit 0 for src[0].
+ */
+uint64_t
+_vbi_unham8_packet		(int8_t *		dst,
+				 const uint8_t *	src,
+				 unsigned int		n)
+{
+	uint64_t err;
+	unsigned int i;
+
+	assert (n <= 64);
+
+	i = n & ~15;
+	err = unham8_packet_block (dst, src, i);
+	if (i < n)
+		err |= unham8_packet_c (dst + i, src + i, n - i) << i;
+
+	return err;
+}
+
+/**
+ * @internal
+ * @param dst The results of vbi_unham24p() for each triplet of
+ *   @a src are stored here.
+ * @param src Array of Hamming 24/18 protected triplets.
+ * @param n_triplets Number of triplets, at most 32. A Teletext
+ *   packet 26, 28 or 29 contains 13 triplets.
+ *
+ * Decodes a sequence of Hamming 24/18 protected triplets. The
+ * correction table has 64 entries of 32 bits, which does not map
+ * onto byte shuffles, so this function has no SIMD version.
+ *
+ * @returns
+ * Bitmap of the triplets with uncorrectable errors, bit 0 for the
+ * first triplet.
+ */
+unsigned int
+_vbi_unham24_packet		(int *			dst,
+				 const uint8_t *	src,
+				 unsigned int		n_triplets)
+{
+	unsigned int err = 0;
+	unsigned int i;
+
+	assert (n_triplets <= 32);
+
+	for (i = 0; i < n_triplets; src += 3, ++i) {
+		unsigned int ABCDEF;
+		int32_t d;
+
+		d = (_vbi_hamm24_inv_d1_d4[src[0] >> 2]
+		     | ((src[1] & 0x7F) << 4)
+		     | ((src[2] & 0x7F) << 11));
+
+		ABCDEF = (_vbi_hamm24_inv_par[0][src[0]]
+			  ^ _vbi_hamm24_inv_par[1][src[1]]
+			  ^ _vbi_hamm24_inv_par[2][src[2]]);
+
+		d ^= (int) _vbi_hamm24_inv_err[ABCDEF];
+
+		err |= (unsigned int)(d < 0) << i;
+		dst[i] = d;
+	}
+
+	return err;
 }
 
 /**
@@ -159,6 +517,23 @@ vbi_unham24p			(const uint8_t *	p)
 	return d ^ (int) _vbi_hamm24_inv_err[ABCDEF];
 }
 
+static void
+init_hamm			(void)
+{
+#if defined (HAVE_X86_SIMD)
+	unsigned int features = _vbi_cpu_features ();
+
+	if (features & _VBI_CPU_SSE2) {
+		par_block = par_sse2;
+		unpar_block = unpar_sse2;
+		unpar_packet_block = unpar_packet_sse2;
+	}
+
+	if (features & _VBI_CPU_SSSE3)
+		unham8_packet_block = unham8_packet_ssse3;
+#endif
+}
+
 /*
 Local variables:
 c-set-style: K&R
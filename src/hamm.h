@@ -221,6 +221,19 @@ vbi_unham24p			(const uint8_t *	p)
 
 /* Private */
 
+extern uint64_t
+_vbi_unpar_packet		(uint8_t *		dst,
+				 const uint8_t *	src,
+				 unsigned int		n);
+extern uint64_t
+_vbi_unham8_packet		(int8_t *		dst,
+				 const uint8_t *	src,
+				 unsigned int		n);
+extern unsigned int
+_vbi_unham24_packet		(int *			dst,
+				 const uint8_t *	src,
+				 unsigned int		n_triplets);
+
 VBI_END_DECLS
 
 #endif /* __ZVBI_HAMM_H__ */
@@ -104,6 +104,11 @@ typedef struct vbi_capture_v4l2 {
 
 	vbi_sampling_par	sp;
 	vbi3_raw_decoder	rd;
+
+	/* Layout of the lines in a capture buffer, and the
+	   number of bytes needed to hold all of them. */
+	vbi3_raw_view		raw_view;
+	unsigned long		raw_view_size;
         unsigned int            services;    /* all services, including raw */
 
 	double			time_per_frame;
@@ -126,12 +131,16 @@ typedef struct vbi_capture_v4l2 {
 
 } vbi_capture_v4l2;
 
+/* Decodes raw data in place, which may be a driver buffer
+   of size bytes. */
 static void
 vbi_sliced_data_from_raw	(vbi_capture_v4l2 *	v,
 				 vbi_capture_buffer **	sliced,
-				 const vbi_capture_buffer *raw)
+				 const vbi_capture_buffer *raw,
+				 unsigned long		size)
 {
 	vbi_capture_buffer *b;
+	vbi3_raw_view view;
 	unsigned int max_lines;
 	unsigned int n_lines;
 
@@ -149,10 +158,18 @@ vbi_sliced_data_from_raw	(vbi_capture_v4l2 *	v,
 
 	max_lines = v->sp.count[0] + v->sp.count[1];
 
-	n_lines = vbi3_raw_decoder_decode (&v->rd,
-					   (vbi_sliced *) b->data,
-					   max_lines,
-					   (uint8_t *) raw->data);
+	if (size < v->raw_view_size) {
+		warning (&v->log,
+			 "Short raw buffer, %lu of %lu bytes.",
+			 size, v->raw_view_size);
+		n_lines = 0;
+	} else {
+		view = v->raw_view;
+		view.data = (const uint8_t *) raw->data;
+
+		n_lines = vbi3_raw_decoder_decode_view
+			(&v->rd, (vbi_sliced *) b->data, max_lines, &view);
+	}
 
 	b->size = n_lines * sizeof (vbi_sliced);
 	b->timestamp = raw->timestamp;
@@ -484,7 +501,15 @@ v4l2_stream(vbi_capture *vc, vbi_capture_buffer **raw,
 	}
 
 	if (NULL != sliced) {
-		vbi_sliced_data_from_raw (v, sliced, b);
+		unsigned long size;
+
+		/* Older drivers may not set bytesused. */
+		size = v->vbuf.bytesused;
+		if (0 == size)
+			size = b->size;
+
+		/* Slice directly out of the mmapped buffer. */
+		vbi_sliced_data_from_raw (v, sliced, b, size);
 	}
 
 	/* if no raw pointer returned to the caller, re-queue buffer immediately
@@ -717,7 +742,7 @@ v4l2_read(vbi_capture *vc, vbi_capture_buffer **raw,
 	(*raw)->timestamp = tv.tv_sec + tv.tv_usec * (1 / 1e6);
 
 	if (sliced) {
-		vbi_sliced_data_from_raw (v, sliced, *raw);
+		vbi_sliced_data_from_raw (v, sliced, *raw, (*raw)->size);
 	}
 
 	return 1;
@@ -1130,6 +1155,20 @@ v4l2_update_services(vbi_capture *vc,
 					   ? 1.0 / 25 : 1001.0 / 30000);
 	v->sp.sampling_format	= VBI_PIXFMT_YUV420;
 
+	/* The driver stores the lines of the second field after
+	   those of the first field, or interleaved with them. */
+	v->raw_view.data	= NULL;
+	v->raw_view.offset[0]	= 0;
+	if (v->sp.interlaced) {
+		v->raw_view.offset[1] = v->sp.bytes_per_line;
+		v->raw_view.stride = v->sp.bytes_per_line * 2;
+	} else {
+		v->raw_view.offset[1] = v->sp.count[0] * v->sp.bytes_per_line;
+		v->raw_view.stride = v->sp.bytes_per_line;
+	}
+	v->raw_view_size	= (v->sp.count[0] + v->sp.count[1])
+				  * v->sp.bytes_per_line;
+
  	if (vfmt.fmt.vbi.sample_format != V4L2_PIX_FMT_GREY) {
 		asprintf(errstr, _("%s (%s) offers unknown vbi sampling format #%d. "
 				   "This may be a driver bug or libzvbi is too old."),
@@ -720,6 +720,7 @@ typedef struct vbi_event {
 			unsigned int		roll_header : 1;
 		        unsigned int		header_update : 1;
 			unsigned int		clock_update : 1;
+			unsigned int		dirty_rows;
 	        }			ttx_page;
 		struct {
 			int			pgno;
@@ -750,6 +751,27 @@ extern vbi_bool		vbi_event_handler_register(vbi_decoder *vbi, int event_mask,
 extern void		vbi_event_handler_unregister(vbi_decoder *vbi,
 						     vbi_event_handler handler,
 						     void *user_data);
+extern vbi_bool
+vbi_event_queue_start		(vbi_decoder *		vbi,
+				 unsigned int		max_events);
+extern void
+vbi_event_queue_stop		(vbi_decoder *		vbi);
+extern void
+vbi_event_queue_get_stats	(vbi_decoder *		vbi,
+				 unsigned int *		depth,
+				 unsigned int *		dropped,
+				 unsigned int *		coalesced);
+extern vbi_bool
+vbi_event_handler_register_queued
+				(vbi_decoder *		vbi,
+				 int			event_mask,
+				 vbi_event_handler	handler,
+				 void *			user_data);
+extern void
+vbi_event_handler_unregister_queued
+				(vbi_decoder *		vbi,
+				 vbi_event_handler	handler,
+				 void *			user_data);
 
 
 /* format.h */
@@ -961,6 +983,12 @@ extern char *			vbi_export_errstr(vbi_export *);
 extern void             vbi_unref_page(vbi_page *pg);
 extern int              vbi_is_cached(vbi_decoder *, int pgno, int subno);
 extern int              vbi_cache_hi_subno(vbi_decoder *vbi, int pgno);
+extern vbi_bool         vbi_cache_predict_subpage(vbi_decoder *vbi, vbi_pgno pgno,
+						  vbi_subno subno, double *time);
+extern vbi_bool         vbi_save_cache(vbi_decoder *vbi, const char *file_name);
+extern vbi_bool         vbi_load_cache(vbi_decoder *vbi, const char *file_name);
+extern void             vbi_set_cache_memory_limit(vbi_decoder *vbi, unsigned long limit);
+extern void             vbi_set_cache_compression(vbi_decoder *vbi, vbi_bool enable);
 
 
 /* search.h */
@@ -2024,11 +2052,28 @@ typedef enum {
 
 extern void		vbi_teletext_set_default_region(vbi_decoder *vbi, int default_region);
 extern void		vbi_teletext_set_level(vbi_decoder *vbi, int level);
+extern void		vbi_teletext_set_changes_only(vbi_decoder *vbi, vbi_bool enable);
+extern vbi_bool		vbi_teletext_add_interest_pages(vbi_decoder *vbi,
+							vbi_pgno first_pgno,
+							vbi_pgno last_pgno);
+extern vbi_bool		vbi_teletext_add_interest_subpages(vbi_decoder *vbi,
+							   vbi_pgno pgno,
+							   vbi_subno first_subno,
+							   vbi_subno last_subno);
+extern vbi_bool		vbi_teletext_remove_interest_pages(vbi_decoder *vbi,
+							   vbi_pgno first_pgno,
+							   vbi_pgno last_pgno);
+extern void		vbi_teletext_reset_interest(vbi_decoder *vbi);
 
 extern vbi_bool		vbi_fetch_vt_page(vbi_decoder *vbi, vbi_page *pg,
 					  vbi_pgno pgno, vbi_subno subno,
 					  vbi_wst_level max_level, int display_rows,
 					  vbi_bool navigation);
+extern vbi_bool		vbi_update_vt_page(vbi_decoder *vbi, vbi_page *pg,
+					   vbi_pgno pgno, vbi_subno subno,
+					   vbi_wst_level max_level, int display_rows,
+					   vbi_bool navigation, unsigned int *version,
+					   unsigned int *dirty_rows);
 extern int		vbi_page_title(vbi_decoder *vbi, int pgno, int subno, char *buf);
 
 extern void		vbi_resolve_link(vbi_page *pg, int column, int row,
@@ -2122,6 +2167,8 @@ vbi_encode_dvb_pdc_descriptor	(uint8_t		buffer[5],
 
 /* vbi.h */
 
+typedef struct vbi_multi_decoder vbi_multi_decoder;
+
 typedef enum {
 	VBI_NO_PAGE = 0x00,
 	VBI_NORMAL_PAGE = 0x01,
@@ -2152,6 +2199,25 @@ extern void
 vbi_set_log_fn			(vbi_log_mask		mask,
 				 vbi_log_fn *		log_fn,
 				 void *			user_data);
+extern vbi_multi_decoder *
+vbi_multi_decoder_new		(void);
+extern void
+vbi_multi_decoder_delete	(vbi_multi_decoder *	md);
+extern vbi_decoder *
+vbi_multi_decoder_add_stream	(vbi_multi_decoder *	md,
+				 unsigned int		stream_id);
+extern void
+vbi_multi_decoder_remove_stream	(vbi_multi_decoder *	md,
+				 unsigned int		stream_id);
+extern vbi_decoder *
+vbi_multi_decoder_get_stream	(vbi_multi_decoder *	md,
+				 unsigned int		stream_id);
+extern vbi_bool
+vbi_multi_decode		(vbi_multi_decoder *	md,
+				 unsigned int		stream_id,
+				 vbi_sliced *		sliced,
+				 int			lines,
+				 double			timestamp);
 
 
 
@@ -150,6 +150,22 @@ dump_page_info(struct teletext *vt)
 }
 #endif
 
+/* n: six Hamming 8/4 decoded nibbles without errors. */
+_vbi_inline void
+nibbles_page_link(struct ttx_page_link *p, const int8_t *n, int magazine)
+{
+	int b1, b2, b3, m;
+
+	b1 = n[0] | (n[1] << 4);
+	b2 = n[2] | (n[3] << 4);
+	b3 = n[4] | (n[5] << 4);
+
+	m = ((b3 >> 5) & 6) + (b2 >> 7);
+
+	p->pgno = ((magazine ^ m) ? : 8) * 256 + b1;
+	p->subno = (b3 * 256 + b2) & 0x3f7f;
+}
+
 _vbi_inline vbi_bool
 unham_page_link(struct ttx_page_link *p, const uint8_t *raw, int magazine)
 {
@@ -310,8 +326,7 @@ parse_pop(cache_page *vtp, uint8_t *raw, int packet)
 	if ((designation = vbi_unham8 (raw[0])) < 0)
 		return FALSE;
 
-	for (raw++, i = 0; i < 13; raw += 3, i++)
-		triplet[i] = vbi_unham24p (raw);
+	_vbi_unham24_packet (triplet, raw + 1, 13);
 
 	if (packet == 26)
 		packet += designation;
@@ -547,8 +562,11 @@ parse_mip_page(vbi_decoder *vbi, cache_page *vtp,
 		cp = _vbi_cache_get_page (vbi->ca, vbi->cn, pgno,
 					  /* subno */ 0,
 					  /* subno_mask */ 0);
+
+		pthread_mutex_lock(&vbi->ca->mutex);
 		ps->charset_code =
 			page_language (&vbi->vt, vbi->cn, cp, pgno, code & 7);
+		pthread_mutex_unlock(&vbi->ca->mutex);
 
 		cache_page_unref (cp);
 
@@ -589,6 +607,8 @@ parse_mip_page(vbi_decoder *vbi, cache_page *vtp,
 		break;
 	}
 
+	pthread_mutex_lock(&vbi->ca->mutex);
+
 	old_code = ps->page_type;
 	old_subc = ps->subcode;
 
@@ -603,6 +623,8 @@ parse_mip_page(vbi_decoder *vbi, cache_page *vtp,
 	if (old_code == VBI_UNKNOWN_PAGE || subc > old_subc)
 		ps->subcode = subc;
 
+	pthread_mutex_unlock(&vbi->ca->mutex);
+
 	return TRUE;
 }
 
@@ -662,7 +684,7 @@ eacem_trigger(vbi_decoder *vbi, cache_page *vtp)
 	if (0)
 		dump_raw(vtp, FALSE);
 
-	if (!(vbi->event_mask & VBI_EVENT_TRIGGER))
+	if (!(_vbi_event_mask(vbi) & VBI_EVENT_TRIGGER))
 		return;
 
 	if (!vbi_format_vt_page(vbi, &pg, vtp, VBI_WST_LEVEL_1p5, 24, 0))
@@ -748,36 +770,39 @@ parse_btt(vbi_decoder *vbi, uint8_t *raw, int packet)
 		for (i = 0; i < 4; i++) {
 			for (j = 0; j < 10; index++, j++) {
 				struct ttx_page_stat *ps;
-
-				ps = cache_network_page_stat (vbi->cn,
-							      0x100 + index);
+				unsigned int old_type;
+				cache_page *cp;
 
 				if ((code = vbi_unham8 (*raw++)) < 0)
 					break;
 
-				switch (code) {
-				case BTT_SUBTITLE:
-				{
-					cache_page *cp;
-
-					ps->page_type = VBI_SUBTITLE_PAGE;
-
+				/* Before we lock the cache. */
+				cp = NULL;
+				if (BTT_SUBTITLE == code)
 					cp = _vbi_cache_get_page
 						(vbi->ca, vbi->cn,
 						 index + 0x100,
 						 /* subno */ 0,
 						 /* subno_mask */ 0);
-					if (NULL != cp) {
+
+				pthread_mutex_lock(&vbi->ca->mutex);
+
+				ps = cache_network_page_stat (vbi->cn,
+							      0x100 + index);
+
+				old_type = ps->page_type;
+
+				switch (code) {
+				case BTT_SUBTITLE:
+					ps->page_type = VBI_SUBTITLE_PAGE;
+
+					if (NULL != cp)
 						ps->charset_code =
 							page_language
 							(&vbi->vt,
 							 vbi->cn, cp,
 							 0, 0);
-						cache_page_unref (cp);
-					}
-
 					break;
-				}
 
 				case BTT_PROGR_INDEX_S:
 				case BTT_PROGR_INDEX_M:
@@ -801,9 +826,16 @@ parse_btt(vbi_decoder *vbi, uint8_t *raw, int packet)
 
 				default:
 					ps->page_type = VBI_NO_PAGE;
+					if (old_type != VBI_NO_PAGE)
+						++vbi->vt.top_version;
+					pthread_mutex_unlock(&vbi->ca->mutex);
 					continue;
 				}
 
+				/* Formatted pages show TOP labels. */
+				if (old_type != ps->page_type)
+					++vbi->vt.top_version;
+
 				switch (code) {
 				case BTT_PROGR_INDEX_M:
 				case BTT_BLOCK_M:
@@ -816,6 +848,10 @@ parse_btt(vbi_decoder *vbi, uint8_t *raw, int packet)
 					ps->subcode = 0;
 					break;
 				}
+
+				pthread_mutex_unlock(&vbi->ca->mutex);
+
+				cache_page_unref (cp);
 			}
 
 			index += ((index & 0xFF) == 0x9A) ? 0x66 : 0x06;
@@ -829,6 +865,8 @@ parse_btt(vbi_decoder *vbi, uint8_t *raw, int packet)
 		struct ttx_page_link *pl;
 		int i;
 
+		pthread_mutex_lock(&vbi->ca->mutex);
+
 		pl = vbi->cn->btt_link + (packet - 21) * 5;
 
 		vbi->cn->have_top = TRUE;
@@ -858,6 +896,8 @@ parse_btt(vbi_decoder *vbi, uint8_t *raw, int packet)
 			}
 		}
 
+		pthread_mutex_unlock(&vbi->ca->mutex);
+
 		break;
 	    }
 	}
@@ -900,6 +940,8 @@ parse_mpt(cache_network *cn, uint8_t *raw, int packet)
 	int i, j, index;
 	int n;
 
+	pthread_mutex_lock(&cn->cache->mutex);
+
 	switch (packet) {
 	case 1 ... 20:
 		index = dec2bcdp[packet - 1];
@@ -927,6 +969,8 @@ parse_mpt(cache_network *cn, uint8_t *raw, int packet)
 		}
 	}
 
+	pthread_mutex_unlock(&cn->cache->mutex);
+
 	return TRUE;
 }
 
@@ -936,6 +980,8 @@ parse_mpt_ex(cache_network *cn, uint8_t *raw, int packet)
 	int i, code, subc;
 	struct ttx_page_link p;
 
+	pthread_mutex_lock(&cn->cache->mutex);
+
 	switch (packet) {
 	case 1 ... 23:
 		for (i = 0; i < 5; raw += 8, i++) {
@@ -968,6 +1014,8 @@ parse_mpt_ex(cache_network *cn, uint8_t *raw, int packet)
 		break;
 	}
 
+	pthread_mutex_unlock(&cn->cache->mutex);
+
 	return TRUE;
 }
 
@@ -1065,7 +1113,8 @@ vbi_convert_page(vbi_decoder *vbi, cache_page *vtp,
 	if (cached) {
 		cache_page *new_vtp;
 
-		new_vtp = _vbi_cache_put_page (vbi->ca, vbi->cn, &page);
+		new_vtp = _vbi_cache_put_page (vbi->ca, vbi->cn, &page,
+					       /* diff */ NULL);
 		if (NULL != new_vtp)
 			cache_page_unref (vtp);
 		return new_vtp;
@@ -1206,7 +1255,7 @@ vbi_decode_vps(vbi_decoder *vbi, uint8_t *buf)
 
 		n->cycle = 2;
 
-		if (vbi->event_mask & VBI_EVENT_PROG_ID) {
+		if (_vbi_event_mask(vbi) & VBI_EVENT_PROG_ID) {
 			vbi_program_id pid;
 			vbi_event e;
 
@@ -1519,6 +1568,7 @@ store_lop(vbi_decoder *vbi, const cache_page *vtp)
 {
 	struct ttx_page_stat *ps;
 	cache_page *new_cp;
+	unsigned int diff;
 	vbi_event event;
 
 	event.type = VBI_EVENT_TTX_PAGE;
@@ -1537,6 +1587,7 @@ store_lop(vbi_decoder *vbi, const cache_page *vtp)
 		 && vbi_is_bcd(vtp->pgno) /* no hex numbers */);
 
 	event.ev.ttx_page.header_update = FALSE;
+	event.ev.ttx_page.clock_update = FALSE;
 	event.ev.ttx_page.raw_header = NULL;
 	event.ev.ttx_page.pn_offset = -1;
 
@@ -1570,9 +1621,7 @@ store_lop(vbi_decoder *vbi, const cache_page *vtp)
 		case TRUE:
 			// fprintf(stderr, "+");
 
-			pthread_mutex_lock(&vbi->chswcd_mutex);
-			vbi->chswcd = 0;
-			pthread_mutex_unlock(&vbi->chswcd_mutex);
+			__atomic_store_n (&vbi->chswcd, 0, __ATOMIC_RELAXED);
 
 			vbi->vt.header_page.pgno = vtp->pgno;
 			memcpy(vbi->vt.header + 8,
@@ -1600,14 +1649,9 @@ store_lop(vbi_decoder *vbi, const cache_page *vtp)
 			/* fall through */
 
 		default: /* inconclusive */
-			pthread_mutex_lock(&vbi->chswcd_mutex);
-
-			if (vbi->chswcd > 0) {
-				pthread_mutex_unlock(&vbi->chswcd_mutex);
+			if (__atomic_load_n (&vbi->chswcd,
+					     __ATOMIC_RELAXED) > 0)
 				return TRUE;
-			}
-
-			pthread_mutex_unlock(&vbi->chswcd_mutex);
 
 			if (r == -1) {
 				vbi->vt.header_page.pgno = vtp->pgno;
@@ -1643,6 +1687,8 @@ store_lop(vbi_decoder *vbi, const cache_page *vtp)
 	 *  Collect information about those pages
 	 *  not listed in MIP etc.
 	 */
+	pthread_mutex_lock(&vbi->ca->mutex);
+
 	ps = cache_network_page_stat (vbi->cn, vtp->pgno);
 
 	if (ps->page_type == VBI_SUBTITLE_PAGE) {
@@ -1657,13 +1703,26 @@ store_lop(vbi_decoder *vbi, const cache_page *vtp)
 	if (ps->subcode >= 0xFFFE || vtp->subno > ps->subcode)
 		ps->subcode = vtp->subno;
 
+	pthread_mutex_unlock(&vbi->ca->mutex);
+
 	/*
 	 *  Store the page and send event.
 	 */
 
-	new_cp = _vbi_cache_put_page (vbi->ca, vbi->cn, vtp);
+	new_cp = _vbi_cache_put_page (vbi->ca, vbi->cn, vtp, &diff);
 	if (NULL != new_cp) {
-		vbi_send_event(vbi, &event);
+		/* Packet 25 and enhancements may change any row. */
+		if (diff >= (1U << 25))
+			diff = (1U << 25) - 1;
+
+		event.ev.ttx_page.dirty_rows = diff;
+
+		if (0 != diff
+		    || !vbi->vt.changes_only
+		    || event.ev.ttx_page.header_update
+		    || event.ev.ttx_page.clock_update)
+			vbi_send_event(vbi, &event);
+
 		cache_page_unref (new_cp);
 	}
 
@@ -1735,16 +1794,13 @@ lop_parity_check		(cache_page *		cvtp,
 		unsigned int packet;
 
 		for (packet = 1; packet <= 25; ++packet) {
-			unsigned int i;
-			int n;
+			uint8_t buf[40];
 
 			if (0 == (rvtp->lop_packets & (1 << packet)))
 				continue;
 
-			n = 0;
-			for (i = 0; i < 40; ++i)
-				n |= vbi_unpar8 (rvtp->lop_raw[packet][i]);
-			if (n >= 0) {
+			if (0 == _vbi_unpar_packet (buf, rvtp->lop_raw[packet],
+						    40)) {
 				/* Parity is good, replace cached row. We
 				   could replace individual characters, but
 				   a single parity bit isn't very reliable. */
@@ -1767,6 +1823,10 @@ parse_27(vbi_decoder *vbi, uint8_t *p,
 	 cache_page *cvtp, int mag0)
 {
 	int designation, control;
+	int8_t n[37];
+	uint64_t err;
+	int triplet[12];
+	unsigned int t_err;
 	int i;
 
 	vbi = vbi;
@@ -1781,9 +1841,12 @@ parse_27(vbi_decoder *vbi, uint8_t *p,
 
 	switch (designation) {
 	case 0:
-		if ((control = vbi_unham8 (p[37])) < 0)
+		err = _vbi_unham8_packet (n, p + 1, 37);
+		if (err & ((uint64_t) 1 << 36))
 			return FALSE;
 
+		control = n[36];
+
 		/* printf("%x.%x X/27/%d %02x\n",
 		       cvtp->pgno, cvtp->subno, designation, control); */
 #if 0
@@ -1800,14 +1863,18 @@ parse_27(vbi_decoder *vbi, uint8_t *p,
 #endif
 		cvtp->data.unknown.have_flof = control >> 3; /* display row 24 */
 
-		/* fall through */
+		goto links;
+
 	case 1:
 	case 2:
 	case 3:
-		for (p++, i = 0; i <= 5; p += 6, i++) {
-			if (!unham_page_link(cvtp->data.unknown.link
-					       + designation * 6 + i, p, mag0)) {
-				/* return TRUE; */
+		err = _vbi_unham8_packet (n, p + 1, 36);
+	links:
+		for (i = 0; i <= 5; i++) {
+			if (0 == ((err >> (i * 6)) & 0x3F)) {
+				nibbles_page_link(cvtp->data.unknown.link
+						  + designation * 6 + i,
+						  n + i * 6, mag0);
 			}
 
 // printf("X/27/%d link[%d] page %03x/%03x\n", designation, i,
@@ -1818,15 +1885,17 @@ parse_27(vbi_decoder *vbi, uint8_t *p,
 
 	case 4:
 	case 5:
-		for (p++, i = 0; i <= 5; p += 6, i++) {
-			int t1, t2;
+		t_err = _vbi_unham24_packet (triplet, p + 1, 12);
 
-			t1 = vbi_unham24p (p + 0);
-			t2 = vbi_unham24p (p + 3);
+		for (i = 0; i <= 5; i++) {
+			int t1, t2;
 
-			if ((t1 | t2) < 0)
+			if ((t_err >> (i * 2)) & 3)
 				return FALSE;
 
+			t1 = triplet[i * 2 + 0];
+			t2 = triplet[i * 2 + 1];
+
 			cvtp->data.unknown.link[designation * 6 + i].function = t1 & 3;
 			cvtp->data.unknown.link[designation * 6 + i].pgno =
 				((((t1 >> 12) & 0x7) ^ mag0) ? : 8) * 256
@@ -1887,7 +1956,8 @@ parse_28_29(vbi_decoder *vbi, uint8_t *p,
 	int triplets[13];
 	struct bit_stream bs;
 	struct ttx_extension *ext;
-	int i, j, err = 0;
+	unsigned int err;
+	int i, j;
 
 	if ((designation = vbi_unham8 (*p)) < 0)
 		return FALSE;
@@ -1896,8 +1966,7 @@ parse_28_29(vbi_decoder *vbi, uint8_t *p,
 		fprintf(stderr, "Packet %d/%d/%d page %x\n",
 			mag8, packet, designation, cvtp->pgno);
 
-	for (p++, i = 0; i < 13; p += 3, i++)
-		err |= triplets[i] = vbi_unham24p (p);
+	err = _vbi_unham24_packet (triplets, p + 1, 13);
 
 	bs.triplet = triplets;
 	bs.buffer = 0;
@@ -1906,7 +1975,7 @@ parse_28_29(vbi_decoder *vbi, uint8_t *p,
 	switch (designation) {
 	case 0: /* X/28/0, M/29/0 Level 2.5 */
 	case 4: /* X/28/4, M/29/4 Level 3.5 */
-		if (err < 0)
+		if (0 != err)
 			return FALSE;
 
 		function = get_bits (&bs, 4);
@@ -1933,6 +2002,8 @@ parse_28_29(vbi_decoder *vbi, uint8_t *p,
 
 		/* XXX X/28/0 Format 2, distinguish how? */
 
+		pthread_mutex_lock(&vbi->ca->mutex);
+
 		ext = &cache_network_magazine (vbi->cn, mag8 * 0x100)->extension;
 
 		if (packet == 28) {
@@ -2025,9 +2096,13 @@ parse_28_29(vbi_decoder *vbi, uint8_t *p,
 			*/
 		}
 
+		pthread_mutex_unlock(&vbi->ca->mutex);
+
 		return FALSE;
 
 	case 1: /* X/28/1, M/29/1 Level 3.5 DRCS CLUT */
+		pthread_mutex_lock(&vbi->ca->mutex);
+
 		ext = &cache_network_magazine (vbi->cn, mag8 * 0x100)->extension;
 
 		if (packet == 28) {
@@ -2056,13 +2131,15 @@ parse_28_29(vbi_decoder *vbi, uint8_t *p,
 		if (0)
 			dump_extension(ext);
 
+		pthread_mutex_unlock(&vbi->ca->mutex);
+
 		return FALSE;
 
 	case 3: /* X/28/3 Level 2.5, 3.5 DRCS download page */
 		if (packet == 29)
 			break; /* M/29/3 undefined */
 
-		if (err < 0)
+		if (0 != err)
 			return FALSE;
 
 		function = get_bits (&bs, 4);
@@ -2117,17 +2194,23 @@ parse_8_30(vbi_decoder *vbi, uint8_t *buffer, int packet)
 	if (designation > 4)
 		return TRUE; /* ignored */
 
-	if (vbi->event_mask & TTX_EVENTS) {
-		if (!unham_page_link(&vbi->cn->initial_page, p + 1, 0))
+	if (_vbi_event_mask(vbi) & TTX_EVENTS) {
+		struct ttx_page_link initial_page;
+
+		if (!unham_page_link(&initial_page, p + 1, 0))
 			return FALSE;
 
-		if ((vbi->cn->initial_page.pgno & 0xFF) == 0xFF) {
-			vbi->cn->initial_page.pgno = 0x100;
-			vbi->cn->initial_page.subno = VBI_ANY_SUBNO;
+		if ((initial_page.pgno & 0xFF) == 0xFF) {
+			initial_page.pgno = 0x100;
+			initial_page.subno = VBI_ANY_SUBNO;
 		}
+
+		pthread_mutex_lock(&vbi->ca->mutex);
+		vbi->cn->initial_page = initial_page;
+		pthread_mutex_unlock(&vbi->ca->mutex);
 	}
 
-	if (vbi->event_mask & BSDATA_EVENTS) {
+	if (_vbi_event_mask(vbi) & BSDATA_EVENTS) {
 		if (!parse_bsd(vbi, p, packet, designation))
 			return FALSE;
 	}
@@ -2135,7 +2218,7 @@ parse_8_30(vbi_decoder *vbi, uint8_t *buffer, int packet)
 	if (designation < 2) {
 		/* 8/30 format 1 */
 
-		if (vbi->event_mask & VBI_EVENT_LOCAL_TIME) {
+		if (_vbi_event_mask(vbi) & VBI_EVENT_LOCAL_TIME) {
 			vbi_local_time lt;
 			vbi_event e;
 
@@ -2156,7 +2239,7 @@ parse_8_30(vbi_decoder *vbi, uint8_t *buffer, int packet)
 	} else {
 		/* 8/30 format 2 */
 
-		if (vbi->event_mask & VBI_EVENT_PROG_ID) {
+		if (_vbi_event_mask(vbi) & VBI_EVENT_PROG_ID) {
 			vbi_program_id pid;
 			vbi_event e;
 			
@@ -2175,6 +2258,46 @@ parse_8_30(vbi_decoder *vbi, uint8_t *buffer, int packet)
 	return TRUE;
 }
 
+/* TRUE if the client wants page pgno, subno decoded. */
+static vbi_bool
+interest_page(vbi_decoder *vbi, int pgno, int subno)
+{
+	struct teletext *vt = &vbi->vt;
+	vbi_bool r;
+
+	/* System pages. */
+	if (!vbi_is_bcd(pgno))
+		return TRUE;
+
+	pthread_mutex_lock(&vt->interest_mutex);
+
+	r = (NULL == vt->interest
+	     || ((vt->interest_magazines & (1 << ((pgno >> 8) & 7)))
+		 && vbi_page_table_contains_subpage(vt->interest,
+						    pgno, subno)));
+
+	pthread_mutex_unlock(&vt->interest_mutex);
+
+	return r;
+}
+
+/* TRUE if the client wants pages of magazine mag0 decoded. */
+static vbi_bool
+interest_magazine(vbi_decoder *vbi, int mag0)
+{
+	struct teletext *vt = &vbi->vt;
+	vbi_bool r;
+
+	pthread_mutex_lock(&vt->interest_mutex);
+
+	r = (NULL == vt->interest
+	     || 0 != (vt->interest_magazines & (1 << mag0)));
+
+	pthread_mutex_unlock(&vt->interest_mutex);
+
+	return r;
+}
+
 /**
  * @internal
  * @param vbi Initialized vbi decoding context.
@@ -2205,7 +2328,7 @@ vbi_decode_teletext(vbi_decoder *vbi, uint8_t *buffer)
 	packet = pmag >> 3;
 
 	if (packet < 30
-	    && !(vbi->event_mask & TTX_EVENTS))
+	    && !(_vbi_event_mask(vbi) & TTX_EVENTS))
 		return TRUE;
 
 	mag = cache_network_magazine (vbi->cn, mag8 * 0x100);
@@ -2270,10 +2393,19 @@ vbi_decode_teletext(vbi_decoder *vbi, uint8_t *buffer)
 			case PAGE_FUNCTION_DRCS:
 			case PAGE_FUNCTION_GDRCS:
 			{
-				if (convert_drcs(vtp,
-						 vtp->data.drcs.lop.raw[1]))
-					_vbi_cache_put_page (vbi->ca,
-							     vbi->cn, vtp);
+				cache_page *new_cp;
+
+				if (!convert_drcs(vtp,
+						  vtp->data.drcs.lop.raw[1]))
+					break;
+
+				/* Not deleted to make room for other
+				   pages while unreferenced, see
+				   CACHE_LRU_PINNED. */
+				new_cp = _vbi_cache_put_page
+					(vbi->ca, vbi->cn, vtp,
+					 /* diff */ NULL);
+				cache_page_unref (new_cp);
 				break;
 			}
 
@@ -2290,7 +2422,8 @@ vbi_decode_teletext(vbi_decoder *vbi, uint8_t *buffer)
 				cache_page *new_cp;
 
 				new_cp = _vbi_cache_put_page
-					(vbi->ca, vbi->cn, vtp);
+					(vbi->ca, vbi->cn, vtp,
+					 /* diff */ NULL);
 				cache_page_unref (new_cp);
 				break;
 			}
@@ -2319,6 +2452,14 @@ vbi_decode_teletext(vbi_decoder *vbi, uint8_t *buffer)
 		cvtp->subno = subpage & 0x3F7F;
 		cvtp->national = vbi_rev8 (flags) & 7;
 		cvtp->flags = (flags << 16) + subpage;
+		cvtp->time = vbi->time;
+
+		if (!interest_page(vbi, pgno, cvtp->subno)) {
+			/* Nobody wants this page, skip the following
+			   packets up to the next page header. */
+			cvtp->function = PAGE_FUNCTION_DISCARD;
+			return TRUE;
+		}
 
 		if (0 && ((page & 15) > 9 || page > 0x99))
 			printf("data page %03x/%04x n%d\n",
@@ -2522,18 +2663,24 @@ vbi_decode_teletext(vbi_decoder *vbi, uint8_t *buffer)
 
 	case 1 ... 25:
 	{
-		int n;
-		int i;
-
 		switch (cvtp->function) {
 		case PAGE_FUNCTION_DISCARD:
 			return TRUE;
 
 		case PAGE_FUNCTION_MOT:
-			if (!parse_mot(cache_network_magazine
-				       (vbi->cn, mag8 * 0x100), p, packet))
+		{
+			vbi_bool success;
+
+			pthread_mutex_lock(&vbi->ca->mutex);
+			success = parse_mot(cache_network_magazine
+					    (vbi->cn, mag8 * 0x100),
+					    p, packet);
+			pthread_mutex_unlock(&vbi->ca->mutex);
+
+			if (!success)
 				return FALSE;
 			break;
+		}
 
 		case PAGE_FUNCTION_GPOP:
 		case PAGE_FUNCTION_POP:
@@ -2581,10 +2728,12 @@ vbi_decode_teletext(vbi_decoder *vbi, uint8_t *buffer)
 			return TRUE;
 
 		case PAGE_FUNCTION_EACEM_TRIGGER:
-			for (n = i = 0; i < 40; i++)
-				n |= vbi_unpar8 (p[i]);
-			if (n < 0)
+		{
+			uint8_t buf[40];
+
+			if (0 != _vbi_unpar_packet (buf, p, 40))
 				return FALSE;
+		}
 
 			/* fall through */
 
@@ -2603,6 +2752,7 @@ vbi_decode_teletext(vbi_decoder *vbi, uint8_t *buffer)
 	{
 		int designation;
 		struct ttx_triplet triplet;
+		int triplets[13];
 		int i;
 
 		/*
@@ -2641,8 +2791,10 @@ vbi_decode_teletext(vbi_decoder *vbi, uint8_t *buffer)
 			return FALSE;
 		}
 
-		for (p++, i = 0; i < 13; p += 3, i++) {
-			int t = vbi_unham24p (p);
+		_vbi_unham24_packet (triplets, p + 1, 13);
+
+		for (i = 0; i < 13; i++) {
+			int t = triplets[i];
 
 			if (t < 0)
 				break; /* XXX */
@@ -2670,6 +2822,9 @@ vbi_decode_teletext(vbi_decoder *vbi, uint8_t *buffer)
 
 		/* fall through */
 	case 29:
+		if (29 == packet && !interest_magazine(vbi, mag0))
+			break;
+
 		if (!parse_28_29(vbi, p, cvtp, mag8, packet))
 			return FALSE;
 		break;
@@ -2759,6 +2914,8 @@ vbi_teletext_set_default_region(vbi_decoder *vbi, int default_region)
 
 	vbi->vt.region = default_region;
 
+	pthread_mutex_lock(&vbi->ca->mutex);
+
 	for (i = 0x100; i <= 0x800; i += 0x100) {
 		struct ttx_extension *ext;
 
@@ -2768,6 +2925,8 @@ vbi_teletext_set_default_region(vbi_decoder *vbi, int default_region)
 		ext->charset_code[1] = 0;
 	}
 
+	pthread_mutex_unlock(&vbi->ca->mutex);
+
 	vbi->vt.default_magazine.extension.charset_code[0] = default_region;
 	vbi->vt.default_magazine.extension.charset_code[1] = 0;
 }
@@ -2790,6 +2949,233 @@ vbi_teletext_set_level(vbi_decoder *vbi, int level)
 	vbi->vt.max_level = level;
 }
 
+/**
+ * @param vbi Initialized vbi decoding context.
+ * @param enable @c TRUE to report only pages which changed.
+ *
+ * Carousels retransmit Teletext pages every cycle, usually
+ * unchanged. By default a @c VBI_EVENT_TTX_PAGE is sent whenever a
+ * page has been received. When enabled the event is sent only if
+ * the page is new or its content changed, see ev.ttx_page.dirty_rows,
+ * or the rolling header needs an update because the header or
+ * real time clock changed.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_teletext_set_changes_only(vbi_decoder *vbi, vbi_bool enable)
+{
+	vbi->vt.changes_only = !!enable;
+}
+
+static void
+interest_changed(struct teletext *vt)
+{
+	vbi_pgno pgno;
+
+	vt->interest_magazines = 0;
+
+	pgno = 0;
+
+	while (vbi_page_table_next_page(vt->interest, &pgno)) {
+		vt->interest_magazines |= 1 << ((pgno >> 8) & 7);
+		pgno |= 0xFF; /* next magazine */
+	}
+}
+
+/* Creates the interest table, initially with all pages if
+   the decoder decoded all pages until now. */
+static vbi_bool
+interest_table(struct teletext *vt, vbi_bool all_pages)
+{
+	if (NULL != vt->interest)
+		return FALSE;
+
+	vt->interest = vbi_page_table_new();
+	if (NULL == vt->interest)
+		return FALSE;
+
+	if (all_pages)
+		vbi_page_table_add_all_pages(vt->interest);
+
+	return TRUE;
+}
+
+static void
+interest_update_failed(struct teletext *vt, vbi_bool created)
+{
+	if (created) {
+		vbi_page_table_delete(vt->interest);
+		vt->interest = NULL;
+	}
+}
+
+/**
+ * @param vbi Initialized vbi decoding context.
+ * @param first_pgno First page number of the range to add.
+ * @param last_pgno Last page number of the range, inclusive.
+ *
+ * By default the Teletext decoder decodes and caches all pages it
+ * receives. Clients interested in only a few pages, for example
+ * subtitles, can save CPU time and cache memory by naming the
+ * pages they want. When the decoder receives the header of any
+ * other displayable page it ignores the packets of this page until
+ * the next page header, and it ignores the M/29 magazine
+ * enhancement packets of magazines without wanted pages.
+ *
+ * The first call of this function limits decoding to pages
+ * @a first_pgno to @a last_pgno, subsequent calls add more pages.
+ * System pages like TOP, MOT, MIP, DRCS and object pages, which
+ * pages of any magazine may reference, and the packets 8/30 with
+ * network information, time and PDC data are always decoded.
+ *
+ * @returns
+ * @c FALSE if the page numbers are invalid or out of memory.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_teletext_add_interest_pages(vbi_decoder *vbi,
+				vbi_pgno first_pgno,
+				vbi_pgno last_pgno)
+{
+	struct teletext *vt = &vbi->vt;
+	vbi_bool created;
+	vbi_bool success;
+
+	pthread_mutex_lock(&vt->interest_mutex);
+
+	created = interest_table(vt, /* all_pages */ FALSE);
+
+	if (NULL == vt->interest) {
+		success = FALSE;
+	} else {
+		success = vbi_page_table_add_pages(vt->interest,
+						   first_pgno, last_pgno);
+		if (success)
+			interest_changed(vt);
+		else
+			interest_update_failed(vt, created);
+	}
+
+	pthread_mutex_unlock(&vt->interest_mutex);
+
+	return success;
+}
+
+/**
+ * @param vbi Initialized vbi decoding context.
+ * @param pgno Page number.
+ * @param first_subno First subpage number of the range to add.
+ * @param last_subno Last subpage number of the range, inclusive.
+ *
+ * Like vbi_teletext_add_interest_pages(), but only subpages
+ * @a first_subno to @a last_subno of page @a pgno will be decoded.
+ * When both subpage numbers are @c VBI_ANY_SUBNO all subpages
+ * will be decoded.
+ *
+ * @returns
+ * @c FALSE if the page or subpage numbers are invalid or out of
+ * memory.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_teletext_add_interest_subpages(vbi_decoder *vbi,
+				   vbi_pgno pgno,
+				   vbi_subno first_subno,
+				   vbi_subno last_subno)
+{
+	struct teletext *vt = &vbi->vt;
+	vbi_bool created;
+	vbi_bool success;
+
+	pthread_mutex_lock(&vt->interest_mutex);
+
+	created = interest_table(vt, /* all_pages */ FALSE);
+
+	if (NULL == vt->interest) {
+		success = FALSE;
+	} else {
+		success = vbi_page_table_add_subpages(vt->interest, pgno,
+						      first_subno,
+						      last_subno);
+		if (success)
+			interest_changed(vt);
+		else
+			interest_update_failed(vt, created);
+	}
+
+	pthread_mutex_unlock(&vt->interest_mutex);
+
+	return success;
+}
+
+/**
+ * @param vbi Initialized vbi decoding context.
+ * @param first_pgno First page number of the range to remove.
+ * @param last_pgno Last page number of the range, inclusive.
+ *
+ * Stops decoding of pages @a first_pgno to @a last_pgno. When
+ * the decoder decoded all pages until now it continues to decode
+ * all pages except these. See vbi_teletext_add_interest_pages()
+ * for details.
+ *
+ * @returns
+ * @c FALSE if the page numbers are invalid or out of memory.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_teletext_remove_interest_pages(vbi_decoder *vbi,
+				   vbi_pgno first_pgno,
+				   vbi_pgno last_pgno)
+{
+	struct teletext *vt = &vbi->vt;
+	vbi_bool created;
+	vbi_bool success;
+
+	pthread_mutex_lock(&vt->interest_mutex);
+
+	created = interest_table(vt, /* all_pages */ TRUE);
+
+	if (NULL == vt->interest) {
+		success = FALSE;
+	} else {
+		success = vbi_page_table_remove_pages(vt->interest,
+						      first_pgno, last_pgno);
+		if (success)
+			interest_changed(vt);
+		else
+			interest_update_failed(vt, created);
+	}
+
+	pthread_mutex_unlock(&vt->interest_mutex);
+
+	return success;
+}
+
+/**
+ * @param vbi Initialized vbi decoding context.
+ *
+ * Forgets the pages added with vbi_teletext_add_interest_pages()
+ * and removed with vbi_teletext_remove_interest_pages(), the
+ * decoder will decode all pages again.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_teletext_reset_interest(vbi_decoder *vbi)
+{
+	pthread_mutex_lock(&vbi->vt.interest_mutex);
+
+	vbi_page_table_delete(vbi->vt.interest);
+	vbi->vt.interest = NULL;
+	vbi->vt.interest_magazines = 0;
+
+	pthread_mutex_unlock(&vbi->vt.interest_mutex);
+}
+
 /**
  * @internal
  * @param vbi Initialized vbi decoding context.
@@ -2872,6 +3258,8 @@ vbi_teletext_channel_switched(vbi_decoder *vbi)
 {
 	unsigned int i;
 
+	pthread_mutex_lock(&vbi->ca->mutex);
+
 	vbi->cn->initial_page.pgno = 0x100;
 	vbi->cn->initial_page.subno = VBI_ANY_SUBNO;
 
@@ -2885,6 +3273,8 @@ vbi_teletext_channel_switched(vbi_decoder *vbi)
 	for (i = 0; i < N_ELEMENTS (vbi->cn->_magazines); ++i)
 		ttx_magazine_init (vbi->cn->_magazines + i);
 
+	pthread_mutex_unlock(&vbi->ca->mutex);
+
 	vbi_teletext_set_default_region(vbi, vbi->vt.region);
 
 	vbi_teletext_desync(vbi);
@@ -2901,7 +3291,15 @@ vbi_teletext_channel_switched(vbi_decoder *vbi)
 void
 vbi_teletext_destroy(vbi_decoder *vbi)
 {
-	vbi = vbi;
+	free (vbi->vt.format_cache.entry);
+	vbi->vt.format_cache.entry = NULL;
+
+	pthread_mutex_destroy (&vbi->vt.format_cache.mutex);
+
+	vbi_page_table_delete (vbi->vt.interest);
+	vbi->vt.interest = NULL;
+
+	pthread_mutex_destroy (&vbi->vt.interest_mutex);
 }
 
 /**
@@ -2921,6 +3319,9 @@ vbi_teletext_init(vbi_decoder *vbi)
 
 	ttx_magazine_init (&vbi->vt.default_magazine);
 
+	pthread_mutex_init (&vbi->vt.format_cache.mutex, NULL);
+	pthread_mutex_init (&vbi->vt.interest_mutex, NULL);
+
 	vbi_teletext_channel_switched(vbi);     /* Reset */
 }
 
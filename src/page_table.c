@@ -264,11 +264,17 @@ vbi_page_table_next_subpage	(const vbi_page_table *pt,
 		next_pgno = last_pgno + 1;
 	}
 
+	/* Lowest subpage of the lowest page in the subpages vector. */
 	min_pgno = 0x900;
+	min_subno = 0;
 
 	for (i = 0; i < pt->subpages_size; ++i) {
-		if (next_pgno <= pt->subpages[i].pgno
-		    && next_pgno < min_pgno) {
+		if (pt->subpages[i].pgno < next_pgno)
+			continue;
+
+		if (pt->subpages[i].pgno < min_pgno
+		    || (pt->subpages[i].pgno == min_pgno
+			&& pt->subpages[i].first < min_subno)) {
 			min_pgno = pt->subpages[i].pgno;
 			min_subno = pt->subpages[i].first;
 		}
@@ -281,19 +287,21 @@ vbi_page_table_next_subpage	(const vbi_page_table *pt,
 	next_pgno &= ~31;
 
 	for (;;) {
-		if (0 != mask)
+		if (0 != mask) {
+			next_pgno += ffs (mask) - 1;
 			break;
+		}
 
 		next_pgno += 32;
 		if (next_pgno >= 0x900)
-			return FALSE;
+			break;
 
 		mask = pt->pages[++offset];
 	}
 
-	next_pgno += ffs (mask) - 1;
-
-	if (min_pgno < next_pgno) {
+	if (min_pgno >= 0x900 && next_pgno >= 0x900) {
+		return FALSE;
+	} else if (min_pgno < next_pgno) {
 		*pgno = min_pgno;
 		*subno = min_subno;
 	} else {
@@ -402,7 +410,7 @@ extend_vector			(void **		vector,
 	if (unlikely (new_capacity > (max_capacity / 2))) {
 		new_capacity = max_capacity;
 	} else {
-		new_capacity = MIN (min_capacity, new_capacity * 2);
+		new_capacity = MAX (min_capacity, new_capacity * 2);
 	}
 
 	new_vec = vbi_realloc (*vector, new_capacity * element_size);
@@ -29,8 +29,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "misc.h"
+#include "hamm.h"
 #include "raw_decoder.h"
 
 #ifndef RAW_DECODER_PATTERN_DUMP
@@ -66,6 +68,7 @@ _vbi_service_table [] = {
 		10500, 6203125, 6203125, /* 397 x FH */
 		0x00AAAAE7, 0xFFFF, 18, 6, 37 * 8, VBI_MODULATION_NRZ_LSB,
 		0, /* probably */
+		/* min_amplitude */ 20,
 	}, {
 		VBI_SLICED_TELETEXT_B_L10_625,
 		"Teletext System B 625 Level 1.5",
@@ -75,6 +78,7 @@ _vbi_service_table [] = {
 		10300, 6937500, 6937500, /* 444 x FH */
 		0x00AAAAE4, 0xFFFF, 18, 6, 42 * 8, VBI_MODULATION_NRZ_LSB,
 		0,
+		/* min_amplitude */ 20,
 	}, {
 		VBI_SLICED_TELETEXT_B,
 		"Teletext System B, 625",
@@ -84,6 +88,7 @@ _vbi_service_table [] = {
 		10300, 6937500, 6937500, /* 444 x FH */
 		0x00AAAAE4, 0xFFFF, 18, 6, 42 * 8, VBI_MODULATION_NRZ_LSB,
 		0,
+		/* min_amplitude */ 20,
 	}, {
 		VBI_SLICED_TELETEXT_C_625, /* UNTESTED */
 		"Teletext System C 625",
@@ -93,6 +98,7 @@ _vbi_service_table [] = {
 		10480, 5734375, 5734375, /* 367 x FH */
 		0x00AAAAE7, 0xFFFF, 18, 6, 33 * 8, VBI_MODULATION_NRZ_LSB,
 		0,
+		/* min_amplitude */ 20,
 	}, {
 		VBI_SLICED_TELETEXT_D_625, /* UNTESTED */
 		"Teletext System D 625",
@@ -103,6 +109,7 @@ _vbi_service_table [] = {
 		5642787, 5642787, /* 14/11 x FSC (color subcarrier) */
 		0x00AAAAE5, 0xFFFF, 18, 6, 34 * 8, VBI_MODULATION_NRZ_LSB,
 		0,
+		/* min_amplitude */ 20,
 	}, {
 		VBI_SLICED_VPS, "Video Program System",
 		VBI_VIDEOSTD_SET_PAL_BG,
@@ -112,6 +119,7 @@ _vbi_service_table [] = {
 		0xAAAA8A99, 0xFFFFFF, 32, 0, 13 * 8,
 		VBI_MODULATION_BIPHASE_MSB,
 		_VBI_SP_FIELD_NUM,
+		/* min_amplitude */ 20,
 	}, {
 		VBI_SLICED_VPS_F2, "Pseudo-VPS on field 2",
 		VBI_VIDEOSTD_SET_PAL_BG,
@@ -121,6 +129,7 @@ _vbi_service_table [] = {
 		0xAAAA8A99, 0xFFFFFF, 32, 0, 13 * 8,
 		VBI_MODULATION_BIPHASE_MSB,
 		_VBI_SP_FIELD_NUM,
+		/* min_amplitude */ 20,
 	}, {
 		VBI_SLICED_WSS_625, "Wide Screen Signalling 625",
 		VBI_VIDEOSTD_SET_625_50,
@@ -133,6 +142,7 @@ _vbi_service_table [] = {
 		VBI_MODULATION_BIPHASE_LSB,
 		/* Hm. Too easily confused with caption?? */
 		_VBI_SP_FIELD_NUM | _VBI_SP_LINE_NUM,
+		/* min_amplitude */ 20,
 	}, {
 		VBI_SLICED_CAPTION_625_F1, "Closed Caption 625, field 1",
 		VBI_VIDEOSTD_SET_625_50,
@@ -141,6 +151,7 @@ _vbi_service_table [] = {
 		10500, 1000000, 500000, /* 32 x FH */
 		0x00005551, 0x7FF, 14, 2, 2 * 8, VBI_MODULATION_NRZ_LSB,
 		_VBI_SP_FIELD_NUM,
+		/* min_amplitude */ 32,
 	}, {
 		VBI_SLICED_CAPTION_625_F2, "Closed Caption 625, field 2",
 		VBI_VIDEOSTD_SET_625_50,
@@ -149,6 +160,7 @@ _vbi_service_table [] = {
 		10500, 1000000, 500000, /* 32 x FH */
 		0x00005551, 0x7FF, 14, 2, 2 * 8, VBI_MODULATION_NRZ_LSB,
 		_VBI_SP_FIELD_NUM,
+		/* min_amplitude */ 32,
 	}, {
 		VBI_SLICED_VBI_625, "VBI 625", /* Blank VBI */
 		VBI_VIDEOSTD_SET_625_50,
@@ -157,6 +169,7 @@ _vbi_service_table [] = {
 		10000, 1510000, 1510000,
 		0, 0, 0, 0, 10 * 8, 0, /* 10.0-2 ... 62.9+1 us */
 		0,
+		/* min_amplitude */ 0, /* raw data, no squelch */
 	}, {
 		VBI_SLICED_TELETEXT_B_525, /* UNTESTED */
 		"Teletext System B 525",
@@ -166,6 +179,7 @@ _vbi_service_table [] = {
 		10500, 5727272, 5727272, /* 364 x FH */
 		0x00AAAAE4, 0xFFFF, 18, 6, 34 * 8, VBI_MODULATION_NRZ_LSB,
 		0,
+		/* min_amplitude */ 20,
 	}, {
 		VBI_SLICED_TELETEXT_C_525, /* UNTESTED */
 		"Teletext System C 525",
@@ -175,6 +189,7 @@ _vbi_service_table [] = {
 		10480, 5727272, 5727272, /* 364 x FH */
 		0x00AAAAE7, 0xFFFF, 18, 6, 33 * 8, VBI_MODULATION_NRZ_LSB,
 		0,
+		/* min_amplitude */ 20,
 	}, {
 		VBI_SLICED_TELETEXT_D_525, /* UNTESTED */
 		"Teletext System D 525",
@@ -184,6 +199,7 @@ _vbi_service_table [] = {
 		9780, 5727272, 5727272, /* 364 x FH */
 		0x00AAAAE5, 0xFFFF, 18, 6, 34 * 8, VBI_MODULATION_NRZ_LSB,
 		0,
+		/* min_amplitude */ 20,
 	}, {
 #if 0 /* FIXME probably wrong */
 		VBI_SLICED_WSS_CPR1204,	/* NOT CONFIRMED (EIA-J CPR-1204) */
@@ -195,6 +211,7 @@ _vbi_service_table [] = {
 		0x000000F0, 0xFF, 8, 0, 20 * 1, VBI_MODULATION_NRZ_MSB,
 		/* No useful FRC, but a six bit CRC */
 		0,
+		/* min_amplitude */ 20,
 	}, {
 #endif
 		VBI_SLICED_CAPTION_525_F1,
@@ -211,6 +228,7 @@ _vbi_service_table [] = {
 		/* I've seen CC signals on other lines and there's no
 		   way to distinguish from the transmitted data. */
 		_VBI_SP_FIELD_NUM | _VBI_SP_LINE_NUM,
+		/* min_amplitude */ 32,
 	}, {
 		VBI_SLICED_CAPTION_525_F2,
 		"Closed Caption 525, field 2",
@@ -221,6 +239,7 @@ _vbi_service_table [] = {
 		0x03, 0x0F, 4, 0, 2 * 8, VBI_MODULATION_NRZ_LSB,
 		/* 0x00005551, 0x7FF, 14, 2, 2 * 8, VBI_MODULATION_NRZ_LSB, */
 		_VBI_SP_FIELD_NUM | _VBI_SP_LINE_NUM,
+		/* min_amplitude */ 32,
 	}, {
 		VBI_SLICED_2xCAPTION_525, /* NOT CONFIRMED */
 		"2xCaption 525",
@@ -231,6 +250,7 @@ _vbi_service_table [] = {
 		0x000554ED, 0xFFFF, 12, 8, 4 * 8,
 		VBI_MODULATION_NRZ_LSB, /* Tb. */
 		_VBI_SP_FIELD_NUM,
+		/* min_amplitude */ 32,
 	}, {
 		VBI_SLICED_VBI_525, "VBI 525", /* Blank VBI */
 		VBI_VIDEOSTD_SET_525_60,
@@ -239,6 +259,7 @@ _vbi_service_table [] = {
 		9500, 1510000, 1510000,
 		0, 0, 0, 0, 10 * 8, 0, /* 9.5-1 ... 62.4+1 us */
 		0,
+		/* min_amplitude */ 0, /* raw data, no squelch */
 	}, {
 		0, NULL,
 		VBI_VIDEOSTD_SET_EMPTY,
@@ -247,6 +268,7 @@ _vbi_service_table [] = {
 		0, 0, 0,
 		0, 0, 0, 0, 0, 0,
 		0,
+		/* min_amplitude */ 0,
 	}
 };
 
@@ -369,6 +391,10 @@ dump_pattern_line		(const vbi3_raw_decoder *rd,
 		fprintf (fp, "%02x ", (uint8_t) rd->pattern[pos + i]);
 	}
 
+	fprintf (fp, "hits %5u conf %3u",
+		 rd->line_stats[row].hits,
+		 rd->line_stats[row].confidence);
+
 	fputc ('\n', fp);
 }
 
@@ -427,6 +453,27 @@ cpr1204_crc			(const vbi_sliced *	sliced)
 	return crc;
 }
 
+/* Cheap plausibility check of a decoded line for the quality
+   counters, the caller is responsible for real error correction. */
+_vbi_inline vbi_bool
+check_parity			(vbi_service_set	id,
+				 const vbi_sliced *	sliced)
+{
+	if (id & VBI_SLICED_TELETEXT_B) {
+		/* Magazine and packet address. */
+		return vbi_unham16p (sliced->data) >= 0;
+	} else if (id & (VBI_SLICED_CAPTION_525 |
+			 VBI_SLICED_CAPTION_625)) {
+		return (vbi_unpar8 (sliced->data[0]) >= 0
+			&& vbi_unpar8 (sliced->data[1]) >= 0);
+	} else if (id & VBI_SLICED_WSS_625) {
+		/* Bit 3 is an odd parity bit of group A. */
+		return 0 != (0x6996 & (1 << (sliced->data[0] & 15)));
+	}
+
+	return TRUE;
+}
+
 static vbi_bool
 slice				(vbi3_raw_decoder *	rd,
 				 vbi_sliced *		sliced,
@@ -452,12 +499,45 @@ slice				(vbi3_raw_decoder *	rd,
 	}
 }
 
+/* Lines with few hits, e.g. noise mistaken for data, are predicted
+   as blank after CONFIDENCE_MIN * 16 frames, lines with many hits after
+   at most 255 * 16 frames (2.7 minutes at 25 Hz). */
+#define CONFIDENCE_MIN 16
+
+_vbi_inline void
+line_hit			(_vbi3_raw_decoder_line_stat *stat)
+{
+	if (stat->hits < 0xFFFF)
+		++stat->hits;
+
+	stat->confidence = MIN (stat->hits + CONFIDENCE_MIN, 255);
+}
+
+_vbi_inline vbi_bool
+line_expired			(_vbi3_raw_decoder_line_stat *stat,
+				 int			readjust)
+{
+	if (0 != readjust)
+		return FALSE;
+
+	if (stat->confidence > 0) {
+		--stat->confidence;
+		return FALSE;
+	}
+
+	stat->hits = 0;
+
+	return TRUE;
+}
+
 _vbi_inline vbi_sliced *
 decode_pattern			(vbi3_raw_decoder *	rd,
+				 _vbi3_raw_decoder_job *jobs,
 				 vbi_sliced *		sliced,
 				 int8_t *		pattern,
 				 unsigned int		i,
-				 const uint8_t *	raw)
+				 const uint8_t *	raw,
+				 int			readjust)
 {
 	vbi_sampling_par *sp;
 	int8_t *pat;
@@ -471,13 +551,33 @@ decode_pattern			(vbi3_raw_decoder *	rd,
 
 		if (j > 0) {
 			_vbi3_raw_decoder_job *job;
+			vbi3_raw_decoder_quality *q;
+			unsigned int n_cri_matches;
+			unsigned int n_frc_errors;
+
+			job = jobs + j - 1;
 
-			job = rd->jobs + j - 1;
+			q = &rd->quality[i * _VBI3_RAW_DECODER_MAX_JOBS + j - 1];
+
+			n_cri_matches = job->slicer.n_cri_matches;
+			n_frc_errors = job->slicer.n_frc_errors;
+
+			++q->attempts;
 
 			if (!slice (rd, sliced, job, i, raw)) {
+				q->cri_matches += job->slicer.n_cri_matches
+					- n_cri_matches;
+				q->frc_errors += job->slicer.n_frc_errors
+					- n_frc_errors;
 				continue; /* no match, try next data service */
 			}
 
+			++q->cri_matches;
+			++q->decoded;
+			q->thresh = job->slicer.last_thresh;
+			q->eye_opening = job->slicer.last_eye_opening;
+			q->parity_errors += !check_parity (job->id, sliced);
+
 			/* FIXME probably wrong */
 			if (0 && VBI_SLICED_WSS_CPR1204 == job->id) {
 				const int poly = (1 << 6) + (1 << 1) + 1;
@@ -523,12 +623,15 @@ decode_pattern			(vbi3_raw_decoder *	rd,
 			++sliced;
 
 			/* Predict line as non-blank, force testing for
-			   all data services in the next 128 frames. */
+			   all data services until the line was blank
+			   for a while. */
 			pattern[_VBI3_RAW_DECODER_MAX_WAYS - 1] = -128;
+
+			line_hit (&rd->line_stats[i]);
 		} else if (pat == pattern) {
 			/* Line was predicted as blank, once in 16
 			   frames look for data services. */
-			if (0 == rd->readjust) {
+			if (0 == readjust) {
 				unsigned int size;
 
 				size = sizeof (*pattern)
@@ -540,15 +643,22 @@ decode_pattern			(vbi3_raw_decoder *	rd,
 			}
 
 			break;
-		} else if ((j = pattern[_VBI3_RAW_DECODER_MAX_WAYS - 1]) < 0) {
-			/* Increment counter, when zero predict line as
-			   blank and stop looking for data services until
-			   0 == rd->readjust. */
-			/* Disabled because we may miss caption/subtitles
-			   when the signal inserter is disabled during silent
-			   periods for more than 4-5 seconds. */
-			/* pattern[_VBI3_RAW_DECODER_MAX_WAYS - 1] = j + 1; */
-			break;
+		} else if (pattern[_VBI3_RAW_DECODER_MAX_WAYS - 1] < 0) {
+			/* We may miss caption/subtitles when the signal
+			   inserter is disabled during silent periods for
+			   more than 4-5 seconds, so we predict the line as
+			   blank only after a much longer time. Until then
+			   we keep looking for data services. */
+			if (!line_expired (&rd->line_stats[i], readjust))
+				break;
+
+			/* Predict line as blank and stop looking for
+			   data services until 0 == readjust. When all
+			   other ways hold services j is the counter,
+			   which must not move into pattern[0] where
+			   the line would have no free way. */
+			pattern[_VBI3_RAW_DECODER_MAX_WAYS - 1] = 0;
+			j = 0;
 		} else {
 			/* found nothing, j = 0 */
 		}
@@ -563,6 +673,438 @@ decode_pattern			(vbi3_raw_decoder *	rd,
 	return sliced;
 }
 
+/* Parallel decoding. Worker n decodes the n-th of n_threads blocks
+   of consecutive scan lines, the caller's thread is worker 0. Blocks
+   rather than every n_threads-th line, so workers do not write
+   the same cache lines of the per-line output, pattern and
+   statistics. Each line has its own pattern, so workers do not share
+   any learning state, but they need private copies of the jobs
+   because the bit slicer adapts its threshold while decoding. */
+
+typedef struct {
+	_vbi3_raw_decoder_pool *pool;
+	pthread_t		thread;
+	unsigned int		index;
+
+	/* Last frame this worker decoded. */
+	unsigned int		frame;
+
+	/* Copy of rd->jobs, unused by worker 0. */
+	_vbi3_raw_decoder_job	jobs[_VBI3_RAW_DECODER_MAX_JOBS];
+	unsigned int		jobs_serial;
+} _vbi3_raw_decoder_worker;
+
+struct _vbi3_raw_decoder_pool {
+	vbi3_raw_decoder *	rd;
+
+	pthread_mutex_t		mutex;
+	pthread_cond_t		start_cond;
+	pthread_cond_t		done_cond;
+
+	/* Incremented when the workers shall decode a frame. */
+	unsigned int		frame;
+	unsigned int		n_busy;
+	vbi_bool		quit;
+
+	/* The current batch of frames, the first one at view,
+	   the others frame_size bytes apart. */
+	vbi3_raw_view		view;
+	unsigned long		frame_size;
+	unsigned int		n_frames;
+	int			readjust;
+
+	/* One vbi_sliced per scan line and frame,
+	   id 0 if nothing found. */
+	vbi_sliced *		lines;
+	unsigned int		lines_capacity;
+
+	unsigned int		n_threads;
+	_vbi3_raw_decoder_worker workers[1];
+};
+
+_vbi_inline const uint8_t *
+row_data			(const vbi_sampling_par *sp,
+				 const vbi3_raw_view *	view,
+				 unsigned int		row)
+{
+	if (row >= (unsigned int) sp->count[0])
+		return view->data + view->offset[1]
+			+ (row - sp->count[0]) * view->stride;
+	else
+		return view->data + view->offset[0] + row * view->stride;
+}
+
+static void
+decode_rows			(vbi3_raw_decoder *	rd,
+				 _vbi3_raw_decoder_job *jobs,
+				 unsigned int		index)
+{
+	_vbi3_raw_decoder_pool *pool;
+	const vbi_sampling_par *sp;
+	unsigned int scan_lines;
+	unsigned int first_row;
+	unsigned int end_row;
+	unsigned int f;
+
+	pool = rd->pool;
+	sp = &rd->sampling;
+
+	scan_lines = sp->count[0] + sp->count[1];
+
+	first_row = scan_lines * index / pool->n_threads;
+	end_row = scan_lines * (index + 1) / pool->n_threads;
+
+	for (f = 0; f < pool->n_frames; ++f) {
+		vbi3_raw_view view;
+		vbi_sliced *lines;
+		int readjust;
+		unsigned int i;
+
+		lines = pool->lines + f * scan_lines;
+		view = pool->view;
+		view.data += f * pool->frame_size;
+		readjust = (pool->readjust + f) & 15;
+
+		for (i = first_row; i < end_row; ++i) {
+			int8_t *pattern;
+			vbi_sliced *s;
+
+			pattern = rd->pattern + i * _VBI3_RAW_DECODER_MAX_WAYS;
+
+			s = decode_pattern (rd, jobs, &lines[i], pattern, i,
+					    row_data (sp, &view, i), readjust);
+			if (s == &lines[i])
+				lines[i].id = 0;
+		}
+	}
+}
+
+static void *
+worker_thread			(void *			arg)
+{
+	_vbi3_raw_decoder_worker *w = arg;
+	_vbi3_raw_decoder_pool *pool = w->pool;
+
+	pthread_mutex_lock (&pool->mutex);
+
+	for (;;) {
+		while (!pool->quit && w->frame == pool->frame)
+			pthread_cond_wait (&pool->start_cond, &pool->mutex);
+
+		if (pool->quit)
+			break;
+
+		w->frame = pool->frame;
+
+		pthread_mutex_unlock (&pool->mutex);
+
+		decode_rows (pool->rd, w->jobs, w->index);
+
+		pthread_mutex_lock (&pool->mutex);
+
+		if (0 == --pool->n_busy)
+			pthread_cond_signal (&pool->done_cond);
+	}
+
+	pthread_mutex_unlock (&pool->mutex);
+
+	return NULL;
+}
+
+static unsigned int
+decode_parallel			(vbi3_raw_decoder *	rd,
+				 vbi_sliced *		sliced,
+				 unsigned int		max_lines,
+				 unsigned int *		n_lines,
+				 const vbi3_raw_view *	view,
+				 unsigned long		frame_size,
+				 unsigned int		n_frames)
+{
+	_vbi3_raw_decoder_pool *pool;
+	unsigned int scan_lines;
+	unsigned int total;
+	unsigned int f;
+	unsigned int i;
+
+	pool = rd->pool;
+
+	scan_lines = rd->sampling.count[0] + rd->sampling.count[1];
+
+	/* The workers are idle now, we can safely change
+	   the buffers and their jobs. */
+
+	if (scan_lines * n_frames > pool->lines_capacity) {
+		vbi_sliced *lines;
+
+		lines = vbi_malloc (scan_lines * n_frames * sizeof (*lines));
+		if (NULL == lines) {
+			error (&rd->log, "Out of memory.");
+			return 0;
+		}
+
+		vbi_free (pool->lines);
+		pool->lines = lines;
+		pool->lines_capacity = scan_lines * n_frames;
+	}
+
+	for (i = 1; i < pool->n_threads; ++i) {
+		_vbi3_raw_decoder_worker *w = &pool->workers[i];
+
+		if (w->jobs_serial != rd->jobs_serial) {
+			memcpy (w->jobs, rd->jobs, sizeof (w->jobs));
+			w->jobs_serial = rd->jobs_serial;
+		}
+	}
+
+	pthread_mutex_lock (&pool->mutex);
+
+	pool->view = *view;
+	pool->frame_size = frame_size;
+	pool->n_frames = n_frames;
+	pool->readjust = rd->readjust;
+	pool->n_busy = pool->n_threads - 1;
+	++pool->frame;
+
+	pthread_cond_broadcast (&pool->start_cond);
+
+	pthread_mutex_unlock (&pool->mutex);
+
+	decode_rows (rd, rd->jobs, 0);
+
+	pthread_mutex_lock (&pool->mutex);
+
+	while (pool->n_busy > 0)
+		pthread_cond_wait (&pool->done_cond, &pool->mutex);
+
+	pthread_mutex_unlock (&pool->mutex);
+
+	/* Output in scan line order, like the single threaded
+	   decoder. Like the bit slicer we store only the payload. */
+	total = 0;
+
+	for (f = 0; f < n_frames; ++f) {
+		const vbi_sliced *lines;
+		vbi_sliced *out;
+		unsigned int n;
+
+		lines = pool->lines + f * scan_lines;
+		out = sliced + f * max_lines;
+		n = 0;
+
+		for (i = 0; i < scan_lines && n < max_lines; ++i) {
+			const vbi_sliced *s = &lines[i];
+
+			if (0 != s->id) {
+				out[n].id = s->id;
+				out[n].line = s->line;
+				memcpy (out[n].data, s->data,
+					(vbi_sliced_payload_bits (s->id)
+					 + 7) >> 3);
+				++n;
+			}
+		}
+
+		if (NULL != n_lines)
+			n_lines[f] = n;
+
+		total += n;
+	}
+
+	rd->readjust = (rd->readjust + n_frames) & 15;
+
+	return total;
+}
+
+static void
+delete_pool			(_vbi3_raw_decoder_pool *pool)
+{
+	unsigned int i;
+
+	pthread_mutex_lock (&pool->mutex);
+
+	pool->quit = TRUE;
+	pthread_cond_broadcast (&pool->start_cond);
+
+	pthread_mutex_unlock (&pool->mutex);
+
+	for (i = 1; i < pool->n_threads; ++i)
+		pthread_join (pool->workers[i].thread, NULL);
+
+	pthread_cond_destroy (&pool->done_cond);
+	pthread_cond_destroy (&pool->start_cond);
+	pthread_mutex_destroy (&pool->mutex);
+
+	vbi_free (pool->lines);
+
+	CLEAR (*pool);
+
+	vbi_free (pool);
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param n_threads Number of threads decoding a frame, including
+ *   the thread calling vbi3_raw_decoder_decode(). 0 or 1 disables
+ *   parallel decoding, this is the default.
+ *
+ * Distributes the scan lines of a frame over a pool of threads
+ * to reduce the latency of vbi3_raw_decoder_decode() on SMP systems.
+ * The output remains sorted by line number. Note the bit slicer of
+ * each thread adapts to the signal independently, so the results
+ * may differ slightly from single threaded decoding when the signal
+ * is weak. Also all lines are decoded, even if less than
+ * $a max_lines are stored.
+ *
+ * $return
+ * $c FALSE if the threads could not be created. Then the decoder
+ * falls back to single threaded decoding.
+ */
+vbi_bool
+vbi3_raw_decoder_set_threads	(vbi3_raw_decoder *	rd,
+				 unsigned int		n_threads)
+{
+	_vbi3_raw_decoder_pool *pool;
+	unsigned int i;
+
+	assert (NULL != rd);
+
+	if (NULL != rd->pool) {
+		if (n_threads == rd->pool->n_threads)
+			return TRUE;
+
+		delete_pool (rd->pool);
+		rd->pool = NULL;
+	}
+
+	if (n_threads <= 1)
+		return TRUE;
+
+	pool = vbi_malloc (sizeof (*pool)
+			   + (n_threads - 1) * sizeof (pool->workers[0]));
+	if (NULL == pool) {
+		error (&rd->log, "Out of memory.");
+		return FALSE;
+	}
+
+	memset (pool, 0, sizeof (*pool)
+		+ (n_threads - 1) * sizeof (pool->workers[0]));
+
+	pool->rd = rd;
+
+	pthread_mutex_init (&pool->mutex, NULL);
+	pthread_cond_init (&pool->start_cond, NULL);
+	pthread_cond_init (&pool->done_cond, NULL);
+
+	for (i = 0; i < n_threads; ++i) {
+		_vbi3_raw_decoder_worker *w = &pool->workers[i];
+		int err;
+
+		w->pool = pool;
+		w->index = i;
+
+		/* Copy jobs before the first frame. */
+		w->jobs_serial = rd->jobs_serial - 1;
+
+		if (0 == i)
+			continue;
+
+		err = pthread_create (&w->thread, NULL, worker_thread, w);
+		if (0 != err) {
+			error (&rd->log,
+			       "Cannot create decoder thread: %s.",
+			       strerror (err));
+
+			/* Join the threads we have. */
+			pool->n_threads = i;
+			delete_pool (pool);
+
+			return FALSE;
+		}
+	}
+
+	pool->n_threads = n_threads;
+
+	rd->pool = pool;
+
+	return TRUE;
+}
+
+/* Number of bytes the bit slicers may read from a line. */
+static unsigned long
+line_size			(const vbi_sampling_par *sp)
+{
+#if 2 == VBI_VERSION_MINOR
+	return sp->bytes_per_line;
+#else
+	return sp->samples_per_line * VBI_PIXFMT_BPP (sp->sample_format);
+#endif
+}
+
+/* The layout of a raw image as described by the sampling
+   parameters, the second field following the first or, if
+   interlaced, the lines of both fields alternating. */
+static void
+image_view			(vbi3_raw_view *	view,
+				 const vbi_sampling_par *sp,
+				 const uint8_t *	raw)
+{
+	view->data = raw;
+	view->offset[0] = 0;
+
+	if (sp->interlaced) {
+		view->offset[1] = sp->bytes_per_line;
+		view->stride = sp->bytes_per_line * 2;
+	} else {
+		view->offset[1] = sp->count[0] * sp->bytes_per_line;
+		view->stride = sp->bytes_per_line;
+	}
+}
+
+static unsigned int
+decode_frame			(vbi3_raw_decoder *	rd,
+				 vbi_sliced *		sliced,
+				 unsigned int		max_lines,
+				 const vbi3_raw_view *	view)
+{
+	vbi_sampling_par *sp;
+	unsigned int scan_lines;
+	int8_t *pattern;
+	const uint8_t *raw;
+	vbi_sliced *sliced_begin;
+	vbi_sliced *sliced_end;
+	unsigned int i;
+
+	sp = &rd->sampling;
+
+	scan_lines = sp->count[0] + sp->count[1];
+
+	pattern = rd->pattern;
+
+	raw = view->data + view->offset[0];
+
+	sliced_begin = sliced;
+	sliced_end = sliced + max_lines;
+
+	for (i = 0; i < scan_lines; ++i) {
+		if (sliced >= sliced_end)
+			break;
+
+		if (i == (unsigned int) sp->count[0])
+			raw = view->data + view->offset[1];
+
+		sliced = decode_pattern (rd, rd->jobs, sliced,
+					 pattern, i, raw, rd->readjust);
+
+		pattern += _VBI3_RAW_DECODER_MAX_WAYS;
+		raw += view->stride;
+	}
+
+	rd->readjust = (rd->readjust + 1) & 15;
+
+	return sliced - sliced_begin;
+}
+
 /**
  * $param rd Pointer to vbi3_raw_decoder object allocated with
  *   vbi3_raw_decoder_new().
@@ -591,49 +1133,525 @@ vbi3_raw_decoder_decode		(vbi3_raw_decoder *	rd,
 				 unsigned int		max_lines,
 				 const uint8_t *	raw)
 {
-	vbi_sampling_par *sp;
+	vbi3_raw_view view;
+
+	image_view (&view, &rd->sampling, raw);
+
+	return vbi3_raw_decoder_decode_view (rd, sliced, max_lines, &view);
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param sliced Buffer to store the decoded vbi_sliced data.
+ * $param max_lines Size of $a sliced data array, in lines, not bytes.
+ * $param view Location of the raw vbi image. The number of lines
+ *   and the format of the samples are described by the vbi_sampling_par
+ *   associated with $a rd, but the lines of each field can start
+ *   at any offset and be any distance apart.
+ *
+ * Like vbi3_raw_decoder_decode(), but decodes a raw image in
+ * place, for example directly out of a driver buffer with padding
+ * between the lines or between the fields.
+ *
+ * $return
+ * The number of lines decoded, i. e. the number of vbi_sliced records
+ * written. Zero if the $a view stride is smaller than a line.
+ */
+unsigned int
+vbi3_raw_decoder_decode_view	(vbi3_raw_decoder *	rd,
+				 vbi_sliced *		sliced,
+				 unsigned int		max_lines,
+				 const vbi3_raw_view *	view)
+{
+	if (!rd->services)
+		return 0;
+
+	if (view->stride < line_size (&rd->sampling)) {
+		error (&rd->log,
+		       "Raw view stride %lu is smaller than a line.",
+		       view->stride);
+		return 0;
+	}
+
+	if (RAW_DECODER_PATTERN_DUMP)
+		_vbi3_raw_decoder_dump (rd, stderr);
+
+	if (NULL != rd->pool)
+		return decode_parallel (rd, sliced, max_lines,
+					/* n_lines */ NULL, view,
+					/* frame_size */ 0,
+					/* n_frames */ 1);
+
+	return decode_frame (rd, sliced, max_lines, view);
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param sliced Buffer to store the decoded vbi_sliced data, an array
+ *   of $a max_lines * $a n_frames elements. The lines of frame n are
+ *   stored at $a sliced + n * $a max_lines.
+ * $param max_lines Number of vbi_sliced elements available for each
+ *   frame.
+ * $param n_lines The number of lines decoded from each frame will be
+ *   stored here, an array of $a n_frames elements. Can be $c NULL.
+ * $param raw $a n_frames raw vbi images as described by the
+ *   vbi_sampling_par associated with $a rd, stored one after the other
+ *   without padding.
+ * $param n_frames Number of raw images.
+ *
+ * Like vbi3_raw_decoder_decode(), but decodes a sequence of frames
+ * in one call, for example when reprocessing recorded raw vbi data.
+ * The results are the same as when decoding the frames one at a time,
+ * but with vbi3_raw_decoder_set_threads() the worker threads are
+ * dispatched only once for the whole batch.
+ *
+ * $return
+ * The total number of lines decoded, i. e. the sum of all $a n_lines.
+ */
+unsigned int
+vbi3_raw_decoder_decode_frames	(vbi3_raw_decoder *	rd,
+				 vbi_sliced *		sliced,
+				 unsigned int		max_lines,
+				 unsigned int *		n_lines,
+				 const uint8_t *	raw,
+				 unsigned int		n_frames)
+{
+	vbi3_raw_view view;
+	unsigned long frame_size;
+	unsigned int total;
+	unsigned int f;
+
+	if (0 == n_frames)
+		return 0;
+
+	if (!rd->services) {
+		if (NULL != n_lines)
+			memset (n_lines, 0, n_frames * sizeof (*n_lines));
+		return 0;
+	}
+
+	if (RAW_DECODER_PATTERN_DUMP)
+		_vbi3_raw_decoder_dump (rd, stderr);
+
+	image_view (&view, &rd->sampling, raw);
+
+	frame_size = (rd->sampling.count[0] + rd->sampling.count[1])
+		* rd->sampling.bytes_per_line;
+
+	if (NULL != rd->pool)
+		return decode_parallel (rd, sliced, max_lines, n_lines,
+					&view, frame_size, n_frames);
+
+	total = 0;
+
+	for (f = 0; f < n_frames; ++f) {
+		unsigned int n;
+
+		n = decode_frame (rd, sliced, max_lines, &view);
+
+		if (NULL != n_lines)
+			n_lines[f] = n;
+
+		total += n;
+
+		sliced += max_lines;
+		view.data += frame_size;
+	}
+
+	return total;
+}
+
+/* Prediction state, all numbers little endian:
+   char[4] magic, uint8_t version, n_jobs, uint16_t 0,
+   uint16_t start[0], count[0], start[1], count[1],
+   uint32_t service id of each job,
+   for each scan line int8_t pattern[_VBI3_RAW_DECODER_MAX_WAYS],
+   uint16_t hits, uint8_t confidence, uint8_t 0. */
+
+static const uint8_t
+prediction_magic [4] = { 'Z', 'V', 'R', 'P' };
+
+#define PREDICTION_VERSION 1
+
+static uint8_t *
+put_le			(uint8_t *		p,
+			 unsigned int		value,
+			 unsigned int		n_bytes)
+{
+	while (n_bytes-- > 0) {
+		*p++ = value;
+		value >>= 8;
+	}
+
+	return p;
+}
+
+static const uint8_t *
+get_le			(unsigned int *		value,
+			 const uint8_t *	p,
+			 unsigned int		n_bytes)
+{
+	unsigned int i;
+
+	*value = 0;
+
+	for (i = 0; i < n_bytes; ++i)
+		*value |= (unsigned int) p[i] << (i * 8);
+
+	return p + n_bytes;
+}
+
+static size_t
+prediction_size			(const vbi3_raw_decoder *rd)
+{
 	unsigned int scan_lines;
-	unsigned int pitch;
-	int8_t *pattern;
-	const uint8_t *raw1;
-	vbi_sliced *sliced_begin;
-	vbi_sliced *sliced_end;
+
+	scan_lines = rd->sampling.count[0] + rd->sampling.count[1];
+
+	return 16 + rd->n_jobs * 4
+		+ scan_lines * (_VBI3_RAW_DECODER_MAX_WAYS + 4);
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param buffer Output buffer, can be $c NULL to determine the
+ *   required size.
+ * $param buffer_size Size of the buffer in bytes.
+ *
+ * The raw decoder learns which scan lines carry which data services.
+ * This function stores that knowledge in a buffer, for example to save
+ * it in a file with the settings of a channel. When you load it with
+ * vbi3_raw_decoder_load_prediction() after tuning in again, the
+ * decoder does not need to search all lines for all services
+ * in the first frames.
+ *
+ * $return
+ * The number of bytes stored in the buffer or which would be stored
+ * if $a buffer is $c NULL. Zero if no services have been added or
+ * the buffer is too small.
+ */
+size_t
+vbi3_raw_decoder_save_prediction
+				(const vbi3_raw_decoder *rd,
+				 void *			buffer,
+				 size_t			buffer_size)
+{
+	const vbi_sampling_par *sp;
+	unsigned int scan_lines;
+	uint8_t *p;
+	size_t size;
 	unsigned int i;
 
-	if (!rd->services)
+	assert (NULL != rd);
+
+	if (NULL == rd->pattern)
+		return 0;
+
+	size = prediction_size (rd);
+
+	if (NULL == buffer)
+		return size;
+
+	if (buffer_size < size)
 		return 0;
 
 	sp = &rd->sampling;
+	scan_lines = sp->count[0] + sp->count[1];
+
+	p = buffer;
+
+	memcpy (p, prediction_magic, sizeof (prediction_magic));
+	p += sizeof (prediction_magic);
+
+	p = put_le (p, PREDICTION_VERSION, 1);
+	p = put_le (p, rd->n_jobs, 1);
+	p = put_le (p, 0, 2);
+
+	for (i = 0; i < 2; ++i) {
+		p = put_le (p, sp->start[i], 2);
+		p = put_le (p, sp->count[i], 2);
+	}
+
+	for (i = 0; i < rd->n_jobs; ++i)
+		p = put_le (p, rd->jobs[i].id, 4);
+
+	for (i = 0; i < scan_lines; ++i) {
+		memcpy (p, rd->pattern + i * _VBI3_RAW_DECODER_MAX_WAYS,
+			_VBI3_RAW_DECODER_MAX_WAYS);
+		p += _VBI3_RAW_DECODER_MAX_WAYS;
+
+		p = put_le (p, rd->line_stats[i].hits, 2);
+		p = put_le (p, rd->line_stats[i].confidence, 1);
+		p = put_le (p, 0, 1);
+	}
+
+	assert ((size_t)(p - (uint8_t *) buffer) == size);
+
+	return size;
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param buffer Prediction state stored by
+ *   vbi3_raw_decoder_save_prediction().
+ * $param buffer_size Size of the state in bytes.
+ *
+ * Restores which scan lines carry which data services, as learned
+ * by another raw decoder. The state is only accepted if the decoder
+ * has the same sampling parameters and services, added in the same
+ * order, as the decoder which saved it.
+ *
+ * $return
+ * $c FALSE if the state is invalid or does not match this decoder.
+ * Then the decoder state remains unchanged.
+ */
+vbi_bool
+vbi3_raw_decoder_load_prediction
+				(vbi3_raw_decoder *	rd,
+				 const void *		buffer,
+				 size_t			buffer_size)
+{
+	const vbi_sampling_par *sp;
+	const uint8_t *p;
+	unsigned int scan_lines;
+	unsigned int value;
+	unsigned int i;
+
+	assert (NULL != rd);
+	assert (NULL != buffer);
+
+	if (NULL == rd->pattern
+	    || buffer_size != prediction_size (rd))
+		goto failure;
 
+	sp = &rd->sampling;
 	scan_lines = sp->count[0] + sp->count[1];
-	pitch = sp->bytes_per_line << sp->interlaced;
 
-	pattern = rd->pattern;
+	p = buffer;
 
-	raw1 = raw;
+	if (0 != memcmp (p, prediction_magic, sizeof (prediction_magic)))
+		goto failure;
+	p += sizeof (prediction_magic);
 
-	sliced_begin = sliced;
-	sliced_end = sliced + max_lines;
+	p = get_le (&value, p, 1);
+	if (PREDICTION_VERSION != value)
+		goto failure;
 
-	if (RAW_DECODER_PATTERN_DUMP)
-		_vbi3_raw_decoder_dump (rd, stderr);
+	p = get_le (&value, p, 1);
+	if (rd->n_jobs != value)
+		goto failure;
 
+	p += 2;
+
+	for (i = 0; i < 2; ++i) {
+		p = get_le (&value, p, 2);
+		if ((unsigned int) sp->start[i] != value)
+			goto failure;
+
+		p = get_le (&value, p, 2);
+		if ((unsigned int) sp->count[i] != value)
+			goto failure;
+	}
+
+	for (i = 0; i < rd->n_jobs; ++i) {
+		p = get_le (&value, p, 4);
+		if (rd->jobs[i].id != value)
+			goto failure;
+	}
+
+	/* Only jobs which can appear on a line per
+	   add_job_to_pattern(), and a free way. */
 	for (i = 0; i < scan_lines; ++i) {
-		if (sliced >= sliced_end)
-			break;
+		const int8_t *pattern;
+		const int8_t *cur;
+		unsigned int n_free;
+		unsigned int j;
 
-		if (sp->interlaced && i == (unsigned int) sp->count[0])
-			raw = raw1 + sp->bytes_per_line;
+		pattern = (const int8_t *) p
+			+ i * (_VBI3_RAW_DECODER_MAX_WAYS + 4);
+		cur = rd->pattern + i * _VBI3_RAW_DECODER_MAX_WAYS;
 
-		sliced = decode_pattern (rd, sliced, pattern, i, raw);
+		n_free = 0;
 
-		pattern += _VBI3_RAW_DECODER_MAX_WAYS;
-		raw += pitch;
+		for (j = 0; j < _VBI3_RAW_DECODER_MAX_WAYS; ++j) {
+			unsigned int k;
+
+			if (pattern[j] <= 0) {
+				n_free += (0 == pattern[j]);
+				continue;
+			}
+
+			for (k = 0; k < _VBI3_RAW_DECODER_MAX_WAYS; ++k)
+				if (cur[k] == pattern[j])
+					break;
+
+			if (k >= _VBI3_RAW_DECODER_MAX_WAYS)
+				goto failure;
+		}
+
+		if (0 == n_free)
+			goto failure;
 	}
 
-	rd->readjust = (rd->readjust + 1) & 15;
+	for (i = 0; i < scan_lines; ++i) {
+		memcpy (rd->pattern + i * _VBI3_RAW_DECODER_MAX_WAYS,
+			p, _VBI3_RAW_DECODER_MAX_WAYS);
+		p += _VBI3_RAW_DECODER_MAX_WAYS;
 
-	return sliced - sliced_begin;
+		p = get_le (&value, p, 2);
+		rd->line_stats[i].hits = value;
+
+		p = get_le (&value, p, 1);
+		rd->line_stats[i].confidence = value;
+
+		p += 1;
+	}
+
+	return TRUE;
+
+ failure:
+	info (&rd->log, "Prediction state does not match the decoder.");
+
+	return FALSE;
+}
+
+static void
+add_quality			(vbi3_raw_decoder_quality *sum,
+				 unsigned int *		max_decoded,
+				 const vbi3_raw_decoder_quality *q)
+{
+	/* Levels of the most successful service and line. */
+	if (q->decoded > *max_decoded) {
+		*max_decoded = q->decoded;
+		sum->thresh = q->thresh;
+		sum->eye_opening = q->eye_opening;
+	}
+
+	sum->attempts += q->attempts;
+	sum->cri_matches += q->cri_matches;
+	sum->frc_errors += q->frc_errors;
+	sum->decoded += q->decoded;
+	sum->parity_errors += q->parity_errors;
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param quality The counters will be stored here.
+ * $param row Number of the scan line in the raw VBI image,
+ *   0 ... vbi_sampling_par.count[0] + .count[1] - 1.
+ *
+ * The raw decoder counts for each scan line and data service how often
+ * it looked for the service, found it or failed and why. These counters
+ * are always enabled and cheap, unlike vbi3_raw_decoder_debug(). This
+ * function returns the sum of the counters of all services on a line.
+ * The counters are reset by vbi3_raw_decoder_reset_quality(), those
+ * of a service when it is removed.
+ *
+ * Note while the decoder predicts a line as blank it does not look for
+ * data services on that line, see vbi3_raw_decoder_decode().
+ *
+ * $return
+ * $c FALSE if $a row is out of bounds.
+ */
+vbi_bool
+vbi3_raw_decoder_line_quality	(const vbi3_raw_decoder *rd,
+				 vbi3_raw_decoder_quality *quality,
+				 unsigned int		row)
+{
+	const vbi3_raw_decoder_quality *q;
+	unsigned int max_decoded;
+	unsigned int i;
+
+	assert (NULL != rd);
+	assert (NULL != quality);
+
+	CLEAR (*quality);
+
+	if (row >= ((unsigned int) rd->sampling.count[0]
+		    + (unsigned int) rd->sampling.count[1]))
+		return FALSE;
+
+	if (NULL == rd->quality)
+		return TRUE;
+
+	q = rd->quality + row * _VBI3_RAW_DECODER_MAX_JOBS;
+	max_decoded = 0;
+
+	for (i = 0; i < rd->n_jobs; ++i)
+		add_quality (quality, &max_decoded, &q[i]);
+
+	return TRUE;
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ * $param quality The counters will be stored here.
+ * $param services Set of data services.
+ *
+ * Like vbi3_raw_decoder_line_quality(), but returns the sum of the
+ * counters of all scan lines for the given data services. Services
+ * with the same modulation, for example Closed Caption on the first
+ * and second field, are counted together.
+ */
+void
+vbi3_raw_decoder_service_quality
+				(const vbi3_raw_decoder *rd,
+				 vbi3_raw_decoder_quality *quality,
+				 vbi_service_set	services)
+{
+	const vbi3_raw_decoder_quality *q;
+	unsigned int scan_lines;
+	unsigned int max_decoded;
+	unsigned int i;
+
+	assert (NULL != rd);
+	assert (NULL != quality);
+
+	CLEAR (*quality);
+
+	if (NULL == rd->quality)
+		return;
+
+	q = rd->quality;
+	scan_lines = rd->sampling.count[0] + rd->sampling.count[1];
+	max_decoded = 0;
+
+	while (scan_lines-- > 0) {
+		for (i = 0; i < rd->n_jobs; ++i) {
+			if (rd->jobs[i].id & services)
+				add_quality (quality, &max_decoded, &q[i]);
+		}
+
+		q += _VBI3_RAW_DECODER_MAX_JOBS;
+	}
+}
+
+/**
+ * $param rd Pointer to vbi3_raw_decoder object allocated with
+ *   vbi3_raw_decoder_new().
+ *
+ * Resets all quality counters to zero.
+ */
+void
+vbi3_raw_decoder_reset_quality	(vbi3_raw_decoder *	rd)
+{
+	unsigned int scan_lines;
+
+	assert (NULL != rd);
+
+	if (NULL == rd->quality)
+		return;
+
+	scan_lines = rd->sampling.count[0] + rd->sampling.count[1];
+
+	memset (rd->quality, 0, scan_lines * _VBI3_RAW_DECODER_MAX_JOBS
+		* sizeof (rd->quality[0]));
 }
 
 /**
@@ -646,6 +1664,8 @@ vbi3_raw_decoder_decode		(vbi3_raw_decoder *	rd,
 void
 vbi3_raw_decoder_reset		(vbi3_raw_decoder *	rd)
 {
+	unsigned int i;
+
 	assert (NULL != rd);
 
 	if (rd->pattern) {
@@ -653,12 +1673,23 @@ vbi3_raw_decoder_reset		(vbi3_raw_decoder *	rd)
 		rd->pattern = NULL;
 	}
 
+	vbi_free (rd->line_stats);
+	rd->line_stats = NULL;
+
+	vbi_free (rd->quality);
+	rd->quality = NULL;
+
 	rd->services = 0;
 	rd->n_jobs = 0;
 
 	rd->readjust = 1;
 
+	for (i = 0; i < N_ELEMENTS (rd->jobs); ++i)
+		_vbi3_bit_slicer_destroy (&rd->jobs[i].slicer);
+
 	CLEAR (rd->jobs);
+
+	++rd->jobs_serial;
 }
 
 static void
@@ -700,6 +1731,28 @@ remove_job_from_pattern		(vbi3_raw_decoder *	rd,
 	}
 }
 
+static void
+remove_job_quality		(vbi3_raw_decoder *	rd,
+				 unsigned int		job_num)
+{
+	vbi3_raw_decoder_quality *q;
+	unsigned int scan_lines;
+
+	q = rd->quality;
+	scan_lines = rd->sampling.count[0] + rd->sampling.count[1];
+
+	/* For each scan line. Jobs above job_num move down
+	   in rd->jobs. */
+	while (scan_lines-- > 0) {
+		memmove (&q[job_num], &q[job_num + 1],
+			 (_VBI3_RAW_DECODER_MAX_JOBS - job_num - 1)
+			 * sizeof (*q));
+		CLEAR (q[_VBI3_RAW_DECODER_MAX_JOBS - 1]);
+
+		q += _VBI3_RAW_DECODER_MAX_JOBS;
+	}
+}
+
 /**
  * $param rd Pointer to vbi3_raw_decoder object allocated with
  *   vbi3_raw_decoder_new().
@@ -721,13 +1774,18 @@ vbi3_raw_decoder_remove_services
 
 	assert (NULL != rd);
 
-	job = rd->jobs;
 	job_num = 0;
 
 	while (job_num < rd->n_jobs) {
+		job = &rd->jobs[job_num];
+
 		if (job->id & services) {
-			if (rd->pattern)
+			if (rd->pattern) {
                                 remove_job_from_pattern (rd, job_num);
+				remove_job_quality (rd, job_num);
+			}
+
+			_vbi3_bit_slicer_destroy (&job->slicer);
 
 			memmove (job, job + 1,
 				 (rd->n_jobs - job_num - 1) * sizeof (*job));
@@ -742,6 +1800,8 @@ vbi3_raw_decoder_remove_services
 
 	rd->services &= ~services;
 
+	++rd->jobs_serial;
+
 	return rd->services;
 }
 
@@ -940,6 +2000,32 @@ vbi3_raw_decoder_add_services	(vbi3_raw_decoder *	rd,
 		}
 
 		memset (rd->pattern, 0, scan_ways * sizeof (rd->pattern[0]));
+
+		size = scan_lines * sizeof (rd->line_stats[0]);
+		rd->line_stats = (_vbi3_raw_decoder_line_stat *)
+			vbi_malloc (size);
+		if (NULL == rd->line_stats) {
+			error (&rd->log, "Out of memory.");
+			vbi_free (rd->pattern);
+			rd->pattern = NULL;
+			return rd->services;
+		}
+
+		memset (rd->line_stats, 0, size);
+
+		size = scan_lines * _VBI3_RAW_DECODER_MAX_JOBS
+			* sizeof (rd->quality[0]);
+		rd->quality = (vbi3_raw_decoder_quality *) vbi_malloc (size);
+		if (NULL == rd->quality) {
+			error (&rd->log, "Out of memory.");
+			vbi_free (rd->line_stats);
+			rd->line_stats = NULL;
+			vbi_free (rd->pattern);
+			rd->pattern = NULL;
+			return rd->services;
+		}
+
+		memset (rd->quality, 0, size);
 	}
 
 #if 2 == VBI_VERSION_MINOR
@@ -1032,6 +2118,10 @@ vbi3_raw_decoder_add_services	(vbi3_raw_decoder *	rd,
 		samples_per_line = sp->samples_per_line;
 #endif
 
+		/* Another service with the same parameters may share
+		   this job, we replace its bit slicer. */
+		_vbi3_bit_slicer_destroy (&job->slicer);
+
 		if (!_vbi3_bit_slicer_init (&job->slicer)) {
 			assert (!"bit_slicer_init");
 		}
@@ -1055,6 +2145,9 @@ vbi3_raw_decoder_add_services	(vbi3_raw_decoder *	rd,
 			assert (!"bit_slicer_set_params");
 		}
 
+		vbi3_bit_slicer_set_min_amplitude (&job->slicer,
+						   par->min_amplitude);
+
 		vbi3_bit_slicer_set_log_fn (&job->slicer,
 					    rd->log.mask,
 					    rd->log.fn,
@@ -1067,6 +2160,10 @@ vbi3_raw_decoder_add_services	(vbi3_raw_decoder *	rd,
 			       "Out of decoder pattern space for "
 			       "service 0x%08x (%s).",
 			       par->id, par->label);
+
+			if (job >= rd->jobs + rd->n_jobs)
+				_vbi3_bit_slicer_destroy (&job->slicer);
+
 			continue;
 		}
 
@@ -1078,6 +2175,8 @@ vbi3_raw_decoder_add_services	(vbi3_raw_decoder *	rd,
 		rd->services |= par->id;
 	}
 
+	++rd->jobs_serial;
+
 	return rd->services;
 }
 
@@ -1255,6 +2354,8 @@ vbi3_raw_decoder_set_log_fn	(vbi3_raw_decoder *	rd,
 		vbi3_bit_slicer_set_log_fn (&rd->jobs[i].slicer,
 					    mask, log_fn, user_data);
 	}
+
+	++rd->jobs_serial;
 }
 
 /**
@@ -1269,6 +2370,8 @@ _vbi3_raw_decoder_destroy	(vbi3_raw_decoder *	rd)
 
 	vbi3_raw_decoder_debug (rd, FALSE);
 
+	vbi3_raw_decoder_set_threads (rd, 1);
+
 	/* Make unusable. */
 	CLEAR (*rd);
 }
@@ -41,11 +41,86 @@ VBI_BEGIN_DECLS
  */
 typedef struct _vbi3_raw_decoder vbi3_raw_decoder;
 
+/*
+ * $ingroup RawDecoder
+ * $brief Raw VBI decoder quality counters.
+ *
+ * See vbi3_raw_decoder_line_quality().
+ */
+typedef struct {
+	/** Number of times the bit slicer looked for the data service. */
+	unsigned int		attempts;
+
+	/** Number of times it found the Clock Run-In. */
+	unsigned int		cri_matches;
+
+	/** Number of times the CRI was found but not the Framing Code. */
+	unsigned int		frc_errors;
+
+	/** Number of lines decoded. */
+	unsigned int		decoded;
+
+	/**
+	 * Number of decoded lines with uncorrectable Hamming or parity
+	 * errors. Checked are the Teletext packet address, both Closed
+	 * Caption bytes, and WSS 625 group A.
+	 */
+	unsigned int		parity_errors;
+
+	/**
+	 * The 0/1 threshold of the last decoded line, in range 0 to 255
+	 * for 8 bit sample formats.
+	 */
+	unsigned int		thresh;
+
+	/**
+	 * Average distance of the Framing Code samples from the
+	 * threshold in the last decoded line, in the same units. A
+	 * small value indicates a weak or distorted signal. Zero if the
+	 * data service has no Framing Code.
+	 */
+	unsigned int		eye_opening;
+} vbi3_raw_decoder_quality;
+
+/*
+ * $ingroup RawDecoder
+ * $brief Location of a raw VBI image in memory.
+ *
+ * See vbi3_raw_decoder_decode_view().
+ */
+typedef struct {
+	/** Start of the buffer. */
+	const uint8_t *		data;
+
+	/**
+	 * Offset in bytes from $a data to the first line of the first
+	 * and second field.
+	 */
+	unsigned long		offset[2];
+
+	/**
+	 * Distance in bytes from the start of one line to the start of
+	 * the next line of the same field.
+	 */
+	unsigned long		stride;
+} vbi3_raw_view;
+
 /*
  * $addtogroup RawDecoder
  * ${
  */
 extern vbi_bool
+vbi3_raw_decoder_line_quality	(const vbi3_raw_decoder *rd,
+				 vbi3_raw_decoder_quality *quality,
+				 unsigned int		row);
+extern void
+vbi3_raw_decoder_service_quality
+				(const vbi3_raw_decoder *rd,
+				 vbi3_raw_decoder_quality *quality,
+				 vbi_service_set	services);
+extern void
+vbi3_raw_decoder_reset_quality	(vbi3_raw_decoder *	rd);
+extern vbi_bool
 vbi3_raw_decoder_sampling_point	(vbi3_raw_decoder *	rd,
 				 vbi3_bit_slicer_point *point,
 				 unsigned int		row,
@@ -55,6 +130,18 @@ vbi3_raw_decoder_decode		(vbi3_raw_decoder *	rd,
 				 vbi_sliced *		sliced,
 				 unsigned int		sliced_lines,
 				 const uint8_t *	raw);
+extern unsigned int
+vbi3_raw_decoder_decode_view	(vbi3_raw_decoder *	rd,
+				 vbi_sliced *		sliced,
+				 unsigned int		max_lines,
+				 const vbi3_raw_view *	view);
+extern unsigned int
+vbi3_raw_decoder_decode_frames	(vbi3_raw_decoder *	rd,
+				 vbi_sliced *		sliced,
+				 unsigned int		max_lines,
+				 unsigned int *		n_lines,
+				 const uint8_t *	raw,
+				 unsigned int		n_frames);
 extern void
 vbi3_raw_decoder_reset		(vbi3_raw_decoder *	rd);
 extern vbi_service_set
@@ -70,6 +157,19 @@ vbi3_raw_decoder_add_services	(vbi3_raw_decoder *	rd,
 extern vbi_bool
 vbi3_raw_decoder_debug		(vbi3_raw_decoder *	rd,
 				 vbi_bool		enable);
+extern size_t
+vbi3_raw_decoder_save_prediction
+				(const vbi3_raw_decoder *rd,
+				 void *			buffer,
+				 size_t			buffer_size);
+extern vbi_bool
+vbi3_raw_decoder_load_prediction
+				(vbi3_raw_decoder *	rd,
+				 const void *		buffer,
+				 size_t			buffer_size);
+extern vbi_bool
+vbi3_raw_decoder_set_threads	(vbi3_raw_decoder *	rd,
+				 unsigned int		n_threads);
 extern vbi_service_set
 vbi3_raw_decoder_set_sampling_par
 				(vbi3_raw_decoder *	rd,
@@ -110,6 +210,21 @@ typedef struct {
 	unsigned int		n_points;
 } _vbi3_raw_decoder_sp_line;
 
+/** @internal */
+typedef struct {
+	/** Number of frames with data on this line, saturating. */
+	uint16_t		hits;
+
+	/**
+	 * Decremented every 16 frames without data, when zero
+	 * the line is predicted as blank.
+	 */
+	uint8_t			confidence;
+} _vbi3_raw_decoder_line_stat;
+
+/** @internal */
+typedef struct _vbi3_raw_decoder_pool _vbi3_raw_decoder_pool;
+
 /**
  * @internal
  * Don't dereference pointers to this structure.
@@ -127,8 +242,16 @@ struct _vbi3_raw_decoder {
 	unsigned int		n_sp_lines;
 	int			readjust;
 	int8_t *		pattern;	/* n scan lines * MAX_WAYS */
+	_vbi3_raw_decoder_line_stat *line_stats; /* n scan lines */
+	vbi3_raw_decoder_quality *quality; /* n scan lines * MAX_JOBS */
 	_vbi3_raw_decoder_job	jobs[_VBI3_RAW_DECODER_MAX_JOBS];
 	_vbi3_raw_decoder_sp_line *sp_lines;
+
+	/* Incremented when jobs are added or removed. */
+	unsigned int		jobs_serial;
+
+	/* Worker threads, NULL if decoding in the caller's thread. */
+	_vbi3_raw_decoder_pool *pool;
 };
 
 /** @internal */
@@ -187,6 +310,14 @@ struct _vbi_service_par {
 	vbi_modulation		modulation;
 
 	_vbi_service_par_flag	flags;
+
+	/**
+	 * Minimum peak-to-peak amplitude of a line carrying this
+	 * service, in 8 bit sample units. The bit slicer skips lines
+	 * with less signal without searching for the CRI. Zero
+	 * disables the check.
+	 */
+	unsigned int		min_amplitude;
 };
 
 extern const _vbi_service_par _vbi_service_table [];
@@ -154,9 +154,82 @@ static void character_set_designation(struct vbi_font_descr **font,
 				      cache_page *vtp);
 static void screen_color(vbi_page *pg, int flags, int color);
 
+/* Looks up a page needed to format a page. Unless fs is NULL
+   records the page version in fs, see vbi_fetch_vt_page(). */
+static cache_page *
+format_get_page			(vbi_decoder *		vbi,
+				 struct ttx_format_state *fs,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 vbi_subno		subno_mask)
+{
+	struct ttx_format_dep *dep;
+	cache_page *cp;
+	unsigned int i;
+
+	cp = _vbi_cache_get_page (vbi->ca, vbi->cn, pgno, subno, subno_mask);
+
+	if (NULL == fs)
+		return cp;
+
+	for (i = 0; i < fs->n_deps; ++i) {
+		dep = &fs->deps[i];
+		if (dep->pgno == pgno
+		    && dep->subno == subno
+		    && dep->subno_mask == subno_mask)
+			return cp;
+	}
+
+	if (fs->n_deps >= N_ELEMENTS (fs->deps)) {
+		fs->overflow = TRUE;
+		return cp;
+	}
+
+	dep = &fs->deps[fs->n_deps++];
+
+	dep->pgno = pgno;
+	dep->subno = subno;
+	dep->subno_mask = subno_mask;
+	dep->version = (NULL != cp) ? cp->version : 0;
+
+	return cp;
+}
+
+/* Saves the decoder state other than cached pages which
+   vbi_format_vt_page() uses to format page pgno. The decoder changes
+   this state with the cache locked, so the formatter reads the copy,
+   not the network. */
+static void
+format_save_state		(vbi_decoder *		vbi,
+				 struct ttx_format_state *fs,
+				 vbi_pgno		pgno,
+				 vbi_wst_level		max_level)
+{
+	pthread_mutex_lock (&vbi->ca->mutex);
+
+	if (max_level <= VBI_WST_LEVEL_1p5)
+		memcpy (&fs->magazine, &vbi->vt.default_magazine,
+			sizeof (fs->magazine));
+	else
+		memcpy (&fs->magazine, cache_network_magazine (vbi->cn, pgno),
+			sizeof (fs->magazine));
+
+	memcpy (&fs->initial_page, &vbi->cn->initial_page,
+		sizeof (fs->initial_page));
+	memcpy (fs->btt_link, vbi->cn->btt_link, sizeof (fs->btt_link));
+
+	fs->have_top = vbi->cn->have_top;
+	fs->top_version = vbi->vt.top_version;
+
+	pthread_mutex_unlock (&vbi->ca->mutex);
+
+	fs->nuid = vbi->network.ev.network.nuid;
+}
+
 static vbi_bool
 top_label(vbi_decoder *vbi, vbi_page *pg, struct vbi_font_descr *font,
-	  int index, int pgno, int foreground, int ff)
+	  int index, int pgno, int foreground, int ff,
+	  struct ttx_format_state *fs)
 {
 	int column = index * 13 + 1;
 	vbi_char *acp;
@@ -166,17 +239,17 @@ top_label(vbi_decoder *vbi, vbi_page *pg, struct vbi_font_descr *font,
 	acp = &pg->text[LAST_ROW + column];
 
 	for (i = 0; i < 8; i++)
-		if (PAGE_FUNCTION_AIT == vbi->cn->btt_link[i].function) {
+		if (PAGE_FUNCTION_AIT == fs->btt_link[i].function) {
 			cache_page *vtp;
 
-			vtp = _vbi_cache_get_page
-				(vbi->ca, vbi->cn,
-				 vbi->cn->btt_link[i].pgno,
-				 vbi->cn->btt_link[i].subno,
+			vtp = format_get_page
+				(vbi, fs,
+				 fs->btt_link[i].pgno,
+				 fs->btt_link[i].subno,
 				 /* subno_mask */ 0x3f7f);
 			if (!vtp) {
 				printv ("top ait page %x not cached\n",
-					vbi->cn->btt_link[i].pgno);
+					fs->btt_link[i].pgno);
 				continue;
 			} else if (vtp->function != PAGE_FUNCTION_AIT) {
 				printv("no ait page %x\n", vtp->pgno);
@@ -249,15 +322,13 @@ add_modulo			(vbi_pgno		pgno,
 
 static inline void
 top_navigation_bar(vbi_decoder *vbi, vbi_page *pg,
-		   cache_page *vtp)
+		   cache_page *vtp, struct ttx_format_state *fs)
 {
-	struct ttx_page_stat *ps;
+	const struct ttx_page_stat *ps;
 	vbi_char ac;
 	vbi_pgno pgno1;
-	int i, got;
-
-	ps = cache_network_page_stat (vbi->cn, vtp->pgno);
-	printv("PAGE MIP/BTT: %d\n", ps->page_type);
+	vbi_pgno label[3];
+	int i;
 
 	memset(&ac, 0, sizeof(ac));
 
@@ -274,39 +345,47 @@ top_navigation_bar(vbi_decoder *vbi, vbi_page *pg,
 
 	pgno1 = add_modulo (vtp->pgno, 1);
 
-	for (i = vtp->pgno; i != pgno1; i = add_modulo (i, -1)) {
-		struct ttx_page_stat *ps;
+	/* Current block or group, next group, next block. */
+	memset(label, 0, sizeof(label));
+
+	pthread_mutex_lock (&vbi->ca->mutex);
 
-		ps = cache_network_page_stat (vbi->cn, i);
+	ps = cache_network_const_page_stat (vbi->cn, vtp->pgno);
+	printv("PAGE MIP/BTT: %d\n", ps->page_type);
+
+	for (i = vtp->pgno; i != pgno1; i = add_modulo (i, -1)) {
+		ps = cache_network_const_page_stat (vbi->cn, i);
 		if (ps->page_type == VBI_TOP_BLOCK ||
 		    ps->page_type == VBI_TOP_GROUP) {
-			top_label(vbi, pg, pg->font[0], 0, i, 32 + VBI_WHITE, 0);
+			label[0] = i;
 			break;
 		}
 	}
 
-	for (i = pgno1, got = FALSE; i != vtp->pgno; i = add_modulo (i, 1)) {
-		struct ttx_page_stat *ps;
-
-		ps = cache_network_page_stat (vbi->cn, i);
-		switch (ps->page_type) {
-		case VBI_TOP_BLOCK:
-			top_label(vbi, pg, pg->font[0], 2, i, 32 + VBI_YELLOW, 2);
-			return;
-
-		case VBI_TOP_GROUP:
-			if (!got) {
-				top_label(vbi, pg, pg->font[0], 1, i, 32 + VBI_GREEN, 1);
-				got = TRUE;
-			}
-
+	for (i = pgno1; i != vtp->pgno; i = add_modulo (i, 1)) {
+		ps = cache_network_const_page_stat (vbi->cn, i);
+		if (ps->page_type == VBI_TOP_BLOCK) {
+			label[2] = i;
 			break;
+		} else if (ps->page_type == VBI_TOP_GROUP && 0 == label[1]) {
+			label[1] = i;
 		}
 	}
+
+	/* top_label() looks up pages, that takes the lock again. */
+	pthread_mutex_unlock (&vbi->ca->mutex);
+
+	if (0 != label[0])
+		top_label(vbi, pg, pg->font[0], 0, label[0], 32 + VBI_WHITE, 0, fs);
+	if (0 != label[1])
+		top_label(vbi, pg, pg->font[0], 1, label[1], 32 + VBI_GREEN, 1, fs);
+	if (0 != label[2])
+		top_label(vbi, pg, pg->font[0], 2, label[2], 32 + VBI_YELLOW, 2, fs);
 }
 
 static struct ttx_ait_title *
-next_ait(vbi_decoder *vbi, int pgno, int subno, cache_page **mvtp)
+next_ait(vbi_decoder *vbi, const struct ttx_format_state *fs,
+	 int pgno, int subno, cache_page **mvtp)
 {
 	struct ttx_ait_title *ait, *mait = NULL;
 	int mpgno = 0xFFF, msubno = 0xFFFF;
@@ -315,17 +394,17 @@ next_ait(vbi_decoder *vbi, int pgno, int subno, cache_page **mvtp)
 	*mvtp = NULL;
 
 	for (i = 0; i < 8; i++) {
-		if (PAGE_FUNCTION_AIT == vbi->cn->btt_link[i].function) {
+		if (PAGE_FUNCTION_AIT == fs->btt_link[i].function) {
 			cache_page *vtp;
 
 			vtp = _vbi_cache_get_page
 				(vbi->ca, vbi->cn,
-				 vbi->cn->btt_link[i].pgno, 
-				 vbi->cn->btt_link[i].subno,
+				 fs->btt_link[i].pgno, 
+				 fs->btt_link[i].subno,
 				 /* subno_mask */ 0x3f7f);
 			if (!vtp) {
 				printv("top ait page %x not cached\n",
-				       vbi->cn->btt_link[i].pgno);
+				       fs->btt_link[i].pgno);
 				continue;
 			} else if (vtp->function != PAGE_FUNCTION_AIT) {
 				printv("no ait page %x\n", vtp->pgno);
@@ -362,7 +441,8 @@ next_ait(vbi_decoder *vbi, int pgno, int subno, cache_page **mvtp)
 }
 
 static int
-top_index(vbi_decoder *vbi, vbi_page *pg, int subno)
+top_index(vbi_decoder *vbi, vbi_page *pg, int subno,
+	  struct ttx_format_state *fs)
 {
 	cache_page *vtp = NULL;
 	vbi_char ac, *acp;
@@ -383,13 +463,15 @@ top_index(vbi_decoder *vbi, vbi_page *pg, int subno)
 	pg->dirty.y1 = ROWS - 1;
 	pg->dirty.roll = 0;
 
-	ext = &cache_network_magazine (vbi->cn, 0x100)->extension;
+	ext = &fs->magazine.extension;
 
 	screen_color(pg, 0, 32 + VBI_BLUE);
 
 	vbi_transp_colormap(vbi, pg->color_map, ext->color_map, 40);
 
-	pg->drcs_clut = ext->drcs_clut;
+	/* pg outlives fs. */
+	pg->drcs_clut = cache_network_magazine (vbi->cn, 0x100)
+		->extension.drcs_clut;
 
 	pg->page_opacity[0] = VBI_OPAQUE;
 	pg->page_opacity[1] = VBI_OPAQUE;
@@ -428,8 +510,8 @@ top_index(vbi_decoder *vbi, vbi_page *pg, int subno)
 	xpgno = 0;
 	xsubno = 0;
 
-	while ((ait = next_ait(vbi, xpgno, xsubno, &vtp))) {
-		struct ttx_page_stat *ps;
+	while ((ait = next_ait(vbi, fs, xpgno, xsubno, &vtp))) {
+		vbi_bool group;
 
 		xpgno = ait->link.pgno;
 		xsubno = ait->link.subno;
@@ -456,15 +538,12 @@ top_index(vbi_decoder *vbi, vbi_page *pg, int subno)
 			if (ait->text[i] > 0x20)
 				break;
 
-		ps = cache_network_page_stat (vbi->cn, ait->link.pgno);
-		switch (ps->page_type) {
-		case VBI_TOP_GROUP:
-			k = 3;
-			break;
+		pthread_mutex_lock (&vbi->ca->mutex);
+		group = (VBI_TOP_GROUP == cache_network_const_page_stat
+			 (vbi->cn, ait->link.pgno)->page_type);
+		pthread_mutex_unlock (&vbi->ca->mutex);
 
-		default:
-    			k = 1;
-		}
+		k = group ? 3 : 1;
 
 		for (j = 0; j <= i; j++) {
 			acp[k + j].unicode = vbi_teletext_unicode(pg->font[0]->G0,
@@ -1004,13 +1083,12 @@ vbi_resolve_home(vbi_page *pg, vbi_link *ld)
 }
 
 static inline void
-ait_title(vbi_decoder *vbi, cache_page *vtp, struct ttx_ait_title *ait, char *buf)
+ait_title(struct ttx_magazine *mag, cache_page *vtp,
+	  struct ttx_ait_title *ait, char *buf)
 {
-	struct ttx_magazine *mag;
 	struct vbi_font_descr *font[2];
 	int i;
 
-	mag = cache_network_magazine (vbi->cn, 0x100);
 	character_set_designation (font, &mag->extension, vtp);
 
 	for (i = 11; i >= 0; i--)
@@ -1044,23 +1122,26 @@ ait_title(vbi_decoder *vbi, cache_page *vtp, struct ttx_ait_title *ait, char *bu
 vbi_bool
 vbi_page_title(vbi_decoder *vbi, int pgno, int subno, char *buf)
 {
+	struct ttx_format_state fs;
 	struct ttx_ait_title *ait;
 	int i, j;
 
 	subno = subno;
 
-	if (vbi->cn->have_top) {
+	format_save_state (vbi, &fs, 0x100, VBI_WST_LEVEL_3p5);
+
+	if (fs.have_top) {
 		for (i = 0; i < 8; i++)
-			if (PAGE_FUNCTION_AIT == vbi->cn->btt_link[i].function) {
+			if (PAGE_FUNCTION_AIT == fs.btt_link[i].function) {
 				cache_page *vtp;
 
 				vtp = _vbi_cache_get_page
 					(vbi->ca, vbi->cn,
-					 vbi->cn->btt_link[i].pgno, 
-					 vbi->cn->btt_link[i].subno,
+					 fs.btt_link[i].pgno, 
+					 fs.btt_link[i].subno,
 					 /* subno_mask */ 0x3f7f);
 				if (!vtp) {
-					printv("p/t top ait page %x not cached\n", vbi->cn->btt_link[i].pgno);
+					printv("p/t top ait page %x not cached\n", fs.btt_link[i].pgno);
 					continue;
 				} else if (vtp->function != PAGE_FUNCTION_AIT) {
 					printv("p/t no ait page %x\n", vtp->pgno);
@@ -1072,7 +1153,7 @@ vbi_page_title(vbi_decoder *vbi, int pgno, int subno, char *buf)
 				for (ait = vtp->data.ait.title, j = 0;
 				     j < 46; ait++, j++) {
 					if (ait->link.pgno == pgno) {
-						ait_title(vbi, vtp, ait, buf);
+						ait_title(&fs.magazine, vtp, ait, buf);
 						cache_page_unref (vtp);
 						vtp = NULL;
 						return TRUE;
@@ -1141,6 +1222,7 @@ screen_color(vbi_page *pg, int flags, int color)
 
 static struct ttx_triplet *
 resolve_obj_address		(vbi_decoder *		vbi,
+				 struct ttx_format_state *fs,
 				 cache_page **		vtpp,
 				 enum ttx_object_type	type,
 				 vbi_pgno		pgno,
@@ -1160,7 +1242,7 @@ resolve_obj_address		(vbi_decoder *		vbi,
 	printv("obj invocation, source page %03x/%04x, "
 		"pointer packet %d triplet %d\n", pgno, s1, packet + 1, i);
 
-	vtp = _vbi_cache_get_page (vbi->ca, vbi->cn, pgno, s1, 0x000F);
+	vtp = format_get_page (vbi, fs, pgno, s1, 0x000F);
 
 	if (!vtp) {
 		printv("... page not cached\n");
@@ -1434,7 +1516,7 @@ enhance(vbi_decoder *vbi,
 	int max_triplets,
 	int inv_row, int inv_column,
 	vbi_wst_level max_level, vbi_bool header_only,
-	struct pex26 *ptable)
+	struct pex26 *ptable, struct ttx_format_state *fs)
 {
 	struct enhance_state es;
 	int offset_column, offset_row;
@@ -1731,7 +1813,7 @@ enhance(vbi_decoder *vbi,
 					printv("... %s obj\n", (source == 3) ? "global" : "public");
 
 					trip = resolve_obj_address
-						(vbi, &trip_cp, new_type, pgno,
+						(vbi, fs, &trip_cp, new_type, pgno,
 						 (p->address << 7) + p->data,
 						 function,
 						 &remaining_max_triplets);
@@ -1746,7 +1828,7 @@ enhance(vbi_decoder *vbi,
 				if (!enhance(vbi, mag, ext, pg, vtp, new_type, trip,
 					     remaining_max_triplets,
 					     row + offset_row, column + offset_column,
-					     max_level, header_only, NULL)) {
+					     max_level, header_only, NULL, fs)) {
 					cache_page_unref (trip_cp);
 					trip_cp = NULL;
 					return FALSE;
@@ -2048,8 +2130,8 @@ enhance(vbi_decoder *vbi,
 					printv("... %s drcs from page %03x/%04x\n",
 						normal ? "normal" : "global", pgno, drcs_s1[normal]);
 
-					dvtp = _vbi_cache_get_page
-						(vbi->ca, vbi->cn,
+					dvtp = format_get_page
+						(vbi, fs,
 						 pgno, drcs_s1[normal],
 						 /* subno_mask */ 0x000F);
 
@@ -2278,20 +2360,17 @@ post_enhance(vbi_page *pg, int display_rows)
 	}
 }
 
-static inline vbi_bool
-default_object_invocation	(vbi_decoder *		vbi,
-				 struct ttx_magazine *	mag,
-				 struct ttx_extension *	ext,
-				 vbi_page *		pg,
+/* Returns the MOT link to the default objects of vtp, NULL if none. */
+static struct ttx_pop_link *
+default_pop_link		(struct ttx_magazine *	mag,
 				 cache_page *		vtp,
-				 vbi_wst_level		max_level,
-				 vbi_bool		header_only)
+				 vbi_wst_level		max_level)
 {
 	struct ttx_pop_link *pop;
-	int i, order;
+	int i;
 
 	if (!(i = mag->pop_lut[vtp->pgno & 0xFF]))
-		return FALSE; /* has no link (yet) */
+		return NULL; /* has no link (yet) */
 
 	pop = &mag->pop_link[1][i];
 
@@ -2300,10 +2379,29 @@ default_object_invocation	(vbi_decoder *		vbi,
 
 		if (NO_PAGE(pop->pgno)) {
 			printv("default object has dead MOT pop link %d\n", i);
-			return FALSE;
+			return NULL;
 		}
 	}
 
+	return pop;
+}
+
+static inline vbi_bool
+default_object_invocation	(vbi_decoder *		vbi,
+				 struct ttx_magazine *	mag,
+				 struct ttx_extension *	ext,
+				 vbi_page *		pg,
+				 cache_page *		vtp,
+				 vbi_wst_level		max_level,
+				 vbi_bool		header_only,
+				 struct ttx_format_state *fs)
+{
+	struct ttx_pop_link *pop;
+	int i, order;
+
+	if (!(pop = default_pop_link (mag, vtp, max_level)))
+		return FALSE;
+
 	order = pop->default_obj[0].type > pop->default_obj[1].type;
 
 	for (i = 0; i < 2; i++) {
@@ -2317,7 +2415,7 @@ default_object_invocation	(vbi_decoder *		vbi,
 
 		printv("default object #%d invocation, type %d\n", i ^ order, type);
 
-		trip = resolve_obj_address(vbi, &trip_cp, type, pop->pgno,
+		trip = resolve_obj_address(vbi, fs, &trip_cp, type, pop->pgno,
 			pop->default_obj[i ^ order].address, PAGE_FUNCTION_POP,
 			&remaining_max_triplets);
 
@@ -2326,7 +2424,7 @@ default_object_invocation	(vbi_decoder *		vbi,
 
 		if (!enhance(vbi, mag, ext, pg, vtp, type, trip,
 			     remaining_max_triplets, 0, 0, max_level,
-			     header_only, NULL)) {
+			     header_only, NULL, fs)) {
 			cache_page_unref (trip_cp);
 			return FALSE;
 		}
@@ -2374,7 +2472,7 @@ column_41			(vbi_page *		pg,
 	black0 = TRUE;
 	cont39 = TRUE;
 
-	for (row = 1; row <= 24; ++row) {
+	for (row = 1; row <= 23; ++row) {
 		if (0x0020 != acp[0].unicode
 		    || (VBI_BLACK != acp[0].background
 			&& 32 != acp[0].background)) {
@@ -2395,7 +2493,7 @@ column_41			(vbi_page *		pg,
 	acp = pg->text + 41;
 
 	if (!black0 && cont39) {
-		for (row = 1; row <= 24; ++row) {
+		for (row = 1; row <= 23; ++row) {
 			acp[40] = acp[39];
 
 			if (!vbi_is_gfx (acp[39].unicode))
@@ -2413,7 +2511,7 @@ column_41			(vbi_page *		pg,
 		ac.background	= ext->background_clut + VBI_BLACK;
 		ac.opacity	= pg->page_opacity[1];
 
-		for (row = 1; row <= 24; ++row) {
+		for (row = 1; row <= 23; ++row) {
 			acp[40] = ac;
 			acp += 41;
 		}
@@ -2425,59 +2523,21 @@ column_41			(vbi_page *		pg,
 	acp[40].unicode = 0x0020;
 }
 
-/**
- * @internal
- * @param vbi Initialized vbi_decoder context.
- * @param pg Place to store the formatted page.
- * @param vtp Raw Teletext page. 
- * @param max_level Format the page at this Teletext implementation level.
- * @param display_rows Number of rows to format, between 1 ... 25.
- * @param navigation Analyse the page and add navigation links,
- *   including TOP and FLOF.
- * 
- * Format a page @a pg from a raw Teletext page @a vtp. This function is
- * used internally by libzvbi only.
- * 
- * @return
- * @c TRUE if the page could be formatted.
- */
-int
-vbi_format_vt_page(vbi_decoder *vbi,
-		   vbi_page *pg, cache_page *vtp,
-		   vbi_wst_level max_level,
-		   int display_rows, vbi_bool navigation)
+/* Sets the attributes of the page which apply to all rows. Returns
+   the extension used for formatting, the magazine in *magp. */
+static struct ttx_extension *
+format_attributes		(vbi_decoder *		vbi,
+				 vbi_page *		pg,
+				 cache_page *		vtp,
+				 vbi_wst_level		max_level,
+				 struct ttx_format_state *fs,
+				 struct ttx_magazine **	magp)
 {
-	char buf[16];
 	struct ttx_magazine *mag;
 	struct ttx_extension *ext;
-	int column, row, i;
-
-	if (vtp->function != PAGE_FUNCTION_LOP &&
-	    vtp->function != PAGE_FUNCTION_EACEM_TRIGGER)
-		return FALSE;
-
-	printv("\nFormatting page %03x/%04x pg=%p lev=%d rows=%d nav=%d\n",
-	       vtp->pgno, vtp->subno, pg, max_level, display_rows, navigation);
 
-	display_rows = SATURATE(display_rows, 1, ROWS);
-
-	pg->vbi = vbi;
-
-	pg->nuid = vbi->network.ev.network.nuid;
-
-	pg->pgno = vtp->pgno;
-	pg->subno = vtp->subno;
-
-	pg->rows = display_rows;
-	pg->columns = EXT_COLUMNS;
-
-	pg->dirty.y0 = 0;
-	pg->dirty.y1 = ROWS - 1;
-	pg->dirty.roll = 0;
-
-	mag = (max_level <= VBI_WST_LEVEL_1p5) ?
-		&vbi->vt.default_magazine
-		: cache_network_magazine (vbi->cn, vtp->pgno);
+	mag = &fs->magazine;
+	*magp = mag;
 
 	if (vtp->x28_designations & 0x11)
 		ext = &vtp->data.ext_lop.ext;
@@ -2494,7 +2554,14 @@ vbi_format_vt_page(vbi_decoder *vbi,
 
 	vbi_transp_colormap(vbi, pg->color_map, ext->color_map, 40);
 
-	pg->drcs_clut = ext->drcs_clut;
+	/* pg outlives fs. */
+	if (ext != &mag->extension)
+		pg->drcs_clut = ext->drcs_clut;
+	else if (max_level <= VBI_WST_LEVEL_1p5)
+		pg->drcs_clut = vbi->vt.default_magazine.extension.drcs_clut;
+	else
+		pg->drcs_clut = cache_network_magazine (vbi->cn, vtp->pgno)
+			->extension.drcs_clut;
 
 	/* Opacity */
 
@@ -2513,212 +2580,311 @@ vbi_format_vt_page(vbi_decoder *vbi,
 		pg->boxed_opacity[0] = pg->boxed_opacity[1];
 	}
 
-	/* DRCS */
-
-	memset(pg->drcs, 0, sizeof(pg->drcs));
+	return ext;
+}
 
-	/* Current page number in header */
+/* Level 1 formatting of one row. Returns TRUE if the row contains
+   double height characters, the lower half has been stored in
+   the next row then. */
+static vbi_bool
+format_row			(vbi_page *		pg,
+				 cache_page *		vtp,
+				 struct ttx_extension *	ext,
+				 const char *		buf,
+				 int			row)
+{
+	struct vbi_font_descr *font;
+	int mosaic_unicodes; /* 0xEE00 separate, 0xEE20 contiguous */
+	int held_mosaic_unicode;
+	int esc;
+	vbi_bool hold, mosaic;
+	vbi_bool double_height, wide_char;
+	vbi_char ac, *acp = &pg->text[row * EXT_COLUMNS];
+	int column, i;
 
-	snprintf (buf, sizeof (buf),
-		  "\2%x.%02x\7", vtp->pgno, vtp->subno & 0xff);
+	i = row * COLUMNS;
 
-	/* Level 1 formatting */
+	held_mosaic_unicode = 0xEE20; /* G1 block mosaic, blank, contiguous */
 
-	i = 0;
-	pg->double_height_lower = 0;
+	memset(&ac, 0, sizeof(ac));
 
-	for (row = 0; row < display_rows; row++) {
-		struct vbi_font_descr *font;
-		int mosaic_unicodes; /* 0xEE00 separate, 0xEE20 contiguous */
-		int held_mosaic_unicode;
-		int esc;
-		vbi_bool hold, mosaic;
-		vbi_bool double_height, wide_char;
-		vbi_char ac, *acp = &pg->text[row * EXT_COLUMNS];
+	ac.unicode      = 0x0020;
+	ac.foreground	= ext->foreground_clut + VBI_WHITE;
+	ac.background	= ext->background_clut + VBI_BLACK;
+	mosaic_unicodes	= 0xEE20; /* contiguous */
+	ac.opacity	= pg->page_opacity[row > 0];
+	font		= pg->font[0];
+	esc		= 0;
+	hold		= FALSE;
+	mosaic		= FALSE;
 
-		held_mosaic_unicode = 0xEE20; /* G1 block mosaic, blank, contiguous */
+	double_height	= FALSE;
+	wide_char	= FALSE;
 
-		memset(&ac, 0, sizeof(ac));
+	acp[COLUMNS] = ac; /* artificial column 41 */
 
-		ac.unicode      = 0x0020;
-		ac.foreground	= ext->foreground_clut + VBI_WHITE;
-		ac.background	= ext->background_clut + VBI_BLACK;
-		mosaic_unicodes	= 0xEE20; /* contiguous */
-		ac.opacity	= pg->page_opacity[row > 0];
-		font		= pg->font[0];
-		esc		= 0;
-		hold		= FALSE;
-		mosaic		= FALSE;
+	for (column = 0; column < COLUMNS; ++column) {
+		int raw;
 
-		double_height	= FALSE;
-		wide_char	= FALSE;
+		if (row == 0 && column < 8) {
+			raw = buf[column];
+			i++;
+		} else if ((raw = vbi_unpar8 (vtp->data.lop.raw[0][i++])) < 0)
+			raw = ' ';
 
-		acp[COLUMNS] = ac; /* artificial column 41 */
+		/* set-at spacing attributes */
 
-		for (column = 0; column < COLUMNS; ++column) {
-			int raw;
+		switch (raw) {
+		case 0x09:		/* steady */
+			ac.flash = FALSE;
+			break;
 
-			if (row == 0 && column < 8) {
-				raw = buf[column];
-				i++;
-			} else if ((raw = vbi_unpar8 (vtp->data.lop.raw[0][i++])) < 0)
-				raw = ' ';
+		case 0x0C:		/* normal size */
+			ac.size = VBI_NORMAL_SIZE;
+			break;
 
-			/* set-at spacing attributes */
+		case 0x18:		/* conceal */
+			ac.conceal = TRUE;
+			break;
 
-			switch (raw) {
-			case 0x09:		/* steady */
-				ac.flash = FALSE;
-				break;
+		case 0x19:		/* contiguous mosaics */
+			mosaic_unicodes = 0xEE20;
+			break;
 
-			case 0x0C:		/* normal size */
-				ac.size = VBI_NORMAL_SIZE;
-				break;
+		case 0x1A:		/* separated mosaics */
+			mosaic_unicodes = 0xEE00;
+			break;
 
-			case 0x18:		/* conceal */
-				ac.conceal = TRUE;
-				break;
+		case 0x1C:		/* black background */
+			ac.background = ext->background_clut + VBI_BLACK;
+			break;
 
-			case 0x19:		/* contiguous mosaics */
-				mosaic_unicodes = 0xEE20;
-				break;
+		case 0x1D:		/* new background */
+			ac.background = ext->background_clut + (ac.foreground & 7);
+			break;
 
-			case 0x1A:		/* separated mosaics */
-				mosaic_unicodes = 0xEE00;
-				break;
+		case 0x1E:		/* hold mosaic */
+			hold = TRUE;
+			break;
+		}
 
-			case 0x1C:		/* black background */
-				ac.background = ext->background_clut + VBI_BLACK;
-				break;
+		if (raw <= 0x1F) {
+			ac.unicode = (hold & mosaic) ? held_mosaic_unicode : 0x0020;
+		} else {
+			if (mosaic && (raw & 0x20)) {
+				held_mosaic_unicode = mosaic_unicodes + raw - 0x20;
+				ac.unicode = held_mosaic_unicode;
+			} else
+				ac.unicode = vbi_teletext_unicode(font->G0,
+								  font->subset, raw);
+		}
 
-			case 0x1D:		/* new background */
-				ac.background = ext->background_clut + (ac.foreground & 7);
-				break;
+		if (wide_char) {
+			wide_char = FALSE;
+		} else {
+			acp[column] = ac;
 
-			case 0x1E:		/* hold mosaic */
-				hold = TRUE;
-				break;
+			wide_char = /*!!*/(ac.size & VBI_DOUBLE_WIDTH);
+			if (wide_char) {
+				if (column < (COLUMNS - 1)) {
+					acp[column + 1] = ac;
+					acp[column + 1].size = VBI_OVER_TOP;
+				} else {
+					acp[column].size = VBI_NORMAL_SIZE;
+					wide_char = FALSE;
+				}
 			}
+		}
 
-			if (raw <= 0x1F) {
-				ac.unicode = (hold & mosaic) ? held_mosaic_unicode : 0x0020;
-			} else {
-				if (mosaic && (raw & 0x20)) {
-					held_mosaic_unicode = mosaic_unicodes + raw - 0x20;
-					ac.unicode = held_mosaic_unicode;
-				} else
-					ac.unicode = vbi_teletext_unicode(font->G0,
-									  font->subset, raw);
-			}
+		/* set-after spacing attributes */
 
-			if (wide_char) {
-				wide_char = FALSE;
-			} else {
-				acp[column] = ac;
+		switch (raw) {
+		case 0x00 ... 0x07:	/* alpha + foreground color */
+			ac.foreground = ext->foreground_clut + (raw & 7);
+			ac.conceal = FALSE;
+			mosaic = FALSE;
+			break;
 
-				wide_char = /*!!*/(ac.size & VBI_DOUBLE_WIDTH);
-				if (wide_char) {
-                            		if (column < (COLUMNS - 1)) {
-                                    		acp[column + 1] = ac;
-                                    		acp[column + 1].size = VBI_OVER_TOP;
-					} else {
-                                    		acp[column].size = VBI_NORMAL_SIZE;
-						wide_char = FALSE;
-					}
-				}
-			}
+		case 0x08:		/* flash */
+			ac.flash = TRUE;
+			break;
 
-			/* set-after spacing attributes */
+		case 0x0A:		/* end box */
+			if (column < (COLUMNS - 1)
+			    && vbi_unpar8 (vtp->data.lop.raw[0][i]) == 0x0a)
+				ac.opacity = pg->page_opacity[row > 0];
+			break;
 
-			switch (raw) {
-			case 0x00 ... 0x07:	/* alpha + foreground color */
-				ac.foreground = ext->foreground_clut + (raw & 7);
-				ac.conceal = FALSE;
-				mosaic = FALSE;
-				break;
+		case 0x0B:		/* start box */
+			if (column < (COLUMNS - 1)
+			    && vbi_unpar8 (vtp->data.lop.raw[0][i]) == 0x0b)
+				ac.opacity = pg->boxed_opacity[row > 0];
+			break;
 
-			case 0x08:		/* flash */
-				ac.flash = TRUE;
+		case 0x0D:		/* double height */
+			if (row <= 0 || row >= 23)
 				break;
+			ac.size = VBI_DOUBLE_HEIGHT;
+			double_height = TRUE;
+			break;
 
-			case 0x0A:		/* end box */
-				if (column < (COLUMNS - 1)
-				    && vbi_unpar8 (vtp->data.lop.raw[0][i]) == 0x0a)
-					ac.opacity = pg->page_opacity[row > 0];
-				break;
+		case 0x0E:		/* double width */
+			printv("spacing col %d row %d double width\n", column, row);
+			if (column < (COLUMNS - 1))
+				ac.size = VBI_DOUBLE_WIDTH;
+			break;
 
-			case 0x0B:		/* start box */
-				if (column < (COLUMNS - 1)
-				    && vbi_unpar8 (vtp->data.lop.raw[0][i]) == 0x0b)
-					ac.opacity = pg->boxed_opacity[row > 0];
+		case 0x0F:		/* double size */
+			printv("spacing col %d row %d double size\n", column, row);
+			if (column >= (COLUMNS - 1) || row <= 0 || row >= 23)
 				break;
+			ac.size = VBI_DOUBLE_SIZE;
+			double_height = TRUE;
 
-			case 0x0D:		/* double height */
-				if (row <= 0 || row >= 23)
-					break;
-				ac.size = VBI_DOUBLE_HEIGHT;
-				double_height = TRUE;
-				break;
+			break;
 
-			case 0x0E:		/* double width */
-				printv("spacing col %d row %d double width\n", column, row);
-				if (column < (COLUMNS - 1))
-					ac.size = VBI_DOUBLE_WIDTH;
-				break;
+		case 0x10 ... 0x17:	/* mosaic + foreground color */
+			ac.foreground = ext->foreground_clut + (raw & 7);
+			ac.conceal = FALSE;
+			mosaic = TRUE;
+			break;
 
-			case 0x0F:		/* double size */
-				printv("spacing col %d row %d double size\n", column, row);
-				if (column >= (COLUMNS - 1) || row <= 0 || row >= 23)
-					break;
-				ac.size = VBI_DOUBLE_SIZE;
-				double_height = TRUE;
+		case 0x1F:		/* release mosaic */
+			hold = FALSE;
+			break;
 
-				break;
+		case 0x1B:		/* ESC */
+			font = pg->font[esc ^= 1];
+			break;
+		}
+	}
 
-			case 0x10 ... 0x17:	/* mosaic + foreground color */
-				ac.foreground = ext->foreground_clut + (raw & 7);
-				ac.conceal = FALSE;
-				mosaic = TRUE;
-				break;
+	if (double_height) {
+		for (column = 0; column < EXT_COLUMNS; column++) {
+			ac = acp[column];
 
-			case 0x1F:		/* release mosaic */
-				hold = FALSE;
+			switch (ac.size) {
+			case VBI_DOUBLE_HEIGHT:
+				ac.size = VBI_DOUBLE_HEIGHT2;
+				acp[EXT_COLUMNS + column] = ac;
+				break;
+	
+			case VBI_DOUBLE_SIZE:
+				ac.size = VBI_DOUBLE_SIZE2;
+				acp[EXT_COLUMNS + column] = ac;
+				ac.size = VBI_OVER_BOTTOM;
+				acp[EXT_COLUMNS + (++column)] = ac;
 				break;
 
-			case 0x1B:		/* ESC */
-				font = pg->font[esc ^= 1];
+			default: /* NORMAL, DOUBLE_WIDTH, OVER_TOP */
+				ac.size = VBI_NORMAL_SIZE;
+				ac.unicode = 0x0020;
+				acp[EXT_COLUMNS + column] = ac;
 				break;
 			}
 		}
+	}
 
-		if (double_height) {
-			for (column = 0; column < EXT_COLUMNS; column++) {
-				ac = acp[column];
+	return double_height;
+}
 
-				switch (ac.size) {
-				case VBI_DOUBLE_HEIGHT:
-					ac.size = VBI_DOUBLE_HEIGHT2;
-					acp[EXT_COLUMNS + column] = ac;
-					break;
-		
-				case VBI_DOUBLE_SIZE:
-					ac.size = VBI_DOUBLE_SIZE2;
-					acp[EXT_COLUMNS + column] = ac;
-					ac.size = VBI_OVER_BOTTOM;
-					acp[EXT_COLUMNS + (++column)] = ac;
-					break;
+/* Adds navigation links, searching rows 1 ... 23 in the set
+   zap_rows for page numbers. Replaces row 24 by a navigation bar
+   if the page has no FLOF links there. */
+static void
+add_navigation			(vbi_decoder *		vbi,
+				 vbi_page *		pg,
+				 cache_page *		vtp,
+				 int			display_rows,
+				 unsigned int		zap_rows,
+				 struct ttx_format_state *fs)
+{
+	int row;
 
-				default: /* NORMAL, DOUBLE_WIDTH, OVER_TOP */
-					ac.size = VBI_NORMAL_SIZE;
-					ac.unicode = 0x0020;
-					acp[EXT_COLUMNS + column] = ac;
-					break;
-				}
+	pg->nav_link[5].pgno = fs->initial_page.pgno;
+	pg->nav_link[5].subno = fs->initial_page.subno;
+
+	for (row = 1; row < MIN(ROWS - 1, display_rows); row++)
+		if (zap_rows & (1 << row))
+			zap_links(pg, row);
+
+	if (display_rows >= ROWS) {
+		if (vtp->data.lop.have_flof) {
+			if (vtp->data.lop.link[5].pgno >= 0x100
+			    && vtp->data.lop.link[5].pgno <= 0x899
+			    && (vtp->data.lop.link[5].pgno & 0xFF) != 0xFF) {
+				pg->nav_link[5].pgno = vtp->data.lop.link[5].pgno;
+				pg->nav_link[5].subno = vtp->data.lop.link[5].subno;
 			}
 
-			i += COLUMNS;
-			row++;
+			if (vtp->lop_packets & (1 << 24))
+				flof_links(pg, vtp);
+			else
+				flof_navigation_bar(pg, vtp);
+		} else if (fs->have_top)
+			top_navigation_bar(vbi, pg, vtp, fs);
+
+//		pdc_method_a(pg, vtp, NULL);
+	}
+}
+
+/* vbi_format_vt_page() with the state saved in fs by
+   format_save_state(). Records the pages looked up in fs. */
+static vbi_bool
+format_vt_page			(vbi_decoder *		vbi,
+				 vbi_page *		pg,
+				 cache_page *		vtp,
+				 vbi_wst_level		max_level,
+				 int			display_rows,
+				 vbi_bool		navigation,
+				 struct ttx_format_state *fs)
+{
+	char buf[16];
+	struct ttx_magazine *mag;
+	struct ttx_extension *ext;
+	int column, row, i;
 
+	if (vtp->function != PAGE_FUNCTION_LOP &&
+	    vtp->function != PAGE_FUNCTION_EACEM_TRIGGER)
+		return FALSE;
+
+	printv("\nFormatting page %03x/%04x pg=%p lev=%d rows=%d nav=%d\n",
+	       vtp->pgno, vtp->subno, pg, max_level, display_rows, navigation);
+
+	display_rows = SATURATE(display_rows, 1, ROWS);
+
+	pg->vbi = vbi;
+
+	pg->nuid = vbi->network.ev.network.nuid;
+
+	pg->pgno = vtp->pgno;
+	pg->subno = vtp->subno;
+
+	pg->rows = display_rows;
+	pg->columns = EXT_COLUMNS;
+
+	pg->dirty.y0 = 0;
+	pg->dirty.y1 = ROWS - 1;
+	pg->dirty.roll = 0;
+
+	ext = format_attributes (vbi, pg, vtp, max_level, fs, &mag);
+
+	/* DRCS */
+
+	memset(pg->drcs, 0, sizeof(pg->drcs));
+
+	/* Current page number in header */
+
+	snprintf (buf, sizeof (buf),
+		  "\2%x.%02x\7", vtp->pgno, vtp->subno & 0xff);
+
+	/* Level 1 formatting */
+
+	pg->double_height_lower = 0;
+
+	for (row = 0; row < display_rows; row++) {
+		if (format_row (pg, vtp, ext, buf, row)) {
+			row++;
 			pg->double_height_lower |= 1 << row;
 		}
 	}
@@ -2757,10 +2923,11 @@ vbi_format_vt_page(vbi_decoder *vbi,
 			       vtp->x26_designations);
 			success = enhance(vbi, mag, ext, pg, vtp, LOCAL_ENHANCEMENT_DATA,
 				vtp->data.enh_lop.enh, elements(vtp->data.enh_lop.enh),
-				0, 0, max_level, display_rows == 1, NULL);
+				0, 0, max_level, display_rows == 1, NULL, fs);
 		} else
 			success = default_object_invocation(vbi, mag, ext, pg, vtp,
-							    max_level, display_rows == 1);
+							    max_level, display_rows == 1,
+							    fs);
 
 		if (success) {
 			if (max_level >= VBI_WST_LEVEL_2p5)
@@ -2771,32 +2938,8 @@ vbi_format_vt_page(vbi_decoder *vbi,
 
 	/* Navigation */
 
-	if (navigation) {
-		pg->nav_link[5].pgno = vbi->cn->initial_page.pgno;
-		pg->nav_link[5].subno = vbi->cn->initial_page.subno;
-
-		for (row = 1; row < MIN(ROWS - 1, display_rows); row++)
-			zap_links(pg, row);
-
-		if (display_rows >= ROWS) {
-			if (vtp->data.lop.have_flof) {
-				if (vtp->data.lop.link[5].pgno >= 0x100
-				    && vtp->data.lop.link[5].pgno <= 0x899
-				    && (vtp->data.lop.link[5].pgno & 0xFF) != 0xFF) {
-					pg->nav_link[5].pgno = vtp->data.lop.link[5].pgno;
-					pg->nav_link[5].subno = vtp->data.lop.link[5].subno;
-				}
-
-				if (vtp->lop_packets & (1 << 24))
-					flof_links(pg, vtp);
-				else
-					flof_navigation_bar(pg, vtp);
-			} else if (vbi->cn->have_top)
-				top_navigation_bar(vbi, pg, vtp);
-
-//			pdc_method_a(pg, vtp, NULL);
-		}
-	}
+	if (navigation)
+		add_navigation (vbi, pg, vtp, display_rows, -1, fs);
 
 	column_41 (pg, ext);
 
@@ -2828,6 +2971,127 @@ vbi_format_vt_page(vbi_decoder *vbi,
 	return TRUE;
 }
 
+/**
+ * @internal
+ * @param vbi Initialized vbi_decoder context.
+ * @param pg Place to store the formatted page.
+ * @param vtp Raw Teletext page. 
+ * @param max_level Format the page at this Teletext implementation level.
+ * @param display_rows Number of rows to format, between 1 ... 25.
+ * @param navigation Analyse the page and add navigation links,
+ *   including TOP and FLOF.
+ * 
+ * Format a page @a pg from a raw Teletext page @a vtp. This function is
+ * used internally by libzvbi only.
+ * 
+ * @return
+ * @c TRUE if the page could be formatted.
+ */
+int
+vbi_format_vt_page(vbi_decoder *vbi,
+		   vbi_page *pg, cache_page *vtp,
+		   vbi_wst_level max_level,
+		   int display_rows, vbi_bool navigation)
+{
+	struct ttx_format_state fs;
+
+	fs.n_deps = 0;
+	fs.overflow = FALSE;
+
+	format_save_state (vbi, &fs, vtp->pgno, max_level);
+
+	return format_vt_page (vbi, pg, vtp, max_level,
+			       display_rows, navigation, &fs);
+}
+
+/* TRUE if the page in fe is still what vbi_format_vt_page()
+   would return. */
+static vbi_bool
+format_cache_valid		(vbi_decoder *		vbi,
+				 struct ttx_format_entry *fe)
+{
+	struct ttx_format_state *fs = &fe->state;
+	struct ttx_magazine *mag;
+	vbi_bool valid;
+	unsigned int i;
+
+	for (i = 0; i < fs->n_deps; ++i) {
+		struct ttx_format_dep *dep = &fs->deps[i];
+		unsigned int version;
+
+		version = _vbi_cache_get_page_version
+			(vbi->ca, vbi->cn, dep->pgno,
+			 dep->subno, dep->subno_mask);
+		if (version != dep->version)
+			return FALSE;
+	}
+
+	pthread_mutex_lock (&vbi->ca->mutex);
+
+	if (fe->max_level <= VBI_WST_LEVEL_1p5)
+		mag = &vbi->vt.default_magazine;
+	else
+		mag = cache_network_magazine (vbi->cn, fe->pgno);
+
+	valid = (0 == memcmp (&fs->magazine, mag, sizeof (fs->magazine))
+		 && 0 == memcmp (&fs->initial_page, &vbi->cn->initial_page,
+				 sizeof (fs->initial_page))
+		 && 0 == memcmp (fs->btt_link, vbi->cn->btt_link,
+				 sizeof (fs->btt_link))
+		 && fs->have_top == vbi->cn->have_top
+		 && fs->top_version == vbi->vt.top_version);
+
+	pthread_mutex_unlock (&vbi->ca->mutex);
+
+	return (valid && fs->nuid == vbi->network.ev.network.nuid);
+}
+
+/* Returns the entry of the format cache holding a valid page
+   formatted with these parameters. If none, returns the entry to
+   reuse with state.n_deps zero. */
+static struct ttx_format_entry *
+format_cache_lookup		(vbi_decoder *		vbi,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 vbi_wst_level		max_level,
+				 int			display_rows,
+				 vbi_bool		navigation)
+{
+	struct ttx_format_cache *fc;
+	struct ttx_format_entry *lru;
+	unsigned int i;
+
+	fc = &vbi->vt.format_cache;
+	lru = &fc->entry[0];
+
+	for (i = 0; i < TTX_FORMAT_CACHE_SIZE; ++i) {
+		struct ttx_format_entry *fe = &fc->entry[i];
+
+		if (0 == fe->state.n_deps) {
+			if (lru->state.n_deps > 0)
+				lru = fe;
+			continue;
+		}
+
+		if (fe->pgno == pgno
+		    && fe->subno == subno
+		    && fe->max_level == max_level
+		    && fe->display_rows == display_rows
+		    && fe->navigation == navigation) {
+			if (!format_cache_valid (vbi, fe))
+				fe->state.n_deps = 0;
+			return fe;
+		}
+
+		if (lru->state.n_deps > 0 && fe->last_used < lru->last_used)
+			lru = fe;
+	}
+
+	lru->state.n_deps = 0;
+
+	return lru;
+}
+
 /**
  * @param vbi Initialized vbi_decoder context.
  * @param pg Place to store the formatted page.
@@ -2846,7 +3110,15 @@ vbi_format_vt_page(vbi_decoder *vbi,
  * 
  * Although safe to do, this function is not supposed to be called from
  * an event handler since rendering may block decoding for extended
- * periods of time.
+ * periods of time. It can be called from other threads while
+ * vbi_decode() runs, the cache is locked only to look up pages,
+ * not while formatting.
+ *
+ * The decoder keeps the last few formatted pages. Fetching a page
+ * again with the same parameters copies the cached result unless the
+ * page, an object or DRCS page it references, or the magazine and
+ * TOP data used to format it changed in the meantime. Calls from
+ * different threads can format pages at the same time.
  *
  * @return
  * @c FALSE if the page is not cached or could not be formatted
@@ -2861,6 +3133,9 @@ vbi_fetch_vt_page(vbi_decoder *vbi, vbi_page *pg,
 		  vbi_wst_level max_level,
 		  int display_rows, vbi_bool navigation)
 {
+	struct ttx_format_state fs;
+	struct ttx_format_cache *fc;
+	struct ttx_format_entry *fe;
 	cache_page *vtp;
 	vbi_bool success;
 	int row;
@@ -2870,7 +3145,9 @@ vbi_fetch_vt_page(vbi_decoder *vbi, vbi_page *pg,
 		if (subno == VBI_ANY_SUBNO)
 			subno = 0;
 
-		if (!vbi->cn->have_top || !top_index(vbi, pg, subno))
+		format_save_state (vbi, &fs, 0x100, VBI_WST_LEVEL_3p5);
+
+		if (!fs.have_top || !top_index(vbi, pg, subno, &fs))
 			return FALSE;
 
 		pg->nuid = vbi->network.ev.network.nuid;
@@ -2885,15 +3162,360 @@ vbi_fetch_vt_page(vbi_decoder *vbi, vbi_page *pg,
 		return TRUE;
 
 	default:
-		vtp = _vbi_cache_get_page (vbi->ca, vbi->cn, pgno, subno, -1);
-		if (!vtp)
-			return FALSE;
-		success = vbi_format_vt_page(vbi, pg, vtp,
-					     max_level, display_rows,
-					     navigation);
-		cache_page_unref (vtp);
+		break;
+	}
+
+	display_rows = SATURATE(display_rows, 1, ROWS);
+	navigation = !!navigation;
+
+	fc = &vbi->vt.format_cache;
+
+	pthread_mutex_lock (&fc->mutex);
+
+	if (NULL == fc->entry) {
+		fc->entry = calloc (TTX_FORMAT_CACHE_SIZE,
+				    sizeof (*fc->entry));
+		if (NULL == fc->entry) {
+			pthread_mutex_unlock (&fc->mutex);
+
+			/* Without the format cache. */
+			vtp = _vbi_cache_get_page (vbi->ca, vbi->cn,
+						   pgno, subno, -1);
+			if (!vtp)
+				return FALSE;
+
+			success = vbi_format_vt_page (vbi, pg, vtp,
+						      max_level, display_rows,
+						      navigation);
+			cache_page_unref (vtp);
+
+			return success;
+		}
+	}
+
+	fe = format_cache_lookup (vbi, pgno, subno, max_level,
+				  display_rows, navigation);
+	if (fe->state.n_deps > 0) {
+		fe->last_used = ++fc->clock;
+		memcpy (pg, &fe->page, sizeof (*pg));
+		pthread_mutex_unlock (&fc->mutex);
+		return TRUE;
+	}
+
+	/* Formatting takes a while, other threads may fetch
+	   cached pages meanwhile. */
+	pthread_mutex_unlock (&fc->mutex);
+
+	fs.n_deps = 0;
+	fs.overflow = FALSE;
+
+	/* Records the first dependency. */
+	vtp = format_get_page (vbi, &fs, pgno, subno, -1);
+	if (!vtp)
+		return FALSE;
+
+	format_save_state (vbi, &fs, vtp->pgno, max_level);
+
+	success = format_vt_page (vbi, pg, vtp, max_level,
+				  display_rows, navigation, &fs);
+	cache_page_unref (vtp);
+
+	if (!success || fs.overflow)
 		return success;
+
+	pthread_mutex_lock (&fc->mutex);
+
+	/* Unless another thread stored this page meanwhile. */
+	fe = format_cache_lookup (vbi, pgno, subno, max_level,
+				  display_rows, navigation);
+	if (0 == fe->state.n_deps) {
+		memcpy (&fe->state, &fs, sizeof (fe->state));
+		memcpy (&fe->page, pg, sizeof (fe->page));
+
+		fe->pgno = pgno;
+		fe->subno = subno;
+		fe->max_level = max_level;
+		fe->display_rows = display_rows;
+		fe->navigation = navigation;
+	}
+
+	fe->last_used = ++fc->clock;
+
+	pthread_mutex_unlock (&fc->mutex);
+
+	return TRUE;
+}
+
+/* TRUE if vbi_format_vt_page() formats vtp without enhancements
+   or objects, so each row depends only on its packet, the row
+   above and the attributes of the page. */
+static vbi_bool
+level_one_page			(cache_page *		vtp,
+				 vbi_wst_level		max_level,
+				 struct ttx_format_state *fs)
+{
+	if (max_level < VBI_WST_LEVEL_1p5)
+		return TRUE;
+
+	if (vtp->x26_designations & 1)
+		return FALSE;
+
+	return NULL == default_pop_link (&fs->magazine, vtp, max_level);
+}
+
+/* Reformats the rows of a Level 1 page pg in the set changed,
+   1 << row, and the rows depending on them. Stores the rows which
+   actually changed in *dirty_rows. Returns FALSE if the page must
+   be formatted from scratch. */
+static vbi_bool
+update_rows			(vbi_decoder *		vbi,
+				 vbi_page *		pg,
+				 cache_page *		vtp,
+				 vbi_wst_level		max_level,
+				 int			display_rows,
+				 vbi_bool		navigation,
+				 struct ttx_format_state *fs,
+				 unsigned int		changed,
+				 unsigned int *		dirty_rows)
+{
+	struct vbi_font_descr *font[2];
+	vbi_color screen_color;
+	vbi_opacity screen_opacity;
+	vbi_rgba color_map[40];
+	uint8_t *drcs_clut;
+	vbi_opacity page_opacity[2];
+	vbi_opacity boxed_opacity[2];
+	vbi_char nav_bar[COLUMNS];
+	vbi_char column_40[ROWS];
+	struct ttx_magazine *mag;
+	struct ttx_extension *ext;
+	unsigned int old_lower;
+	unsigned int lower;
+	unsigned int dirty;
+	vbi_bool nav_bar_row;
+	char buf[16];
+	int row;
+
+	if (vtp->function != PAGE_FUNCTION_LOP
+	    || 0 != (changed & ~(CACHE_PAGE_OTHER_CHANGED - 1))
+	    || pg->pgno != vtp->pgno
+	    || pg->rows != display_rows
+	    || pg->columns != EXT_COLUMNS)
+		return FALSE;
+
+	memcpy (font, pg->font, sizeof (font));
+	screen_color = pg->screen_color;
+	screen_opacity = pg->screen_opacity;
+	memcpy (color_map, pg->color_map, sizeof (color_map));
+	drcs_clut = pg->drcs_clut;
+	memcpy (page_opacity, pg->page_opacity, sizeof (page_opacity));
+	memcpy (boxed_opacity, pg->boxed_opacity, sizeof (boxed_opacity));
+
+	ext = format_attributes (vbi, pg, vtp, max_level, fs, &mag);
+
+	/* Character set, colors or flags changed. */
+	if (0 != memcmp (font, pg->font, sizeof (font))
+	    || screen_color != pg->screen_color
+	    || screen_opacity != pg->screen_opacity
+	    || 0 != memcmp (color_map, pg->color_map, sizeof (color_map))
+	    || drcs_clut != pg->drcs_clut
+	    || 0 != memcmp (page_opacity, pg->page_opacity,
+			    sizeof (page_opacity))
+	    || 0 != memcmp (boxed_opacity, pg->boxed_opacity,
+			    sizeof (boxed_opacity)))
+		return FALSE;
+
+	/* Page number in the header. */
+	if (pg->subno != vtp->subno)
+		changed |= 1 << 0;
+
+	pg->vbi = vbi;
+	pg->nuid = vbi->network.ev.network.nuid;
+	pg->subno = vtp->subno;
+
+	snprintf (buf, sizeof (buf),
+		  "\2%x.%02x\7", vtp->pgno, vtp->subno & 0xff);
+
+	/* The TOP navigation bar depends on other pages. */
+	nav_bar_row = (navigation && display_rows >= ROWS);
+	if (nav_bar_row) {
+		memcpy (nav_bar, pg->text + LAST_ROW, sizeof (nav_bar));
+		changed |= 1 << 24;
 	}
+
+	for (row = 0; row < display_rows; row++)
+		column_40[row] = pg->text[row * EXT_COLUMNS + COLUMNS];
+
+	old_lower = pg->double_height_lower;
+	lower = 0;
+	dirty = 0;
+
+	for (row = 0; row < display_rows; row++) {
+		unsigned int bit = 1 << row;
+
+		if (lower & bit)
+			continue; /* lower half of row - 1 */
+
+		if (old_lower & bit) {
+			if (!(dirty & (bit >> 1))) {
+				/* Lower half of an unchanged row. */
+				lower |= bit;
+				continue;
+			}
+		} else if (!(changed & bit)) {
+			continue;
+		}
+
+		dirty |= bit;
+
+		if (format_row (pg, vtp, ext, buf, row)) {
+			lower |= bit << 1;
+			dirty |= bit << 1;
+		}
+	}
+
+	pg->double_height_lower = lower;
+
+	if (navigation)
+		add_navigation (vbi, pg, vtp, display_rows, dirty, fs);
+
+	if (nav_bar_row
+	    && 0 == memcmp (nav_bar, pg->text + LAST_ROW, sizeof (nav_bar)))
+		dirty &= ~(1 << 24);
+
+	column_41 (pg, ext);
+
+	for (row = 0; row < display_rows; row++) {
+		if (0 != memcmp (&column_40[row],
+				 &pg->text[row * EXT_COLUMNS + COLUMNS],
+				 sizeof (*column_40)))
+			dirty |= 1 << row;
+	}
+
+	*dirty_rows = dirty;
+
+	return TRUE;
+}
+
+/**
+ * @param vbi Initialized vbi_decoder context.
+ * @param pg Place to store the formatted page, usually the page
+ *   formatted by the previous call.
+ * @param pgno Page number of the page to fetch, see vbi_pgno.
+ * @param subno Subpage number to fetch (optional @c VBI_ANY_SUBNO).
+ * @param max_level Format the page at this Teletext implementation level.
+ * @param display_rows Number of rows to format, between 1 ... 25.
+ * @param navigation Analyse the page and add navigation links,
+ *   including TOP and FLOF.
+ * @param version Version of the page in @a pg, as returned by the
+ *   previous call, or zero to format the page from scratch. Returns
+ *   the version now in @a pg.
+ * @param dirty_rows If not @c NULL, the set of rows which changed
+ *   is stored here, 1 << row 0 ... 24.
+ *
+ * Like vbi_fetch_vt_page(), but only updates the rows of @a pg which
+ * changed if @a pg contains the previous version of the cached page
+ * and this is a Level 1 page, i.e. it has no enhancements or objects.
+ * Otherwise the page is formatted from scratch and all rows are dirty.
+ * @a pg->dirty covers the first to last dirty row, @a pg->dirty.y1
+ * is smaller than @a pg->dirty.y0 if nothing changed.
+ *
+ * @a max_level, @a display_rows and @a navigation must be the
+ * same as in the call which formatted @a pg. Renderers which update
+ * a page whenever a new version has been received can call this
+ * function from a @c VBI_EVENT_TTX_PAGE handler and redraw only the
+ * dirty rows.
+ *
+ * @return
+ * @c FALSE if the page is not cached or could not be formatted,
+ * see vbi_fetch_vt_page(). @a pg and @a version are unchanged then.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_update_vt_page(vbi_decoder *vbi, vbi_page *pg,
+		   vbi_pgno pgno, vbi_subno subno,
+		   vbi_wst_level max_level,
+		   int display_rows, vbi_bool navigation,
+		   unsigned int *version, unsigned int *dirty_rows)
+{
+	struct ttx_format_state fs;
+	cache_page *vtp;
+	vbi_bool level_one;
+	unsigned int changed;
+	unsigned int dirty;
+	int row;
+
+	assert (NULL != version);
+
+	if (0x900 == pgno) {
+		/* TOP index, not cached. */
+		if (!vbi_fetch_vt_page (vbi, pg, pgno, subno, max_level,
+					display_rows, navigation))
+			return FALSE;
+
+		*version = 0;
+
+		if (NULL != dirty_rows)
+			*dirty_rows = (1 << ROWS) - 1;
+
+		return TRUE;
+	}
+
+	vtp = _vbi_cache_get_page (vbi->ca, vbi->cn, pgno, subno, -1);
+	if (!vtp)
+		return FALSE;
+
+	display_rows = SATURATE(display_rows, 1, ROWS);
+
+	fs.n_deps = 0;
+	fs.overflow = FALSE;
+
+	format_save_state (vbi, &fs, vtp->pgno, max_level);
+
+	level_one = level_one_page (vtp, max_level, &fs);
+
+	if (0 == *version || !level_one)
+		changed = ~0U;
+	else if (*version == vtp->version)
+		changed = 0;
+	else if (*version == vtp->prev_version)
+		changed = vtp->changed_packets;
+	else
+		changed = ~0U;
+
+	if (update_rows (vbi, pg, vtp, max_level, display_rows,
+			 navigation, &fs, changed, &dirty)) {
+		pg->dirty.y0 = 0;
+		pg->dirty.y1 = -1;
+		pg->dirty.roll = 0;
+
+		for (row = 0; row < display_rows; row++) {
+			if (dirty & (1 << row)) {
+				if (pg->dirty.y1 < pg->dirty.y0)
+					pg->dirty.y0 = row;
+				pg->dirty.y1 = row;
+			}
+		}
+	} else {
+		if (!format_vt_page (vbi, pg, vtp, max_level,
+				     display_rows, navigation, &fs)) {
+			cache_page_unref (vtp);
+			return FALSE;
+		}
+
+		dirty = (1 << display_rows) - 1;
+	}
+
+	/* Enhanced pages are always formatted from scratch. */
+	*version = level_one ? vtp->version : 0;
+
+	cache_page_unref (vtp);
+
+	if (NULL != dirty_rows)
+		*dirty_rows = dirty;
+
+	return TRUE;
 }
 
 /*
@@ -27,6 +27,8 @@
 #define TELETEXT_H
 
 #include "cache-priv.h"
+#include "format.h"
+#include "page_table.h"
 
 struct raw_page {
 	cache_page		page[1];
@@ -56,6 +58,61 @@ typedef enum {
 
 /* Private */
 
+/* A page looked up while formatting a page. */
+struct ttx_format_dep {
+	vbi_pgno			pgno;
+	vbi_subno			subno;
+	vbi_subno			subno_mask;
+	/* cache_page.version, 0 if the page was not cached. */
+	unsigned int			version;
+};
+
+#define TTX_FORMAT_CACHE_SIZE 8
+
+/* What a page formatted by vbi_fetch_vt_page() depends on. The
+   formatted page is valid while these are unchanged. */
+struct ttx_format_state {
+	unsigned int			n_deps;
+	struct ttx_format_dep		deps[16];
+	struct ttx_magazine		magazine;
+	struct ttx_page_link		initial_page;
+	struct ttx_page_link		btt_link[2 * 5];
+	vbi_bool			have_top;
+	unsigned int			top_version;
+	vbi_nuid			nuid;
+
+	/* TRUE if more pages were looked up than fit in deps. */
+	vbi_bool			overflow;
+};
+
+/* A page formatted by vbi_fetch_vt_page(). */
+struct ttx_format_entry {
+	/* Parameters, state.n_deps is zero if the entry is unused. */
+	vbi_pgno			pgno;
+	vbi_subno			subno;
+	vbi_wst_level			max_level;
+	int				display_rows;
+	vbi_bool			navigation;
+
+	struct ttx_format_state		state;
+
+	/* For LRU replacement. */
+	unsigned int			last_used;
+
+	vbi_page			page;
+};
+
+struct ttx_format_cache {
+	/* Protects the entries, not held while formatting. */
+	pthread_mutex_t			mutex;
+
+	unsigned int			clock;
+
+	/* TTX_FORMAT_CACHE_SIZE entries, allocated on the first
+	   vbi_fetch_vt_page() call. NULL if none. */
+	struct ttx_format_entry *	entry;
+};
+
 struct teletext {
 	vbi_wst_level			max_level;
 
@@ -68,6 +125,24 @@ struct teletext {
 
 	struct raw_page			raw_page[8];
 	struct raw_page			*current;
+
+	/* Incremented when the TOP page types change. */
+	unsigned int			top_version;
+
+	/* Don't send VBI_EVENT_TTX_PAGE for retransmitted pages. */
+	vbi_bool			changes_only;
+
+	/* Protects interest and interest_magazines. */
+	pthread_mutex_t			interest_mutex;
+
+	/* Displayable pages to decode, NULL if all. */
+	vbi_page_table *		interest;
+
+	/* Magazines with pages in the interest table,
+	   1 << (magazine & 7). */
+	unsigned int			interest_magazines;
+
+	struct ttx_format_cache		format_cache;
 };
 
 /* Public */
@@ -78,6 +153,18 @@ struct teletext {
  */
 extern void		vbi_teletext_set_default_region(vbi_decoder *vbi, int default_region);
 extern void		vbi_teletext_set_level(vbi_decoder *vbi, int level);
+extern void		vbi_teletext_set_changes_only(vbi_decoder *vbi, vbi_bool enable);
+extern vbi_bool		vbi_teletext_add_interest_pages(vbi_decoder *vbi,
+							vbi_pgno first_pgno,
+							vbi_pgno last_pgno);
+extern vbi_bool		vbi_teletext_add_interest_subpages(vbi_decoder *vbi,
+							   vbi_pgno pgno,
+							   vbi_subno first_subno,
+							   vbi_subno last_subno);
+extern vbi_bool		vbi_teletext_remove_interest_pages(vbi_decoder *vbi,
+							   vbi_pgno first_pgno,
+							   vbi_pgno last_pgno);
+extern void		vbi_teletext_reset_interest(vbi_decoder *vbi);
 /** @} */
 /**
  * @addtogroup Cache
@@ -87,6 +174,11 @@ extern vbi_bool		vbi_fetch_vt_page(vbi_decoder *vbi, vbi_page *pg,
 					  vbi_pgno pgno, vbi_subno subno,
 					  vbi_wst_level max_level, int display_rows,
 					  vbi_bool navigation);
+extern vbi_bool		vbi_update_vt_page(vbi_decoder *vbi, vbi_page *pg,
+					   vbi_pgno pgno, vbi_subno subno,
+					   vbi_wst_level max_level, int display_rows,
+					   vbi_bool navigation, unsigned int *version,
+					   unsigned int *dirty_rows);
 extern int		vbi_page_title(vbi_decoder *vbi, int pgno, int subno, char *buf);
 /** @} */
 /**
@@ -166,76 +166,285 @@ vbi_event_enable(vbi_decoder *vbi, int mask)
 	if (activate & VBI_EVENT_PROG_ID)
 		CLEAR (vbi->vps_pid);
 
-	vbi->event_mask = mask;
+	__atomic_store_n(&vbi->event_mask, mask, __ATOMIC_RELAXED);
 }
 
-/**
- * @param vbi Initialized vbi decoding context.
- * @param event_mask Events the handler is waiting for.
- * @param handler Event handler function.
- * @param user_data Pointer passed to the handler.
- * 
- * @deprecated
- * Replaces all existing handlers with this @a handler function,
- * ignoring @a user_data. Use vbi_event_handler_register() in new code.
- * 
- * @return
- * FALSE on failure.
- */
-vbi_bool
-vbi_event_handler_add(vbi_decoder *vbi, int event_mask,
-		      vbi_event_handler handler, void *user_data) 
+/* The dispatcher whose handlers this thread is calling, if any. */
+static __thread const struct event_dispatcher *current_dispatcher;
+
+static void
+dispatcher_init(struct event_dispatcher *d)
 {
-	struct event_handler *eh, **ehp;
-	int found = 0, mask = 0, was_locked;
+	pthread_mutex_init(&d->mutex, NULL);
+	pthread_cond_init(&d->cond, NULL);
 
-	/* If was_locked we're a handler, no recursion. */
-	was_locked = pthread_mutex_trylock(&vbi->event_mutex);
+	d->list = NULL;
+	d->dispatching = 0;
+	d->retired = NULL;
+}
 
-	ehp = &vbi->handlers;
+static void
+free_handler_lists(struct event_handler_list *hl)
+{
+	while (NULL != hl) {
+		struct event_handler_list *next = hl->next;
+		struct event_handler *eh;
 
-	while ((eh = *ehp)) {
-		if (eh->handler == handler) {
-			found = 1;
+		while (NULL != (eh = hl->removed)) {
+			hl->removed = eh->next;
+			free(eh);
+		}
 
-			if (!event_mask) {
-				*ehp = eh->next;
+		free(hl);
+
+		hl = next;
+	}
+}
+
+/* No dispatcher_send() call must be in progress. */
+static void
+dispatcher_destroy(struct event_dispatcher *d)
+{
+	struct event_handler_list *hl;
+	unsigned int i;
+
+	if (NULL != (hl = d->list)) {
+		for (i = 0; i < hl->n_handlers; ++i)
+			free(hl->handlers[i]);
+		free(hl);
+	}
+
+	free_handler_lists(d->retired);
+
+	pthread_cond_destroy(&d->cond);
+	pthread_mutex_destroy(&d->mutex);
+
+	CLEAR(*d);
+}
+
+/* Frees hl, or if dispatcher_send() may still use it, postpones
+   this until a later call. Call with d->mutex locked. */
+static void
+retire_handler_list(struct event_dispatcher *d, struct event_handler_list *hl)
+{
+	if (NULL != hl) {
+		hl->next = d->retired;
+		__atomic_store_n(&d->retired, hl, __ATOMIC_SEQ_CST);
+	}
+
+	/* dispatcher_send() increments dispatching before it loads
+	   d->list, and we replaced d->list before this load. So if
+	   no call is in progress now, later calls will see the new
+	   list. */
+	if (NULL != d->retired
+	    && 0 == __atomic_load_n(&d->dispatching, __ATOMIC_SEQ_CST)) {
+		free_handler_lists(d->retired);
+		__atomic_store_n(&d->retired, NULL, __ATOMIC_SEQ_CST);
+	}
+}
+
+/* Waits until the removed handlers returned, unless this thread
+   calls them. Call with d->mutex locked. */
+static void
+wait_for_handlers(struct event_dispatcher *d, struct event_handler *removed)
+{
+	struct event_handler *eh;
+
+	if (d == current_dispatcher)
+		return;
+
+	for (eh = removed; NULL != eh; eh = eh->next) {
+		/* dispatcher_send() increments running before it loads
+		   the event mask, we cleared the mask before this load. */
+		__atomic_store_n(&eh->waiting, TRUE, __ATOMIC_SEQ_CST);
+
+		while (0 != __atomic_load_n(&eh->running, __ATOMIC_SEQ_CST))
+			pthread_cond_wait(&d->cond, &d->mutex);
+	}
+}
+
+/* Adds, changes or removes (event_mask 0) the handler. Stores the
+   events all handlers wait for in *mask. Call with d->mutex locked. */
+static vbi_bool
+dispatcher_update(struct event_dispatcher *d, int event_mask,
+		  vbi_event_handler handler, void *user_data,
+		  vbi_bool match_user_data, int *mask)
+{
+	struct event_handler_list *old_hl, *hl;
+	struct event_handler *eh, *removed;
+	unsigned int i, n;
+	int found = 0;
+
+	old_hl = d->list;
+	n = (NULL != old_hl) ? old_hl->n_handlers : 0;
+
+	/* Room for one more handler. */
+	hl = (struct event_handler_list *)
+		malloc(sizeof(*hl) + n * sizeof(hl->handlers[0]));
+	if (NULL == hl)
+		return FALSE;
+
+	hl->next = NULL;
+	hl->removed = NULL;
+	hl->n_handlers = 0;
+
+	removed = NULL;
+	*mask = 0;
+
+	for (i = 0; i < n; ++i) {
+		eh = old_hl->handlers[i];
+
+		if (eh->handler == handler
+		    && (!match_user_data || eh->user_data == user_data)) {
+			found = 1;
 
-				if (vbi->next_handler == eh)
-					vbi->next_handler = eh->next;
-						/* in event send loop */
-				free(eh);
+			/* If a dispatcher_send() call is in progress it
+			   shall not call the handler again. */
+			__atomic_store_n(&eh->event_mask, event_mask,
+					 __ATOMIC_RELEASE);
 
+			if (!event_mask) {
+				eh->next = removed;
+				removed = eh;
 				continue;
-			} else
-				eh->event_mask = event_mask;
+			}
 		}
 
-		mask |= eh->event_mask;	
-		ehp = &eh->next;
+		*mask |= eh->event_mask;
+		hl->handlers[hl->n_handlers++] = eh;
 	}
 
 	if (!found && event_mask) {
-		if (!(eh = (struct event_handler *) calloc(1, sizeof(*eh))))
+		if (!(eh = (struct event_handler *) calloc(1, sizeof(*eh)))) {
+			free(hl);
 			return FALSE;
+		}
 
 		eh->event_mask = event_mask;
-		mask |= event_mask;
+		*mask |= event_mask;
 
 		eh->handler = handler;
 		eh->user_data = user_data;
 
-		*ehp = eh;
+		hl->handlers[hl->n_handlers++] = eh;
 	}
 
-	vbi_event_enable(vbi, mask);
+	if (hl->n_handlers == n && NULL == removed) {
+		/* Only event masks changed. */
+		free(hl);
+	} else {
+		if (0 == hl->n_handlers) {
+			free(hl);
+			hl = NULL;
+		}
+
+		__atomic_store_n(&d->list, hl, __ATOMIC_SEQ_CST);
+
+		wait_for_handlers(d, removed);
 
-	if (!was_locked)
-		pthread_mutex_unlock(&vbi->event_mutex);
+		if (NULL != old_hl)
+			old_hl->removed = removed;
+
+		retire_handler_list(d, old_hl);
+	}
 
 	return TRUE;
 }
 
+/* Calls each handler of d waiting for this ev->type of event.
+   Takes no locks, see struct event_handler_list. */
+static void
+dispatcher_send(struct event_dispatcher *d, vbi_event *ev)
+{
+	struct event_handler_list *hl;
+	const struct event_dispatcher *saved_dispatcher;
+	unsigned int i;
+
+	__atomic_add_fetch(&d->dispatching, 1, __ATOMIC_SEQ_CST);
+
+	hl = __atomic_load_n(&d->list, __ATOMIC_SEQ_CST);
+
+	saved_dispatcher = current_dispatcher;
+	current_dispatcher = d;
+
+	for (i = 0; NULL != hl && i < hl->n_handlers; ++i) {
+		struct event_handler *eh = hl->handlers[i];
+
+		if (!(__atomic_load_n(&eh->event_mask, __ATOMIC_RELAXED)
+		      & ev->type))
+			continue;
+
+		/* See wait_for_handlers(). */
+		__atomic_add_fetch(&eh->running, 1, __ATOMIC_SEQ_CST);
+
+		if (__atomic_load_n(&eh->event_mask, __ATOMIC_SEQ_CST)
+		    & ev->type)
+			eh->handler(ev, eh->user_data);
+
+		if (0 == __atomic_sub_fetch(&eh->running, 1,
+					    __ATOMIC_SEQ_CST)
+		    && __atomic_load_n(&eh->waiting, __ATOMIC_SEQ_CST)) {
+			pthread_mutex_lock(&d->mutex);
+			pthread_cond_broadcast(&d->cond);
+			pthread_mutex_unlock(&d->mutex);
+		}
+	}
+
+	current_dispatcher = saved_dispatcher;
+
+	/* Free replaced lists if a registration function could not.
+	   Don't wait for the lock, we try again next time. */
+	if (0 == __atomic_sub_fetch(&d->dispatching, 1, __ATOMIC_SEQ_CST)
+	    && NULL != __atomic_load_n(&d->retired, __ATOMIC_SEQ_CST)
+	    && 0 == pthread_mutex_trylock(&d->mutex)) {
+		retire_handler_list(d, NULL);
+		pthread_mutex_unlock(&d->mutex);
+	}
+}
+
+/* Adds, changes or removes (event_mask 0) the handler. */
+static vbi_bool
+event_handler_update(vbi_decoder *vbi, int event_mask,
+		     vbi_event_handler handler, void *user_data,
+		     vbi_bool match_user_data)
+{
+	vbi_bool success;
+	int mask;
+
+	pthread_mutex_lock(&vbi->handlers.mutex);
+
+	success = dispatcher_update(&vbi->handlers, event_mask,
+				    handler, user_data,
+				    match_user_data, &mask);
+	if (success)
+		vbi_event_enable(vbi, mask);
+
+	pthread_mutex_unlock(&vbi->handlers.mutex);
+
+	return success;
+}
+
+/**
+ * @param vbi Initialized vbi decoding context.
+ * @param event_mask Events the handler is waiting for.
+ * @param handler Event handler function.
+ * @param user_data Pointer passed to the handler.
+ * 
+ * @deprecated
+ * Replaces all existing handlers with this @a handler function,
+ * ignoring @a user_data. Use vbi_event_handler_register() in new code.
+ * 
+ * @return
+ * FALSE on failure.
+ */
+vbi_bool
+vbi_event_handler_add(vbi_decoder *vbi, int event_mask,
+		      vbi_event_handler handler, void *user_data) 
+{
+	return event_handler_update(vbi, event_mask, handler, user_data,
+				    /* match_user_data */ FALSE);
+}
+
 /**
  * @param vbi Initialized vbi decoding context.
  * @param handler Event handler function.
@@ -268,6 +477,8 @@ vbi_event_handler_remove(vbi_decoder *vbi, vbi_event_handler handler)
  * decoding.
  * 
  * This function can be safely called at any time, even from a handler.
+ * It does not block the thread calling vbi_decode(), a new handler
+ * receives events from the next event on.
  * 
  * @return
  * @c FALSE on failure.
@@ -276,55 +487,8 @@ vbi_bool
 vbi_event_handler_register(vbi_decoder *vbi, int event_mask,
 		           vbi_event_handler handler, void *user_data) 
 {
-	struct event_handler *eh, **ehp;
-	int found = 0, mask = 0, was_locked;
-
-	/* If was_locked we're a handler, no recursion. */
-	was_locked = pthread_mutex_trylock(&vbi->event_mutex);
-
-	ehp = &vbi->handlers;
-
-	while ((eh = *ehp)) {
-		if (eh->handler == handler
-		    && eh->user_data == user_data) {
-			found = 1;
-
-			if (!event_mask) {
-				*ehp = eh->next;
-
-				if (vbi->next_handler == eh)
-					vbi->next_handler = eh->next;
-						/* in event send loop */
-				free(eh);
-
-				continue;
-			} else
-				eh->event_mask = event_mask;
-		}
-
-		mask |= eh->event_mask;	
-		ehp = &eh->next;
-	}
-
-	if (!found && event_mask) {
-		if (!(eh = (struct event_handler *) calloc(1, sizeof(*eh))))
-			return FALSE;
-
-		eh->event_mask = event_mask;
-		mask |= event_mask;
-
-		eh->handler = handler;
-		eh->user_data = user_data;
-
-		*ehp = eh;
-	}
-
-	vbi_event_enable(vbi, mask);
-
-	if (!was_locked)
-		pthread_mutex_unlock(&vbi->event_mutex);
-
-	return TRUE;
+	return event_handler_update(vbi, event_mask, handler, user_data,
+				    /* match_user_data */ TRUE);
 }
 
 /**
@@ -356,26 +520,489 @@ vbi_event_handler_unregister(vbi_decoder *vbi,
  * @param ev The event to send.
  * 
  * Traverses the list of event handlers and calls each handler waiting
-* * for this @a ev->type of event, passing @a ev as parameter.
+ * for this @a ev->type of event, passing @a ev as parameter.
  * 
  * This function is reentrant, but not supposed to be called from
- * different threads to ensure correct event order.
+ * different threads to ensure correct event order. It takes no
+ * locks, see struct event_handler_list.
  */
 void
 vbi_send_event(vbi_decoder *vbi, vbi_event *ev)
 {
-	struct event_handler *eh;
+	dispatcher_send(&vbi->handlers, ev);
+}
+
+/*
+ *  Event queue
+ */
+
+/* Points e->ev at the data copied into e. */
+static void
+event_queue_entry_link(struct event_queue_entry *e)
+{
+	switch (e->ev.type) {
+	case VBI_EVENT_TTX_PAGE:
+		if (NULL != e->ev.ev.ttx_page.raw_header)
+			e->ev.ev.ttx_page.raw_header = e->data.raw_header;
+		break;
+
+	case VBI_EVENT_TRIGGER:
+		e->ev.ev.trigger = &e->data.link;
+		break;
+
+	case VBI_EVENT_PROG_INFO:
+		e->ev.ev.prog_info = &e->data.prog_info;
+		break;
+
+	case VBI_EVENT_LOCAL_TIME:
+		e->ev.ev.local_time = &e->data.local_time;
+		break;
+
+	case VBI_EVENT_PROG_ID:
+		e->ev.ev.prog_id = &e->data.prog_id;
+		break;
+
+	default:
+		break;
+	}
+}
 
-	pthread_mutex_lock(&vbi->event_mutex);
+/* Copies ev and the data it points to, which is valid only
+   while the event is sent. */
+static void
+event_queue_entry_set(struct event_queue_entry *e, const vbi_event *ev)
+{
+	e->ev = *ev;
+
+	switch (ev->type) {
+	case VBI_EVENT_TTX_PAGE:
+		if (NULL != ev->ev.ttx_page.raw_header)
+			memcpy(e->data.raw_header,
+			       ev->ev.ttx_page.raw_header,
+			       sizeof(e->data.raw_header));
+		break;
+
+	case VBI_EVENT_TRIGGER:
+		e->data.link = *ev->ev.trigger;
+		break;
+
+	case VBI_EVENT_PROG_INFO:
+		e->data.prog_info = *ev->ev.prog_info;
+		break;
+
+	case VBI_EVENT_LOCAL_TIME:
+		e->data.local_time = *ev->ev.local_time;
+		break;
+
+	case VBI_EVENT_PROG_ID:
+		e->data.prog_id = *ev->ev.prog_id;
+		break;
+
+	default:
+		break;
+	}
 
-	for (eh = vbi->handlers; eh; eh = vbi->next_handler) {
-		vbi->next_handler = eh->next;
+	event_queue_entry_link(e);
+}
 
-		if (eh->event_mask & ev->type)
-			eh->handler(ev, eh->user_data);
+/* Merges a page event into a queued event of the same page, if any.
+   Not across a network event, the page may belong to another
+   network now. */
+static vbi_bool
+event_queue_coalesce(struct event_queue *q, const vbi_event *ev)
+{
+	unsigned int i;
+
+	if (VBI_EVENT_TTX_PAGE != ev->type
+	    && VBI_EVENT_CAPTION != ev->type)
+		return FALSE;
+
+	for (i = q->count; i-- > 0;) {
+		struct event_queue_entry *e;
+
+		e = &q->entries[(q->head + i) % q->capacity];
+
+		if (VBI_EVENT_NETWORK == e->ev.type
+		    || VBI_EVENT_NETWORK_ID == e->ev.type)
+			return FALSE;
+
+		if (e->ev.type != ev->type)
+			continue;
+
+		if (VBI_EVENT_CAPTION == ev->type) {
+			if (e->ev.ev.caption.pgno == ev->ev.caption.pgno)
+				return TRUE;
+			continue;
+		}
+
+		if (e->ev.ev.ttx_page.pgno != ev->ev.ttx_page.pgno
+		    || e->ev.ev.ttx_page.subno != ev->ev.ttx_page.subno)
+			continue;
+
+		/* The latest header, the rows changed by both. */
+		e->ev.ev.ttx_page.pn_offset = ev->ev.ttx_page.pn_offset;
+		e->ev.ev.ttx_page.roll_header = ev->ev.ttx_page.roll_header;
+		e->ev.ev.ttx_page.header_update |=
+			ev->ev.ttx_page.header_update;
+		e->ev.ev.ttx_page.clock_update |=
+			ev->ev.ttx_page.clock_update;
+		e->ev.ev.ttx_page.dirty_rows |= ev->ev.ttx_page.dirty_rows;
+
+		if (NULL != ev->ev.ttx_page.raw_header) {
+			memcpy(e->data.raw_header,
+			       ev->ev.ttx_page.raw_header,
+			       sizeof(e->data.raw_header));
+			e->ev.ev.ttx_page.raw_header = e->data.raw_header;
+		}
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Registered with vbi_event_handler_register(), called by the
+   decoding thread. */
+static void
+event_queue_handler(vbi_event *ev, void *user_data)
+{
+	struct event_queue *q = (struct event_queue *) user_data;
+
+	pthread_mutex_lock(&q->mutex);
+
+	/* May still be called after vbi_event_queue_stop(). */
+	if (!q->running || q->stop) {
+		pthread_mutex_unlock(&q->mutex);
+		return;
+	}
+
+	if (event_queue_coalesce(q, ev)) {
+		++q->coalesced;
+	} else if (q->count >= q->capacity) {
+		++q->dropped;
+	} else {
+		event_queue_entry_set(&q->entries[(q->head + q->count)
+						  % q->capacity], ev);
+		++q->count;
+
+		pthread_cond_signal(&q->cond);
+	}
+
+	pthread_mutex_unlock(&q->mutex);
+}
+
+static void *
+event_queue_thread(void *user_data)
+{
+	struct event_queue *q = (struct event_queue *) user_data;
+	struct event_queue_entry e;
+
+	pthread_mutex_lock(&q->mutex);
+
+	for (;;) {
+		while (0 == q->count && !q->stop)
+			pthread_cond_wait(&q->cond, &q->mutex);
+
+		/* Delivers pending events before stopping. */
+		if (0 == q->count)
+			break;
+
+		e = q->entries[q->head];
+		event_queue_entry_link(&e);
+
+		q->head = (q->head + 1) % q->capacity;
+		--q->count;
+
+		pthread_mutex_unlock(&q->mutex);
+
+		dispatcher_send(&q->handlers, &e.ev);
+
+		pthread_mutex_lock(&q->mutex);
+	}
+
+	pthread_mutex_unlock(&q->mutex);
+
+	return NULL;
+}
+
+/* Registers event_queue_handler() for the events the queued handlers
+   wait for. Call with q->handlers.mutex locked. */
+static vbi_bool
+event_queue_update_mask(vbi_decoder *vbi, struct event_queue *q)
+{
+	vbi_bool running;
+
+	pthread_mutex_lock(&q->mutex);
+	running = q->running;
+	pthread_mutex_unlock(&q->mutex);
+
+	if (!running)
+		return TRUE;
+
+	return vbi_event_handler_register(vbi, q->event_mask,
+					  event_queue_handler, q);
+}
+
+static void
+event_queue_delete(struct event_queue *q)
+{
+	if (NULL == q)
+		return;
+
+	dispatcher_destroy(&q->handlers);
+
+	pthread_cond_destroy(&q->cond);
+	pthread_mutex_destroy(&q->mutex);
+
+	free(q->entries);
+
+	CLEAR(*q);
+
+	free(q);
+}
+
+static struct event_queue *
+event_queue_new(void)
+{
+	struct event_queue *q;
+
+	q = (struct event_queue *) calloc(1, sizeof(*q));
+	if (NULL == q)
+		return NULL;
+
+	pthread_mutex_init(&q->mutex, NULL);
+	pthread_cond_init(&q->cond, NULL);
+
+	dispatcher_init(&q->handlers);
+
+	return q;
+}
+
+/**
+ * @param vbi Initialized vbi decoding context.
+ * @param max_events Maximum number of events waiting for delivery.
+ *
+ * Starts a thread which calls the handlers registered with
+ * vbi_event_handler_register_queued(). vbi_decode() merely adds the
+ * events to a queue, so slow handlers do not stall decoding. When
+ * the queue already holds a Teletext or Closed Caption event of the
+ * same page, and no network event after it, the events are merged.
+ * The dirty_rows, header_update and clock_update fields of merged
+ * Teletext events cover the changes of all of them. When the queue
+ * is full further events are discarded.
+ *
+ * Handlers registered with vbi_event_handler_register() are still
+ * called by vbi_decode(), in its thread.
+ *
+ * @return
+ * @c FALSE if out of memory or the thread could not be created.
+ * @c TRUE if the queue was already running.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_event_queue_start		(vbi_decoder *		vbi,
+				 unsigned int		max_events)
+{
+	struct event_queue *q;
+	struct event_queue_entry *entries;
+	vbi_bool success;
+
+	q = vbi->event_queue;
+	if (NULL == q) {
+		q = event_queue_new();
+		if (NULL == q)
+			return FALSE;
+
+		vbi->event_queue = q;
+	}
+
+	pthread_mutex_lock(&q->mutex);
+	success = q->running;
+	pthread_mutex_unlock(&q->mutex);
+
+	if (success)
+		return TRUE;
+
+	max_events = MAX(max_events, 1U);
+
+	entries = (struct event_queue_entry *)
+		malloc(max_events * sizeof(*entries));
+	if (NULL == entries)
+		return FALSE;
+
+	pthread_mutex_lock(&q->mutex);
+
+	free(q->entries);
+
+	q->entries = entries;
+	q->capacity = max_events;
+	q->head = 0;
+	q->count = 0;
+	q->stop = FALSE;
+
+	if (0 != pthread_create(&q->thread, NULL, event_queue_thread, q)) {
+		pthread_mutex_unlock(&q->mutex);
+		return FALSE;
+	}
+
+	q->running = TRUE;
+
+	pthread_mutex_unlock(&q->mutex);
+
+	pthread_mutex_lock(&q->handlers.mutex);
+	success = event_queue_update_mask(vbi, q);
+	pthread_mutex_unlock(&q->handlers.mutex);
+
+	return success;
+}
+
+/**
+ * @param vbi Initialized vbi decoding context.
+ *
+ * Delivers all events waiting in the queue, then stops the thread
+ * started by vbi_event_queue_start(). Queued handlers remain
+ * registered and receive events again when the queue is restarted.
+ * Do not call this function from a queued handler.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_event_queue_stop		(vbi_decoder *		vbi)
+{
+	struct event_queue *q;
+
+	q = vbi->event_queue;
+	if (NULL == q)
+		return;
+
+	pthread_mutex_lock(&q->mutex);
+
+	if (!q->running || q->stop) {
+		pthread_mutex_unlock(&q->mutex);
+		return;
+	}
+
+	q->stop = TRUE;
+	pthread_cond_signal(&q->cond);
+
+	pthread_mutex_unlock(&q->mutex);
+
+	vbi_event_handler_unregister(vbi, event_queue_handler, q);
+
+	pthread_join(q->thread, NULL);
+
+	pthread_mutex_lock(&q->mutex);
+	q->running = FALSE;
+	pthread_mutex_unlock(&q->mutex);
+}
+
+/**
+ * @param vbi Initialized vbi decoding context.
+ * @param depth The number of events waiting in the queue is stored
+ *   here. Can be @c NULL.
+ * @param dropped The number of events discarded because the queue
+ *   was full is stored here. Can be @c NULL.
+ * @param coalesced The number of events merged with an event
+ *   waiting in the queue is stored here. Can be @c NULL.
+ *
+ * Returns statistics of the event queue, see vbi_event_queue_start().
+ * The counters are not reset when the queue restarts.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_event_queue_get_stats	(vbi_decoder *		vbi,
+				 unsigned int *		depth,
+				 unsigned int *		dropped,
+				 unsigned int *		coalesced)
+{
+	struct event_queue *q;
+	unsigned int d = 0, dr = 0, co = 0;
+
+	q = vbi->event_queue;
+	if (NULL != q) {
+		pthread_mutex_lock(&q->mutex);
+
+		d = q->count;
+		dr = q->dropped;
+		co = q->coalesced;
+
+		pthread_mutex_unlock(&q->mutex);
 	}
 
-	pthread_mutex_unlock(&vbi->event_mutex);
+	if (NULL != depth)
+		*depth = d;
+	if (NULL != dropped)
+		*dropped = dr;
+	if (NULL != coalesced)
+		*coalesced = co;
+}
+
+/**
+ * @param vbi Initialized vbi decoding context.
+ * @param event_mask Events the handler is waiting for.
+ * @param handler Event handler function.
+ * @param user_data Pointer passed to the handler.
+ *
+ * Like vbi_event_handler_register(), but the @a handler will be
+ * called by the thread started with vbi_event_queue_start(), with a
+ * copy of the event. Queued handlers can register and unregister
+ * handlers.
+ *
+ * @return
+ * @c FALSE on failure, or if vbi_event_queue_start() was never called.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_event_handler_register_queued
+				(vbi_decoder *		vbi,
+				 int			event_mask,
+				 vbi_event_handler	handler,
+				 void *			user_data)
+{
+	struct event_queue *q;
+	vbi_bool success;
+
+	q = vbi->event_queue;
+	if (NULL == q)
+		return FALSE;
+
+	pthread_mutex_lock(&q->handlers.mutex);
+
+	success = dispatcher_update(&q->handlers, event_mask,
+				    handler, user_data,
+				    /* match_user_data */ TRUE,
+				    &q->event_mask);
+
+	if (!event_queue_update_mask(vbi, q))
+		success = FALSE;
+
+	pthread_mutex_unlock(&q->handlers.mutex);
+
+	return success;
+}
+
+/**
+ * @param vbi Initialized vbi decoding context.
+ * @param handler Event handler function.
+ * @param user_data Pointer passed to the handler.
+ *
+ * Unregisters an event handler registered with
+ * vbi_event_handler_register_queued(). When called from another
+ * thread than a queued handler, the function waits until the
+ * @a handler returns.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_event_handler_unregister_queued
+				(vbi_decoder *		vbi,
+				 vbi_event_handler	handler,
+				 void *			user_data)
+{
+	vbi_event_handler_register_queued(vbi, 0, handler, user_data);
 }
 
 /*
@@ -425,41 +1052,44 @@ vbi_decode(vbi_decoder *vbi, vbi_sliced *sliced, int lines, double time)
 	d = time - vbi->time;
 
 	if (vbi->time > 0 && (d < 0.025 || d > 0.050)) {
+	  int zero = 0;
+
 	  /*
 	   *  Since (dropped >= channel switch) we give
 	   *  ~1.5 s, then assume a switch.
 	   */
-	  pthread_mutex_lock(&vbi->chswcd_mutex);
-
-	  if (vbi->chswcd == 0)
-		  vbi->chswcd = 40;
-
-	  pthread_mutex_unlock(&vbi->chswcd_mutex);
+	  __atomic_compare_exchange_n(&vbi->chswcd, &zero, 40,
+				      /* weak */ FALSE,
+				      __ATOMIC_RELAXED, __ATOMIC_RELAXED);
 
 	  if (0)
 		  fprintf(stderr, "vbi frame/s dropped at %f, D=%f\n",
 			  time, time - vbi->time);
 
-	  if (vbi->event_mask & (VBI_EVENT_TTX_PAGE |
+	  if (_vbi_event_mask(vbi) & (VBI_EVENT_TTX_PAGE |
 				 VBI_EVENT_NETWORK |
 				 VBI_EVENT_NETWORK_ID |
 				 VBI_EVENT_LOCAL_TIME |
 				 VBI_EVENT_PROG_ID))
 		  vbi_teletext_desync(vbi);
-	  if (vbi->event_mask & (VBI_EVENT_CAPTION |
+	  if (_vbi_event_mask(vbi) & (VBI_EVENT_CAPTION |
 				 VBI_EVENT_NETWORK |
 				 VBI_EVENT_NETWORK_ID |
 				 VBI_EVENT_LOCAL_TIME |
 				 VBI_EVENT_PROG_ID))
 		  vbi_caption_desync(vbi);
 	} else {
-		pthread_mutex_lock(&vbi->chswcd_mutex);
-		
-		if (vbi->chswcd > 0 && --vbi->chswcd == 0) {
-			pthread_mutex_unlock(&vbi->chswcd_mutex);
+		int n;
+
+		/* vbi_channel_switched() may set chswcd concurrently. */
+		n = __atomic_load_n(&vbi->chswcd, __ATOMIC_RELAXED);
+		while (n > 0 && !__atomic_compare_exchange_n
+		       (&vbi->chswcd, &n, n - 1, /* weak */ TRUE,
+			__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			;
+
+		if (1 == n)
 			vbi_chsw_reset(vbi, 0);
-		} else
-			pthread_mutex_unlock(&vbi->chswcd_mutex);
 	}
 
 	if (time > vbi->time)
@@ -481,7 +1111,7 @@ vbi_decode(vbi_decoder *vbi, vbi_sliced *sliced, int lines, double time)
 		lines--;
 	}
 
-	if (vbi->event_mask & VBI_EVENT_TRIGGER)
+	if (_vbi_event_mask(vbi) & VBI_EVENT_TRIGGER)
 		vbi_deferred_trigger(vbi);
 
 	if (0 && (rand() % 511) == 0)
@@ -548,11 +1178,7 @@ vbi_chsw_reset(vbi_decoder *vbi, vbi_nuid identified)
 
 	vbi->vt.header_page.pgno = 0;
 
-	pthread_mutex_lock(&vbi->chswcd_mutex);
-
-	vbi->chswcd = 0;
-
-	pthread_mutex_unlock(&vbi->chswcd_mutex);
+	__atomic_store_n(&vbi->chswcd, 0, __ATOMIC_RELAXED);
 }
 
 /**
@@ -581,11 +1207,7 @@ vbi_channel_switched(vbi_decoder *vbi, vbi_nuid nuid)
 
 	nuid = nuid;
 
-	pthread_mutex_lock(&vbi->chswcd_mutex);
-
-	vbi->chswcd = 1;
-
-	pthread_mutex_unlock(&vbi->chswcd_mutex);
+	__atomic_store_n(&vbi->chswcd, 1, __ATOMIC_RELAXED);
 }
 
 static inline int
@@ -723,7 +1345,7 @@ vbi_page_type
 vbi_classify_page(vbi_decoder *vbi, vbi_pgno pgno,
 		  vbi_subno *subno, char **language)
 {
-	struct ttx_page_stat *ps;
+	struct ttx_page_stat ps;
 	int code, subc;
 	char *lang;
 
@@ -738,29 +1360,34 @@ vbi_classify_page(vbi_decoder *vbi, vbi_pgno pgno,
 	if (pgno < 1) {
 		return VBI_UNKNOWN_PAGE;
 	} else if (pgno <= 8) {
-		if ((current_time() - vbi->cc.channel[pgno - 1].time) > 20)
+		if (NULL == vbi->cc
+		    || (current_time() - vbi->cc->channel[pgno - 1].time) > 20)
 			return VBI_NO_PAGE;
 
-		*language = (char *) vbi->cc.channel[pgno - 1].language;
+		*language = (char *) vbi->cc->channel[pgno - 1].language;
 
 		return (pgno <= 4) ? VBI_SUBTITLE_PAGE : VBI_NORMAL_PAGE;
 	} else if (pgno < 0x100 || pgno > 0x8FF) {
 		return VBI_UNKNOWN_PAGE;
 	}
 
-	ps = cache_network_page_stat (vbi->cn, pgno);
-	code = ps->page_type;
+	/* The decoder updates the statistics with the cache locked. */
+	pthread_mutex_lock(&vbi->ca->mutex);
+	ps = *cache_network_const_page_stat (vbi->cn, pgno);
+	pthread_mutex_unlock(&vbi->ca->mutex);
+
+	code = ps.page_type;
 
 	if (code != VBI_UNKNOWN_PAGE) {
 		if (code == VBI_SUBTITLE_PAGE) {
-			if (ps->charset_code != 0xFF)
-				*language = vbi_font_descriptors[ps->charset_code].label;
+			if (ps.charset_code != 0xFF)
+				*language = vbi_font_descriptors[ps.charset_code].label;
 		} else if (code == VBI_TOP_BLOCK || code == VBI_TOP_GROUP)
 			code = VBI_NORMAL_PAGE;
 		else if (code == VBI_NOT_PUBLIC || code > 0xE0)
 			return VBI_UNKNOWN_PAGE;
 
-		*subno = ps->subcode;
+		*subno = ps.subcode;
 
 		return code;
 	}
@@ -831,43 +1458,36 @@ vbi_reset_prog_info(vbi_program_info *pi)
 void
 vbi_decoder_delete(vbi_decoder *vbi)
 {
-	struct event_handler *eh;
-
 	if (NULL == vbi)
 		return;
 
+	vbi_event_queue_stop(vbi);
+	event_queue_delete(vbi->event_queue);
+
 	vbi_trigger_flush(vbi);
 
 	vbi_caption_destroy(vbi);
 
-	while (NULL != (eh = vbi->handlers)) {
-		vbi_event_handler_unregister (vbi,
-					      eh->handler,
-					      eh->user_data);
-	}
+	dispatcher_destroy(&vbi->handlers);
 
 	pthread_mutex_destroy(&vbi->prog_info_mutex);
-	pthread_mutex_destroy(&vbi->event_mutex);
-	pthread_mutex_destroy(&vbi->chswcd_mutex);
+
+	vbi_teletext_destroy(vbi);
 
 	cache_network_unref (vbi->cn);
 
-	vbi_cache_delete (vbi->ca);
+	vbi_cache_unref (vbi->ca);
 
 	CLEAR (*vbi);
 
 	free (vbi);
 }
 
-/**
- * @brief Allocate a new data service decoder instance.
- * 
- * @return
- * vbi_decoder pointer or @c NULL on failure, probably due to lack
- * of memory.
- */
-vbi_decoder *
-vbi_decoder_new(void)
+/* ca: Cache to share or NULL to allocate a new one.
+   caption: Whether the decoder shall decode Closed Caption. */
+static vbi_decoder *
+decoder_new			(vbi_cache *		ca,
+				 vbi_bool		caption)
 {
 	vbi_decoder *vbi;
 
@@ -877,7 +1497,10 @@ vbi_decoder_new(void)
 	if (NULL == vbi)
 		goto failed;
 
-	vbi->ca = vbi_cache_new ();
+	if (NULL != ca)
+		vbi->ca = vbi_cache_ref (ca);
+	else
+		vbi->ca = vbi_cache_new ();
 	if (NULL == vbi->ca)
 		goto failed;
 
@@ -887,8 +1510,7 @@ vbi_decoder_new(void)
 	if (NULL == vbi->cn)
 		goto failed;
 
-	pthread_mutex_init(&vbi->chswcd_mutex, NULL);
-	pthread_mutex_init(&vbi->event_mutex, NULL);
+	dispatcher_init(&vbi->handlers);
 	pthread_mutex_init(&vbi->prog_info_mutex, NULL);
 
 	vbi->time = 0.0;
@@ -900,7 +1522,10 @@ vbi_decoder_new(void)
 
 	vbi_teletext_set_level(vbi, VBI_WST_LEVEL_2p5);
 
-	vbi_caption_init(vbi);
+	if (caption && !vbi_caption_init(vbi)) {
+		vbi_decoder_delete(vbi);
+		return NULL;
+	}
 
 	return vbi;
 
@@ -908,7 +1533,7 @@ vbi_decoder_new(void)
 	if (NULL != vbi) {
 		cache_network_unref (vbi->cn);
 
-		vbi_cache_delete (vbi->ca);
+		vbi_cache_unref (vbi->ca);
 
 		CLEAR (*vbi);
 
@@ -918,6 +1543,260 @@ vbi_decoder_new(void)
 	return NULL;
 }
 
+/**
+ * @brief Allocate a new data service decoder instance.
+ * 
+ * @return
+ * vbi_decoder pointer or @c NULL on failure, probably due to lack
+ * of memory.
+ */
+vbi_decoder *
+vbi_decoder_new(void)
+{
+	return decoder_new (/* ca */ NULL, /* caption */ TRUE);
+}
+
+/* Returns the index of the stream with stream_id, or if none the
+   index where to insert it. */
+static unsigned int
+multi_stream_index		(const vbi_multi_decoder *md,
+				 unsigned int		stream_id)
+{
+	unsigned int first, last;
+
+	first = 0;
+	last = md->n_streams;
+
+	while (first < last) {
+		unsigned int mid = (first + last) / 2;
+
+		if (md->streams[mid].id < stream_id)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	return first;
+}
+
+/**
+ * @param md Multi-stream decoder allocated with vbi_multi_decoder_new().
+ * @param stream_id Stream identifier.
+ *
+ * @return
+ * The decoder of the stream with @a stream_id, or @c NULL if no such
+ * stream has been added to @a md.
+ *
+ * @since 0.2.36
+ */
+vbi_decoder *
+vbi_multi_decoder_get_stream	(vbi_multi_decoder *	md,
+				 unsigned int		stream_id)
+{
+	unsigned int i;
+
+	/* No lookup hint, streams may be decoded in different threads. */
+	i = multi_stream_index (md, stream_id);
+	if (i >= md->n_streams || md->streams[i].id != stream_id)
+		return NULL;
+
+	return md->streams[i].vbi;
+}
+
+/**
+ * @param md Multi-stream decoder allocated with vbi_multi_decoder_new().
+ * @param stream_id Stream identifier, for example the PID of a DVB
+ *   Teletext elementary stream.
+ * @param sliced Array of vbi_sliced data packets of one stream.
+ * @param lines Number of vbi_sliced data packets.
+ * @param timestamp Capture time of the sliced data, as with vbi_decode().
+ *   Each stream keeps its own time.
+ *
+ * Decodes sliced VBI data of one stream like vbi_decode(), calling
+ * the event handlers registered with the decoder of this stream.
+ *
+ * @return
+ * @c FALSE if no stream with @a stream_id has been added to @a md.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_multi_decode		(vbi_multi_decoder *	md,
+				 unsigned int		stream_id,
+				 vbi_sliced *		sliced,
+				 int			lines,
+				 double			timestamp)
+{
+	vbi_decoder *vbi;
+
+	vbi = vbi_multi_decoder_get_stream (md, stream_id);
+	if (NULL == vbi)
+		return FALSE;
+
+	vbi_decode (vbi, sliced, lines, timestamp);
+
+	return TRUE;
+}
+
+/**
+ * @param md Multi-stream decoder allocated with vbi_multi_decoder_new().
+ * @param stream_id Stream identifier.
+ *
+ * Deletes the decoder of the stream with @a stream_id, if any.
+ *
+ * Like libzvbi 0.2 in general the cache keeps the pages of at most
+ * one network no decoder uses. So when other streams remain, the
+ * pages of this stream are deleted right away. Otherwise, or if the
+ * client still references pages of the stream, the pages stay in
+ * the cache. They are deleted before the pages of other streams when
+ * the cache runs out of memory, and all at once when the cache needs
+ * room for the network of a stream added later.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_multi_decoder_remove_stream	(vbi_multi_decoder *	md,
+				 unsigned int		stream_id)
+{
+	unsigned int i;
+
+	i = multi_stream_index (md, stream_id);
+	if (i >= md->n_streams || md->streams[i].id != stream_id)
+		return;
+
+	vbi_decoder_delete (md->streams[i].vbi);
+
+	memmove (&md->streams[i], &md->streams[i + 1],
+		 (md->n_streams - i - 1) * sizeof (*md->streams));
+
+	--md->n_streams;
+}
+
+/**
+ * @param md Multi-stream decoder allocated with vbi_multi_decoder_new().
+ * @param stream_id Stream identifier, for example the PID of a DVB
+ *   Teletext elementary stream.
+ *
+ * Adds a stream to the multi-stream decoder. The decoder of the
+ * stream shares the page cache of @a md with all other streams, and
+ * it ignores Closed Caption data. Use the returned decoder to
+ * register event handlers and to fetch pages of this stream.
+ * Functions changing the cache, for example vbi_set_cache_memory_limit(),
+ * affect all streams. Do not delete the decoder with
+ * vbi_decoder_delete(), call vbi_multi_decoder_remove_stream()
+ * instead.
+ *
+ * Adding and removing streams is not reentrant. Different streams
+ * can be decoded in different threads.
+ *
+ * @return
+ * The decoder of the stream, @c NULL if out of memory. If a stream
+ * with this @a stream_id already exists the function returns its
+ * decoder.
+ *
+ * @since 0.2.36
+ */
+vbi_decoder *
+vbi_multi_decoder_add_stream	(vbi_multi_decoder *	md,
+				 unsigned int		stream_id)
+{
+	vbi_decoder *vbi;
+	unsigned int i;
+
+	i = multi_stream_index (md, stream_id);
+	if (i < md->n_streams && md->streams[i].id == stream_id)
+		return md->streams[i].vbi;
+
+	if (md->n_streams >= md->capacity) {
+		struct vbi_multi_stream *streams;
+		unsigned int capacity;
+
+		capacity = MAX (md->capacity * 2, 16U);
+		streams = realloc (md->streams,
+				   capacity * sizeof (*streams));
+		if (NULL == streams)
+			return NULL;
+
+		md->streams = streams;
+		md->capacity = capacity;
+	}
+
+	vbi = decoder_new (md->ca, /* caption */ FALSE);
+	if (NULL == vbi)
+		return NULL;
+
+	memmove (&md->streams[i + 1], &md->streams[i],
+		 (md->n_streams - i) * sizeof (*md->streams));
+
+	md->streams[i].id = stream_id;
+	md->streams[i].vbi = vbi;
+
+	++md->n_streams;
+
+	return vbi;
+}
+
+/**
+ * @param md Multi-stream decoder allocated with vbi_multi_decoder_new(),
+ *   can be @c NULL.
+ *
+ * Deletes the decoders of all streams and the shared cache.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_multi_decoder_delete	(vbi_multi_decoder *	md)
+{
+	unsigned int i;
+
+	if (NULL == md)
+		return;
+
+	for (i = 0; i < md->n_streams; ++i)
+		vbi_decoder_delete (md->streams[i].vbi);
+
+	free (md->streams);
+
+	vbi_cache_unref (md->ca);
+
+	CLEAR (*md);
+
+	free (md);
+}
+
+/**
+ * @brief Allocate a new multi-stream data service decoder.
+ *
+ * A multi-stream decoder decodes the Teletext, VPS and WSS data
+ * of many streams at once, for example all DVB services of a
+ * transponder. All streams share one page cache, the state of
+ * each stream is much smaller than a vbi_decoder of its own.
+ * Add streams with vbi_multi_decoder_add_stream() and feed data
+ * with vbi_multi_decode().
+ *
+ * @return
+ * vbi_multi_decoder pointer or @c NULL if out of memory.
+ *
+ * @since 0.2.36
+ */
+vbi_multi_decoder *
+vbi_multi_decoder_new		(void)
+{
+	vbi_multi_decoder *md;
+
+	md = (vbi_multi_decoder *) calloc (1, sizeof (*md));
+	if (NULL == md)
+		return NULL;
+
+	md->ca = vbi_cache_new ();
+	if (NULL == md->ca) {
+		free (md);
+		return NULL;
+	}
+
+	return md;
+}
+
 /**
  * @ingroup Basic
  *
@@ -981,11 +1860,138 @@ int
 vbi_cache_hi_subno		(vbi_decoder *		vbi,
 				 int			pgno)
 {
-	const struct ttx_page_stat *ps;
+	int subno_max;
+
+	pthread_mutex_lock (&vbi->ca->mutex);
+	subno_max = cache_network_const_page_stat (vbi->cn, pgno)->subno_max;
+	pthread_mutex_unlock (&vbi->ca->mutex);
+
+	return subno_max;
+}
+
+/**
+ * @param vbi Initialized vbi_decoder context.
+ * @param pgno Page number.
+ * @param subno Subpage number 0x01 ... 0x79.
+ * @param time The predicted time is stored here.
+ *
+ * Networks transmit the subpages of a page in rotation, one
+ * after another. This function predicts when subpage @a subno
+ * will be received next, so applications can wait for it instead
+ * of polling the cache. The time is in the time base of the
+ * vbi_decode() timestamps, counting from the subpage received
+ * last, so it may lie in the past when the page is no longer
+ * transmitted.
+ *
+ * @returns
+ * @c FALSE if the page has no subpages or the decoder has not
+ * seen enough subpages to tell.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_cache_predict_subpage	(vbi_decoder *		vbi,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 double *		time)
+{
+	return _vbi_cache_predict_subpage (vbi->ca, vbi->cn,
+					   pgno, subno, time);
+}
+
+/**
+ * @param vbi Initialized vbi_decoder context.
+ * @param file_name Name of the file to create or replace.
+ *
+ * Saves the Teletext pages of the current network in the cache,
+ * and what the decoder learned about the Teletext service, in
+ * a file. You can load it with vbi_load_cache() when the application
+ * restarts to display pages before they have been received again.
+ *
+ * The file format depends on the version of libzvbi and the
+ * machine architecture.
+ *
+ * @returns
+ * @c FALSE on failure (out of memory or I/O error).
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_save_cache			(vbi_decoder *		vbi,
+				 const char *		file_name)
+{
+	return _vbi_cache_save_network (vbi->ca, vbi->cn, file_name);
+}
 
-	ps = cache_network_const_page_stat (vbi->cn, pgno);
+/**
+ * @param vbi Initialized vbi_decoder context.
+ * @param file_name Name of a file created by vbi_save_cache().
+ *
+ * Loads a Teletext cache snapshot into the current network, which
+ * should be the network the snapshot was saved from. Call this
+ * function after vbi_decoder_new() or vbi_channel_switched(), not
+ * while another thread calls vbi_decode().
+ *
+ * The file is mapped into memory and pages are copied into the cache
+ * when vbi_fetch_vt_page() or another function requests them first,
+ * unless a newer version has been received in the meantime. A
+ * channel switch discards pages not requested yet.
+ *
+ * @returns
+ * @c FALSE if the file could not be opened, is damaged or
+ * incompatible, or if the snapshot belongs to a different network.
+ *
+ * @since 0.2.36
+ */
+vbi_bool
+vbi_load_cache			(vbi_decoder *		vbi,
+				 const char *		file_name)
+{
+	return _vbi_cache_load_network (vbi->ca, vbi->cn, file_name);
+}
 
-	return ps->subno_max;
+/**
+ * @param vbi Initialized vbi_decoder context.
+ * @param limit Amount of memory in bytes.
+ *
+ * Limits the amount of memory used by the Teletext page cache of
+ * this decoder. Reasonable values range from 16 KB to 1 GB, the
+ * default is 1 GB. Expect on the order of one or two megabytes for
+ * a complete set of pages.
+ *
+ * When the cache is full newly received pages replace the oldest
+ * pages, pages of a magazine start, subpages, objects and
+ * navigation pages last. Pages referenced by the client do not
+ * count. DRCS pages are never deleted to make room for other pages
+ * because a vbi_page refers to their data, so they do not count
+ * either.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_set_cache_memory_limit	(vbi_decoder *		vbi,
+				 unsigned long		limit)
+{
+	_vbi_cache_set_memory_limit (vbi->ca, limit);
+}
+
+/**
+ * @param vbi Initialized vbi_decoder context.
+ * @param enable @c TRUE to enable compression.
+ *
+ * Stores Teletext pages in the cache of this decoder which are not
+ * in use in a compact form, so more pages fit within the memory
+ * limit set with vbi_set_cache_memory_limit(). Pages are expanded
+ * again when requested, at the cost of some CPU time. Compression
+ * is disabled by default.
+ *
+ * @since 0.2.36
+ */
+void
+vbi_set_cache_compression	(vbi_decoder *		vbi,
+				 vbi_bool		enable)
+{
+	_vbi_cache_set_compression (vbi->ca, enable);
 }
 
 /*
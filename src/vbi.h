@@ -37,18 +37,94 @@
 #include "trigger.h"
 #include "pfc_demux.h"
 #include "pdc.h"
+#include "event-priv.h"
 
 struct event_handler {
+	/* Chain of removed handlers, see struct event_handler_list. */
 	struct event_handler *	next;
+	/* Accessed atomically, zero when the handler was removed. */
 	int			event_mask;
+	/* Number of calls of this handler in progress, atomic. */
+	int			running;
+	/* Atomic, TRUE if a registration function waits
+	   until running drops to zero. */
+	int			waiting;
 	vbi_event_handler	handler;
 	void *			user_data;
 };
 
+/* Handlers are not added or removed in place. Registration functions
+   build a new list and publish it with an atomic pointer store, so
+   the dispatcher needs no lock to call handlers. Replaced lists are
+   freed when no call is in progress. */
+struct event_handler_list {
+	/* Next list waiting to be freed. */
+	struct event_handler_list *next;
+	/* Handlers removed when this list was replaced, freed with it. */
+	struct event_handler *	removed;
+	unsigned int		n_handlers;
+	struct event_handler *	handlers[1];
+};
+
+/* The handlers called by vbi_send_event(), or by the event queue
+   thread. */
+struct event_dispatcher {
+	/* Serializes handler registration, not held while calling
+	   handlers. */
+	pthread_mutex_t		mutex;
+	/* Signals when a removed handler returned, with mutex. */
+	pthread_cond_t		cond;
+	/* Current handlers, accessed atomically. */
+	struct event_handler_list *list;
+	/* Number of handler list traversals in progress, atomic. */
+	int			dispatching;
+	/* Replaced handler lists, written with mutex locked,
+	   read atomically by the dispatcher. */
+	struct event_handler_list *retired;
+};
+
+/* A copy of an event and the data it points to. */
+struct event_queue_entry {
+	vbi_event		ev;
+	union {
+		uint8_t			raw_header[40];
+		vbi_link		link;
+		vbi_program_info	prog_info;
+		vbi_local_time		local_time;
+		vbi_program_id		prog_id;
+	}			data;
+};
+
+/* Delivers events to the queued handlers in a thread of its own,
+   see vbi_event_queue_start(). */
+struct event_queue {
+	/* Protects the following fields up to handlers. */
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;
+
+	pthread_t		thread;
+	vbi_bool		running;
+	vbi_bool		stop;
+
+	/* Ring buffer. */
+	struct event_queue_entry *entries;
+	unsigned int		capacity;
+	unsigned int		head;
+	unsigned int		count;
+
+	unsigned int		dropped;
+	unsigned int		coalesced;
+
+	/* Queued handlers, the thread calls them with no lock held. */
+	struct event_dispatcher	handlers;
+	/* Events the queued handlers wait for, with handlers.mutex. */
+	int			event_mask;
+};
+
 struct vbi_decoder {
 	double			time;
 
-	pthread_mutex_t		chswcd_mutex;
+	/* Channel switch countdown, accessed atomically. */
         int                     chswcd;
 
 	vbi_event		network;
@@ -63,7 +139,8 @@ struct vbi_decoder {
 	int			contrast;
 
 	struct teletext		vt;
-	struct caption		cc;
+	/* NULL if the decoder ignores Closed Caption. */
+	struct caption *	cc;
 
 	cache_network *		cn;
 
@@ -74,10 +151,12 @@ struct vbi_decoder {
 	/* preliminary */
 	int			pageref;
 
-	pthread_mutex_t		event_mutex;
+	struct event_dispatcher	handlers;
+	/* Events the handlers wait for, with handlers.mutex. */
 	int			event_mask;
-	struct event_handler *	handlers;
-	struct event_handler *	next_handler;
+
+	/* NULL if vbi_event_queue_start() was never called. */
+	struct event_queue *	event_queue;
 
 	unsigned char		wss_last[2];
 	int			wss_rep_ct;
@@ -97,6 +176,21 @@ struct vbi_decoder {
 typedef struct vbi_decoder vbi_decoder;
 #endif
 
+struct vbi_multi_stream {
+	unsigned int		id;
+	vbi_decoder *		vbi;
+};
+
+struct vbi_multi_decoder {
+	/* Shared by all streams. */
+	vbi_cache *		ca;
+
+	/* Sorted by id. */
+	struct vbi_multi_stream *streams;
+	unsigned int		n_streams;
+	unsigned int		capacity;
+};
+
 /*
  *  vbi_page_type, the page identification codes,
  *  are derived from the MIP code scheme:
@@ -127,6 +221,14 @@ typedef struct vbi_decoder vbi_decoder;
 
 /* Public */
 
+/**
+ * @ingroup HiDec
+ * @brief Opaque multi-stream data service decoder object.
+ *
+ * Allocate with vbi_multi_decoder_new().
+ */
+typedef struct vbi_multi_decoder vbi_multi_decoder;
+
 /**
  * @ingroup HiDec
  * @brief Page classification.
@@ -186,6 +288,25 @@ extern void
 vbi_set_log_fn			(vbi_log_mask		mask,
 				 vbi_log_fn *		log_fn,
 				 void *			user_data);
+extern vbi_multi_decoder *
+vbi_multi_decoder_new		(void);
+extern void
+vbi_multi_decoder_delete	(vbi_multi_decoder *	md);
+extern vbi_decoder *
+vbi_multi_decoder_add_stream	(vbi_multi_decoder *	md,
+				 unsigned int		stream_id);
+extern void
+vbi_multi_decoder_remove_stream	(vbi_multi_decoder *	md,
+				 unsigned int		stream_id);
+extern vbi_decoder *
+vbi_multi_decoder_get_stream	(vbi_multi_decoder *	md,
+				 unsigned int		stream_id);
+extern vbi_bool
+vbi_multi_decode		(vbi_multi_decoder *	md,
+				 unsigned int		stream_id,
+				 vbi_sliced *		sliced,
+				 int			lines,
+				 double			timestamp);
 /** @} */
 
 /* Private */
@@ -196,6 +317,14 @@ extern void		vbi_init(void);
 extern void		vbi_transp_colormap(vbi_decoder *vbi, vbi_rgba *d, vbi_rgba *s, int entries);
 extern void             vbi_chsw_reset(vbi_decoder *vbi, vbi_nuid nuid);
 
+/* The event mask of the handlers, which may be registered in
+   another thread than the decoding thread. */
+_vbi_inline int
+_vbi_event_mask(const vbi_decoder *vbi)
+{
+	return __atomic_load_n(&vbi->event_mask, __ATOMIC_RELAXED);
+}
+
 #endif /* VBI_H */
 
 /*
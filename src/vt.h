@@ -609,6 +609,16 @@ struct ttx_page_stat {
 	/** Subpage numbers actually received (0x00 ... 0x79). */
 	uint8_t				subno_min;
 	uint8_t				subno_max;
+
+	/**
+	 * Subpage rotation: the subpage 0x01 ... 0x79 received
+	 * last (zero if none), the time it was first received, and the
+	 * average time from one subpage to the next in seconds, zero
+	 * if unknown. See _vbi_cache_predict_subpage().
+	 */
+	uint8_t				last_subno;
+	float				interval;
+	double				last_time;
 };
 
 #endif /* VT_H */
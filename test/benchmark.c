@@ -0,0 +1,525 @@
+/*
+ *  libzvbi -- Raw VBI decoder benchmark
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+/* $Id$ */
+
+/* For libzvbi version 0.2.x. */
+
+/* Synthesizes raw VBI images with the io-sim signal generator,
+   decodes them with vbi3_raw_decoder_decode() and the sliced data
+   with vbi_decode(), and prints the throughput as CSV, one line per
+   pixel format, data services, sampling rate and noise level. */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>		/* optarg */
+#include <assert.h>
+#include <sys/time.h>		/* gettimeofday() */
+#ifdef HAVE_GETOPT_LONG
+#  include <getopt.h>
+#endif
+
+#include "src/raw_decoder.h"
+#include "src/io-sim.h"
+#include "src/hamm.h"
+#include "src/vbi.h"
+
+#undef _
+#define _(x) x /* i18n TODO */
+
+#define PROGRAM_NAME "benchmark"
+
+#define N_ELEMENTS(array) (sizeof (array) / sizeof (*(array)))
+#define VBI_PIXFMT_IS_YUV(pf) (0 != (VBI_PIXFMT_SET (pf)		\
+				       & VBI_PIXFMT_SET_YUV))
+
+/* Number of different raw images per test case,
+   decoded in rotation. */
+#define N_RAW_FRAMES 25
+
+static unsigned int		option_n_frames = 500;
+static unsigned int		option_n_threads = 1;
+
+typedef struct {
+	const char *		name;
+	vbi_pixfmt		pixfmt;
+} pixfmt_case;
+
+static const pixfmt_case
+pixfmt_cases [] = {
+	{ "y8",			VBI_PIXFMT_YUV420 },
+	{ "yuyv",		VBI_PIXFMT_YUYV },
+	{ "rgba32",		VBI_PIXFMT_RGBA32_LE },
+};
+
+typedef struct {
+	const char *		name;
+	vbi_service_set		services;
+	int			scanning;
+} service_case;
+
+static const service_case
+service_cases [] = {
+	{ "ttx",		VBI_SLICED_TELETEXT_B_625, 625 },
+	{ "ttx+vps+wss+cc",	(VBI_SLICED_TELETEXT_B_625 |
+				 VBI_SLICED_VPS |
+				 VBI_SLICED_WSS_625 |
+				 VBI_SLICED_CAPTION_625), 625 },
+	{ "cc",			VBI_SLICED_CAPTION_525, 525 },
+};
+
+static const int
+sampling_rates [] = {
+	13500000,
+	27000000,
+};
+
+/* vbi_raw_add_noise() amplitude, Y8 only. */
+static const unsigned int
+noise_levels [] = {
+	0,
+	25,
+};
+
+static unsigned long		n_events;
+
+static void
+event_handler			(vbi_event *		ev,
+				 void *			user_data)
+{
+	ev = ev; /* unused */
+	user_data = user_data;
+
+	++n_events;
+}
+
+static double
+now				(void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec * (1 / 1e6);
+}
+
+/* A Teletext page on magazine 1, a different page every frame. */
+static void
+teletext_packet			(uint8_t		buffer[42],
+				 unsigned int		frame,
+				 unsigned int		row)
+{
+	unsigned int page;
+	unsigned int i;
+
+	buffer[0] = vbi_ham8 (1 + ((row & 1) << 3));
+	buffer[1] = vbi_ham8 (row >> 1);
+
+	i = 2;
+
+	if (0 == row) {
+		page = frame % 100;
+
+		buffer[2] = vbi_ham8 (page % 10);
+		buffer[3] = vbi_ham8 (page / 10);
+		buffer[4] = vbi_ham8 (0); /* subcode */
+		buffer[5] = vbi_ham8 (0);
+		buffer[6] = vbi_ham8 (0);
+		buffer[7] = vbi_ham8 (0);
+		buffer[8] = vbi_ham8 (0); /* control bits */
+		buffer[9] = vbi_ham8 (0);
+
+		i = 10;
+	}
+
+	for (; i < 42; ++i)
+		buffer[i] = vbi_par8 (0x20 + (frame + row + i) % 0x5F);
+}
+
+static unsigned int
+sliced_frame			(vbi_sliced *		sliced,
+				 const vbi_sampling_par *sp,
+				 vbi_service_set	services,
+				 unsigned int		frame)
+{
+	vbi_sliced *s;
+	unsigned int ttx_row;
+	unsigned int field;
+
+	s = sliced;
+	ttx_row = 0;
+
+	for (field = 0; field < 2; ++field) {
+		unsigned int line;
+
+		for (line = sp->start[field];
+		     line < (unsigned int)(sp->start[field]
+					   + sp->count[field]); ++line) {
+			unsigned int field_line;
+
+			field_line = line - field * 313;
+
+			if ((services & VBI_SLICED_VPS)
+			    && 16 == line) {
+				s->id = VBI_SLICED_VPS;
+				memset (s->data, 0, 13);
+				s->data[frame % 13] = frame;
+			} else if ((services & VBI_SLICED_WSS_625)
+				   && 23 == line) {
+				s->id = VBI_SLICED_WSS_625;
+				s->data[0] = 0x08;
+				s->data[1] = 0x00;
+			} else if ((services & VBI_SLICED_CAPTION_625)
+				   && 22 == line) {
+				s->id = VBI_SLICED_CAPTION_625;
+				s->data[0] = vbi_par8 ('A' + frame % 26);
+				s->data[1] = vbi_par8 ('a' + frame % 26);
+			} else if ((services & VBI_SLICED_CAPTION_525)
+				   && (21 == line || 284 == line)) {
+				s->id = VBI_SLICED_CAPTION_525;
+				s->data[0] = vbi_par8 ('A' + frame % 26);
+				s->data[1] = vbi_par8 ('a' + frame % 26);
+			} else if ((services & VBI_SLICED_TELETEXT_B_625)
+				   && field_line >= 7 && field_line <= 22) {
+				s->id = VBI_SLICED_TELETEXT_B_625;
+				teletext_packet (s->data, frame,
+						 ttx_row++ % 24);
+			} else {
+				continue;
+			}
+
+			s->line = line;
+			++s;
+		}
+	}
+
+	return s - sliced;
+}
+
+static void
+sampling_par			(vbi_sampling_par *	sp,
+				 const pixfmt_case *	pc,
+				 const service_case *	sc,
+				 int			sampling_rate)
+{
+	unsigned int samples_per_line;
+
+	memset (sp, 0, sizeof (*sp));
+
+	/* 62 us of the 64 us line period, even for YUYV. */
+	samples_per_line = (unsigned int)(sampling_rate * 62e-6) & ~1;
+
+	sp->scanning		= sc->scanning;
+	sp->sampling_format	= pc->pixfmt;
+	sp->sampling_rate	= sampling_rate;
+	sp->bytes_per_line	= samples_per_line
+		* VBI_PIXFMT_BPP (pc->pixfmt);
+	sp->synchronous		= TRUE;
+	sp->interlaced		= FALSE;
+
+	if (625 == sc->scanning) {
+		sp->offset	= (int)(9.7e-6 * sampling_rate);
+		sp->start[0]	= 6;
+		sp->count[0]	= 18;
+		sp->start[1]	= 318;
+		sp->count[1]	= 18;
+	} else {
+		sp->offset	= (int)(9.2e-6 * sampling_rate);
+		sp->start[0]	= 10;
+		sp->count[0]	= 15;
+		sp->start[1]	= 272;
+		sp->count[1]	= 15;
+	}
+}
+
+static void
+run_case			(const pixfmt_case *	pc,
+				 const service_case *	sc,
+				 int			sampling_rate,
+				 unsigned int		noise)
+{
+	vbi_sampling_par sp;
+	vbi3_raw_decoder *rd;
+	vbi_decoder *vbi;
+	vbi_sliced *in;
+	vbi_sliced *out;
+	unsigned int n_out[N_RAW_FRAMES];
+	uint8_t *raw;
+	unsigned int scan_lines;
+	unsigned long frame_size;
+	unsigned long n_decoded;
+	double decode_time;
+	double vbi_decode_time;
+	double t;
+	unsigned int i;
+
+	sampling_par (&sp, pc, sc, sampling_rate);
+
+	scan_lines = sp.count[0] + sp.count[1];
+	frame_size = scan_lines * sp.bytes_per_line;
+
+	raw = malloc (N_RAW_FRAMES * frame_size);
+	in = malloc (scan_lines * sizeof (*in));
+	out = malloc (N_RAW_FRAMES * scan_lines * sizeof (*out));
+	assert (NULL != raw && NULL != in && NULL != out);
+
+	for (i = 0; i < N_RAW_FRAMES; ++i) {
+		uint8_t *r = raw + i * frame_size;
+		unsigned int n_lines;
+		vbi_bool success;
+
+		n_lines = sliced_frame (in, &sp, sc->services, i);
+
+		if (VBI_PIXFMT_YUV420 == pc->pixfmt) {
+			success = _vbi_raw_vbi_image
+				(r, frame_size, &sp,
+				 /* blank_level */ 0,
+				 /* white_level */ 0,
+				 /* flags */ 0, in, n_lines);
+			assert (success);
+
+			if (noise > 0) {
+				success = vbi_raw_add_noise
+					(r, &sp,
+					 /* min_freq */ 0,
+					 /* max_freq */ 5000000,
+					 noise, /* seed */ 12345678 + i);
+				assert (success);
+			}
+		} else {
+			memset (r, 0x80, frame_size);
+
+			success = _vbi_raw_video_image
+				(r, frame_size, &sp,
+				 /* blank_level */ 0,
+				 /* black_level */ 0,
+				 /* white_level */ 0,
+				 /* pixel_mask */ (VBI_PIXFMT_IS_YUV
+						   (pc->pixfmt) ?
+						   0xFF : 0xFF00),
+				 /* flags */ 0, in, n_lines);
+			assert (success);
+		}
+	}
+
+	rd = vbi3_raw_decoder_new (&sp);
+	assert (NULL != rd);
+
+	vbi3_raw_decoder_add_services (rd, sc->services, /* strict */ 0);
+
+	if (option_n_threads > 1) {
+		if (!vbi3_raw_decoder_set_threads (rd, option_n_threads))
+			exit (EXIT_FAILURE);
+	}
+
+	/* Let the decoder learn which lines carry which data. */
+	for (i = 0; i < N_RAW_FRAMES; ++i) {
+		n_out[i] = vbi3_raw_decoder_decode
+			(rd, out + i * scan_lines, scan_lines,
+			 raw + i * frame_size);
+	}
+
+	n_decoded = 0;
+
+	t = now ();
+
+	for (i = 0; i < option_n_frames; ++i) {
+		unsigned int j = i % N_RAW_FRAMES;
+
+		n_out[j] = vbi3_raw_decoder_decode
+			(rd, out + j * scan_lines, scan_lines,
+			 raw + j * frame_size);
+
+		n_decoded += n_out[j];
+	}
+
+	decode_time = now () - t;
+
+	vbi3_raw_decoder_delete (rd);
+
+	vbi = vbi_decoder_new ();
+	assert (NULL != vbi);
+
+	/* Without a handler vbi_decode() skips most packets. */
+	vbi_event_handler_register (vbi, (VBI_EVENT_TTX_PAGE |
+					  VBI_EVENT_CAPTION),
+				    event_handler, /* user_data */ NULL);
+
+	n_events = 0;
+
+	t = now ();
+
+	for (i = 0; i < option_n_frames; ++i) {
+		unsigned int j = i % N_RAW_FRAMES;
+
+		vbi_decode (vbi, out + j * scan_lines, n_out[j],
+			    /* timestamp */ i * 0.04);
+	}
+
+	vbi_decode_time = now () - t;
+
+	vbi_decoder_delete (vbi);
+
+	printf ("%s,%s,%d,%u,%u,%u,%u,%.2f,%.1f,%.1f,%.1f,%.2f\n",
+		pc->name, sc->name, sampling_rate, noise,
+		option_n_threads, option_n_frames, scan_lines,
+		(double) n_decoded / option_n_frames,
+		option_n_frames / decode_time,
+		decode_time * 1e9 / ((double) option_n_frames * scan_lines),
+		vbi_decode_time * 1e9 / option_n_frames,
+		(double) n_events / option_n_frames);
+
+	fflush (stdout);
+
+	free (out);
+	free (in);
+	free (raw);
+}
+
+static void
+usage				(FILE *			fp)
+{
+	fprintf (fp, _("\
+%s %s -- Raw VBI decoder benchmark\n\n\
+This program is licensed under GPLv2 or later. NO WARRANTIES.\n\n\
+Usage: %s [options] > CSV file\n\
+-h | --help | --usage             Print this message and exit\n\
+-n | --frames n                   Decode this many frames per test\n\
+                                  case (%u)\n\
+-t | --threads n                  Raw decoder threads (%u)\n\
+\n\
+Output columns: pixel format, data services, sampling rate in Hz,\n\
+noise amplitude, threads, frames, scan lines per frame, lines decoded\n\
+per frame, frames decoded per second, nanoseconds per scan line,\n\
+nanoseconds per frame in vbi_decode(), vbi_decode() events per frame.\n\
+"),
+		 PROGRAM_NAME, VERSION, PROGRAM_NAME,
+		 option_n_frames, option_n_threads);
+}
+
+static const char
+short_options [] = "hn:t:";
+
+#ifdef HAVE_GETOPT_LONG
+static const struct option
+long_options [] = {
+	{ "help",		no_argument,		NULL,	'h' },
+	{ "usage",		no_argument,		NULL,	'h' },
+	{ "frames",		required_argument,	NULL,	'n' },
+	{ "threads",		required_argument,	NULL,	't' },
+	{ NULL, 0, 0, 0 }
+};
+#else
+#  define getopt_long(ac, av, s, l, i) getopt(ac, av, s)
+#endif
+
+static int			option_index;
+
+static unsigned int
+parse_option_count		(unsigned int		min,
+				 unsigned int		max)
+{
+	unsigned long value;
+	char *end;
+
+	assert (NULL != optarg);
+
+	value = strtoul (optarg, &end, 0);
+	if (*end || value < min || value > max) {
+		usage (stderr);
+		exit (EXIT_FAILURE);
+	}
+
+	return value;
+}
+
+int
+main				(int			argc,
+				 char **		argv)
+{
+	unsigned int i, j, k, l;
+
+	for (;;) {
+		int c;
+
+		c = getopt_long (argc, argv, short_options,
+				 long_options, &option_index);
+		if (-1 == c)
+			break;
+
+		switch (c) {
+		case 'h':
+			usage (stdout);
+			exit (EXIT_SUCCESS);
+
+		case 'n':
+			option_n_frames = parse_option_count (1, INT_MAX);
+			break;
+
+		case 't':
+			option_n_threads = parse_option_count (1, 64);
+			break;
+
+		default:
+			usage (stderr);
+			exit (EXIT_FAILURE);
+		}
+	}
+
+	printf ("format,services,sampling_rate,noise,threads,frames,"
+		"lines_per_frame,decoded_per_frame,frames_per_s,"
+		"ns_per_line,vbi_decode_ns_per_frame,"
+		"events_per_frame\n");
+
+	for (i = 0; i < N_ELEMENTS (pixfmt_cases); ++i) {
+		for (j = 0; j < N_ELEMENTS (service_cases); ++j) {
+			for (k = 0; k < N_ELEMENTS (sampling_rates); ++k) {
+				for (l = 0; l < N_ELEMENTS (noise_levels);
+				     ++l) {
+					if (noise_levels[l] > 0
+					    && (VBI_PIXFMT_YUV420
+						!= pixfmt_cases[i].pixfmt))
+						continue;
+
+					run_case (&pixfmt_cases[i],
+						  &service_cases[j],
+						  sampling_rates[k],
+						  noise_levels[l]);
+				}
+			}
+		}
+	}
+
+	exit (EXIT_SUCCESS);
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
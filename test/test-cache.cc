@@ -0,0 +1,775 @@
+/*
+ *  libzvbi -- Teletext cache snapshot unit test
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+/* $Id$ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>		/* unlink() */
+#include <pthread.h>
+
+#include "src/libzvbi.h"
+#include "test-ttx.h"
+
+static void
+assert_same_page		(vbi_decoder *		vbi1,
+				 vbi_decoder *		vbi2,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno)
+{
+	vbi_page pg1;
+	vbi_page pg2;
+
+	assert (fetch (&pg1, vbi1, pgno, subno));
+	assert (fetch (&pg2, vbi2, pgno, subno));
+
+	assert (pg1.pgno == pg2.pgno);
+	assert (pg1.subno == pg2.subno);
+	assert (pg1.rows == pg2.rows);
+	assert (pg1.columns == pg2.columns);
+	assert (0 == memcmp (pg1.text, pg2.text,
+			     pg1.rows * pg1.columns * sizeof (*pg1.text)));
+
+	vbi_unref_page (&pg2);
+	vbi_unref_page (&pg1);
+}
+
+static void
+transmit			(ttx_stream &		st)
+{
+	st.page (0x100, 0x0000, "Index");
+	st.page (0x200, 0x0000, "News");
+	st.page (0x201, 0x0001, "Weather 1");
+	st.page (0x101, 0x0000, "Sports");
+	/* Terminates subpage 1, a repeated header would not. */
+	st.page (0x202, 0x0000, "Traffic");
+	st.page (0x201, 0x0002, "Weather 2");
+	st.flush ();
+}
+
+static void
+test_save_load			(const char *		file_name)
+{
+	ttx_stream st1;
+	ttx_stream st2;
+	ttx_stream st3;
+
+	transmit (st1);
+
+	assert (vbi_is_cached (st1.vbi, 0x100, 0x0000));
+	assert (vbi_is_cached (st1.vbi, 0x201, 0x0002));
+
+	assert (vbi_save_cache (st1.vbi, file_name));
+
+	assert (!vbi_is_cached (st2.vbi, 0x100, 0x0000));
+	assert (vbi_load_cache (st2.vbi, file_name));
+
+	/* Loaded on demand. */
+	assert_same_page (st1.vbi, st2.vbi, 0x100, VBI_ANY_SUBNO);
+	assert_same_page (st1.vbi, st2.vbi, 0x200, VBI_ANY_SUBNO);
+	assert_same_page (st1.vbi, st2.vbi, 0x201, 0x0001);
+	assert_same_page (st1.vbi, st2.vbi, 0x201, 0x0002);
+	assert (!vbi_is_cached (st2.vbi, 0x201, 0x0003));
+	assert (!vbi_is_cached (st2.vbi, 0x300, 0x0000));
+
+	/* A page received after loading replaces the snapshot. */
+	st2.page (0x101, 0x0000, "Lottery");
+	st2.flush ();
+	assert ('L' == row_1_char (st2.vbi, 0x101, VBI_ANY_SUBNO));
+
+	/* Saves loaded, pending and new pages. */
+	assert (vbi_save_cache (st2.vbi, file_name));
+	assert (vbi_load_cache (st3.vbi, file_name));
+
+	assert_same_page (st1.vbi, st3.vbi, 0x100, VBI_ANY_SUBNO);
+	assert_same_page (st1.vbi, st3.vbi, 0x201, 0x0002);
+	assert ('L' == row_1_char (st3.vbi, 0x101, VBI_ANY_SUBNO));
+}
+
+static void
+test_invalid			(const char *		file_name)
+{
+	ttx_stream st;
+	FILE *fp;
+	long size;
+	char *buffer;
+
+	assert (!vbi_load_cache (st.vbi, "/nonexistent/file"));
+
+	transmit (st);
+	assert (vbi_save_cache (st.vbi, file_name));
+
+	fp = fopen (file_name, "rb");
+	assert (NULL != fp);
+	assert (0 == fseek (fp, 0, SEEK_END));
+	size = ftell (fp);
+	assert (size > 0);
+	rewind (fp);
+	buffer = (char *) malloc (size);
+	assert (NULL != buffer);
+	assert (1 == fread (buffer, size, 1, fp));
+	fclose (fp);
+
+	/* Truncated. */
+	fp = fopen (file_name, "wb");
+	assert (NULL != fp);
+	assert (1 == fwrite (buffer, size - 1, 1, fp));
+	fclose (fp);
+	assert (!vbi_load_cache (st.vbi, file_name));
+
+	/* Other version. */
+	buffer[8] ^= 0x80;
+	fp = fopen (file_name, "wb");
+	assert (NULL != fp);
+	assert (1 == fwrite (buffer, size, 1, fp));
+	fclose (fp);
+	assert (!vbi_load_cache (st.vbi, file_name));
+
+	free (buffer);
+}
+
+/* Updates pg and compares it with a page formatted from scratch. */
+static unsigned int
+update				(vbi_page *		pg,
+				 unsigned int *		version,
+				 vbi_decoder *		vbi,
+				 vbi_pgno		pgno)
+{
+	vbi_page pg2;
+	unsigned int dirty_rows;
+
+	assert (vbi_update_vt_page (vbi, pg, pgno, VBI_ANY_SUBNO,
+				    VBI_WST_LEVEL_1p5, 25,
+				    /* navigation */ TRUE,
+				    version, &dirty_rows));
+	assert (0 != *version);
+
+	assert (vbi_fetch_vt_page (vbi, &pg2, pgno, VBI_ANY_SUBNO,
+				   VBI_WST_LEVEL_1p5, 25,
+				   /* navigation */ TRUE));
+	assert (pg->rows == pg2.rows);
+	assert (pg->double_height_lower == pg2.double_height_lower);
+	assert (0 == memcmp (pg->text, pg2.text,
+			     pg->rows * pg->columns * sizeof (*pg->text)));
+	vbi_unref_page (&pg2);
+
+	return dirty_rows;
+}
+
+static void
+test_any_subno			(void)
+{
+	ttx_stream st;
+
+	st.page (0x300, 0x0001, "A");
+	st.page (0x301, 0x0000, "-");
+	st.page (0x300, 0x0002, "B");
+	st.flush ();
+
+	/* The most recently used subpage. */
+	assert ('B' == row_1_char (st.vbi, 0x300, VBI_ANY_SUBNO));
+	assert (vbi_is_cached (st.vbi, 0x300, 0x0001));
+	assert ('A' == row_1_char (st.vbi, 0x300, VBI_ANY_SUBNO));
+	assert ('B' == row_1_char (st.vbi, 0x300, 0x0002));
+	assert ('B' == row_1_char (st.vbi, 0x300, VBI_ANY_SUBNO));
+}
+
+static void
+test_update			(void)
+{
+	ttx_stream st;
+	vbi_page pg;
+	unsigned int version;
+
+	st.page (0x300, 0x0000, "Alpha");
+	st.row (0x300, 5, "Five");
+	st.row (0x300, 10, "\x0d" "Double");
+	st.flush ();
+
+	version = 0;
+	assert (0x1FFFFFF == update (&pg, &version, st.vbi, 0x300));
+
+	/* Other rows are kept from the previous version. */
+	st.page (0x300, 0x0000, "Alpha");
+	st.row (0x300, 5, "Fuenf");
+	st.flush ();
+	assert ((1 << 5) == update (&pg, &version, st.vbi, 0x300));
+
+	assert (0 == update (&pg, &version, st.vbi, 0x300));
+
+	/* Row 10 is now the lower half of row 9, row 11 a normal row. */
+	st.page (0x300, 0x0000, "Alpha");
+	st.row (0x300, 9, "\x0d" "Nine");
+	st.flush ();
+	assert ((7 << 9) == update (&pg, &version, st.vbi, 0x300));
+
+	/* And row 11 the lower half of row 10 again. */
+	st.page (0x300, 0x0000, "Alpha");
+	st.row (0x300, 9, "Nine");
+	st.flush ();
+	assert ((7 << 9) == update (&pg, &version, st.vbi, 0x300));
+
+	/* Missed a version. */
+	st.page (0x300, 0x0000, "Alpha");
+	st.row (0x300, 5, "Five");
+	st.flush ();
+	st.page (0x300, 0x0000, "Alpha");
+	st.row (0x300, 6, "Six");
+	st.flush ();
+	assert (0x1FFFFFF == update (&pg, &version, st.vbi, 0x300));
+}
+
+static void
+test_format_cache		(void)
+{
+	ttx_stream st;
+	vbi_page pg;
+	unsigned int version1;
+	unsigned int version2;
+	unsigned int dirty_rows;
+	unsigned int i;
+
+	st.page (0x400, 0x0000, "One");
+	st.flush ();
+
+	assert ('O' == row_1_char (st.vbi, 0x400, VBI_ANY_SUBNO));
+	assert ('O' == row_1_char (st.vbi, 0x400, VBI_ANY_SUBNO));
+
+	assert (vbi_fetch_vt_page (st.vbi, &pg, 0x400, VBI_ANY_SUBNO,
+				   VBI_WST_LEVEL_1p5, 1,
+				   /* navigation */ FALSE));
+	assert (1 == pg.rows);
+	vbi_unref_page (&pg);
+
+	version1 = 0;
+	assert (vbi_update_vt_page (st.vbi, &pg, 0x400, VBI_ANY_SUBNO,
+				    VBI_WST_LEVEL_1p5, 25,
+				    /* navigation */ FALSE,
+				    &version1, &dirty_rows));
+
+	/* A retransmission keeps the version. */
+	st.page (0x400, 0x0000, "One");
+	st.flush ();
+
+	version2 = version1;
+	assert (vbi_update_vt_page (st.vbi, &pg, 0x400, VBI_ANY_SUBNO,
+				    VBI_WST_LEVEL_1p5, 25,
+				    /* navigation */ FALSE,
+				    &version2, &dirty_rows));
+	assert (version1 == version2);
+	assert (0 == dirty_rows);
+
+	st.page (0x400, 0x0000, "Two");
+	st.flush ();
+
+	assert ('T' == row_1_char (st.vbi, 0x400, VBI_ANY_SUBNO));
+
+	/* More pages than the decoder keeps. */
+	for (i = 0; i < 10; ++i)
+		st.page (0x500 + i, 0x0000, i & 1 ? "Odd" : "Even");
+	st.flush ();
+
+	for (i = 0; i < 3 * 10; ++i) {
+		assert ((i & 1 ? 'O' : 'E')
+			== row_1_char (st.vbi, 0x500 + i % 10,
+				       VBI_ANY_SUBNO));
+	}
+
+	st.page (0x505, 0x0000, "Even");
+	st.flush ();
+
+	assert ('E' == row_1_char (st.vbi, 0x505, VBI_ANY_SUBNO));
+	assert ('O' == row_1_char (st.vbi, 0x507, VBI_ANY_SUBNO));
+}
+
+static unsigned int
+row_1_char_2p5			(vbi_decoder *		vbi,
+				 vbi_pgno		pgno)
+{
+	vbi_page pg;
+	unsigned int c;
+
+	assert (vbi_fetch_vt_page (vbi, &pg, pgno, VBI_ANY_SUBNO,
+				   VBI_WST_LEVEL_2p5, 25,
+				   /* navigation */ FALSE));
+	c = pg.text[1 * pg.columns + 0].unicode;
+	vbi_unref_page (&pg);
+
+	return c;
+}
+
+/* A formatted page is discarded when a DRCS page it uses changes. */
+static void
+test_format_deps		(void)
+{
+	static const unsigned int enh[13] = {
+		/* Set active position row 1, column 0. */
+		41 | (0x04 << 6) | (0 << 11),
+		/* Normal DRCS character 0 at column 0. */
+		0 | (0x0D << 6) | (0x40 << 11),
+		/* Termination. */
+		63 | (0x1F << 6), 63 | (0x1F << 6), 63 | (0x1F << 6),
+		63 | (0x1F << 6), 63 | (0x1F << 6), 63 | (0x1F << 6),
+		63 | (0x1F << 6), 63 | (0x1F << 6), 63 | (0x1F << 6),
+		63 | (0x1F << 6), 63 | (0x1F << 6)
+	};
+	ttx_stream st;
+	uint8_t data[40];
+	unsigned int i;
+
+	/* Magazine inventory page, page 105 is a DRCS page. */
+	for (i = 0; i < 20; ++i) {
+		unsigned int code = (5 == i) ? 0xE5 : 0xFF;
+
+		data[i * 2 + 0] = vbi_ham8 (code);
+		data[i * 2 + 1] = vbi_ham8 (code >> 4);
+	}
+
+	st.page (0x1FD, 0x0000, " ");
+	st.raw_row (0x1FD, 1, data);
+
+	/* No valid characters yet. */
+	st.page (0x105, 0x0000, "!");
+
+	st.page (0x100, 0x0000, "x");
+
+	/* X/26/0 enhancement data. */
+	memset (data, 0, sizeof (data));
+	data[0] = vbi_ham8 (0);
+	for (i = 0; i < 13; ++i)
+		vbi_ham24p (data + 1 + i * 3, enh[i]);
+	st.raw_row (0x100, 26, data);
+
+	/* X/27/4 links, DRCS page 105. */
+	memset (data, 0, sizeof (data));
+	data[0] = vbi_ham8 (4);
+	for (i = 0; i < 6; ++i) {
+		vbi_ham24p (data + 1 + i * 6, 0x05 << 7);
+		vbi_ham24p (data + 4 + i * 6, 0);
+	}
+	st.raw_row (0x100, 27, data);
+
+	st.flush ();
+
+	/* Formatted at Level 1.5 for lack of the DRCS character. */
+	assert ('x' == row_1_char_2p5 (st.vbi, 0x100));
+	assert ('x' == row_1_char_2p5 (st.vbi, 0x100));
+
+	st.page (0x105, 0x0000, "@");
+	st.flush ();
+
+	assert ('x' != row_1_char_2p5 (st.vbi, 0x100));
+}
+
+static void
+test_memory_limit		(void)
+{
+	ttx_stream st;
+	unsigned int n_cached;
+	unsigned int i;
+
+	vbi_set_cache_memory_limit (st.vbi, 16 << 10);
+
+	/* A magazine start page, which we delete last. */
+	st.page (0x100, 0x0000, "Index");
+
+	for (i = 1; i <= 40; ++i)
+		st.page (vbi_add_bcd (0x100, vbi_dec2bcd (i)), 0x0000, "Page");
+	st.flush ();
+
+	assert (vbi_is_cached (st.vbi, 0x100, VBI_ANY_SUBNO));
+	assert (!vbi_is_cached (st.vbi, 0x101, VBI_ANY_SUBNO));
+	assert (vbi_is_cached (st.vbi, 0x140, VBI_ANY_SUBNO));
+
+	n_cached = 0;
+	for (i = 1; i <= 40; ++i) {
+		n_cached += !!vbi_is_cached (st.vbi,
+					     vbi_add_bcd (0x100,
+							  vbi_dec2bcd (i)),
+					     VBI_ANY_SUBNO);
+	}
+
+	assert (n_cached > 0 && n_cached < 40);
+
+	/* Pages we deleted can be received again. */
+	st.page (0x101, 0x0000, "Again");
+	st.flush ();
+	assert ('A' == row_1_char (st.vbi, 0x101, VBI_ANY_SUBNO));
+}
+
+/* Unreferenced DRCS pages are never deleted in libzvbi 0.2, they
+   must not fill the cache either. */
+static void
+test_pinned_pages		(const char *		file_name)
+{
+	ttx_stream st1;
+	ttx_stream st2;
+	uint8_t mip[40];
+	unsigned int i;
+
+	/* Magazine inventory page, pages 101 ... 108 are DRCS pages. */
+	for (i = 0; i < 20; ++i) {
+		unsigned int code = (i >= 1 && i <= 8) ? 0xE5 : 0xFF;
+
+		mip[i * 2 + 0] = vbi_ham8 (code);
+		mip[i * 2 + 1] = vbi_ham8 (code >> 4);
+	}
+
+	st1.page (0x1FD, 0x0000, " ");
+	st1.raw_row (0x1FD, 1, mip);
+
+	for (i = 1; i <= 8; ++i)
+		st1.page (0x100 + i, 0x0000, "DRCS");
+	st1.flush ();
+
+	assert (vbi_save_cache (st1.vbi, file_name));
+
+	vbi_set_cache_memory_limit (st2.vbi, 16 << 10);
+	assert (vbi_load_cache (st2.vbi, file_name));
+
+	/* Loads the DRCS pages from the snapshot. */
+	for (i = 1; i <= 8; ++i)
+		assert (vbi_is_cached (st2.vbi, 0x100 + i, VBI_ANY_SUBNO));
+
+	st2.page (0x200, 0x0000, "Index");
+	st2.flush ();
+
+	assert (vbi_is_cached (st2.vbi, 0x200, VBI_ANY_SUBNO));
+
+	for (i = 1; i <= 8; ++i)
+		assert (vbi_is_cached (st2.vbi, 0x100 + i, VBI_ANY_SUBNO));
+}
+
+static void
+test_compression		(const char *		file_name)
+{
+	ttx_stream st1;
+	ttx_stream st2;
+	ttx_stream st3;
+	ttx_stream st4;
+	unsigned int i;
+
+	vbi_set_cache_compression (st1.vbi, TRUE);
+
+	transmit (st1);
+	transmit (st2);
+
+	/* Expanded when requested, compressed again when unreferenced. */
+	for (i = 0; i < 2; ++i) {
+		assert_same_page (st1.vbi, st2.vbi, 0x100, VBI_ANY_SUBNO);
+		assert_same_page (st1.vbi, st2.vbi, 0x201, 0x0001);
+		assert_same_page (st1.vbi, st2.vbi, 0x201, 0x0002);
+	}
+
+	/* Compares a new version with the compressed one. */
+	st1.page (0x200, 0x0000, "News");
+	st1.page (0x202, 0x0000, "Roadworks");
+	st1.flush ();
+	st2.page (0x202, 0x0000, "Roadworks");
+	st2.flush ();
+
+	assert_same_page (st1.vbi, st2.vbi, 0x200, VBI_ANY_SUBNO);
+	assert ('R' == row_1_char (st1.vbi, 0x202, VBI_ANY_SUBNO));
+
+	/* Saves the pages expanded. */
+	assert (vbi_save_cache (st1.vbi, file_name));
+	assert (vbi_load_cache (st3.vbi, file_name));
+
+	assert_same_page (st2.vbi, st3.vbi, 0x101, VBI_ANY_SUBNO);
+	assert_same_page (st2.vbi, st3.vbi, 0x201, 0x0002);
+	assert_same_page (st2.vbi, st3.vbi, 0x202, VBI_ANY_SUBNO);
+
+	/* More pages fit within the memory limit, see
+	   test_memory_limit(). Enabling compression later compresses
+	   the cached pages. */
+	vbi_set_cache_memory_limit (st4.vbi, 16 << 10);
+
+	for (i = 0; i < 5; ++i)
+		st4.page (vbi_add_bcd (0x100, vbi_dec2bcd (i)), 0x0000, "Page");
+
+	vbi_set_cache_compression (st4.vbi, TRUE);
+
+	for (i = 5; i < 60; ++i)
+		st4.page (vbi_add_bcd (0x100, vbi_dec2bcd (i)), 0x0000, "Page");
+	st4.flush ();
+
+	for (i = 0; i < 60; ++i) {
+		assert ('P' == row_1_char (st4.vbi,
+					   vbi_add_bcd (0x100,
+							vbi_dec2bcd (i)),
+					   VBI_ANY_SUBNO));
+	}
+}
+
+static void
+test_changes_only		(void)
+{
+	ttx_stream st;
+	struct page_events pe;
+
+	assert (vbi_event_handler_register (st.vbi, VBI_EVENT_TTX_PAGE,
+					    count_handler, &pe));
+
+	vbi_teletext_set_changes_only (st.vbi, TRUE);
+
+	/* No rolling header, see store_lop(). */
+	memset (&pe, 0, sizeof (pe));
+	st.page (0x300, 0x0000, "Weather");
+	st.page (0x301, 0x0000, "Sports");
+	st.flush ();
+	assert (2 == pe.count);
+	assert ((1U << 25) - 1 == pe.dirty_rows);
+
+	/* Retransmission. */
+	memset (&pe, 0, sizeof (pe));
+	st.page (0x300, 0x0000, "Weather");
+	st.page (0x301, 0x0000, "Sports");
+	st.flush ();
+	assert (0 == pe.count);
+
+	memset (&pe, 0, sizeof (pe));
+	st.page (0x300, 0x0000, "Weather");
+	st.row (0x300, 3, "Rain");
+	st.flush ();
+	assert (1 == pe.count);
+	assert (1U << 3 == pe.dirty_rows);
+
+	vbi_teletext_set_changes_only (st.vbi, FALSE);
+
+	memset (&pe, 0, sizeof (pe));
+	st.page (0x300, 0x0000, "Weather");
+	st.row (0x300, 3, "Rain");
+	st.flush ();
+	assert (1 == pe.count);
+	assert (0 == pe.dirty_rows);
+}
+
+static vbi_bool
+close_to			(double			t1,
+				 double			t2)
+{
+	return t1 - t2 < 0.001 && t2 - t1 < 0.001;
+}
+
+static void
+test_rotation			(void)
+{
+	ttx_stream st;
+	double t1, t2, t3;
+	unsigned int i, j;
+
+	/* Subpages 1 ... 3, 0.4 seconds each. */
+	for (i = 0; i < 9; ++i) {
+		st.page (0x300, i % 3 + 1, "Rotation");
+		for (j = 0; j < 4; ++j)
+			st.page (0x301 + j, 0x0000, "Other");
+	}
+	st.flush ();
+
+	assert (vbi_cache_predict_subpage (st.vbi, 0x300, 0x01, &t1));
+	assert (vbi_cache_predict_subpage (st.vbi, 0x300, 0x02, &t2));
+	assert (vbi_cache_predict_subpage (st.vbi, 0x300, 0x03, &t3));
+
+	assert (close_to (t2 - t1, 0.4));
+	assert (close_to (t3 - t2, 0.4));
+
+	assert (!vbi_cache_predict_subpage (st.vbi, 0x300, 0x04, &t1));
+	assert (!vbi_cache_predict_subpage (st.vbi, 0x301, 0x01, &t1));
+}
+
+static void *
+reader_thread			(void *			user_data)
+{
+	vbi_decoder *vbi = (vbi_decoder *) user_data;
+	unsigned int i;
+
+	for (i = 0; i < 3000; ++i) {
+		vbi_page pg;
+		vbi_pgno pgno;
+
+		pgno = 0x100 + i % 3;
+		if (!fetch (&pg, vbi, pgno, VBI_ANY_SUBNO))
+			continue;
+
+		/* Never a page in transition. */
+		assert ((int)(pgno & 0xF) + 'A'
+			== pg.text[1 * pg.columns + 0].unicode);
+		assert (pg.text[1 * pg.columns + 0].unicode
+			== pg.text[1 * pg.columns + 39].unicode);
+
+		vbi_unref_page (&pg);
+	}
+
+	return NULL;
+}
+
+/* Searches walk the page statistics the decoder updates. */
+static void *
+search_thread			(void *			user_data)
+{
+	vbi_decoder *vbi = (vbi_decoder *) user_data;
+	uint16_t pattern[] = { 'B', 0 };
+	unsigned int i;
+
+	for (i = 0; i < 300; ++i) {
+		vbi_search *s;
+		vbi_page *pg;
+
+		s = vbi_search_new (vbi, 0x100, VBI_ANY_SUBNO, pattern,
+				    FALSE, FALSE, NULL);
+		if (NULL == s)
+			break; /* search not supported */
+
+		assert (VBI_SEARCH_ERROR != vbi_search_next (s, &pg, +1));
+
+		vbi_search_delete (s);
+	}
+
+	return NULL;
+}
+
+struct saver {
+	vbi_decoder *		vbi;
+	const char *		file_name;
+};
+
+/* Saving, classifying and formatting pages at Level 2.5 read the
+   network state the decoder updates. */
+static void *
+save_thread			(void *			user_data)
+{
+	const struct saver *s = (const struct saver *) user_data;
+	unsigned int i;
+
+	for (i = 0; i < 30; ++i) {
+		vbi_page pg;
+		vbi_subno subno;
+		char *language;
+
+		assert (vbi_save_cache (s->vbi, s->file_name));
+
+		if (vbi_fetch_vt_page (s->vbi, &pg, 0x100 + i % 3,
+				       VBI_ANY_SUBNO, VBI_WST_LEVEL_2p5,
+				       25, /* navigation */ TRUE))
+			vbi_unref_page (&pg);
+
+		vbi_classify_page (s->vbi, 0x100 + i % 3, &subno, &language);
+		vbi_cache_hi_subno (s->vbi, 0x100 + i % 3);
+	}
+
+	return NULL;
+}
+
+#define N_READERS 3
+
+/* One thread decodes while others fetch the pages it replaces. */
+static void
+test_threads			(const char *		file_name)
+{
+	static const char *texts[] = { "A", "B", "C" };
+	ttx_stream st;
+	struct saver s;
+	pthread_t threads[N_READERS + 2];
+	uint8_t m29[40];
+	unsigned int i;
+
+	/* M/29/0, a Level 2.5 magazine default. */
+	m29[0] = vbi_ham8 (0);
+	for (i = 0; i < 13; ++i)
+		vbi_ham24p (m29 + 1 + i * 3, 0);
+
+	for (i = 0; i < 3; ++i)
+		st.page (0x100 + i, 0x0000, texts[i]);
+	st.flush ();
+
+	for (i = 0; i < N_READERS; ++i)
+		assert (0 == pthread_create (&threads[i], NULL,
+					     reader_thread, st.vbi));
+	assert (0 == pthread_create (&threads[N_READERS], NULL,
+				     search_thread, st.vbi));
+
+	s.vbi = st.vbi;
+	s.file_name = file_name;
+	assert (0 == pthread_create (&threads[N_READERS + 1], NULL,
+				     save_thread, &s));
+
+	for (i = 0; i < 3000; ++i) {
+		st.page (0x100 + i % 3, 0x0000, texts[i % 3]);
+		/* A changed page replaces the cached one. */
+		st.row (0x100 + i % 3, 2, (i / 3) & 1 ? "x" : "y");
+		st.raw_row (0x100, 29, m29);
+	}
+
+	for (i = 0; i <= N_READERS + 1; ++i)
+		assert (0 == pthread_join (threads[i], NULL));
+}
+
+int
+main				(int			argc,
+				 char **		argv)
+{
+	char file_name[] = "test-cache.XXXXXX";
+	int fd;
+
+	argc = argc; /* unused */
+	argv = argv;
+
+	fd = mkstemp (file_name);
+	assert (-1 != fd);
+	close (fd);
+
+	test_save_load (file_name);
+	test_invalid (file_name);
+	test_compression (file_name);
+	test_pinned_pages (file_name);
+	test_threads (file_name);
+
+	unlink (file_name);
+
+	test_any_subno ();
+
+	test_update ();
+
+	test_format_cache ();
+
+	test_format_deps ();
+
+	test_memory_limit ();
+
+	test_changes_only ();
+
+	test_rotation ();
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
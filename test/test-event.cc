@@ -0,0 +1,534 @@
+/*
+ *  libzvbi -- Teletext decoder event unit test
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+/* $Id$ */
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "src/libzvbi.h"
+#include "test-ttx.h"
+
+static vbi_bool
+cached				(vbi_decoder *		vbi,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno)
+{
+	vbi_page pg;
+
+	if (!fetch (&pg, vbi, pgno, subno))
+		return FALSE;
+
+	vbi_unref_page (&pg);
+
+	return TRUE;
+}
+
+static void
+test_interest			(void)
+{
+	ttx_stream st;
+	struct page_events pe;
+
+	assert (vbi_event_handler_register (st.vbi, VBI_EVENT_TTX_PAGE,
+					    count_handler, &pe));
+
+	assert (vbi_teletext_add_interest_pages (st.vbi, 0x888, 0x888));
+	assert (vbi_teletext_add_interest_subpages (st.vbi, 0x100,
+						    0x0001, 0x0001));
+
+	memset (&pe, 0, sizeof (pe));
+	st.page (0x100, 0x0000, "Index");
+	st.page (0x888, 0x0000, "Subtitles");
+	st.page (0x300, 0x0000, "Weather");
+	st.page (0x100, 0x0001, "Index 1");
+	st.page (0x889, 0x0000, "Other");
+	st.flush ();
+	assert (2 == pe.count);
+
+	assert (cached (st.vbi, 0x888, 0x0000));
+	assert (cached (st.vbi, 0x100, 0x0001));
+	assert (!cached (st.vbi, 0x100, 0x0000));
+	assert (!cached (st.vbi, 0x300, 0x0000));
+	assert (!cached (st.vbi, 0x889, 0x0000));
+
+	/* Invalid page numbers leave the interest set unchanged. */
+	assert (!vbi_teletext_add_interest_pages (st.vbi, 0x099, 0x099));
+	assert (!vbi_teletext_add_interest_subpages (st.vbi, 0x100,
+						     0x3F7F, 0x0001));
+
+	/* All pages but 0x301. */
+	vbi_teletext_reset_interest (st.vbi);
+	assert (vbi_teletext_remove_interest_pages (st.vbi, 0x301, 0x301));
+
+	st.page (0x300, 0x0000, "Weather");
+	st.page (0x301, 0x0000, "Sports");
+	st.page (0x302, 0x0000, "Traffic");
+	st.flush ();
+
+	assert (cached (st.vbi, 0x300, 0x0000));
+	assert (!cached (st.vbi, 0x301, 0x0000));
+	assert (cached (st.vbi, 0x302, 0x0000));
+
+	/* Only subpages. */
+	vbi_teletext_reset_interest (st.vbi);
+	assert (vbi_teletext_add_interest_subpages (st.vbi, 0x102,
+						    0x0001, 0x0001));
+
+	st.page (0x102, 0x0001, "Index 1");
+	st.flush ();
+
+	assert (cached (st.vbi, 0x102, 0x0001));
+
+	vbi_teletext_reset_interest (st.vbi);
+	assert (vbi_teletext_add_interest_subpages (st.vbi, 0x150,
+						    0x0001, 0x0001));
+	assert (vbi_teletext_add_interest_subpages (st.vbi, 0x400,
+						    0x0001, 0x0001));
+	assert (vbi_teletext_add_interest_pages (st.vbi, 0x888, 0x888));
+
+	st.page (0x150, 0x0001, "Index 1");
+	st.page (0x400, 0x0001, "Index 1");
+	st.flush ();
+
+	assert (cached (st.vbi, 0x150, 0x0001));
+	assert (cached (st.vbi, 0x400, 0x0001));
+
+	/* All pages. */
+	vbi_teletext_reset_interest (st.vbi);
+	assert (!vbi_teletext_add_interest_pages (st.vbi, 0x900, 0x900));
+
+	st.page (0x301, 0x0000, "Sports");
+	st.flush ();
+
+	assert (cached (st.vbi, 0x301, 0x0000));
+}
+
+static void
+test_multi_stream		(void)
+{
+	vbi_multi_decoder *md;
+	vbi_decoder *vbi1;
+	vbi_decoder *vbi2;
+	vbi_sliced sliced;
+	vbi_page pg;
+
+	md = vbi_multi_decoder_new ();
+	assert (NULL != md);
+
+	{
+		ttx_stream st1 (md, 0x1234);
+		ttx_stream st2 (md, 0x0567);
+
+		vbi1 = st1.vbi;
+		vbi2 = st2.vbi;
+		assert (vbi1 != vbi2);
+		assert (vbi1 == vbi_multi_decoder_add_stream (md, 0x1234));
+		assert (vbi2 == vbi_multi_decoder_get_stream (md, 0x0567));
+
+		/* Same page number, different networks. */
+		st1.page (0x100, 0x0000, "One");
+		st2.page (0x100, 0x0000, "Two");
+		st2.page (0x101, 0x0000, "Three");
+		st1.flush ();
+		st2.flush ();
+	}
+
+	assert ('O' == row_1_char (vbi1, 0x100, VBI_ANY_SUBNO));
+	assert ('T' == row_1_char (vbi2, 0x100, VBI_ANY_SUBNO));
+	assert (!fetch (&pg, vbi1, 0x101, VBI_ANY_SUBNO));
+	assert ('T' == row_1_char (vbi2, 0x101, VBI_ANY_SUBNO));
+
+	/* Streams decode Teletext only. */
+	assert (!vbi_fetch_cc_page (vbi1, &pg, 1, TRUE));
+
+	vbi_multi_decoder_remove_stream (md, 0x1234);
+	assert (NULL == vbi_multi_decoder_get_stream (md, 0x1234));
+	assert (vbi2 == vbi_multi_decoder_get_stream (md, 0x0567));
+
+	memset (&sliced, 0, sizeof (sliced));
+	assert (!vbi_multi_decode (md, 0x1234, &sliced, 0, 10.0));
+
+	assert ('T' == row_1_char (vbi2, 0x100, VBI_ANY_SUBNO));
+
+	vbi_multi_decoder_delete (md);
+}
+
+static void
+self_removing_handler		(vbi_event *		ev,
+				 void *			user_data)
+{
+	struct page_events *pe = (struct page_events *) user_data;
+
+	ev = ev; /* unused */
+
+	++pe->count;
+	vbi_event_handler_unregister (pe->vbi, self_removing_handler,
+				      user_data);
+}
+
+/* Unregistered handlers do not run anymore, so the events
+   can be on the stack of this thread. */
+static void *
+register_thread			(void *			user_data)
+{
+	vbi_decoder *vbi = (vbi_decoder *) user_data;
+	struct page_events pe[4];
+	unsigned int i;
+
+	memset (pe, 0, sizeof (pe));
+
+	for (i = 0; i < 3000; ++i) {
+		struct page_events *p = &pe[i % 4];
+
+		if (i & 4)
+			vbi_event_handler_unregister (vbi, count_handler, p);
+		else
+			assert (vbi_event_handler_register
+				(vbi, VBI_EVENT_TTX_PAGE, count_handler, p));
+	}
+
+	for (i = 0; i < 4; ++i)
+		vbi_event_handler_unregister (vbi, count_handler, &pe[i]);
+
+	return NULL;
+}
+
+/* Handlers change while the decoding thread sends events. */
+static void
+test_event_handlers		(void)
+{
+	ttx_stream st;
+	struct page_events pe;
+	pthread_t thread;
+	unsigned int i;
+
+	memset (&pe, 0, sizeof (pe));
+	pe.vbi = st.vbi;
+
+	assert (vbi_event_handler_register (st.vbi, VBI_EVENT_TTX_PAGE,
+					    self_removing_handler, &pe));
+	st.page (0x100, 0x0000, "One");
+	st.page (0x101, 0x0000, "Two");
+	st.flush ();
+	assert (1 == pe.count);
+
+	assert (0 == pthread_create (&thread, NULL,
+				     register_thread, st.vbi));
+
+	for (i = 0; i < 3000; ++i)
+		st.page (0x100 + i % 3, 0x0000, "Three");
+
+	assert (0 == pthread_join (thread, NULL));
+}
+
+static pthread_mutex_t		queue_gate = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+queued_handler			(vbi_event *		ev,
+				 void *			user_data)
+{
+	struct page_events *pe = (struct page_events *) user_data;
+
+	/* A copy of the header, if any, see ttx_stream::page(). */
+	if (NULL != ev->ev.ttx_page.raw_header) {
+		unsigned int i;
+
+		for (i = 8; i < 40; ++i)
+			assert (ev->ev.ttx_page.raw_header[i]
+				== vbi_par8 ('0' + i % 10));
+	}
+
+	pthread_mutex_lock (&queue_gate);
+	++pe->count;
+	pthread_mutex_unlock (&queue_gate);
+}
+
+static void
+wait_queue_depth		(vbi_decoder *		vbi,
+				 unsigned int		depth)
+{
+	unsigned int d;
+
+	for (;;) {
+		vbi_event_queue_get_stats (vbi, &d, NULL, NULL);
+		if (d == depth)
+			break;
+		usleep (1000);
+	}
+}
+
+/* Events wait in the queue while a queued handler blocks. */
+static void
+test_event_queue		(void)
+{
+	ttx_stream st;
+	struct page_events pe;
+	unsigned int depth, dropped, coalesced;
+	unsigned int i;
+
+	memset (&pe, 0, sizeof (pe));
+
+	assert (!vbi_event_handler_register_queued
+		(st.vbi, VBI_EVENT_TTX_PAGE, queued_handler, &pe));
+
+	assert (vbi_event_queue_start (st.vbi, 4));
+	assert (vbi_event_handler_register_queued
+		(st.vbi, VBI_EVENT_TTX_PAGE, queued_handler, &pe));
+
+	pthread_mutex_lock (&queue_gate);
+
+	st.page (0x100, 0x0000, "Blocks");
+	st.page (0x101, 0x0000, "Queued");
+	wait_queue_depth (st.vbi, 0);
+
+	/* Stores pages 0x101 ... 0x104. */
+	for (i = 0x102; i <= 0x105; ++i)
+		st.page (i, 0x0000, "Queued");
+
+	/* Page 0x105 is dropped, 0x101 merged. */
+	st.page (0x101, 0x0000, "Again");
+	st.page (0x106, 0x0000, "Other");
+
+	vbi_event_queue_get_stats (st.vbi, &depth, &dropped, &coalesced);
+	assert (4 == depth);
+	assert (1 == dropped);
+	assert (1 == coalesced);
+
+	pthread_mutex_unlock (&queue_gate);
+
+	vbi_event_queue_stop (st.vbi);
+	assert (5 == pe.count);
+
+	/* Restarts with the handler still registered. */
+	assert (vbi_event_queue_start (st.vbi, 4));
+	st.page (0x107, 0x0000, "Restart");
+	vbi_event_queue_stop (st.vbi);
+	assert (6 == pe.count);
+
+	vbi_event_handler_unregister_queued (st.vbi, queued_handler, &pe);
+}
+
+struct event_log {
+	unsigned int		count;
+	int			type[8];
+	vbi_pgno		pgno[8];
+};
+
+static void
+log_handler			(vbi_event *		ev,
+				 void *			user_data)
+{
+	struct event_log *log = (struct event_log *) user_data;
+
+	pthread_mutex_lock (&queue_gate);
+
+	assert (log->count < 8);
+	log->type[log->count] = ev->type;
+	if (VBI_EVENT_TTX_PAGE == ev->type)
+		log->pgno[log->count] = ev->ev.ttx_page.pgno;
+	++log->count;
+
+	pthread_mutex_unlock (&queue_gate);
+}
+
+/* Transmits packet 8/30 format 1 with a CNI of ORF eins. */
+static void
+network_id			(ttx_stream &		st)
+{
+	uint8_t data[40];
+	unsigned int i;
+
+	data[0] = vbi_ham8 (0); /* designation code */
+	for (i = 1; i < 7; ++i)
+		data[i] = vbi_ham8 (0xF); /* initial page */
+	data[7] = vbi_rev16 (0x4301);
+	data[8] = vbi_rev16 (0x4301) >> 8;
+	for (i = 9; i < 40; ++i)
+		data[i] = vbi_par8 (' ');
+
+	st.raw_row (0x800, 30, data);
+}
+
+/* Page events are not merged across a network event. */
+static void
+test_event_queue_network	(void)
+{
+	ttx_stream st;
+	struct event_log log;
+	unsigned int coalesced;
+
+	memset (&log, 0, sizeof (log));
+
+	assert (vbi_event_queue_start (st.vbi, 8));
+	assert (vbi_event_handler_register_queued
+		(st.vbi, VBI_EVENT_TTX_PAGE | VBI_EVENT_NETWORK,
+		 log_handler, &log));
+
+	pthread_mutex_lock (&queue_gate);
+
+	st.page (0x100, 0x0000, "Blocks");
+	st.page (0x101, 0x0000, "Before");
+	wait_queue_depth (st.vbi, 0);
+
+	st.page (0x102, 0x0000, "Other");
+	/* The CNI must be received twice. */
+	network_id (st);
+	network_id (st);
+	st.page (0x101, 0x0000, "After");
+	st.page (0x103, 0x0000, "Other");
+
+	vbi_event_queue_get_stats (st.vbi, NULL, NULL, &coalesced);
+	assert (0 == coalesced);
+
+	pthread_mutex_unlock (&queue_gate);
+
+	vbi_event_queue_stop (st.vbi);
+
+	assert (5 == log.count);
+	assert (VBI_EVENT_TTX_PAGE == log.type[0] && 0x100 == log.pgno[0]);
+	assert (VBI_EVENT_TTX_PAGE == log.type[1] && 0x101 == log.pgno[1]);
+	assert (VBI_EVENT_NETWORK == log.type[2]);
+	assert (VBI_EVENT_TTX_PAGE == log.type[3] && 0x102 == log.pgno[3]);
+	assert (VBI_EVENT_TTX_PAGE == log.type[4] && 0x101 == log.pgno[4]);
+
+	vbi_event_handler_unregister_queued (st.vbi, log_handler, &log);
+}
+
+struct handover {
+	vbi_decoder *		vbi;
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;
+	vbi_bool		registering;
+	vbi_bool		unregistering;
+	struct page_events	pe;
+};
+
+static void
+registering_handler		(vbi_event *		ev,
+				 void *			user_data)
+{
+	struct handover *h = (struct handover *) user_data;
+
+	ev = ev; /* unused */
+
+	pthread_mutex_lock (&h->mutex);
+	h->registering = TRUE;
+	pthread_cond_broadcast (&h->cond);
+	while (!h->unregistering)
+		pthread_cond_wait (&h->cond, &h->mutex);
+	pthread_mutex_unlock (&h->mutex);
+
+	/* Let the queued handler wait for this handler. */
+	usleep (10000);
+
+	assert (vbi_event_handler_register_queued
+		(h->vbi, VBI_EVENT_TTX_PAGE, count_handler, &h->pe));
+}
+
+static void
+unregistering_handler		(vbi_event *		ev,
+				 void *			user_data)
+{
+	struct handover *h = (struct handover *) user_data;
+
+	ev = ev; /* unused */
+
+	pthread_mutex_lock (&h->mutex);
+	while (!h->registering)
+		pthread_cond_wait (&h->cond, &h->mutex);
+	h->unregistering = TRUE;
+	pthread_cond_broadcast (&h->cond);
+	pthread_mutex_unlock (&h->mutex);
+
+	vbi_event_handler_unregister (h->vbi, registering_handler, h);
+}
+
+/* A queued handler waits for a direct handler which registers
+   a queued handler. */
+static void
+test_event_queue_handover	(void)
+{
+	ttx_stream st;
+	struct handover h;
+
+	memset (&h, 0, sizeof (h));
+	h.vbi = st.vbi;
+	pthread_mutex_init (&h.mutex, NULL);
+	pthread_cond_init (&h.cond, NULL);
+
+	assert (vbi_event_queue_start (st.vbi, 8));
+	assert (vbi_event_handler_register_queued
+		(st.vbi, VBI_EVENT_TTX_PAGE, unregistering_handler, &h));
+	assert (vbi_event_handler_register
+		(st.vbi, VBI_EVENT_TTX_PAGE, registering_handler, &h));
+
+	st.page (0x100, 0x0000, "Handover");
+	st.page (0x101, 0x0000, "Queued");
+	st.flush ();
+
+	vbi_event_queue_stop (st.vbi);
+	assert (1 == h.pe.count);
+
+	vbi_event_handler_unregister_queued (st.vbi, count_handler, &h.pe);
+	vbi_event_handler_unregister_queued (st.vbi, unregistering_handler,
+					     &h);
+
+	pthread_cond_destroy (&h.cond);
+	pthread_mutex_destroy (&h.mutex);
+}
+
+int
+main				(int			argc,
+				 char **		argv)
+{
+	argc = argc; /* unused */
+	argv = argv;
+
+	test_interest ();
+
+	test_multi_stream ();
+
+	test_event_handlers ();
+
+	test_event_queue ();
+
+	test_event_queue_network ();
+
+	test_event_queue_handover ();
+
+	return 0;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/
@@ -159,6 +159,54 @@ test_par_unpar			(void)
 	}
 }
 
+/* Buffers long enough for the SIMD versions, at any alignment. */
+static void
+test_par_unpar_block		(void)
+{
+	uint8_t buf[80];
+	uint8_t ref[80];
+	unsigned int i;
+
+	for (i = 0; i < 2000; ++i) {
+		unsigned int offset = i % 16;
+		unsigned int n = (i / 16) % (sizeof (buf) - 15);
+		int even;
+		unsigned int j;
+
+		for (j = 0; j < sizeof (buf); ++j)
+			buf[j] = mrand48 ();
+
+		memcpy (ref, buf, sizeof (buf));
+		vbi::par (buf + offset, n);
+
+		for (j = 0; j < sizeof (buf); ++j) {
+			if (j < offset || j >= offset + n)
+				assert (buf[j] == ref[j]);
+			else
+				assert (buf[j] == vbi::par8 (ref[j] & 127));
+		}
+
+		/* Even parity in at most one byte. */
+		if (n > 0 && 0 != (i & 1))
+			buf[offset + (unsigned int) mrand48 () % n] ^= 0x01;
+
+		memcpy (ref, buf, sizeof (buf));
+
+		even = 0;
+		for (j = offset; j < offset + n; ++j)
+			even |= (vbi::unpar8 (ref[j]) < 0);
+
+		assert ((vbi::unpar (buf + offset, n) < 0) == even);
+
+		for (j = 0; j < sizeof (buf); ++j) {
+			if (j < offset || j >= offset + n)
+				assert (buf[j] == ref[j]);
+			else
+				assert (buf[j] == (ref[j] & 127));
+		}
+	}
+}
+
 static void
 test_ham8_ham16_unham8_unham16	(void)
 {
@@ -205,6 +253,71 @@ test_ham8_ham16_unham8_unham16	(void)
 	}
 }
 
+/* Whole packet functions against the single byte and triplet
+   versions, with random data and all byte values. */
+static void
+test_packet			(void)
+{
+	uint8_t buf[80];
+	uint8_t dst[80];
+	int8_t ndst[80];
+	int tdst[32];
+	unsigned int i;
+
+	for (i = 0; i < 3000; ++i) {
+		unsigned int offset = i % 16;
+		unsigned int n = (i / 16) % 65;
+		uint64_t err;
+		unsigned int t_err;
+		unsigned int j;
+
+		for (j = 0; j < sizeof (buf); ++j)
+			buf[j] = mrand48 ();
+
+		if (i < 256) {
+			for (j = 0; j < 64; ++j)
+				buf[offset + j] = i + j * 4;
+			n = 64;
+		}
+
+		memset (dst, 0xA5, sizeof (dst));
+		err = _vbi_unpar_packet (dst, buf + offset, n);
+
+		for (j = 0; j < n; ++j) {
+			int c = vbi::unpar8 (buf[offset + j]);
+
+			assert (dst[j] == (buf[offset + j] & 127));
+			assert (((err >> j) & 1) == (uint64_t)(c < 0));
+		}
+		assert (n >= 64 || 0 == (err >> n));
+		assert (0xA5 == dst[n]);
+
+		memset (ndst, 0x5A, sizeof (ndst));
+		err = _vbi_unham8_packet (ndst, buf + offset, n);
+
+		for (j = 0; j < n; ++j) {
+			int c = vbi::unham8 (buf[offset + j]);
+
+			assert (ndst[j] == c);
+			assert (((err >> j) & 1) == (uint64_t)(c < 0));
+		}
+		assert (n >= 64 || 0 == (err >> n));
+		assert (0x5A == ndst[n]);
+
+		n = n * 13 / 64;
+
+		t_err = _vbi_unham24_packet (tdst, buf + offset, n);
+
+		for (j = 0; j < n; ++j) {
+			int t = vbi::unham24 (buf + offset + j * 3);
+
+			assert (tdst[j] == t);
+			assert (((t_err >> j) & 1) == (unsigned int)(t < 0));
+		}
+		assert (0 == (t_err >> n));
+	}
+}
+
 static void
 test_ham24			(unsigned int		val)
 {
@@ -312,9 +425,12 @@ main				(int			argc,
 	test_rev ();
 
 	test_par_unpar ();
+	test_par_unpar_block ();
 
 	test_ham8_ham16_unham8_unham16 ();
 
+	test_packet ();
+
 	for (i = 0; i < (1 << 18); ++i)
 		test_ham24 (i);
 
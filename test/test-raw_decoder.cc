@@ -35,6 +35,7 @@
 #if 2 == VBI_VERSION_MINOR
 #  include "src/raw_decoder.h"
 #  include "src/io-sim.h"
+#  include "src/hamm.h"
 #  define N_ELEMENTS(array) (sizeof (array) / sizeof (*(array)))
 #  define vbi_pixfmt_bytes_per_pixel(pf) VBI_PIXFMT_BPP(pf)
 #  define VBI_PIXFMT_IS_YUV(pf) (0 != (VBI_PIXFMT_SET (pf)		\
@@ -827,6 +828,736 @@ test_line_order			(vbi_bool		synchronous)
 	test1 (&sp);
 }
 
+static void
+test_threads			(vbi_bool		interlaced)
+{
+	vbi_sampling_par sp;
+	vbi_sliced *in;
+	vbi_sliced out1[50];
+	vbi_sliced out2[50];
+	uint8_t *raw;
+	vbi3_raw_decoder *rd1;
+	vbi3_raw_decoder *rd2;
+	unsigned int in_lines;
+	unsigned int n_threads;
+
+	memset (&sp, 0x55, sizeof (sp));
+
+	vbi_sampling_par_from_services (&sp, /* &max_rate */ NULL,
+					VBI_VIDEOSTD_SET_625_50,
+					VBI_SLICED_TELETEXT_B_625 |
+					VBI_SLICED_CAPTION_625 |
+					VBI_SLICED_WSS_625);
+	sp.interlaced = interlaced;
+
+	in_lines = create_raw (&raw, &in, &sp, ttx_wss_cc_625,
+			       /* pixel_mask */ 0, /* raw_flags */ 0);
+
+	rd1 = create_decoder (&sp, ttx_wss_cc_625, /* strict */ 1);
+	rd2 = create_decoder (&sp, ttx_wss_cc_625, /* strict */ 1);
+
+	for (n_threads = 4; n_threads > 0; --n_threads) {
+		unsigned int n1, n2;
+		unsigned int i;
+
+		assert (vbi3_raw_decoder_set_threads (rd2, n_threads));
+
+		for (i = 0; i < 20; ++i) {
+			unsigned int max_lines = (i & 1) ? 40 : 5;
+
+			memset_rand (out1, sizeof (out1));
+			memcpy (out2, out1, sizeof (out2));
+
+			n1 = vbi3_raw_decoder_decode (rd1, out1,
+						      max_lines, raw);
+			n2 = vbi3_raw_decoder_decode (rd2, out2,
+						      max_lines, raw);
+
+			assert (n1 == n2);
+			assert (n1 == MIN (max_lines, in_lines));
+			assert (0 == memcmp (out1, out2, sizeof (out1)));
+		}
+
+		/* Removing and adding services between frames. */
+		vbi3_raw_decoder_remove_services (rd1, VBI_SLICED_WSS_625);
+		vbi3_raw_decoder_remove_services (rd2, VBI_SLICED_WSS_625);
+
+		n1 = vbi3_raw_decoder_decode (rd1, out1, 40, raw);
+		n2 = vbi3_raw_decoder_decode (rd2, out2, 40, raw);
+		assert (n1 == in_lines - 1 && n1 == n2);
+		assert (0 == memcmp (out1, out2, n1 * sizeof (*out1)));
+
+		vbi3_raw_decoder_add_services (rd1, VBI_SLICED_WSS_625, 1);
+		vbi3_raw_decoder_add_services (rd2, VBI_SLICED_WSS_625, 1);
+	}
+
+	vbi3_raw_decoder_delete (rd2);
+	vbi3_raw_decoder_delete (rd1);
+
+	free (in);
+	free (raw);
+}
+
+static void
+test_batch			(vbi_bool		interlaced)
+{
+	static const unsigned int n_frames = 7;
+	vbi_sampling_par sp;
+	vbi_sliced *in;
+	vbi_sliced out1[50];
+	vbi_sliced *out2;
+	unsigned int n_lines[n_frames];
+	uint8_t *raw;
+	uint8_t *raw2;
+	vbi3_raw_decoder *rd1;
+	vbi3_raw_decoder *rd2;
+	unsigned int frame_size;
+	unsigned int max_lines;
+	unsigned int n_threads;
+	unsigned int f;
+
+	memset (&sp, 0x55, sizeof (sp));
+
+	vbi_sampling_par_from_services (&sp, /* &max_rate */ NULL,
+					VBI_VIDEOSTD_SET_625_50,
+					VBI_SLICED_TELETEXT_B_625 |
+					VBI_SLICED_CAPTION_625 |
+					VBI_SLICED_WSS_625);
+	sp.interlaced = interlaced;
+
+	create_raw (&raw, &in, &sp, ttx_wss_cc_625,
+		    /* pixel_mask */ 0, /* raw_flags */ 0);
+
+	frame_size = (sp.count[0] + sp.count[1]) * sp.bytes_per_line;
+
+	/* Frames with and without data. */
+	raw2 = (uint8_t *) malloc (n_frames * frame_size);
+	assert (NULL != raw2);
+
+	for (f = 0; f < n_frames; ++f) {
+		if (f % 3)
+			memcpy (raw2 + f * frame_size, raw, frame_size);
+		else
+			memset (raw2 + f * frame_size, 0, frame_size);
+	}
+
+	out2 = (vbi_sliced *) malloc (n_frames * 50 * sizeof (*out2));
+	assert (NULL != out2);
+
+	rd1 = create_decoder (&sp, ttx_wss_cc_625, /* strict */ 1);
+	rd2 = create_decoder (&sp, ttx_wss_cc_625, /* strict */ 1);
+
+	for (n_threads = 1; n_threads <= 3; ++n_threads) {
+		assert (vbi3_raw_decoder_set_threads (rd2, n_threads));
+
+		for (max_lines = 5; max_lines <= 50; max_lines += 45) {
+			unsigned int total;
+			unsigned int sum;
+
+			memset_rand (n_lines, sizeof (n_lines));
+
+			total = vbi3_raw_decoder_decode_frames
+				(rd2, out2, max_lines, n_lines,
+				 raw2, n_frames);
+
+			sum = 0;
+
+			for (f = 0; f < n_frames; ++f) {
+				unsigned int n1;
+				unsigned int i;
+
+				n1 = vbi3_raw_decoder_decode
+					(rd1, out1, max_lines,
+					 raw2 + f * frame_size);
+
+				assert (n1 == n_lines[f]);
+				assert (0 == (f % 3) || n1 > 0);
+				for (i = 0; i < n1; ++i) {
+					const vbi_sliced *s1 = &out1[i];
+					const vbi_sliced *s2 =
+						&out2[f * max_lines + i];
+
+					assert (s1->id == s2->id);
+					assert (s1->line == s2->line);
+					assert (0 == memcmp (s1->data, s2->data,
+						(vbi_sliced_payload_bits
+						 (s1->id) + 7) >> 3));
+				}
+				sum += n1;
+			}
+
+			assert (total == sum);
+		}
+	}
+
+	vbi3_raw_decoder_delete (rd2);
+	vbi3_raw_decoder_delete (rd1);
+
+	free (out2);
+	free (raw2);
+	free (in);
+	free (raw);
+}
+
+static void
+test_view			(vbi_bool		interlaced)
+{
+	vbi_sampling_par sp;
+	vbi_sliced *in;
+	vbi_sliced out1[50];
+	vbi_sliced out2[50];
+	uint8_t *raw;
+	uint8_t *buffer;
+	vbi3_raw_decoder *rd1;
+	vbi3_raw_decoder *rd2;
+	vbi3_raw_view view;
+	unsigned int n_threads;
+	unsigned int i;
+
+	memset (&sp, 0x55, sizeof (sp));
+
+	vbi_sampling_par_from_services (&sp, /* &max_rate */ NULL,
+					VBI_VIDEOSTD_SET_625_50,
+					VBI_SLICED_TELETEXT_B_625 |
+					VBI_SLICED_CAPTION_625 |
+					VBI_SLICED_WSS_625);
+	sp.interlaced = interlaced;
+
+	create_raw (&raw, &in, &sp, ttx_wss_cc_625,
+		    /* pixel_mask */ 0, /* raw_flags */ 0);
+
+	/* Padding between the lines, second field first. */
+	view.stride = sp.bytes_per_line + 13;
+	view.offset[1] = 5;
+	view.offset[0] = view.offset[1] + sp.count[1] * view.stride + 100;
+
+	buffer = (uint8_t *) xmalloc (view.offset[0]
+				      + sp.count[0] * view.stride);
+	memset_rand (buffer, view.offset[0] + sp.count[0] * view.stride);
+	view.data = buffer;
+
+	for (i = 0; i < (unsigned int)(sp.count[0] + sp.count[1]); ++i) {
+		const uint8_t *src;
+		uint8_t *dst;
+
+		if (i < (unsigned int) sp.count[0])
+			dst = buffer + view.offset[0] + i * view.stride;
+		else
+			dst = buffer + view.offset[1]
+				+ (i - sp.count[0]) * view.stride;
+
+		if (interlaced && i >= (unsigned int) sp.count[0])
+			src = raw + sp.bytes_per_line
+				+ (i - sp.count[0]) * 2 * sp.bytes_per_line;
+		else if (interlaced)
+			src = raw + i * 2 * sp.bytes_per_line;
+		else
+			src = raw + i * sp.bytes_per_line;
+
+		memcpy (dst, src, sp.bytes_per_line);
+	}
+
+	rd1 = create_decoder (&sp, ttx_wss_cc_625, /* strict */ 1);
+	rd2 = create_decoder (&sp, ttx_wss_cc_625, /* strict */ 1);
+
+	for (n_threads = 1; n_threads <= 2; ++n_threads) {
+		unsigned int n1;
+		unsigned int n2;
+
+		assert (vbi3_raw_decoder_set_threads (rd2, n_threads));
+
+		n1 = vbi3_raw_decoder_decode (rd1, out1, 50, raw);
+		n2 = vbi3_raw_decoder_decode_view (rd2, out2, 50, &view);
+
+		assert (n1 > 0);
+		assert (n1 == n2);
+
+		for (i = 0; i < n1; ++i) {
+			assert (out1[i].id == out2[i].id);
+			assert (out1[i].line == out2[i].line);
+			assert (0 == memcmp (out1[i].data, out2[i].data,
+				(vbi_sliced_payload_bits (out1[i].id)
+				 + 7) >> 3));
+		}
+	}
+
+	/* Overlapping lines. */
+	view.stride = sp.bytes_per_line - 1;
+	assert (0 == vbi3_raw_decoder_decode_view (rd2, out2, 50, &view));
+
+	vbi3_raw_decoder_delete (rd2);
+	vbi3_raw_decoder_delete (rd1);
+
+	free (buffer);
+	free (in);
+	free (raw);
+}
+
+static void
+test_prediction			(void)
+{
+	vbi_sampling_par sp;
+	vbi_sliced *in;
+	vbi_sliced out[50];
+	uint8_t *raw;
+	uint8_t *blank;
+	uint8_t *buffer1;
+	uint8_t *buffer2;
+	vbi3_raw_decoder *rd1;
+	vbi3_raw_decoder *rd2;
+	unsigned int in_lines;
+	unsigned int frame_size;
+	size_t size;
+	unsigned int n;
+	unsigned int i;
+
+	memset (&sp, 0x55, sizeof (sp));
+
+	vbi_sampling_par_from_services (&sp, /* &max_rate */ NULL,
+					VBI_VIDEOSTD_SET_625_50,
+					VBI_SLICED_TELETEXT_B_625 |
+					VBI_SLICED_CAPTION_625 |
+					VBI_SLICED_WSS_625);
+
+	in_lines = create_raw (&raw, &in, &sp, ttx_wss_cc_625,
+			       /* pixel_mask */ 0, /* raw_flags */ 0);
+
+	frame_size = (sp.count[0] + sp.count[1]) * sp.bytes_per_line;
+	blank = (uint8_t *) calloc (1, frame_size);
+	assert (NULL != blank);
+
+	rd1 = create_decoder (&sp, ttx_wss_cc_625, /* strict */ 1);
+
+	for (i = 0; i < 300; ++i) {
+		n = vbi3_raw_decoder_decode (rd1, out, 50, raw);
+		assert (n == in_lines);
+	}
+
+	/* Data lines are not predicted as blank after
+	   a few seconds of silence. */
+	for (i = 0; i < 25 * 10; ++i)
+		assert (0 == vbi3_raw_decoder_decode (rd1, out, 50, blank));
+
+	n = vbi3_raw_decoder_decode (rd1, out, 50, raw);
+	assert (n == in_lines);
+
+	size = vbi3_raw_decoder_save_prediction (rd1, NULL, 0);
+	assert (size > 0);
+	assert (0 == vbi3_raw_decoder_save_prediction (rd1, out, 1));
+
+	buffer1 = (uint8_t *) malloc (size);
+	buffer2 = (uint8_t *) malloc (size);
+	assert (NULL != buffer1 && NULL != buffer2);
+
+	assert (size == vbi3_raw_decoder_save_prediction (rd1, buffer1, size));
+
+	rd2 = create_decoder (&sp, ttx_wss_cc_625, /* strict */ 1);
+	assert (vbi3_raw_decoder_load_prediction (rd2, buffer1, size));
+	assert (size == vbi3_raw_decoder_save_prediction (rd2, buffer2, size));
+	assert (0 == memcmp (buffer1, buffer2, size));
+	assert (!vbi3_raw_decoder_load_prediction (rd2, buffer1, size - 1));
+
+	/* Different services. */
+	vbi3_raw_decoder_remove_services (rd2, VBI_SLICED_WSS_625);
+	assert (!vbi3_raw_decoder_load_prediction (rd2, buffer1, size));
+	vbi3_raw_decoder_delete (rd2);
+
+	/* After a long silence lines are predicted as blank,
+	   but still probed once in 16 frames. */
+	for (i = 0; i < 256 * 16 + 16; ++i)
+		assert (0 == vbi3_raw_decoder_decode (rd1, out, 50, blank));
+
+	/* The expired state can be restored. */
+	assert (size == vbi3_raw_decoder_save_prediction (rd1, buffer1, size));
+	rd2 = create_decoder (&sp, ttx_wss_cc_625, /* strict */ 1);
+	assert (vbi3_raw_decoder_load_prediction (rd2, buffer1, size));
+	assert (size == vbi3_raw_decoder_save_prediction (rd2, buffer2, size));
+	assert (0 == memcmp (buffer1, buffer2, size));
+	vbi3_raw_decoder_delete (rd2);
+
+	n = vbi3_raw_decoder_decode (rd1, out, 50, raw);
+	assert (n < in_lines);
+
+	for (i = 0; i < 16 && n < in_lines; ++i)
+		n = vbi3_raw_decoder_decode (rd1, out, 50, raw);
+	assert (n == in_lines);
+
+	vbi3_raw_decoder_delete (rd1);
+
+	free (buffer2);
+	free (buffer1);
+	free (blank);
+	free (in);
+	free (raw);
+}
+
+static void
+test_quality			(void)
+{
+	static const vbi_service_set services[] = {
+		VBI_SLICED_TELETEXT_B_625,
+		VBI_SLICED_CAPTION_625,
+		VBI_SLICED_WSS_625
+	};
+	vbi_sampling_par sp;
+	vbi3_raw_decoder_quality q;
+	vbi_sliced *in;
+	vbi_sliced out[50];
+	uint8_t *raw;
+	uint8_t *blank;
+	vbi3_raw_decoder *rd;
+	unsigned int in_lines;
+	unsigned int decoded;
+	unsigned int n_errors[3];
+	unsigned int i, j;
+
+	memset (&sp, 0x55, sizeof (sp));
+
+	vbi_sampling_par_from_services (&sp, /* &max_rate */ NULL,
+					VBI_VIDEOSTD_SET_625_50,
+					VBI_SLICED_TELETEXT_B_625 |
+					VBI_SLICED_CAPTION_625 |
+					VBI_SLICED_WSS_625);
+
+	in_lines = create_raw (&raw, &in, &sp, ttx_wss_cc_625,
+			       /* pixel_mask */ 0, /* raw_flags */ 0);
+
+	blank = (uint8_t *) calloc (1, (sp.count[0] + sp.count[1])
+				    * sp.bytes_per_line);
+	assert (NULL != blank);
+
+	rd = create_decoder (&sp, ttx_wss_cc_625, /* strict */ 1);
+
+	assert (!vbi3_raw_decoder_line_quality (rd, &q, sp.count[0]
+						+ sp.count[1]));
+
+	for (i = 0; i < 10; ++i)
+		assert (in_lines == vbi3_raw_decoder_decode (rd, out, 50, raw));
+
+	/* The payload is random, count the expected errors. */
+	memset (n_errors, 0, sizeof (n_errors));
+
+	for (i = 0; i < in_lines; ++i) {
+		const uint8_t *d = out[i].data;
+
+		if (out[i].id & VBI_SLICED_TELETEXT_B)
+			n_errors[0] += (vbi_unham16p (d) < 0);
+		else if (out[i].id & VBI_SLICED_CAPTION_625)
+			n_errors[1] += (vbi_unpar8 (d[0]) < 0
+					|| vbi_unpar8 (d[1]) < 0);
+		else if (out[i].id & VBI_SLICED_WSS_625)
+			n_errors[2] += !(0x6996 & (1 << (d[0] & 15)));
+	}
+
+	decoded = 0;
+
+	for (j = 0; j < N_ELEMENTS (services); ++j) {
+		unsigned int n_lines = 0;
+
+		for (i = 0; i < in_lines; ++i)
+			n_lines += !!(out[i].id & services[j]);
+
+		vbi3_raw_decoder_service_quality (rd, &q, services[j]);
+		assert (q.decoded == 10 * n_lines);
+		assert (q.cri_matches == q.decoded);
+		assert (q.attempts >= q.decoded);
+		assert (0 == q.frc_errors);
+		assert (q.parity_errors == 10 * n_errors[j]);
+		assert (q.thresh > 16 && q.thresh < 240);
+		if (VBI_SLICED_WSS_625 == services[j])
+			assert (0 == q.eye_opening);
+		else
+			assert (q.eye_opening > 24);
+
+		decoded += q.decoded;
+	}
+
+	for (i = 0; i < (unsigned int)(sp.count[0] + sp.count[1]); ++i) {
+		assert (vbi3_raw_decoder_line_quality (rd, &q, i));
+		assert (q.decoded <= 10);
+		decoded -= q.decoded;
+	}
+
+	assert (0 == decoded);
+
+	/* Lines without data. */
+	vbi3_raw_decoder_service_quality (rd, &q, VBI_SLICED_TELETEXT_B_625);
+	decoded = q.decoded;
+	i = q.attempts;
+
+	assert (0 == vbi3_raw_decoder_decode (rd, out, 50, blank));
+
+	vbi3_raw_decoder_service_quality (rd, &q, VBI_SLICED_TELETEXT_B_625);
+	assert (q.decoded == decoded);
+	assert (q.attempts > i);
+
+	vbi3_raw_decoder_reset_quality (rd);
+	vbi3_raw_decoder_service_quality (rd, &q, ~0);
+	assert (0 == q.attempts && 0 == q.decoded);
+
+	vbi3_raw_decoder_delete (rd);
+
+	free (blank);
+	free (in);
+	free (raw);
+}
+
+static void
+test_min_amplitude		(void)
+{
+	const _vbi_service_par *par;
+	vbi_sampling_par sp;
+	vbi_sliced sliced;
+	vbi3_bit_slicer *bs;
+	uint8_t buffer[2];
+	uint8_t *raw;
+	unsigned int samples_per_line;
+	unsigned int min;
+	unsigned int i;
+
+	for (par = _vbi_service_table; par->id; ++par)
+		if (VBI_SLICED_CAPTION_625_F1 == par->id)
+			break;
+	assert (0 != par->id);
+	assert (par->min_amplitude > 0);
+
+	memset (&sp, 0, sizeof (sp));
+
+	samples_per_line = 720;
+
+#if 2 == VBI_VERSION_MINOR
+	sp.scanning		= 625;
+	sp.sampling_format	= VBI_PIXFMT_YUV420;
+#else
+	sp.videostd_set		= VBI_VIDEOSTD_SET_PAL_BG;
+	sp.sample_format	= VBI_PIXFMT_Y8;
+	sp.samples_per_line	= samples_per_line;
+#endif
+	sp.sampling_rate	= 13500000;
+	sp.bytes_per_line	= samples_per_line;
+	sp.offset		= (int)(9.7e-6 * sp.sampling_rate);
+	sp.start[0]		= 22;
+	sp.count[0]		= 1;
+	sp.synchronous		= TRUE;
+
+	raw = (uint8_t *) xmalloc (samples_per_line);
+
+	sliced.id = VBI_SLICED_CAPTION_625;
+	sliced.line = 22;
+	sliced.data[0] = 0x15;
+	sliced.data[1] = 0x2A;
+
+	assert (_vbi_raw_vbi_image (raw, samples_per_line, &sp,
+				    /* blank_level */ 0,
+				    /* white_level */ 0,
+				    /* flags */ 0,
+				    &sliced, 1));
+
+	bs = vbi3_bit_slicer_new ();
+	assert (NULL != bs);
+
+	assert (vbi3_bit_slicer_set_params
+		(bs, VBI_PIXFMT_YUV420,
+		 sp.sampling_rate,
+		 /* sample_offset */ 0,
+		 samples_per_line,
+		 par->cri_frc >> par->frc_bits,
+		 par->cri_frc_mask >> par->frc_bits,
+		 par->cri_bits,
+		 par->cri_rate,
+		 /* cri_end */ ~0,
+		 (par->cri_frc & ((1U << par->frc_bits) - 1)),
+		 par->frc_bits,
+		 par->payload,
+		 par->bit_rate,
+		 (vbi3_modulation) par->modulation));
+
+	vbi3_bit_slicer_set_min_amplitude (bs, par->min_amplitude);
+
+	/* A regular signal passes. */
+	assert (vbi3_bit_slicer_slice (bs, buffer, sizeof (buffer), raw));
+	assert (0 == memcmp (buffer, sliced.data, sizeof (buffer)));
+
+	/* A weak signal does not. */
+	min = 255;
+	for (i = 0; i < samples_per_line; ++i)
+		min = MIN (min, (unsigned int) raw[i]);
+	for (i = 0; i < samples_per_line; ++i)
+		raw[i] = min + (raw[i] - min) * (par->min_amplitude - 1) / 255;
+
+	i = bs->n_cri_matches;
+	assert (!vbi3_bit_slicer_slice (bs, buffer, sizeof (buffer), raw));
+	assert (i == bs->n_cri_matches);
+
+	/* Nor a blank line. */
+	memset (raw, min, samples_per_line);
+	assert (!vbi3_bit_slicer_slice (bs, buffer, sizeof (buffer), raw));
+	assert (i == bs->n_cri_matches);
+
+	vbi3_bit_slicer_delete (bs);
+
+	free (raw);
+}
+
+static void
+test_slicer_pair		(vbi3_bit_slicer *	bs,
+				 vbi3_bit_slicer *	ref,
+				 const uint8_t *	raw,
+				 const uint8_t *	ref_raw)
+{
+	vbi3_bit_slicer_point points[512];
+	unsigned int n_points;
+	uint8_t buffer1[64];
+	uint8_t buffer2[64];
+	vbi_bool r1, r2;
+
+	memset (buffer1, 0x55, sizeof (buffer1));
+	memset (buffer2, 0x55, sizeof (buffer2));
+
+	r1 = vbi3_bit_slicer_slice (bs, buffer1, sizeof (buffer1), raw);
+
+	/* Always uses the C bit slicer. */
+	r2 = vbi3_bit_slicer_slice_with_points (ref, buffer2,
+						sizeof (buffer2),
+						points, &n_points,
+						N_ELEMENTS (points),
+						ref_raw);
+
+	assert (r1 == r2);
+	assert (bs->thresh == ref->thresh);
+	assert (0 == memcmp (buffer1, buffer2, sizeof (buffer1)));
+}
+
+/* The SIMD bit slicers must give the same results as the C version,
+   including the adapted 0/1 threshold. */
+static void
+test_bit_slicer_simd		(void)
+{
+	static const unsigned int rates [] = {
+		35468950, 27000000, 13500000
+	};
+	const _vbi_service_par *par;
+	unsigned int i;
+
+	for (par = _vbi_service_table; par->id; ++par)
+		if (VBI_SLICED_TELETEXT_B_625 & par->id)
+			break;
+	assert (0 != par->id);
+
+	for (i = 0; i < N_ELEMENTS (rates); ++i) {
+		vbi_sampling_par sp;
+		vbi_sliced sliced[17];
+		vbi3_bit_slicer *bs[3];
+		vbi_pixfmt y8;
+		unsigned int samples_per_line;
+		unsigned int scan_lines;
+		uint8_t *raw;
+		uint8_t *yuyv;
+		unsigned int j, k;
+
+		memset (&sp, 0, sizeof (sp));
+
+		samples_per_line = (unsigned int)(rates[i] * 62e-6);
+
+#if 2 == VBI_VERSION_MINOR
+		y8 = VBI_PIXFMT_YUV420;
+		sp.scanning		= 625;
+		sp.sampling_format	= y8;
+#else
+		y8 = VBI_PIXFMT_Y8;
+		sp.videostd_set		= VBI_VIDEOSTD_SET_PAL_BG;
+		sp.sample_format	= y8;
+		sp.samples_per_line	= samples_per_line;
+#endif
+		sp.sampling_rate	= rates[i];
+		sp.bytes_per_line	= samples_per_line;
+		sp.offset		= (int)(9.7e-6 * sp.sampling_rate);
+		sp.start[0]		= 6;
+		sp.count[0]		= 17;
+		sp.synchronous		= TRUE;
+
+		scan_lines = sp.count[0];
+
+		raw = (uint8_t *) xmalloc (samples_per_line * scan_lines);
+		yuyv = (uint8_t *) xmalloc (samples_per_line * 2);
+
+		/* Every other line carries data. */
+		for (j = 0; j < scan_lines / 2; ++j) {
+			sliced[j].id = par->id;
+			sliced[j].line = sp.start[0] + j * 2;
+			memset_rand (sliced[j].data, sizeof (sliced[j].data));
+		}
+
+		for (j = 0; j < 3; ++j) {
+			bs[j] = vbi3_bit_slicer_new ();
+			assert (NULL != bs[j]);
+
+			assert (vbi3_bit_slicer_set_params
+				(bs[j],
+				 (1 == j) ? VBI_PIXFMT_YUYV : y8,
+				 sp.sampling_rate,
+				 /* sample_offset */ 0,
+				 samples_per_line,
+				 par->cri_frc >> par->frc_bits,
+				 par->cri_frc_mask >> par->frc_bits,
+				 par->cri_bits,
+				 par->cri_rate,
+				 /* cri_end */ ~0,
+				 (par->cri_frc & ((1U << par->frc_bits) - 1)),
+				 par->frc_bits,
+				 par->payload,
+				 par->bit_rate,
+				 (vbi3_modulation) par->modulation));
+		}
+
+		for (k = 0; k < 40; ++k) {
+			assert (_vbi_raw_vbi_image (raw,
+						    samples_per_line
+						    * scan_lines, &sp,
+						    /* blank_level */ 0,
+						    /* white_level */ 0,
+						    /* flags */ 0,
+						    sliced, scan_lines / 2));
+
+			if (k >= 10) {
+				assert (vbi_raw_add_noise
+					(raw, &sp,
+					 /* min_freq */ 0,
+					 /* max_freq */ 5000000,
+					 /* amplitude */ 10 + k,
+					 /* seed */ k));
+			}
+
+			if (k >= 30)
+				memset_rand (raw, samples_per_line * 4);
+
+			for (j = 0; j < scan_lines; ++j) {
+				const uint8_t *line;
+				unsigned int l;
+
+				line = raw + j * samples_per_line;
+
+				memset_rand (yuyv, samples_per_line * 2);
+				for (l = 0; l < samples_per_line; ++l)
+					yuyv[l * 2] = line[l];
+
+				test_slicer_pair (bs[0], bs[2], line, line);
+
+				/* Restore the threshold of the reference. */
+				bs[2]->thresh = bs[1]->thresh;
+				test_slicer_pair (bs[1], bs[2], yuyv, line);
+				bs[2]->thresh = bs[0]->thresh;
+			}
+		}
+
+		for (j = 0; j < 3; ++j)
+			vbi3_bit_slicer_delete (bs[j]);
+
+		free (yuyv);
+		free (raw);
+	}
+}
+
 int
 main				(int			argc,
 				 char **		argv)
@@ -837,6 +1568,18 @@ main				(int			argc,
 
 	test_services ();
 
+	test_bit_slicer_simd ();
+
+	test_threads (/* interlaced */ FALSE);
+	test_threads (/* interlaced */ TRUE);
+	test_batch (/* interlaced */ FALSE);
+	test_batch (/* interlaced */ TRUE);
+	test_view (/* interlaced */ FALSE);
+	test_view (/* interlaced */ TRUE);
+	test_prediction ();
+	test_quality ();
+	test_min_amplitude ();
+
 	test_line_order (/* synchronous */ TRUE);
 	test_line_order (/* synchronous */ FALSE);
 
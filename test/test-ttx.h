@@ -0,0 +1,216 @@
+/*
+ *  libzvbi -- Teletext decoder unit test helpers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+/* $Id$ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "src/libzvbi.h"
+
+static void
+event_handler			(vbi_event *		ev,
+				 void *			user_data)
+{
+	ev = ev; /* unused */
+	user_data = user_data;
+}
+
+class ttx_stream {
+public:
+	/* The Teletext decoder ignores pages nobody listens to. */
+	ttx_stream ()
+	  { vbi = vbi_decoder_new (); assert (NULL != vbi);
+	    assert (vbi_event_handler_register
+		    (vbi, VBI_EVENT_TTX_PAGE, event_handler, NULL));
+	    md = NULL; stream_id = 0; time = 0.0; }
+	/* A stream of a multi-stream decoder, which owns its decoder. */
+	ttx_stream (vbi_multi_decoder *md, unsigned int stream_id)
+	  { vbi = vbi_multi_decoder_add_stream (md, stream_id);
+	    assert (NULL != vbi);
+	    assert (vbi_event_handler_register
+		    (vbi, VBI_EVENT_TTX_PAGE, event_handler, NULL));
+	    this->md = md; this->stream_id = stream_id; time = 0.0; }
+	~ttx_stream ()
+	  { if (NULL == md) vbi_decoder_delete (vbi); }
+
+	void
+	page			(vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 const char *		text);
+	void
+	row			(vbi_pgno		pgno,
+				 unsigned int		row,
+				 const char *		text);
+	void
+	raw_row			(vbi_pgno		pgno,
+				 unsigned int		row,
+				 const uint8_t		data[40]);
+	void
+	flush			(void);
+
+	vbi_decoder *		vbi;
+
+private:
+	void
+	packet			(unsigned int		magazine,
+				 unsigned int		packet,
+				 const uint8_t		data[40]);
+
+	vbi_multi_decoder *	md;
+	unsigned int		stream_id;
+	double			time;
+};
+
+void
+ttx_stream::packet		(unsigned int		magazine,
+				 unsigned int		packet,
+				 const uint8_t		data[40])
+{
+	vbi_sliced sliced;
+
+	memset (&sliced, 0, sizeof (sliced));
+
+	sliced.id = VBI_SLICED_TELETEXT_B;
+	sliced.line = 7;
+
+	sliced.data[0] = vbi_ham8 ((magazine & 7) | ((packet & 1) << 3));
+	sliced.data[1] = vbi_ham8 (packet >> 1);
+	memcpy (sliced.data + 2, data, 40);
+
+	if (NULL != md)
+		assert (vbi_multi_decode (md, stream_id, &sliced, 1, time));
+	else
+		vbi_decode (vbi, &sliced, 1, time);
+
+	time += 0.04;
+}
+
+/* Transmits a page with text on row 1, in parallel mode. The decoder
+   stores the page when the next page header of the magazine arrives. */
+void
+ttx_stream::page		(vbi_pgno		pgno,
+				 vbi_subno		subno,
+				 const char *		text)
+{
+	uint8_t data[40];
+	unsigned int magazine = pgno >> 8;
+	unsigned int i;
+
+	data[0] = vbi_ham8 (pgno);
+	data[1] = vbi_ham8 (pgno >> 4);
+	data[2] = vbi_ham8 (subno);
+	data[3] = vbi_ham8 ((subno >> 4) & 7);
+	data[4] = vbi_ham8 (subno >> 8);
+	data[5] = vbi_ham8 ((subno >> 12) & 3);
+	data[6] = vbi_ham8 (0);
+	data[7] = vbi_ham8 (0);
+
+	for (i = 8; i < 40; ++i)
+		data[i] = vbi_par8 ('0' + i % 10);
+
+	packet (magazine, 0, data);
+
+	row (pgno, 1, text);
+}
+
+/* Transmits another row of the page last transmitted in the
+   magazine. */
+void
+ttx_stream::row			(vbi_pgno		pgno,
+				 unsigned int		row,
+				 const char *		text)
+{
+	uint8_t data[40];
+	unsigned int i;
+
+	for (i = 0; i < 40; ++i)
+		data[i] = vbi_par8 (text[i % strlen (text)]);
+
+	packet (pgno >> 8, row, data);
+}
+
+/* Transmits another row of the page last transmitted in the
+   magazine, without parity. */
+void
+ttx_stream::raw_row		(vbi_pgno		pgno,
+				 unsigned int		row,
+				 const uint8_t		data[40])
+{
+	packet (pgno >> 8, row, data);
+}
+
+/* Terminates the last page of each magazine. */
+void
+ttx_stream::flush		(void)
+{
+	unsigned int i;
+
+	for (i = 1; i <= 8; ++i)
+		page ((i << 8) | 0xFF, 0x3F7F, " ");
+}
+
+static vbi_bool
+fetch				(vbi_page *		pg,
+				 vbi_decoder *		vbi,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno)
+{
+	return vbi_fetch_vt_page (vbi, pg, pgno, subno,
+				  VBI_WST_LEVEL_1p5, 25,
+				  /* navigation */ FALSE);
+}
+
+static unsigned int
+row_1_char			(vbi_decoder *		vbi,
+				 vbi_pgno		pgno,
+				 vbi_subno		subno)
+{
+	vbi_page pg;
+	unsigned int c;
+
+	assert (fetch (&pg, vbi, pgno, subno));
+	c = pg.text[1 * pg.columns + 0].unicode;
+	vbi_unref_page (&pg);
+
+	return c;
+}
+
+struct page_events {
+	unsigned int		count;
+	unsigned int		dirty_rows;
+	vbi_decoder *		vbi;
+};
+
+static void
+count_handler			(vbi_event *		ev,
+				 void *			user_data)
+{
+	struct page_events *pe = (struct page_events *) user_data;
+
+	++pe->count;
+	pe->dirty_rows = ev->ev.ttx_page.dirty_rows;
+}
+
+/*
+Local variables:
+c-set-style: K&R
+c-basic-offset: 8
+End:
+*/